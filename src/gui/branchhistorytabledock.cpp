@@ -6,7 +6,7 @@
 #include "branchhistorytabledock.h"
 #include "branchhistorytabletableview.h"
 
-BranchHistoryTableDock::BranchHistoryTableDock(QWidget *parent) : Super(parent) {
+BranchHistoryTableDock::BranchHistoryTableDock(QWidget *parent) : Super(parent), machine(nullptr) {
     setObjectName("Branch History Table");
     setWindowTitle("Branch History Table");
 
@@ -30,6 +30,10 @@ BranchHistoryTableDock::BranchHistoryTableDock(QWidget *parent) : Super(parent)
     bht_index_val = new QLineEdit();
     QLabel *accuracy = new QLabel("Accuracy");
     accuracy_val = new QLineEdit("0.0%");
+    QLabel *flush_cycles = new QLabel("Flush Cycles");
+    flush_cycles_val = new QLineEdit("0");
+    QLabel *providers = new QLabel("Components");
+    providers_val = new QLineEdit();
 
     bht_entries_val->setReadOnly(true);
     history_bits_val->setReadOnly(true);
@@ -39,6 +43,8 @@ BranchHistoryTableDock::BranchHistoryTableDock(QWidget *parent) : Super(parent)
     addr_val->setReadOnly(true);
     bht_index_val->setReadOnly(true);
     accuracy_val->setReadOnly(true);
+    flush_cycles_val->setReadOnly(true);
+    providers_val->setReadOnly(true);
 
     hlayout_top->addWidget(bht_entries);
     hlayout_top->addWidget(bht_entries_val);
@@ -53,6 +59,10 @@ BranchHistoryTableDock::BranchHistoryTableDock(QWidget *parent) : Super(parent)
     vlayout_mid->addWidget(bht_index_val);
     vlayout_mid->addWidget(accuracy);
     vlayout_mid->addWidget(accuracy_val);
+    vlayout_mid->addWidget(flush_cycles);
+    vlayout_mid->addWidget(flush_cycles_val);
+    vlayout_mid->addWidget(providers);
+    vlayout_mid->addWidget(providers_val);
 
     vlayout->addLayout(hlayout_top);
     vlayout->addLayout(vlayout_mid);
@@ -104,6 +114,15 @@ void BranchHistoryTableDock::setup(machine::QtMipsMachine *machine) {
             case machine::MachineConfig::CHU_TWO_BIT_BP:
                 text = "Two Bit";
                 break;
+            case machine::MachineConfig::CHU_GSHARE_BP:
+                text = "Gshare";
+                break;
+            case machine::MachineConfig::CHU_TOURNAMENT_BP:
+                text = "Tournament";
+                break;
+            case machine::MachineConfig::CHU_TAGE_BP:
+                text = "TAGE";
+                break;
             default:
                 SANITY_ASSERT(0, "Debug me.");
         }
@@ -143,9 +162,35 @@ void BranchHistoryTableDock::update_bht_index_val(std::uint32_t inst_addr) {
         set_qline_val(bht_index_val, "Not Set");
 }
 
+void BranchHistoryTableDock::refresh() {
+    auto *pmodel = qobject_cast<BranchHistoryTableModel *>(predictor_content->model());
+
+    if (machine == nullptr || pmodel == nullptr)
+        return;
+    pmodel->refresh();
+    update_accuracy_val(machine->bp()->accuracy());
+}
+
 void BranchHistoryTableDock::update_accuracy_val(double acc) {
     if (machine)
         set_qline_val(accuracy_val, QString::number(acc) + "%");
     else
         set_qline_val(accuracy_val, "Not Set");
+    update_stats_val();
+}
+
+void BranchHistoryTableDock::update_stats_val() {
+    QStringList providers;
+
+    if (machine == nullptr) {
+        set_qline_val(flush_cycles_val, "Not Set");
+        set_qline_val(providers_val, "Not Set");
+        return;
+    }
+    const machine::BranchPredictor *bp = machine->bp();
+    set_qline_val(flush_cycles_val, QString::number(bp->flush_cycles()));
+    for (int i = 0; i < bp->providers(); i++)
+        providers.append(QString("%1 %2% of %3").arg(bp->provider_name(i))
+                         .arg(bp->provider_accuracy(i), 0, 'f', 1).arg(bp->provider_predictions(i)));
+    set_qline_val(providers_val, providers.isEmpty() ? "-" : providers.join(", "));
 }
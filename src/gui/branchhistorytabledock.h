@@ -23,6 +23,10 @@ public slots:
     void update_instr_val(const machine::Instruction &instr);
     void update_bht_index_val(uint32_t inst_addr);
     void update_accuracy_val(double acc);
+    void refresh();
+
+private:
+    void update_stats_val();
 
 private:
     QTableView *predictor_content;
@@ -33,6 +37,8 @@ private:
     QLineEdit *instr_val;
     QLineEdit *bht_index_val;
     QLineEdit *accuracy_val;
+    QLineEdit *flush_cycles_val;
+    QLineEdit *providers_val;
     machine::QtMipsMachine *machine;
 };
 
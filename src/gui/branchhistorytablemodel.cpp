@@ -156,6 +156,10 @@ void BranchHistoryTableModel::setup(machine::QtMipsMachine *machine) {
     this->machine = machine;
 }
 
+void BranchHistoryTableModel::refresh() {
+    emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
+}
+
 void BranchHistoryTableModel::update_pos_bht_update(std::int32_t pbu) {
     this->pos_bht_update = pbu;
     emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
@@ -25,6 +25,7 @@ public slots:
     void setup(machine::QtMipsMachine *machine);
     void update_pos_bht_update(int32_t pbu);
     void update_pos_bht_access(int32_t pba);
+    void refresh();
 
 private:
     QFont data_font;
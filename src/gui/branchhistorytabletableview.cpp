@@ -73,6 +73,9 @@ void BranchPredictorTableView::setModel(QAbstractItemModel *model) {
                 items.append("T");
                 break;
             case machine::MachineConfig::CHU_TWO_BIT_BP:
+            case machine::MachineConfig::CHU_GSHARE_BP:
+            case machine::MachineConfig::CHU_TOURNAMENT_BP:
+            case machine::MachineConfig::CHU_TAGE_BP:
                 items.append("STRONGLY_NT");
                 items.append("WEAKLY_NT");
                 items.append("WEAKLY_T");
@@ -2,21 +2,65 @@
 #include "branchtargetbuffermodel.h"
 #include "branchpredictor.h"
 #include "branchtargetbuffer.h"
+#include "returnaddressstack.h"
+#include <QLabel>
 
-BranchTargetBufferDock::BranchTargetBufferDock(QWidget *parent) : Super(parent) {
+BranchTargetBufferDock::BranchTargetBufferDock(QWidget *parent) : Super(parent), machine(nullptr) {
     QWidget *content = new QWidget();
+    QVBoxLayout *vlayout = new QVBoxLayout();
+    QHBoxLayout *hlayout_top = new QHBoxLayout();
     layout = new QHBoxLayout();
     btb_content = new BranchTargetBufferTableView(this);
 
+    QLabel *btb_hits = new QLabel("BTB Hits");
+    btb_hits_val = new QLineEdit("Not Set");
+    QLabel *ras_hits = new QLabel("RAS Hits");
+    ras_hits_val = new QLineEdit("Not Set");
+    btb_hits_val->setReadOnly(true);
+    ras_hits_val->setReadOnly(true);
+
     setObjectName("Branch Target Buffer");
     setWindowTitle("Branch Target Buffer");
+    hlayout_top->addWidget(btb_hits);
+    hlayout_top->addWidget(btb_hits_val);
+    hlayout_top->addWidget(ras_hits);
+    hlayout_top->addWidget(ras_hits_val);
     layout->addWidget(btb_content);
-    content->setLayout(layout);
+    vlayout->addLayout(hlayout_top);
+    vlayout->addLayout(layout);
+    content->setLayout(vlayout);
     setWidget(content);
 }
 
+static QString hits_text(std::uint64_t hits, std::uint64_t lookups, double rate) {
+    return QString("%1 / %2 (%3%)").arg(hits).arg(lookups).arg(rate, 0, 'f', 1);
+}
+
+static QString saved_text(std::uint64_t cycles) {
+    return QString(", %1 cycles saved").arg(cycles);
+}
+
+void BranchTargetBufferDock::refresh() {
+    auto *btb_model = qobject_cast<BranchTargetBufferModel *>(btb_content->model());
+
+    if (btb_model != nullptr)
+        btb_model->refresh();
+    if (machine == nullptr) {
+        btb_hits_val->setText("Not Set");
+        ras_hits_val->setText("Not Set");
+        return;
+    }
+    const machine::BranchTargetBuffer *btb = machine->bp()->btb();
+    const machine::ReturnAddressStack *ras = machine->bp()->ras();
+    btb_hits_val->setText(hits_text(btb->hits(), btb->lookups(), btb->hit_rate())
+                          + saved_text(machine->bp()->btb_saved_cycles()));
+    ras_hits_val->setText(ras != nullptr ? hits_text(ras->hits(), ras->predictions(), ras->hit_rate())
+                          + saved_text(machine->bp()->ras_saved_cycles()) : "Disabled");
+}
+
 void BranchTargetBufferDock::setup(machine::QtMipsMachine *machine) {
     BranchTargetBufferModel *btb_model = new BranchTargetBufferModel(this);
+    this->machine = machine;
     btb_model->setup(machine);
     btb_content->setModel(btb_model);
     layout->update();
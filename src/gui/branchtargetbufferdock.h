@@ -4,6 +4,7 @@
 #include <QDockWidget>
 #include <QTableView>
 #include <QHBoxLayout>
+#include <QLineEdit>
 #include <qtmipsmachine.h>
 #include "branchtargetbuffertableview.h"
 
@@ -16,9 +17,16 @@ public:
     BranchTargetBufferDock(QWidget *parent);
 
     void setup(machine::QtMipsMachine *machine);
+
+public slots:
+    void refresh();
+
 private:
     QTableView *btb_content;
     QHBoxLayout *layout;
+    QLineEdit *btb_hits_val;
+    QLineEdit *ras_hits_val;
+    machine::QtMipsMachine *machine;
 };
 
 #endif // BRANCHTARGETBUFFERDOCK_H
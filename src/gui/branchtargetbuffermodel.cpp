@@ -1,5 +1,6 @@
 #include "branchtargetbuffermodel.h"
 #include "branchpredictor.h"
+#include "branchtargetbuffer.h"
 #include <QBrush>
 #include <QColor>
 #include <cmath>
@@ -9,7 +10,7 @@ BranchTargetBufferModel::BranchTargetBufferModel(QObject *parent) : Super(parent
 }
 
 int BranchTargetBufferModel::rowCount(const QModelIndex & /*index*/) const {
-    return pow(2, (machine ? machine->config().bht_bits() : 0));
+    return machine ? machine->bp()->btb()->entries() : 1;
 }
 
 int BranchTargetBufferModel::columnCount(const QModelIndex & /* parent */) const {
@@ -108,6 +109,10 @@ void BranchTargetBufferModel::setup(machine::QtMipsMachine *machine) {
     this->machine = machine;
 }
 
+void BranchTargetBufferModel::refresh() {
+    emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
+}
+
 void BranchTargetBufferModel::update_pos_btb_update(std::int32_t pbu) {
     this->pos_btb_update = pbu;
     emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
@@ -23,6 +23,7 @@ public slots:
     void setup(machine::QtMipsMachine *machine);
     void update_pos_btb_update(std::int32_t pbu);
     void update_pos_btb_access(std::int32_t pba);
+    void refresh();
 
 private:
     QFont data_font;
@@ -34,6 +34,7 @@
  ******************************************************************************/
 
 #include "cachedock.h"
+#include "writebuffer.h"
 
 CacheDock::CacheDock(QWidget *parent, const QString &type) : QDockWidget(parent) {
     top_widget = new QWidget(this);
@@ -59,11 +60,16 @@ CacheDock::CacheDock(QWidget *parent, const QString &type) : QDockWidget(parent)
     layout_top_form->addRow("Hit rate:", l_hit_rate);
     l_speed  = new QLabel("100%", top_form);
     layout_top_form->addRow("Improved speed:", l_speed);
+    l_prefetch = new QLabel("None", top_form);
+    layout_top_form->addRow("Prefetches:", l_prefetch);
+    l_write_buffer = new QLabel("None", top_form);
+    layout_top_form->addRow("Write buffer:", l_write_buffer);
 
     graphicsview = new GraphicsView(top_widget);
     graphicsview->setVisible(false);
     layout_box->addWidget(graphicsview);
     cachescene = nullptr;
+    cache = nullptr;
 
     no_cache = new QLabel("No " + type + " Cache configured", top_widget);
     layout_box->addWidget(no_cache);
@@ -82,14 +88,23 @@ void CacheDock::setup(const machine::Cache *cache) {
     l_m_writes->setText("0");
     l_hit_rate->setText("0.000%");
     l_speed->setText("100%");
+    l_prefetch->setText(cache != nullptr && cache->config().prefetcher() !=
+                        machine::MachineConfigCache::PF_NONE ? "0" : "None");
+    l_write_buffer->setText("None");
+    if (cache != nullptr && cache->write_buffer() != nullptr)
+        write_buffer_update(0, 0, 0);
     if (cache != nullptr) {
-        connect(cache, SIGNAL(hit_update(std::uint32_t)), this, SLOT(hit_update(std::uint32_t)));
-        connect(cache, SIGNAL(miss_update(std::uint32_t)), this, SLOT(miss_update(std::uint32_t)));
-        connect(cache, SIGNAL(memory_reads_update(std::uint32_t)), this, SLOT(lower_memory_reads_update(std::uint32_t)));
-        connect(cache, SIGNAL(memory_writes_update(std::uint32_t)), this, SLOT(lower_memory_writes_update(std::uint32_t)));
-        connect(cache, SIGNAL(level2_cache_reads_update(std::uint32_t)), this, SLOT(lower_memory_reads_update(std::uint32_t)));
-        connect(cache, SIGNAL(level2_cache_writes_update(std::uint32_t)), this, SLOT(lower_memory_writes_update(std::uint32_t)));
-        connect(cache, SIGNAL(statistics_update(std::uint32_t,double,double)), this, SLOT(statistics_update(std::uint32_t,double,double)));
+        connect(cache, SIGNAL(hit_update(std::uint64_t)), this, SLOT(hit_update(std::uint64_t)));
+        connect(cache, SIGNAL(miss_update(std::uint64_t)), this, SLOT(miss_update(std::uint64_t)));
+        connect(cache, SIGNAL(memory_reads_update(std::uint64_t)), this, SLOT(lower_memory_reads_update(std::uint64_t)));
+        connect(cache, SIGNAL(memory_writes_update(std::uint64_t)), this, SLOT(lower_memory_writes_update(std::uint64_t)));
+        connect(cache, SIGNAL(level2_cache_reads_update(std::uint64_t)), this, SLOT(lower_memory_reads_update(std::uint64_t)));
+        connect(cache, SIGNAL(level2_cache_writes_update(std::uint64_t)), this, SLOT(lower_memory_writes_update(std::uint64_t)));
+        connect(cache, SIGNAL(statistics_update(std::uint64_t,double,double)), this, SLOT(statistics_update(std::uint64_t,double,double)));
+        connect(cache, SIGNAL(prefetch_update(std::uint64_t,double,double,double)),
+                this, SLOT(prefetch_update(std::uint64_t,double,double,double)));
+        connect(cache, SIGNAL(write_buffer_update(std::uint64_t,std::uint64_t,std::uint64_t)),
+                this, SLOT(write_buffer_update(std::uint64_t,std::uint64_t,std::uint64_t)));
     }
     top_form->setVisible(cache != nullptr);
     no_cache->setVisible(!cache->config().enabled());
@@ -101,24 +116,52 @@ void CacheDock::setup(const machine::Cache *cache) {
     graphicsview->setVisible(cache->config().enabled());
 }
 
-void CacheDock::hit_update(unsigned val) {
-    l_hit->setText(QString::number(val));
+void CacheDock::refresh() {
+    if (cache == nullptr || !cache->config().enabled())
+        return;
+    hit_update(cache->hit());
+    miss_update(cache->miss());
+    lower_memory_reads_update(cache->lower_reads());
+    lower_memory_writes_update(cache->lower_writes());
+    statistics_update(cache->stalled_cycles(), cache->speed_improvement(), cache->hit_rate());
+    if (cache->config().prefetcher() != machine::MachineConfigCache::PF_NONE)
+        prefetch_update(cache->prefetches(), cache->prefetch_accuracy(), cache->prefetch_coverage(),
+                        cache->prefetch_timeliness());
+    if (cache->write_buffer() != nullptr)
+        write_buffer_update(cache->write_buffer()->combined(), cache->write_buffer()->forwarded(),
+                            cache->write_buffer()->full_stalls());
+    if (cachescene != nullptr)
+        cachescene->refresh();
 }
 
-void CacheDock::miss_update(unsigned val) {
-    l_miss->setText(QString::number(val));
+void CacheDock::hit_update(std::uint64_t val) {
+    l_hit->setText(QString::number((qulonglong)val));
 }
 
-void CacheDock::lower_memory_reads_update(unsigned val) {
-    l_m_reads->setText(QString::number(val));
+void CacheDock::miss_update(std::uint64_t val) {
+    l_miss->setText(QString::number((qulonglong)val));
 }
 
-void CacheDock::lower_memory_writes_update(unsigned val) {
-    l_m_writes->setText(QString::number(val));
+void CacheDock::lower_memory_reads_update(std::uint64_t val) {
+    l_m_reads->setText(QString::number((qulonglong)val));
 }
 
-void CacheDock::statistics_update(unsigned stalled_cycles, double speed_improv, double hit_rate) {
-    l_stalled->setText(QString::number(stalled_cycles));
+void CacheDock::lower_memory_writes_update(std::uint64_t val) {
+    l_m_writes->setText(QString::number((qulonglong)val));
+}
+
+void CacheDock::statistics_update(std::uint64_t stalled_cycles, double speed_improv, double hit_rate) {
+    l_stalled->setText(QString::number((qulonglong)stalled_cycles));
     l_hit_rate->setText(QString::number(hit_rate, 'f', 3) + QString("%"));
     l_speed->setText(QString::number(speed_improv, 'f', 0) + QString("%"));
 }
+
+void CacheDock::prefetch_update(std::uint64_t prefetches, double accuracy, double coverage, double timeliness) {
+    l_prefetch->setText(QString("%1 (accuracy %2%, coverage %3%, timely %4%)").arg((qulonglong)prefetches)
+                        .arg(accuracy, 0, 'f', 1).arg(coverage, 0, 'f', 1).arg(timeliness, 0, 'f', 1));
+}
+
+void CacheDock::write_buffer_update(std::uint64_t combined, std::uint64_t forwarded, std::uint64_t full_stalls) {
+    l_write_buffer->setText(QString("%1 combined, %2 forwarded, %3 full").arg((qulonglong)combined)
+                            .arg((qulonglong)forwarded).arg((qulonglong)full_stalls));
+}
@@ -51,12 +51,17 @@ public:
 
     void setup(const machine::Cache *cache);
 
+public slots:
+    void refresh(); // Reload statistics and content, cache signals may have been blocked
+
 private slots:
-    void hit_update(std::uint32_t);
-    void miss_update(std::uint32_t);
-    void lower_memory_reads_update(std::uint32_t);
-    void lower_memory_writes_update(std::uint32_t);
-    void statistics_update(std::uint32_t stalled_cycles, double speed_improv, double hit_rate);
+    void hit_update(std::uint64_t);
+    void miss_update(std::uint64_t);
+    void lower_memory_reads_update(std::uint64_t);
+    void lower_memory_writes_update(std::uint64_t);
+    void statistics_update(std::uint64_t stalled_cycles, double speed_improv, double hit_rate);
+    void prefetch_update(std::uint64_t prefetches, double accuracy, double coverage, double timeliness);
+    void write_buffer_update(std::uint64_t combined, std::uint64_t forwarded, std::uint64_t full_stalls);
 
 private:
     QVBoxLayout *layout_box;
@@ -65,6 +70,8 @@ private:
     QLabel *l_hit, *l_miss, *l_stalled, *l_speed, *l_hit_rate;
     QLabel *no_cache;
     QLabel *l_m_reads, *l_m_writes;
+    QLabel *l_prefetch;
+    QLabel *l_write_buffer;
     GraphicsView *graphicsview;
     CacheViewScene *cachescene;
     const machine::Cache *cache;
@@ -153,6 +153,7 @@ void CacheAddressBlock::cache_update(unsigned associat, unsigned set, unsigned c
 
 
 CacheViewBlock::CacheViewBlock(const machine::Cache *cache, unsigned block , bool last) : QGraphicsObject(nullptr) {
+    this->cache = cache;
     islast = last;
     this->block = block;
     rows = cache->config().sets();
@@ -374,6 +375,26 @@ void CacheViewBlock::cache_update(unsigned associat, unsigned set, unsigned col,
     update();
 }
 
+void CacheViewBlock::refresh() {
+    for (unsigned set = 0; set < rows; set++) {
+        bool line_dirty;
+        std::uint32_t line_tag;
+        const std::uint32_t *line_data;
+        bool valid = cache->line(block, set, line_dirty, line_tag, line_data);
+
+        validity[set]->setText(valid ? "1" : "0");
+        if (dirty)
+            dirty[set]->setText(valid ? (line_dirty ? "1" : "0") : "");
+        tag[set]->setText(valid ? QString("0x") + QString("%1").arg(line_tag, 8, 16, QChar('0')).toUpper() : "");
+        for (unsigned i = 0; i < columns; i++)
+            data[set][i]->setText(valid ? QString("0x") + QString("%1").arg(line_data[i], 8, 16, QChar('0')).toUpper() : "");
+    }
+    // Last access is not known, nothing is highlighted
+    if (last_highlighted)
+        data[last_set][last_col]->setBrush(QBrush(QColor(0, 0, 0)));
+    last_highlighted = false;
+    update();
+}
 
 CacheViewScene::CacheViewScene(const machine::Cache *cache) {
     associativity = cache->config().associativity();
@@ -393,3 +414,8 @@ CacheViewScene::CacheViewScene(const machine::Cache *cache) {
 CacheViewScene::~CacheViewScene() {
     delete[] block;
 }
+
+void CacheViewScene::refresh() {
+    for (unsigned i = 0; i < associativity; i++)
+        block[i]->refresh();
+}
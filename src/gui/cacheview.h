@@ -73,11 +73,14 @@ public:
 
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
 
+    void refresh(); // Reload all lines from cache
+
 private slots:
     virtual void cache_update(std::uint32_t associat, std::uint32_t set, std::uint32_t col, bool valid, bool dirty,
                       std::uint32_t tag, const std::uint32_t *data, bool write);
 
 private:
+    const machine::Cache *cache;
     bool islast;
     unsigned block;
     unsigned rows, columns;
@@ -94,6 +97,8 @@ public:
     CacheViewScene(const machine::Cache *cache);
     ~CacheViewScene();
 
+    void refresh(); // Reload whole content, cache signals may have been blocked
+
 private:
     unsigned associativity;
     CacheViewBlock **block;
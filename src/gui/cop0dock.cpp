@@ -68,6 +68,7 @@ Cop0Dock::Cop0Dock(QWidget *parent) : QDockWidget(parent) {
     pal_updated.setColor(QPalette::WindowText, QColor(240, 0, 0));
     pal_read.setColor(QPalette::WindowText, QColor(0, 0, 240));
     cop0reg_highlighted_any = false;
+    cop0state = nullptr;
 }
 
 Cop0Dock::~Cop0Dock() {
@@ -80,12 +81,13 @@ Cop0Dock::~Cop0Dock() {
 void Cop0Dock::setup(machine::QtMipsMachine *machine) {
     if (machine == nullptr) {
         // Reset data
+        cop0state = nullptr;
         for (int i = 1; i < machine::Cop0State::COP0REGS_CNT; i++)
             cop0reg[i]->setText("");
         return;
     }
 
-    const machine::Cop0State *cop0state = machine->cop0state();
+    cop0state = machine->cop0state();
 
     for (int i = 1; i < machine::Cop0State::COP0REGS_CNT; i++)
         labelVal(cop0reg[i], cop0state->read_cop0reg((machine::Cop0State::Cop0Registers)i));
@@ -97,6 +99,13 @@ void Cop0Dock::setup(machine::QtMipsMachine *machine) {
     connect(machine, SIGNAL(tick()), this, SLOT(clear_highlights()));
 }
 
+void Cop0Dock::refresh() {
+    if (cop0state == nullptr)
+        return;
+    for (int i = 1; i < machine::Cop0State::COP0REGS_CNT; i++)
+        labelVal(cop0reg[i], cop0state->read_cop0reg((machine::Cop0State::Cop0Registers)i));
+}
+
 void Cop0Dock::cop0reg_changed(enum machine::Cop0State::Cop0Registers reg, std::uint32_t val) {
     SANITY_ASSERT((uint)reg < machine::Cop0State::COP0REGS_CNT && (uint)reg,
                   QString("Cop0Dock received signal with invalid cop0 register: ") +
@@ -53,6 +53,9 @@ public:
 
     void setup(machine::QtMipsMachine *machine);
 
+public slots:
+    void refresh(); // Reload all values from coprocessor 0
+
 private slots:
     void cop0reg_changed(enum machine::Cop0State::Cop0Registers reg, std::uint32_t val);
     void cop0reg_read(enum machine::Cop0State::Cop0Registers reg, std::uint32_t val);
@@ -61,6 +64,7 @@ private slots:
 private:
     StaticTable *widg;
     QScrollArea *scrollarea;
+    const machine::Cop0State *cop0state;
 
     QLabel *cop0reg[machine::Cop0State::COP0REGS_CNT];
     bool cop0reg_highlighted[machine::Cop0State::COP0REGS_CNT];
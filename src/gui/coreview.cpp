@@ -122,7 +122,7 @@ CoreViewScene::CoreViewScene(machine::QtMipsMachine *machine) : QGraphicsScene()
     NEW(Adder, dc.add, 340, 428);
     const coreview::Connector *dc_con_sign_ext = dc.sign_ext->new_connector(1, 0);
     NEW(Junction, dc.j_sign_ext, 290, dc_con_sign_ext->y());
-    if (machine->config().branch_res_id() || !machine->config().pipelined()) {
+    if (machine->config().branch_res_id() || !machine->core_is_pipelined()) {
         NEW(LogicBlock, dc.cmp, 312, 200, "=");
         dc.cmp->setSize(24, 12);
         NEW(And, dc.and_branch, 350, 190);
@@ -170,7 +170,7 @@ CoreViewScene::CoreViewScene(machine::QtMipsMachine *machine) : QGraphicsScene()
     new_bus(dc_con_sign_ext, dc.j_sign_ext->new_connector(coreview::Connector::AX_X));
     new_bus(dc.j_sign_ext->new_connector(coreview::Connector::AX_Y), dc.shift2->new_connector(-1, 0));
     new_bus(dc.shift2->new_connector(1, 0), dc.add->connector_in_a());
-    if (machine->config().branch_res_id() || !machine->config().pipelined()) {
+    if (machine->config().branch_res_id() || !machine->core_is_pipelined()) {
         new_signal(dc.cmp->new_connector(1, 0), dc.and_branch->connector_in(1))->setAxes({CON_AXIS_Y(343)});
         new_signal(dc.ctl_block->new_connector(1, 0.8), dc.and_branch->connector_in(0))->setAxes({CON_AXIS_Y(343)});
     }
@@ -185,7 +185,7 @@ CoreViewScene::CoreViewScene(machine::QtMipsMachine *machine) : QGraphicsScene()
     // Execute stage
     new_bus(ex.j_mux->new_connector(CON_AX_X), ex.mux_imm->connector_in(0));
     new_bus(ex.mux_imm->connector_out(), alu->connector_in_b());
-    if (!machine->config().branch_res_id() && machine->config().pipelined()) {
+    if (!machine->config().branch_res_id() && machine->core_is_pipelined()) {
         NEW(And, ex.and_branch, alu->x() + 33, alu->y() + 93);
         new_signal(alu->connector_out(), ex.and_branch->connector_in(0))->setAxes({CON_AXIS_Y(520)});
         new_signal(dc.ctl_block->new_connector(1, 0.8), ex.and_branch->connector_in(1))->setAxes({CON_AXIS_Y(460)});
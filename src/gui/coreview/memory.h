@@ -58,8 +58,8 @@ signals:
     void open_cache();
 
 private slots:
-    void cache_hit_update(std::uint32_t);
-    void cache_miss_update(std::uint32_t);
+    void cache_hit_update(std::uint64_t);
+    void cache_miss_update(std::uint64_t);
 
 protected:
     void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) override;
@@ -0,0 +1,116 @@
+#include <QPainter>
+#include <QPolygonF>
+#include <QVector>
+#include <algorithm>
+#include "cpistackchart.h"
+
+using machine::CpiStack;
+
+CpiStackChart::CpiStackChart(QWidget *parent) : Super(parent) {
+    cpi_stack = nullptr;
+    setMinimumHeight(120);
+}
+
+void CpiStackChart::set_stack(const CpiStack *stack) {
+    cpi_stack = stack;
+    update();
+}
+
+const CpiStack *CpiStackChart::stack() const {
+    return cpi_stack;
+}
+
+QSize CpiStackChart::sizeHint() const {
+    return QSize(250, 200);
+}
+
+QColor CpiStackChart::component_color(int component) {
+    static const QColor colors[CpiStack::CPI_COMPONENTS_CNT] = {
+        QColor(0x4c, 0xaf, 0x50), // base
+        QColor(0xff, 0x98, 0x00), // data hazard
+        QColor(0x9c, 0x27, 0xb0), // control hazard
+        QColor(0xe9, 0x1e, 0x63), // branch flush
+        QColor(0xff, 0xeb, 0x3b), // MDU
+        QColor(0x03, 0xa9, 0xf4), // L1 program
+        QColor(0x3f, 0x51, 0xb5), // L1 data
+        QColor(0x00, 0x96, 0x88), // L2 unified
+        QColor(0x60, 0x7d, 0x8b), // Lower caches
+        QColor(0xcd, 0xdc, 0x39), // Write buffer
+        QColor(0x79, 0x55, 0x48), // DRAM
+    };
+    return colors[component];
+}
+
+void CpiStackChart::paintEvent(QPaintEvent *event) {
+    (void)event;
+    QPainter painter(this);
+    const int line_h = fontMetrics().height();
+    const int legend_rows = (CpiStack::CPI_COMPONENTS_CNT + 1) / 2;
+
+    painter.fillRect(rect(), palette().base());
+    painter.setPen(palette().text().color());
+    if (cpi_stack == nullptr || cpi_stack->size() == 0) {
+        painter.drawText(rect(), Qt::AlignCenter, tr("No CPI samples"));
+        return;
+    }
+
+    // Legend in two columns below the plot
+    int legend_top = height() - legend_rows * line_h - 2;
+    for (int c = 0; c < CpiStack::CPI_COMPONENTS_CNT; c++) {
+        int x = 4 + (c % 2) * width() / 2;
+        int y = legend_top + (c / 2) * line_h;
+        painter.fillRect(x, y + 2, line_h - 4, line_h - 4, component_color(c));
+        painter.drawText(x + line_h, y, width() / 2 - line_h - 4, line_h, Qt::AlignLeft | Qt::AlignVCenter,
+                         CpiStack::component_name((CpiStack::Component)c));
+    }
+
+    // Newest samples, at most one per pixel column
+    unsigned shown = cpi_stack->size();
+    unsigned first;
+    double max_cpi = 1.0;
+    QString max_label;
+    int label_w = fontMetrics().width("00.00") + 4;
+    QRectF plot(label_w, 4, width() - label_w - 4, legend_top - 8);
+    if (plot.width() < 2 || plot.height() < 2)
+        return;
+    shown = std::min<unsigned>(shown, plot.width());
+    first = cpi_stack->size() - shown;
+    for (unsigned i = first; i < cpi_stack->size(); i++) {
+        double total = 0;
+        for (int c = 0; c < CpiStack::CPI_COMPONENTS_CNT; c++)
+            total += cpi_stack->at(i).cpi((CpiStack::Component)c);
+        max_cpi = std::max(max_cpi, total);
+    }
+
+    auto x_pos = [&](unsigned i) {
+        return shown > 1 ? plot.left() + plot.width() * (i - first) / (shown - 1) : plot.left();
+    };
+    auto y_pos = [&](double cpi) {
+        return plot.bottom() - plot.height() * cpi / max_cpi;
+    };
+
+    QVector<double> lower(shown, 0.0);
+    painter.setPen(Qt::NoPen);
+    for (int c = 0; c < CpiStack::CPI_COMPONENTS_CNT; c++) {
+        QVector<double> upper(shown);
+        QPolygonF area;
+        for (unsigned i = 0; i < shown; i++)
+            upper[i] = lower[i] + cpi_stack->at(first + i).cpi((CpiStack::Component)c);
+        for (unsigned i = 0; i < shown; i++)
+            area << QPointF(x_pos(first + i), y_pos(upper[i]));
+        if (shown == 1)
+            area << QPointF(plot.right(), y_pos(upper[0])) << QPointF(plot.right(), y_pos(lower[0]));
+        for (unsigned i = shown; i-- > 0;)
+            area << QPointF(x_pos(first + i), y_pos(lower[i]));
+        painter.setBrush(component_color(c));
+        painter.drawPolygon(area);
+        lower = upper;
+    }
+
+    painter.setBrush(Qt::NoBrush);
+    painter.setPen(palette().text().color());
+    painter.drawRect(plot);
+    max_label = QString::number(max_cpi, 'f', 2);
+    painter.drawText(QRectF(0, plot.top(), label_w - 2, line_h), Qt::AlignRight | Qt::AlignTop, max_label);
+    painter.drawText(QRectF(0, plot.bottom() - line_h, label_w - 2, line_h), Qt::AlignRight | Qt::AlignBottom, "0");
+}
@@ -0,0 +1,31 @@
+#ifndef CPISTACKCHART_H
+#define CPISTACKCHART_H
+
+#include <QWidget>
+#include "cpistack.h"
+
+// Stacked area chart of CPI components over sampled intervals, the newest
+// samples which fit to the widget width are shown.
+class CpiStackChart : public QWidget {
+    Q_OBJECT
+
+    using Super = QWidget;
+
+public:
+    explicit CpiStackChart(QWidget *parent = nullptr);
+
+    void set_stack(const machine::CpiStack *stack);
+    const machine::CpiStack *stack() const;
+
+    QSize sizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    static QColor component_color(int component);
+
+    const machine::CpiStack *cpi_stack;
+};
+
+#endif // CPISTACKCHART_H
@@ -1,5 +1,8 @@
 #include <QVBoxLayout>
 #include <QFormLayout>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QPushButton>
 #include "cyclestatisticsdock.h"
 #include <vector>
 
@@ -11,17 +14,27 @@ CycleStatisticsDock::CycleStatisticsDock(QWidget *parent) : QDockWidget(parent)
         "Total Cycles:",
         "Instructions:",
         "CPI:",
+        "IPC:",
+        "Pair Issue Rate:",
         "Data Hazard Stalls:",
         "Control Hazard Stalls:",
+        "Mul/Div Stalls:",
         "RAM Stalls:",
         "L1 Data Stalls:",
         "L1 Program Stalls:",
-        "L2 Unified Stalls:"
+        "L2 Unified Stalls:",
+        "Lower Cache Stalls:",
+        "Write Buffer Stalls:",
+        "Idle Skipped Cycles:",
+        "DRAM Row Hits:",
+        "DRAM Row Misses:",
+        "DRAM Row Conflicts:"
     };
 
     QWidget *content = new QWidget();
 
-    auto *dock_layout = new QFormLayout(content);
+    auto *content_layout = new QVBoxLayout(content);
+    auto *dock_layout = new QFormLayout();
 
     for (size_t i = 0 ; i < labels.size() ; i++) {
         cycle_stats_labels[i] = new QLabel("2147483647", this);
@@ -29,32 +42,75 @@ CycleStatisticsDock::CycleStatisticsDock(QWidget *parent) : QDockWidget(parent)
         cycle_stats_labels[i]->setText("0");
         dock_layout->addRow(labels[i], cycle_stats_labels[i]);
     }
-    content->setLayout(dock_layout);
+    content_layout->addLayout(dock_layout);
+
+    cpi_chart = new CpiStackChart(content);
+    content_layout->addWidget(cpi_chart, 1);
+    auto *export_button = new QPushButton("Export CPI Stack...", content);
+    connect(export_button, &QPushButton::clicked, this, &CycleStatisticsDock::export_cpi_stack);
+    content_layout->addWidget(export_button);
+
+    content->setLayout(content_layout);
     setWidget(content);
 }
 
-void CycleStatisticsDock::setup(machine::QtMipsMachine *machine) const {
+void CycleStatisticsDock::setup(machine::QtMipsMachine *machine) {
+    cpi_chart->set_stack(machine != nullptr ? machine->cpi_stack() : nullptr);
     if (machine == nullptr) {
         // Reset data
         return;
     }
 
     connect(machine, &machine::QtMipsMachine::cycle_stats_update, this, &CycleStatisticsDock::cycle_stats_update);
+    dram_row_update(0, 0, 0);
+    if (machine->dram_controller() != nullptr)
+        connect(machine->dram_controller(), &machine::DramController::row_update,
+                this, &CycleStatisticsDock::dram_row_update);
 }
 
 void CycleStatisticsDock::cycle_stats_update(const machine::CycleStatistics &cycle_stats) {
-    uint32_t instructions = cycle_stats.total_cycles - (cycle_stats.data_hazard_stalls + cycle_stats.control_hazard_stalls +
-            cycle_stats.l1_data_stall_cycles_total + cycle_stats.l1_program_stall_cycles_total + cycle_stats.l2_unified_stall_cycles_total +
-            cycle_stats.ram_program_stall_cycles_total + cycle_stats.ram_data_stall_cycles_total);
+    std::uint64_t instructions = cycle_stats.instructions;
     double cpi = instructions != 0 ? (double) cycle_stats.total_cycles / (double) instructions : 0;
+    double ipc = cycle_stats.total_cycles != 0 ? (double) instructions / (double) cycle_stats.total_cycles : 0;
+    // Share of issue cycles in which dual issue timing model issued two instructions
+    std::uint64_t issue_cycles = instructions - cycle_stats.paired_issues;
+    double pair_rate = issue_cycles != 0 ? (double) cycle_stats.paired_issues / (double) issue_cycles * 100.0 : 0;
 
     cycle_stats_labels[TOTAL_CYCLES]->setText(QString::number(cycle_stats.total_cycles));
     cycle_stats_labels[INSTRUCTIONS]->setText(QString::number(instructions));
     cycle_stats_labels[CPI]->setText(QString::number(cpi));
+    cycle_stats_labels[IPC]->setText(QString::number(ipc));
+    cycle_stats_labels[PAIR_ISSUE_RATE]->setText(QString::number(pair_rate, 'f', 1) + "%");
     cycle_stats_labels[DATA_HAZARD_STALLS]->setText(QString::number(cycle_stats.data_hazard_stalls));
     cycle_stats_labels[CONTROL_HAZARD_STALLS]->setText(QString::number(cycle_stats.control_hazard_stalls));
+    cycle_stats_labels[MDU_STALLS]->setText(QString::number(cycle_stats.mdu_stalls));
     cycle_stats_labels[DRAM_STALLS]->setText(QString::number(cycle_stats.ram_program_stall_cycles_total + cycle_stats.ram_data_stall_cycles_total));
     cycle_stats_labels[L1_DATA_STALLS]->setText(QString::number(cycle_stats.l1_data_stall_cycles_total));
     cycle_stats_labels[L1_PROGRAM_STALLS]->setText(QString::number(cycle_stats.l1_program_stall_cycles_total));
     cycle_stats_labels[L2_UNIFIED_STALLS]->setText(QString::number(cycle_stats.l2_unified_stall_cycles_total));
+    cycle_stats_labels[LOWER_CACHE_STALLS]->setText(QString::number(cycle_stats.lower_cache_stall_cycles_sum()));
+    cycle_stats_labels[WRITE_BUFFER_STALLS]->setText(QString::number(cycle_stats.write_buffer_stall_cycles_total));
+    cycle_stats_labels[IDLE_SKIPPED]->setText(QString::number(cycle_stats.idle_skipped_cycles));
+    cpi_chart->update();
+}
+
+void CycleStatisticsDock::export_cpi_stack() {
+    const machine::CpiStack *stack = cpi_chart->stack();
+    if (stack == nullptr)
+        return;
+    QString path = QFileDialog::getSaveFileName(this, "Export CPI Stack", "",
+                                                "CSV files (*.csv);;JSON files (*.json)");
+    if (path.isEmpty())
+        return;
+    try {
+        stack->save(path);
+    } catch (const machine::QtMipsException &e) {
+        QMessageBox::critical(this, "Export CPI Stack", e.msg(false));
+    }
+}
+
+void CycleStatisticsDock::dram_row_update(std::uint64_t hits, std::uint64_t misses, std::uint64_t conflicts) {
+    cycle_stats_labels[DRAM_ROW_HITS]->setText(QString::number(hits));
+    cycle_stats_labels[DRAM_ROW_MISSES]->setText(QString::number(misses));
+    cycle_stats_labels[DRAM_ROW_CONFLICTS]->setText(QString::number(conflicts));
 }
@@ -6,31 +6,46 @@
 #include <QTextEdit>
 #include <QDockWidget>
 #include "qtmipsmachine.h"
+#include "cpistackchart.h"
 
 class CycleStatisticsDock : public QDockWidget {
     Q_OBJECT
 public:
     explicit CycleStatisticsDock(QWidget *parent);
 
-    void setup(machine::QtMipsMachine *machine) const;
+    void setup(machine::QtMipsMachine *machine);
 
 public slots:
     void cycle_stats_update(const machine::CycleStatistics &stats);
+    void dram_row_update(std::uint64_t hits, std::uint64_t misses, std::uint64_t conflicts);
+
+private slots:
+    void export_cpi_stack();
 
 private:
     enum CycleStatIndex {
         TOTAL_CYCLES,
         INSTRUCTIONS,
         CPI,
+        IPC,
+        PAIR_ISSUE_RATE,
         DATA_HAZARD_STALLS,
         CONTROL_HAZARD_STALLS,
+        MDU_STALLS,
         DRAM_STALLS,
         L1_DATA_STALLS,
         L1_PROGRAM_STALLS,
-        L2_UNIFIED_STALLS
+        L2_UNIFIED_STALLS,
+        LOWER_CACHE_STALLS,
+        WRITE_BUFFER_STALLS,
+        IDLE_SKIPPED,
+        DRAM_ROW_HITS,
+        DRAM_ROW_MISSES,
+        DRAM_ROW_CONFLICTS
     };
 
-   QLabel *cycle_stats_labels[9]{};
+   QLabel *cycle_stats_labels[18]{};
+   CpiStackChart *cpi_chart;
 };
 
 #endif
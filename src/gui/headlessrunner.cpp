@@ -0,0 +1,305 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <cstdio>
+#include <algorithm>
+#include "os_emulation/ossyscall.h"
+#include "samplingcontroller.h"
+#include "headlessrunner.h"
+
+HeadlessRunner::HeadlessRunner(QObject *parent) : QObject(parent) {
+    machine = nullptr;
+    finished = false;
+    exited = false;
+    exit_status = 0;
+    bbv = nullptr;
+}
+
+HeadlessRunner::~HeadlessRunner() {
+    if (machine != nullptr)
+        delete machine;
+    delete bbv;
+}
+
+bool HeadlessRunner::start(const QStringList &arguments) {
+    QCommandLineParser p;
+    p.setApplicationDescription("Run program without graphical interface and write its output to stdout.");
+    p.addHelpOption();
+    p.addPositionalArgument("FILE", "ELF executable to run");
+    p.addOption(QCommandLineOption("headless", "Run without graphical interface."));
+    p.addOption(QCommandLineOption("pipelined", "Use pipelined core instead of single cycle one."));
+    p.addOption(QCommandLineOption("dual-issue-timing", "Account time of single cycle core by dual issue timing model."));
+    p.addOption(QCommandLineOption("osemu-fs-root", "Root directory for emulated file operations.", "DIR"));
+    p.addOption(QCommandLineOption("switch-core-at", "Continue on the other core when execution reaches SYMBOL, or core cycle when number is given.", "SYMBOL"));
+    p.addOption(QCommandLineOption("sample-period", "Run sampled simulation with one sample every N instructions.", "N"));
+    p.addOption(QCommandLineOption("sample-warmup", "Instructions run by pipelined core before sample is measured.", "N", "2000"));
+    p.addOption(QCommandLineOption("sample-window", "Instructions measured in every sample.", "N", "1000"));
+    p.addOption(QCommandLineOption("bbv", "Write basic block vectors of the run to FILE.", "FILE"));
+    p.addOption(QCommandLineOption("bbv-interval", "Instructions in one basic block vector interval.", "N", "100000"));
+    p.addOption(QCommandLineOption("simpoints", "Select representative intervals of BBV FILE, no program is run.", "FILE"));
+    p.addOption(QCommandLineOption("simpoint-run", "Measure only representative intervals selected from BBV FILE.", "FILE"));
+    p.addOption(QCommandLineOption("max-k", "Maximal number of clusters for interval selection.", "K", "10"));
+    p.addOption(QCommandLineOption("no-idle-skip", "Execute every iteration of idle polling loops."));
+    p.addOption(QCommandLineOption("hle", "Emulate memcpy, memset and strlen on host in functional core."));
+    p.addOption(QCommandLineOption("cpi-stack", "Write CPI stack time series to FILE (JSON if it ends with .json, CSV otherwise).", "FILE"));
+    p.addOption(QCommandLineOption("cpi-interval", "Cycles in one CPI stack sample.", "N", "10000"));
+    p.addOption(QCommandLineOption("cpi-samples", "Number of newest CPI stack samples kept.", "N", "100000"));
+    p.addOption(QCommandLineOption("pipe-trace", "Write O3PipeView trace of pipelined core to FILE.", "FILE"));
+    p.process(arguments);
+
+    if (p.isSet("simpoints")) {
+        QVector<machine::SimPointSelector::Region> regions;
+        QString bbv_file = p.value("simpoints");
+        if (!select_simpoints(bbv_file, p.value("max-k").toUInt(), regions))
+            return false;
+        try {
+            machine::SimPointSelector::save(regions, bbv_file + ".simpoints", bbv_file + ".weights");
+        } catch (const machine::QtMipsException &e) {
+            fprintf(stderr, "%s\n", e.msg(false).toLocal8Bit().data());
+            return false;
+        }
+        fprintf(stderr, "%s", machine::SimPointSelector::report(regions).toLocal8Bit().data());
+        finish(0);
+        return true;
+    }
+
+    if (p.positionalArguments().size() != 1) {
+        fprintf(stderr, "Single ELF file has to be specified\n");
+        return false;
+    }
+
+    if (p.isSet("pipelined") && p.isSet("dual-issue-timing")) {
+        fprintf(stderr, "Dual issue timing applies to single cycle core only, it cannot be pipelined\n");
+        return false;
+    }
+
+    machine::MachineConfig config;
+    config.set_elf(p.positionalArguments()[0]);
+    config.set_pipelined(p.isSet("pipelined"));
+    config.set_dual_issue_timing(p.isSet("dual-issue-timing"));
+    config.set_osemu_enable(true);
+    config.set_osemu_known_syscall_stop(false);
+    config.set_osemu_unknown_syscall_stop(false);
+    config.set_osemu_interrupt_stop(false);
+    config.set_osemu_exception_stop(false);
+    if (p.isSet("osemu-fs-root"))
+        config.set_osemu_fs_root(p.value("osemu-fs-root"));
+
+    try {
+        machine = new machine::QtMipsMachine(config, true);
+    } catch (const machine::QtMipsException &e) {
+        fprintf(stderr, "%s\n", e.msg(false).toLocal8Bit().data());
+        return false;
+    }
+
+    osemu::OsSyscallExceptionHandler *osemu_handler =
+            new osemu::OsSyscallExceptionHandler(false, false, config.osemu_fs_root());
+    machine->register_exception_handler(machine::EXCAUSE_SYSCALL, osemu_handler);
+    machine->set_step_over_exception(machine::EXCAUSE_SYSCALL, true);
+    machine->set_stop_on_exception(machine::EXCAUSE_SYSCALL, false);
+    connect(osemu_handler, SIGNAL(char_written(int,uint)), this, SLOT(tx_byte(int,uint)));
+    connect(osemu_handler, SIGNAL(program_exit(int)), this, SLOT(program_exit(int)));
+    connect(osemu_handler, SIGNAL(rx_byte_pool(int,uint&,bool&)),
+            this, SLOT(rx_byte_pool(int,uint&,bool&)));
+    connect(machine->serial_port(), SIGNAL(tx_byte(uint)), this, SLOT(tx_byte(uint)));
+    connect(machine->core(), SIGNAL(stop_on_exception_reached()), machine, SLOT(pause()));
+    machine->set_idle_loop_skip(!p.isSet("no-idle-skip"));
+    if (p.isSet("hle") && machine->set_hle(true) == 0)
+        fprintf(stderr, "No library function for HLE found in symbol table\n");
+    connect(machine, SIGNAL(post_tick()), this, SLOT(flush_output()));
+    connect(machine, SIGNAL(status_change(machine::QtMipsMachine::Status)),
+            this, SLOT(machine_status(machine::QtMipsMachine::Status)));
+    connect(machine, SIGNAL(program_trap(machine::QtMipsException&)),
+            this, SLOT(machine_trap(machine::QtMipsException&)));
+
+    if (p.isSet("cpi-stack")) {
+        std::uint64_t cpi_interval = p.value("cpi-interval").toULongLong();
+        unsigned cpi_samples = p.value("cpi-samples").toUInt();
+        if (cpi_interval == 0 || cpi_samples == 0) {
+            fprintf(stderr, "CPI stack interval and sample count have to be positive\n");
+            return false;
+        }
+        machine->set_cpi_stack(cpi_interval, cpi_samples);
+        cpi_stack_path = p.value("cpi-stack");
+    }
+
+    if (p.isSet("pipe-trace")) {
+        try {
+            machine->set_pipe_trace(p.value("pipe-trace"));
+        } catch (const machine::QtMipsException &e) {
+            fprintf(stderr, "%s\n", e.msg(false).toLocal8Bit().data());
+            return false;
+        }
+    }
+
+    std::uint64_t bbv_interval = p.value("bbv-interval").toULongLong();
+    if (bbv_interval == 0) {
+        fprintf(stderr, "BBV interval has to be positive\n");
+        return false;
+    }
+    if (p.isSet("bbv")) {
+        bbv = new machine::BbvProfiler(bbv_interval, config.control_hazard_unit()
+                                       == machine::MachineConfig::CHU_DELAY_SLOT);
+        bbv_path = p.value("bbv");
+        machine->core_rw()->set_bbv_profiler(bbv);
+    }
+
+    if (p.isSet("simpoint-run")) {
+        QVector<machine::SimPointSelector::Region> regions;
+        if (!select_simpoints(p.value("simpoint-run"), p.value("max-k").toUInt(), regions))
+            return false;
+        machine::SamplingController sampling(machine);
+        sampling.set_warmup(p.value("sample-warmup").toULongLong());
+        try {
+            sampling.run_regions(regions, bbv_interval);
+        } catch (machine::QtMipsException &e) {
+            machine_trap(e);
+            finish(1);
+            return true;
+        }
+        fflush(stdout);
+        fprintf(stderr, "%s", sampling.report().toLocal8Bit().data());
+        finish(0);
+        return true;
+    }
+
+    if (p.isSet("sample-period")) {
+        machine::SamplingController sampling(machine, p.value("sample-period").toULongLong(),
+                                             p.value("sample-warmup").toULongLong(),
+                                             p.value("sample-window").toULongLong());
+        try {
+            sampling.run();
+        } catch (machine::QtMipsException &e) {
+            machine_trap(e);
+            finish(1);
+            return true;
+        }
+        fflush(stdout);
+        fprintf(stderr, "%s", sampling.report().toLocal8Bit().data());
+        finish(0);
+        return true;
+    }
+
+    connect(machine, SIGNAL(core_switched(bool)), this, SLOT(core_switched(bool)));
+
+    if (p.isSet("switch-core-at")) {
+        QString at = p.value("switch-core-at");
+        bool is_cycle;
+        std::uint64_t cycle = at.toULongLong(&is_cycle, 0);
+        if (is_cycle) {
+            machine->schedule_core_switch_at_cycle(!config.pipelined(), cycle);
+        } else if (!machine->schedule_core_switch(!config.pipelined(), at)) {
+            fprintf(stderr, "Symbol \"%s\" not found\n", at.toLocal8Bit().data());
+            return false;
+        }
+    }
+
+    // Views are not present, so run in as large chunks as machine allows
+    machine->set_speed(0, 100);
+    machine->play();
+    return true;
+}
+
+void HeadlessRunner::tx_byte(unsigned int data) {
+    fputc(data & 0xff, stdout);
+}
+
+void HeadlessRunner::tx_byte(int fd, unsigned int data) {
+    (void)fd;
+    tx_byte(data);
+}
+
+void HeadlessRunner::rx_byte_pool(int fd, unsigned int &data, bool &available) {
+    (void)fd;
+    (void)data;
+    available = false;
+}
+
+void HeadlessRunner::flush_output() {
+    fflush(stdout);
+}
+
+void HeadlessRunner::machine_status(machine::QtMipsMachine::Status st) {
+    switch (st) {
+    case machine::QtMipsMachine::ST_READY:
+        // Paused by program exit syscall, otherwise by break or exception stop
+        if (exited) {
+            finish(exit_status);
+        } else {
+            fflush(stdout);
+            fprintf(stderr, "Program stopped on exception at 0x%08x\n",
+                    (unsigned)machine->registers()->read_pc());
+            finish(1);
+        }
+        break;
+    case machine::QtMipsMachine::ST_EXIT:
+        finish(exited ? exit_status : 0);
+        break;
+    case machine::QtMipsMachine::ST_TRAPPED:
+        finish(1);
+        break;
+    default:
+        break;
+    }
+}
+
+void HeadlessRunner::program_exit(int status) {
+    exited = true;
+    exit_status = status;
+}
+
+void HeadlessRunner::machine_trap(machine::QtMipsException &e) {
+    fflush(stdout);
+    fprintf(stderr, "Machine trapped: %s\n", e.msg(false).toLocal8Bit().data());
+}
+
+void HeadlessRunner::core_switched(bool pipelined) {
+    connect(machine->core(), SIGNAL(stop_on_exception_reached()), machine, SLOT(pause()),
+            Qt::UniqueConnection);
+    fprintf(stderr, "Switched to %s core at cycle %llu\n", pipelined ? "pipelined" : "single cycle",
+            (unsigned long long)machine->core()->get_cycles());
+}
+
+bool HeadlessRunner::select_simpoints(const QString &bbv_path, unsigned max_k,
+                                      QVector<machine::SimPointSelector::Region> &regions) {
+    try {
+        machine::SimPointSelector selector(std::max(max_k, 1u));
+        regions = selector.select(machine::BbvProfiler::load(bbv_path));
+    } catch (const machine::QtMipsException &e) {
+        fprintf(stderr, "%s\n", e.msg(false).toLocal8Bit().data());
+        return false;
+    }
+    if (regions.isEmpty()) {
+        fprintf(stderr, "No intervals found in %s\n", bbv_path.toLocal8Bit().data());
+        return false;
+    }
+    return true;
+}
+
+void HeadlessRunner::finish(int code) {
+    if (finished)
+        return;
+    finished = true;
+    fflush(stdout);
+    if (bbv != nullptr) {
+        bbv->finish();
+        try {
+            bbv->save(bbv_path);
+        } catch (const machine::QtMipsException &e) {
+            fprintf(stderr, "%s\n", e.msg(false).toLocal8Bit().data());
+            code = 1;
+        }
+    }
+    if (machine != nullptr && machine->cpi_stack() != nullptr && !cpi_stack_path.isEmpty()) {
+        try {
+            machine->cpi_stack()->save(cpi_stack_path);
+        } catch (const machine::QtMipsException &e) {
+            fprintf(stderr, "%s\n", e.msg(false).toLocal8Bit().data());
+            code = 1;
+        }
+    }
+    if (machine != nullptr)
+        machine->set_pipe_trace(QString()); // Write instructions still in flight
+    // Machine signals are delivered from within its step, quit after it returns
+    QMetaObject::invokeMethod(QCoreApplication::instance(), "exit",
+                              Qt::QueuedConnection, Q_ARG(int, code));
+}
@@ -0,0 +1,47 @@
+#ifndef HEADLESSRUNNER_H
+#define HEADLESSRUNNER_H
+
+#include <QObject>
+#include <QStringList>
+#include "qtmipsmachine.h"
+#include "machineconfig.h"
+#include "bbvprofiler.h"
+#include "simpointselector.h"
+
+// Runs a program without any views and streams its output to stdout.
+// Output bytes go through the stdio buffer and are flushed once per machine
+// tick, so the simulation is not slowed down by console writes.
+class HeadlessRunner : public QObject {
+    Q_OBJECT
+public:
+    HeadlessRunner(QObject *parent = nullptr);
+    ~HeadlessRunner();
+
+    // Returns false and prints reason to stderr if machine can't be started
+    bool start(const QStringList &arguments);
+
+private slots:
+    void tx_byte(unsigned int data);
+    void tx_byte(int fd, unsigned int data);
+    void rx_byte_pool(int fd, unsigned int &data, bool &available);
+    void flush_output();
+    void machine_status(machine::QtMipsMachine::Status st);
+    void machine_trap(machine::QtMipsException &e);
+    void program_exit(int status);
+    void core_switched(bool pipelined);
+
+private:
+    void finish(int code);
+    bool select_simpoints(const QString &bbv_path, unsigned max_k,
+                          QVector<machine::SimPointSelector::Region> &regions);
+
+    machine::QtMipsMachine *machine;
+    bool finished;
+    bool exited; // Program called exit syscall
+    int exit_status;
+    machine::BbvProfiler *bbv;
+    QString bbv_path;
+    QString cpi_stack_path;
+};
+
+#endif // HEADLESSRUNNER_H
@@ -7,8 +7,14 @@
 LcdDisplayView::LcdDisplayView(QWidget *parent) : Super(parent) {
     setMinimumSize(100, 100);
     fb_pixels = nullptr;
+    lcd_display = nullptr;
     scale_x = 1.0;
     scale_y = 1.0;
+    // Changes are collected and repainted once per frame
+    frame_t = new QTimer(this);
+    frame_t->setSingleShot(true);
+    frame_t->setInterval(16);
+    connect(frame_t, SIGNAL(timeout()), this, SLOT(repaint_dirty()));
 }
 
 LcdDisplayView::~LcdDisplayView() {
@@ -19,36 +25,48 @@ LcdDisplayView::~LcdDisplayView() {
 void LcdDisplayView::setup(machine::LcdDisplay *lcd_display) {
     if (lcd_display == nullptr)
         return;
-    connect(lcd_display, SIGNAL(pixel_update(uint,uint,uint,uint,uint)),
-            this, SLOT(pixel_update(uint,uint,uint,uint,uint)));
+    this->lcd_display = lcd_display;
+    connect(lcd_display, SIGNAL(fb_changed()), this, SLOT(fb_changed()));
     if (fb_pixels != nullptr)
         delete fb_pixels;
     fb_pixels = nullptr;
-    fb_pixels = new QImage(lcd_display->width(),
-                           lcd_display->height(), QImage::Format_RGB32);
-    fb_pixels->fill(qRgb(0, 0, 0));
+    // Image is only a view over display memory, no pixel data are copied
+    SANITY_ASSERT(lcd_display->bpp() == 16, "LCD framebuffer has to hold RGB565 pixels");
+    fb_pixels = new QImage(lcd_display->fb_pixels(), lcd_display->width(),
+                           lcd_display->height(), lcd_display->linesize(),
+                           QImage::Format_RGB16);
+    lcd_display->take_dirty_spans();
     update_scale();
     update();
 }
 
-void LcdDisplayView::pixel_update(uint x, uint y, uint r, uint g, uint b) {
+void LcdDisplayView::fb_changed() {
+    if (!frame_t->isActive())
+        frame_t->start();
+}
+
+void LcdDisplayView::repaint_dirty() {
+    QRegion region;
     int x1, y1, x2, y2;
-    if (fb_pixels != nullptr) {
-        fb_pixels->setPixel(x, y, qRgb(r, g, b));
-        x1 = x * scale_x - 2;
+
+    if (lcd_display == nullptr || fb_pixels == nullptr)
+        return;
+    for (const machine::LcdDisplay::DirtySpan &span : lcd_display->take_dirty_spans()) {
+        x1 = span.x_first * scale_x - 2;
         if (x1 < 0)
             x1 = 0;
-        x2 = x * scale_x + 2;
+        x2 = (span.x_last + 1) * scale_x + 2;
         if (x2 > width())
             x2 = width();
-        y1 = y * scale_y - 2;
+        y1 = span.y * scale_y - 2;
         if (y1 < 0)
             y1 = 0;
-        y2 = y * scale_y + 2;
+        y2 = (span.y + 1) * scale_y + 2;
         if (y2 > height())
             y2 = height();
-        update(x1, y1, x2 - x1, y2 - y1);
+        region += QRect(x1, y1, x2 - x1, y2 - y1);
     }
+    update(region);
 }
 
 void LcdDisplayView::update_scale() {
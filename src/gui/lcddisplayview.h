@@ -3,6 +3,7 @@
 
 #include <QWidget>
 #include <QImage>
+#include <QTimer>
 
 #include "lcddisplay.h"
 
@@ -21,7 +22,10 @@ public:
     uint fb_height();
 
 public slots:
-    void pixel_update(uint x, uint y, uint r, uint g, uint b);
+    void fb_changed();
+
+private slots:
+    void repaint_dirty();
 
 protected:
     virtual void paintEvent(QPaintEvent *event)  override;
@@ -32,6 +36,8 @@ private:
     float scale_x;
     float scale_y;
     QImage *fb_pixels;
+    machine::LcdDisplay *lcd_display;
+    QTimer *frame_t;
 };
 
 #endif // LCDDISPLAYVIEW_H
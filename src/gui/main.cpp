@@ -35,9 +35,30 @@
 
 #include <QApplication>
 #include <QCommandLineParser>
+#include <cstring>
 #include "mainwindow.h"
+#include "headlessrunner.h"
+
+static bool headless_requested(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++)
+        if (!strcmp(argv[i], "--headless"))
+            return true;
+    return false;
+}
 
 int main(int argc, char *argv[]) {
+    if (headless_requested(argc, argv)) {
+        // No display is needed to run program with output to stdout
+        QCoreApplication app(argc, argv);
+        app.setApplicationName("qtmips_gui");
+        app.setApplicationVersion("0.7.5");
+
+        HeadlessRunner runner;
+        if (!runner.start(app.arguments()))
+            return 2;
+        return app.exec();
+    }
+
     QApplication app(argc, argv);
     app.setApplicationName("qtmips_gui");
     app.setApplicationVersion("0.7.5");
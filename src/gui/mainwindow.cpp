@@ -95,6 +95,8 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     l1_cache_data->hide();
     l2_cache = new CacheDock(this, "L2 Unified");
     l2_cache->hide();
+    l3_cache = new CacheDock(this, "L3 Unified");
+    l3_cache->hide();
 
     peripherals = new PeripheralsDock(this, settings);
     peripherals->hide();
@@ -113,6 +115,17 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     cycle_stats = new CycleStatisticsDock(this);
     cycle_stats->hide();
 
+    // Views refreshed in bulk when machine runs with coalesced updates
+    update_scheduler = new UpdateScheduler(this, settings);
+    update_scheduler->add_view("Registers", registers, registers, "refresh");
+    update_scheduler->add_view("Coprocessor0", cop0dock, cop0dock, "refresh");
+    update_scheduler->add_view("BranchHistoryTable", predictor, predictor, "refresh");
+    update_scheduler->add_view("BranchTargetBuffer", btb, btb, "refresh");
+    update_scheduler->add_view("L1ProgramCache", l1_cache_program, l1_cache_program, "refresh");
+    update_scheduler->add_view("L1DataCache", l1_cache_data, l1_cache_data, "refresh");
+    update_scheduler->add_view("L2UnifiedCache", l2_cache, l2_cache, "refresh");
+    update_scheduler->add_view("L3UnifiedCache", l3_cache, l3_cache, "refresh");
+
     // Execution speed actions
     speed_group = new QActionGroup(this);
     speed_group->addAction(ui->ips1);
@@ -137,12 +150,15 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     connect(ui->actionCompileSource, SIGNAL(triggered(bool)), this, SLOT(compile_source()));
     connect(ui->actionBuildExe, SIGNAL(triggered(bool)), this, SLOT(build_execute()));
     connect(ui->actionShow_Symbol, SIGNAL(triggered(bool)), this, SLOT(show_symbol_dialog()));
+    connect(ui->actionSwitch_Core, SIGNAL(triggered(bool)), this, SLOT(switch_core()));
+    connect(ui->actionSwitch_Core_At_Symbol, SIGNAL(triggered(bool)), this, SLOT(switch_core_at_symbol()));
     connect(ui->actionRegisters, SIGNAL(triggered(bool)), this, SLOT(show_registers()));
     connect(ui->actionProgram_memory, SIGNAL(triggered(bool)), this, SLOT(show_program()));
     connect(ui->actionMemory, SIGNAL(triggered(bool)), this, SLOT(show_memory()));
     connect(ui->actionL1_Program_Cache, SIGNAL(triggered(bool)), this, SLOT(show_l1_cache_program()));
     connect(ui->actionL1_Data_Cache, SIGNAL(triggered(bool)), this, SLOT(show_l1_cache_data()));
     connect(ui->actionL2_Cache, SIGNAL(triggered(bool)), this, SLOT(show_l2_cache()));
+    connect(ui->actionL3_Cache, SIGNAL(triggered(bool)), this, SLOT(show_l3_cache()));
     connect(ui->actionPeripherals, SIGNAL(triggered(bool)), this, SLOT(show_peripherals()));
     connect(ui->actionTerminal, SIGNAL(triggered(bool)), this, SLOT(show_terminal()));
     connect(ui->actionLcdDisplay, SIGNAL(triggered(bool)), this, SLOT(show_lcd_display()));
@@ -210,6 +226,7 @@ MainWindow::~MainWindow() {
     delete l1_cache_program;
     delete l1_cache_data;
     delete l2_cache;
+    delete l3_cache;
     delete peripherals;
     delete terminal;
     delete lcd_display;
@@ -242,7 +259,7 @@ void MainWindow::show_hide_coreview(bool show) {
     if (show && (corescene != nullptr))
         return;
 
-    if (machine->config().pipelined()) {
+    if (machine->core_is_pipelined()) {
         corescene = new CoreViewScenePipelined(machine);
     } else {
         corescene = new CoreViewSceneSimple(machine);
@@ -287,6 +304,7 @@ void MainWindow::create_core(const machine::MachineConfig &config, bool load_exe
     show_hide_coreview(coreview_shown);
 
     set_speed(); // Update machine speed to current settings
+    machine->set_cpi_stack(1000); // CPI stack sample every 1000 cycles for statistics dock
 
     if (config.osemu_enable()) {
         osemu::OsSyscallExceptionHandler *osemu_handler =
@@ -313,8 +331,8 @@ void MainWindow::create_core(const machine::MachineConfig &config, bool load_exe
     connect(machine, SIGNAL(status_change(machine::QtMipsMachine::Status)), this, SLOT(machine_status(machine::QtMipsMachine::Status)));
     connect(machine, SIGNAL(program_exit()), this, SLOT(machine_exit()));
     connect(machine, SIGNAL(program_trap(machine::QtMipsException&)), this, SLOT(machine_trap(machine::QtMipsException&)));
-    // Connect signal from break to machine pause
-    connect(machine->core(), SIGNAL(stop_on_exception_reached()), machine, SLOT(pause()));
+    connect(machine, SIGNAL(views_update()), update_scheduler, SLOT(mark_dirty()));
+    connect(machine, SIGNAL(core_switched(bool)), this, SLOT(core_switched(bool)));
 
     // Setup docks
     registers->setup(machine);
@@ -323,6 +341,8 @@ void MainWindow::create_core(const machine::MachineConfig &config, bool load_exe
     l1_cache_program->setup(machine->l1_program_cache());
     l1_cache_data->setup(machine->l1_data_cache());
     l2_cache->setup(machine->l2_unified_cache());
+    if (machine->lower_cache_count() > 0)
+        l3_cache->setup(machine->lower_cache(0));
     terminal->setup(machine->serial_port());
     peripherals->setup(machine->peripheral_spi_led());
     lcd_display->setup(machine->peripheral_lcd_display());
@@ -335,20 +355,28 @@ void MainWindow::create_core(const machine::MachineConfig &config, bool load_exe
     memset(&c_stats, 0, sizeof(c_stats));
     cycle_stats->cycle_stats_update(c_stats);
 
+    connect_core_signals();
+
+    // Set status to ready
+    machine_status(machine::QtMipsMachine::ST_READY);
+}
+
+void MainWindow::connect_core_signals() {
+    // Core can be exchanged during run, connections are kept for both cores
+    const Qt::ConnectionType ct = Qt::UniqueConnection;
+    // Connect signal from break to machine pause
+    connect(machine->core(), SIGNAL(stop_on_exception_reached()), machine, SLOT(pause()), ct);
     // Connect signals for instruction address followup
     connect(machine->core(), SIGNAL(fetch_inst_addr_value(std::uint32_t)),
-            program, SLOT(fetch_inst_addr(std::uint32_t)));
+            program, SLOT(fetch_inst_addr(std::uint32_t)), ct);
     connect(machine->core(), SIGNAL(decode_inst_addr_value(std::uint32_t)),
-            program, SLOT(decode_inst_addr(std::uint32_t)));
+            program, SLOT(decode_inst_addr(std::uint32_t)), ct);
     connect(machine->core(), SIGNAL(execute_inst_addr_value(std::uint32_t)),
-            program, SLOT(execute_inst_addr(std::uint32_t)));
+            program, SLOT(execute_inst_addr(std::uint32_t)), ct);
     connect(machine->core(), SIGNAL(memory_inst_addr_value(std::uint32_t)),
-            program, SLOT(memory_inst_addr(std::uint32_t)));
+            program, SLOT(memory_inst_addr(std::uint32_t)), ct);
     connect(machine->core(), SIGNAL(writeback_inst_addr_value(std::uint32_t)),
-            program, SLOT(writeback_inst_addr(std::uint32_t)));
-
-    // Set status to ready
-    machine_status(machine::QtMipsMachine::ST_READY);
+            program, SLOT(writeback_inst_addr(std::uint32_t)), ct);
 }
 
 bool MainWindow::configured() {
@@ -420,6 +448,7 @@ SHOW_HANDLER(memory, Qt::RightDockWidgetArea)
 SHOW_HANDLER(l1_cache_program, Qt::RightDockWidgetArea)
 SHOW_HANDLER(l1_cache_data, Qt::RightDockWidgetArea)
 SHOW_HANDLER(l2_cache, Qt::RightDockWidgetArea)
+SHOW_HANDLER(l3_cache, Qt::RightDockWidgetArea)
 SHOW_HANDLER(peripherals, Qt::RightDockWidgetArea)
 SHOW_HANDLER(terminal, Qt::RightDockWidgetArea)
 SHOW_HANDLER(lcd_display, Qt::RightDockWidgetArea)
@@ -450,6 +479,49 @@ void MainWindow::show_symbol_dialog(){
     gotosyboldialog->open();
 }
 
+void MainWindow::switch_core() {
+    if (machine == nullptr)
+        return;
+    machine->switch_core(!machine->core_is_pipelined());
+}
+
+void MainWindow::switch_core_at_symbol() {
+    if (machine == nullptr || machine->symbol_table() == nullptr)
+        return;
+    QStringList *symnames = machine->symbol_table()->names();
+    symnames->sort();
+    bool ok;
+    QString name = QInputDialog::getItem(this, "Switch Core at Symbol",
+                        machine->core_is_pipelined() ?
+                            "Continue on single cycle core at:" :
+                            "Continue on pipelined core at:",
+                        *symnames, 0, true, &ok);
+    delete symnames;
+    if (!ok || name.isEmpty())
+        return;
+    bool pipelined = !machine->core_is_pipelined();
+    if (machine->schedule_core_switch(pipelined, name))
+        return;
+    std::uint32_t address = name.toUInt(&ok, 0);
+    if (!ok) {
+        QMessageBox::warning(this, "Switch Core at Symbol",
+                             QString("Symbol \"%1\" not found.").arg(name));
+        return;
+    }
+    machine->schedule_core_switch(pipelined, address);
+}
+
+void MainWindow::core_switched(bool pipelined) {
+    (void)pipelined;
+    connect_core_signals();
+    // Rebuild core view for the new core
+    if (corescene != nullptr) {
+        delete corescene;
+        corescene = nullptr;
+        show_hide_coreview(coreview_shown);
+    }
+}
+
 void MainWindow::about_qtmips()
 {
     AboutDialog *aboutdialog = new AboutDialog(this);
@@ -561,6 +633,7 @@ void MainWindow::machine_status(enum machine::QtMipsMachine::Status st) {
         ui->actionRun->setEnabled(true);
         ui->actionStep->setEnabled(true);
         status = "Ready";
+        update_scheduler->flush();
         break;
     case machine::QtMipsMachine::ST_RUNNING:
         ui->actionPause->setEnabled(true);
@@ -574,10 +647,12 @@ void MainWindow::machine_status(enum machine::QtMipsMachine::Status st) {
     case machine::QtMipsMachine::ST_EXIT:
         // machine_exit is called so we disable controls in that
         status = "Exited";
+        update_scheduler->flush();
         break;
     case machine::QtMipsMachine::ST_TRAPPED:
         // machine_trap is called so we disable controls in that
         status = "Trapped";
+        update_scheduler->flush();
         break;
     default:
         status = "Unknown";
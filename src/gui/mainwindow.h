@@ -61,6 +61,7 @@
 #include "srceditor.h"
 #include "assembler/simpleasm.h"
 #include "cyclestatisticsdock.h"
+#include "updatescheduler.h"
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -104,12 +105,16 @@ public slots:
     void show_l1_cache_data();
     void show_l1_cache_program();
     void show_l2_cache();
+    void show_l3_cache();
     void show_peripherals();
     void show_terminal();
     void show_lcd_display();
     void show_cop0dock();
     void show_hide_coreview(bool show);
     void show_symbol_dialog();
+    void switch_core();
+    void switch_core_at_symbol();
+    void core_switched(bool pipelined);
     void show_messages();
     void show_predictor();
     void show_btb();
@@ -150,7 +155,7 @@ private:
     ProgramDock *program;
     MemoryDock *memory;
     CacheDock *l1_cache_program, *l1_cache_data;
-    CacheDock *l2_cache;
+    CacheDock *l2_cache, *l3_cache;
     PeripheralsDock *peripherals;
     TerminalDock *terminal;
     LcdDisplayDock *lcd_display;
@@ -159,6 +164,7 @@ private:
     BranchHistoryTableDock *predictor;
     BranchTargetBufferDock *btb;
     CycleStatisticsDock *cycle_stats;
+    UpdateScheduler *update_scheduler;
     bool load_default_settings;
     bool coreview_shown;
     SrcEditor  *current_srceditor;
@@ -170,6 +176,7 @@ private:
     machine::QtMipsMachine *machine; // Current simulated machine
 
     void show_dockwidget(QDockWidget *w, Qt::DockWidgetArea area = Qt::RightDockWidgetArea);
+    void connect_core_signals();
     void add_src_editor_to_tabs(SrcEditor *editor);
     void update_open_file_list();
     bool modified_file_list(QStringList &list, bool report_unnamed = false);
@@ -203,22 +203,53 @@ void MemoryModel::update_all() {
     emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
 }
 
+// Emit dataChanged only for rows which overlap given address range
+void MemoryModel::update_range(std::uint32_t start, std::uint32_t last) {
+    int row_first, row_last;
+    if (last < index0_offset)
+        return;
+    if (!get_row_for_address(row_first, start < index0_offset ? index0_offset : start) ||
+        row_first >= rowCount())
+        return;
+    get_row_for_address(row_last, last);
+    if (row_last >= rowCount())
+        row_last = rowCount() - 1;
+    emit dataChanged(index(row_first, 0), index(row_last, columnCount() - 1));
+}
+
 void MemoryModel::check_for_updates() {
     bool need_update = false;
+    bool ranges_known = true;
     const machine::MemoryAccess *mem;
+    const machine::Cache *cache;
+    QVector<machine::WriteLog::Range> ranges;
     mem = mem_access();
     if (mem == nullptr)
         return;
+    cache = machine->l1_data_cache();
 
-    if (memory_change_counter != mem->get_change_counter())
+    if (memory_change_counter != mem->get_change_counter()) {
         need_update = true;
-    if (machine->l1_data_cache() != nullptr) {
-        if (cache_data_change_counter != machine->l1_data_cache()->get_change_counter())
+        ranges_known = mem->get_changes_since(memory_change_counter, ranges);
+    }
+    if (cache != nullptr) {
+        if (cache_data_change_counter != cache->get_change_counter()) {
             need_update = true;
+            ranges_known = ranges_known &&
+                    cache->get_changes_since(cache_data_change_counter, ranges);
+        }
     }
     if (!need_update)
         return;
-    update_all();
+    if (!ranges_known) {
+        update_all();
+        return;
+    }
+    memory_change_counter = mem->get_change_counter();
+    if (cache != nullptr)
+        cache_data_change_counter = cache->get_change_counter();
+    for (const machine::WriteLog::Range &r : ranges)
+        update_range(r.start, r.last);
 }
 
 bool MemoryModel::adjustRowAndOffset(int &row, std::uint32_t address) {
@@ -117,6 +117,7 @@ signals:
 private:
     const machine::MemoryAccess *mem_access() const;
     machine::MemoryAccess *mem_access_rw() const;
+    void update_range(std::uint32_t start, std::uint32_t last);
     enum MemoryCellSize cell_size;
     unsigned int cells_per_row;
     std::uint32_t index0_offset;
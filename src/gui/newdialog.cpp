@@ -44,6 +44,7 @@
 
 #define MIN_BHT_BITS 5
 #define MAX_BHT_BITS 14
+#define MAX_BTB_WAYS 8
 
 NewDialog::NewDialog(QWidget *parent, QSettings *settings) : QDialog(parent) {
     setWindowTitle("New machine");
@@ -59,20 +60,48 @@ NewDialog::NewDialog(QWidget *parent, QSettings *settings) : QDialog(parent) {
     ui_l1_p_cache->write_policy->hide();
     // We assume L1 caches access time = CPU time and cannot be altered.
     ui_l1_p_cache->access_time->hide();
+    // Nothing is above L1 caches
+    ui_l1_p_cache->label_inclusion->hide();
+    ui_l1_p_cache->inclusion->hide();
+    ui_l1_p_cache->write_buffer->hide();
 
     ui_l1_d_cache = new Ui::NewDialogCache();
     ui_l1_d_cache->setupUi(ui->tab_l1_data_cache);
     // We assume L1 caches access time = CPU time and cannot be altered.
     ui_l1_d_cache->access_time->hide();
+    ui_l1_d_cache->label_inclusion->hide();
+    ui_l1_d_cache->inclusion->hide();
 
     ui_l2_cache = new Ui::NewDialogCache();
     ui_l2_cache->setupUi(ui->tab_l2_unified_cache);
-
-    ui->predictor_bits->addItem("1");
-    ui->predictor_bits->addItem("2");
+    // Write buffer is placed below L1 data cache
+    ui_l2_cache->write_buffer->hide();
+
+    // Deeper hierarchies are described in settings, dialog edits the first level below L2
+    ui_l3_cache = new Ui::NewDialogCache();
+    ui_l3_cache->setupUi(ui->tab_l3_unified_cache);
+    ui_l3_cache->write_buffer->hide();
+
+    // Order follows predictor values of MachineConfig::ControlHazardUnit
+    ui->predictor->addItem("1-bit");
+    ui->predictor->addItem("2-bit");
+    ui->predictor->addItem("gshare");
+    ui->predictor->addItem("Tournament");
+    ui->predictor->addItem("TAGE");
     for (size_t i = MIN_BHT_BITS ; i <= MAX_BHT_BITS ; i++) {
         ui->bht_bits->addItem(QString::number(i));
     }
+    ui->btb_bits->addItem("Same as BHT");
+    for (size_t i = MIN_BHT_BITS ; i <= MAX_BHT_BITS ; i++) {
+        ui->btb_bits->addItem(QString::number(i));
+    }
+    for (unsigned i = 1 ; i <= MAX_BTB_WAYS ; i <<= 1) {
+        ui->btb_associativity->addItem(QString::number(i));
+    }
+    // Order follows MachineConfigCache::ReplacementPolicy
+    ui->btb_replacement->addItem("Random");
+    ui->btb_replacement->addItem("LRU");
+    ui->btb_replacement->addItem("LFU");
     ui->resolution->addItem("ID");
     ui->resolution->addItem("EX");
 
@@ -89,6 +118,7 @@ NewDialog::NewDialog(QWidget *parent, QSettings *settings) : QDialog(parent) {
     connect(ui->reset_at_compile, SIGNAL(clicked(bool)), this, SLOT(reset_at_compile_change(bool)));
 
     connect(ui->pipelined, SIGNAL(clicked(bool)), this, SLOT(pipelined_change(bool)));
+    connect(ui->dual_issue_timing, SIGNAL(clicked(bool)), this, SLOT(dual_issue_timing_change(bool)));
     connect(ui->data_hazard_unit, SIGNAL(clicked(bool)), this, SLOT(data_hazard_unit_change()));
     connect(ui->data_hazard_stall, SIGNAL(clicked(bool)), this, SLOT(data_hazard_unit_change()));
     connect(ui->data_hazard_stall_forward, SIGNAL(clicked(bool)), this, SLOT(data_hazard_unit_change()));
@@ -97,15 +127,31 @@ NewDialog::NewDialog(QWidget *parent, QSettings *settings) : QDialog(parent) {
     connect(ui->stall, SIGNAL(clicked(bool)), this, SLOT(control_hazard_unit_change()));
     connect(ui->delay_slot, SIGNAL(clicked(bool)), this, SLOT(control_hazard_unit_change()));
     connect(ui->branch_predictor, SIGNAL(clicked(bool)), this, SLOT(control_hazard_unit_change()));
-    connect(ui->predictor_bits, SIGNAL(currentIndexChanged(QString)), this, SLOT(control_hazard_unit_change()));
+    connect(ui->predictor, SIGNAL(currentIndexChanged(QString)), this, SLOT(control_hazard_unit_change()));
     connect(ui->bht_bits, SIGNAL(currentIndexChanged(QString)), this, SLOT(control_hazard_unit_change()));
+    connect(ui->btb_bits, SIGNAL(currentIndexChanged(QString)), this, SLOT(control_hazard_unit_change()));
+    connect(ui->btb_associativity, SIGNAL(currentIndexChanged(QString)), this, SLOT(control_hazard_unit_change()));
+    connect(ui->btb_replacement, SIGNAL(currentIndexChanged(QString)), this, SLOT(control_hazard_unit_change()));
+    connect(ui->ras_depth, SIGNAL(valueChanged(int)), this, SLOT(control_hazard_unit_change()));
     connect(ui->resolution, SIGNAL(currentIndexChanged(QString)), this, SLOT(control_hazard_unit_change()));
+    connect(ui->mdu_model, SIGNAL(clicked(bool)), this, SLOT(mdu_model_change(bool)));
+    connect(ui->mdu_mul_latency, SIGNAL(valueChanged(int)), this, SLOT(mdu_mul_latency_change(int)));
+    connect(ui->mdu_mul_interval, SIGNAL(valueChanged(int)), this, SLOT(mdu_mul_interval_change(int)));
+    connect(ui->mdu_div_latency, SIGNAL(valueChanged(int)), this, SLOT(mdu_div_latency_change(int)));
+    connect(ui->mdu_div_interval, SIGNAL(valueChanged(int)), this, SLOT(mdu_div_interval_change(int)));
 
     connect(ui->mem_protec_exec, SIGNAL(clicked(bool)), this, SLOT(mem_protec_exec_change(bool)));
     connect(ui->mem_protec_write, SIGNAL(clicked(bool)), this, SLOT(mem_protec_write_change(bool)));
     connect(ui->mem_access_read, SIGNAL(valueChanged(int)), this, SLOT(mem_time_read_change(int)));
     connect(ui->mem_access_write, SIGNAL(valueChanged(int)), this, SLOT(mem_time_write_change(int)));
     connect(ui->mem_access_burst, SIGNAL(valueChanged(int)), this, SLOT(mem_time_burst_change(int)));
+    connect(ui->dram_model, SIGNAL(clicked(bool)), this, SLOT(dram_model_change(bool)));
+    connect(ui->dram_banks, SIGNAL(valueChanged(int)), this, SLOT(dram_banks_change(int)));
+    connect(ui->dram_row_bytes, SIGNAL(valueChanged(int)), this, SLOT(dram_row_bytes_change(int)));
+    connect(ui->dram_t_rcd, SIGNAL(valueChanged(int)), this, SLOT(dram_t_rcd_change(int)));
+    connect(ui->dram_t_cas, SIGNAL(valueChanged(int)), this, SLOT(dram_t_cas_change(int)));
+    connect(ui->dram_t_rp, SIGNAL(valueChanged(int)), this, SLOT(dram_t_rp_change(int)));
+    connect(ui->dram_page_policy, SIGNAL(currentIndexChanged(int)), this, SLOT(dram_page_policy_change(int)));
 
     connect(ui->osemu_enable, SIGNAL(clicked(bool)), this, SLOT(osemu_enable_change(bool)));
     connect(ui->osemu_known_syscall_stop, SIGNAL(clicked(bool)), this, SLOT(osemu_known_syscall_stop_change(bool)));
@@ -118,6 +164,7 @@ NewDialog::NewDialog(QWidget *parent, QSettings *settings) : QDialog(parent) {
     l1_p_cache_handler = new NewDialogCacheHandler(this, ui_l1_p_cache);
     l1_d_cache_handler = new NewDialogCacheHandler(this, ui_l1_d_cache);
     l2_u_cache_handler = new NewDialogCacheHandler(this, ui_l2_cache);
+    l3_u_cache_handler = new NewDialogCacheHandler(this, ui_l3_cache);
 
     // TODO remove this block when protections are implemented
     ui->mem_protec_exec->setVisible(false);
@@ -130,6 +177,7 @@ NewDialog::~NewDialog() {
     delete l1_p_cache_handler;
     delete l1_d_cache_handler;
     delete l2_u_cache_handler;
+    delete l3_u_cache_handler;
     delete ui;
     // Settings is freed by parent
     delete config;
@@ -260,6 +308,11 @@ void NewDialog::pipelined_change(bool val) {
     control_hazard_unit_change();
 }
 
+void NewDialog::dual_issue_timing_change(bool val) {
+    config->set_dual_issue_timing(val);
+    switch2custom();
+}
+
 void NewDialog::data_hazard_unit_change() {
     if (ui->data_hazard_unit->isChecked()) {
         config->set_data_hazard_unit(ui->data_hazard_stall->isChecked() ? machine::MachineConfig::DHU_STALL : machine::MachineConfig::DHU_STALL_FORWARD);
@@ -273,13 +326,18 @@ void NewDialog::control_hazard_unit_change() {
     if (config->pipelined()) {
         uint8_t bht_bits_num = 0;
         if (ui->branch_predictor->isChecked()) {
-            QString predictor_bits = ui->predictor_bits->currentText();
             QString bht_bits = ui->bht_bits->currentText();
 
-            config->set_control_hazard_unit(predictor_bits.toShort() == 1 ?
-                                            machine::MachineConfig::CHU_ONE_BIT_BP :
-                                            machine::MachineConfig::CHU_TWO_BIT_BP);
+            config->set_control_hazard_unit((machine::MachineConfig::ControlHazardUnit)
+                                            (machine::MachineConfig::CHU_ONE_BIT_BP + ui->predictor->currentIndex()));
             bht_bits_num = bht_bits.toShort();
+            // First item keeps BTB size bound to BHT size
+            config->set_btb_bits(ui->btb_bits->currentIndex() == 0 ? -1 :
+                                 ui->btb_bits->currentText().toShort());
+            config->set_btb_associativity(ui->btb_associativity->currentText().toUInt());
+            config->set_btb_replacement_policy((machine::MachineConfigCache::ReplacementPolicy)
+                                               ui->btb_replacement->currentIndex());
+            config->set_ras_depth(ui->ras_depth->value());
         } else if (ui->delay_slot->isChecked() || ui->none->isChecked()) {
             config->set_control_hazard_unit(machine::MachineConfig::CHU_DELAY_SLOT);
         } else {
@@ -300,6 +358,39 @@ void NewDialog::control_hazard_unit_change() {
     switch2custom();
 }
 
+void NewDialog::mdu_model_change(bool v) {
+    config->set_mdu_model(v);
+    switch2custom();
+}
+
+void NewDialog::mdu_mul_latency_change(int v) {
+    if (config->mdu_mul_latency() != (unsigned)v) {
+        config->set_mdu_mul_latency(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::mdu_mul_interval_change(int v) {
+    if (config->mdu_mul_interval() != (unsigned)v) {
+        config->set_mdu_mul_interval(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::mdu_div_latency_change(int v) {
+    if (config->mdu_div_latency() != (unsigned)v) {
+        config->set_mdu_div_latency(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::mdu_div_interval_change(int v) {
+    if (config->mdu_div_interval() != (unsigned)v) {
+        config->set_mdu_div_interval(v);
+        switch2custom();
+    }
+}
+
 void NewDialog::mem_protec_exec_change(bool v) {
     config->set_memory_execute_protection(v);
 	switch2custom();
@@ -331,6 +422,53 @@ void NewDialog::mem_time_burst_change(int v) {
     }
 }
 
+void NewDialog::dram_model_change(bool v) {
+    config->set_dram_model(v);
+    switch2custom();
+}
+
+void NewDialog::dram_banks_change(int v) {
+    if (config->dram_banks() != (unsigned)v) {
+        config->set_dram_banks(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::dram_row_bytes_change(int v) {
+    if (config->dram_row_bytes() != (unsigned)v) {
+        config->set_dram_row_bytes(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::dram_t_rcd_change(int v) {
+    if (config->dram_t_rcd() != (unsigned)v) {
+        config->set_dram_t_rcd(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::dram_t_cas_change(int v) {
+    if (config->dram_t_cas() != (unsigned)v) {
+        config->set_dram_t_cas(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::dram_t_rp_change(int v) {
+    if (config->dram_t_rp() != (unsigned)v) {
+        config->set_dram_t_rp(v);
+        switch2custom();
+    }
+}
+
+void NewDialog::dram_page_policy_change(int v) {
+    if (config->dram_page_policy() != v) {
+        config->set_dram_page_policy((machine::MachineConfig::DramPagePolicy)v);
+        switch2custom();
+    }
+}
+
 void NewDialog::osemu_enable_change(bool v) {
     config->set_osemu_enable(v);
 }
@@ -376,23 +514,41 @@ void NewDialog::config_gui() {
     ui->reset_at_compile->setChecked(config->reset_at_compile());
     // Core
     ui->pipelined->setChecked(config->pipelined());
+    ui->dual_issue_timing->setChecked(config->dual_issue_timing());
     ui->data_hazard_unit->setChecked(config->data_hazard_unit() != machine::MachineConfig::DHU_NONE);
     ui->data_hazard_stall->setChecked(config->data_hazard_unit() == machine::MachineConfig::DHU_STALL);
     ui->data_hazard_stall_forward->setChecked(config->data_hazard_unit() == machine::MachineConfig::DHU_STALL_FORWARD);
     if (config->predictor()) {
         ui->branch_predictor->setChecked(true);
-        bool old_state = ui->predictor_bits->blockSignals(true);
-        ui->predictor_bits->setCurrentIndex(config->control_hazard_unit() == machine::MachineConfig::CHU_ONE_BIT_BP ? 0 : 1);
-        ui->predictor_bits->blockSignals(old_state);
+        bool old_state = ui->predictor->blockSignals(true);
+        ui->predictor->setCurrentIndex(config->control_hazard_unit() - machine::MachineConfig::CHU_ONE_BIT_BP);
+        ui->predictor->blockSignals(old_state);
         old_state = ui->bht_bits->blockSignals(true);
         ui->bht_bits->setCurrentIndex(config->bht_bits() - MIN_BHT_BITS);
         ui->bht_bits->blockSignals(old_state);
+        old_state = ui->btb_bits->blockSignals(true);
+        ui->btb_bits->setCurrentIndex(config->btb_bits() < 0 ? 0 : config->btb_bits() - MIN_BHT_BITS + 1);
+        ui->btb_bits->blockSignals(old_state);
+        old_state = ui->btb_associativity->blockSignals(true);
+        ui->btb_associativity->setCurrentText(QString::number(config->btb_associativity()));
+        ui->btb_associativity->blockSignals(old_state);
+        old_state = ui->btb_replacement->blockSignals(true);
+        ui->btb_replacement->setCurrentIndex(config->btb_replacement_policy());
+        ui->btb_replacement->blockSignals(old_state);
+        old_state = ui->ras_depth->blockSignals(true);
+        ui->ras_depth->setValue(config->ras_depth());
+        ui->ras_depth->blockSignals(old_state);
     } else {
         ui->none->setChecked(config->control_hazard_unit() == machine::MachineConfig::CHU_NONE);
         ui->stall->setChecked(config->control_hazard_unit() == machine::MachineConfig::CHU_STALL);
         ui->delay_slot->setChecked(config->control_hazard_unit() == machine::MachineConfig::CHU_DELAY_SLOT);
     }
     ui->resolution->setCurrentIndex(config->branch_res_id() ? 0 : 1);
+    ui->mdu_model->setChecked(config->mdu_model());
+    ui->mdu_mul_latency->setValue(config->mdu_mul_latency());
+    ui->mdu_mul_interval->setValue(config->mdu_mul_interval());
+    ui->mdu_div_latency->setValue(config->mdu_div_latency());
+    ui->mdu_div_interval->setValue(config->mdu_div_interval());
 
     // Memory
     ui->mem_protec_exec->setChecked(config->memory_execute_protection());
@@ -400,12 +556,22 @@ void NewDialog::config_gui() {
     ui->mem_access_read->setValue(config->ram_access_read());
     ui->mem_access_write->setValue(config->ram_access_write());
     ui->mem_access_burst->setValue(config->ram_access_burst());
+    ui->dram_model->setChecked(config->dram_model());
+    ui->dram_banks->setValue(config->dram_banks());
+    ui->dram_row_bytes->setValue(config->dram_row_bytes());
+    ui->dram_t_rcd->setValue(config->dram_t_rcd());
+    ui->dram_t_cas->setValue(config->dram_t_cas());
+    ui->dram_t_rp->setValue(config->dram_t_rp());
+    ui->dram_page_policy->setCurrentIndex(config->dram_page_policy());
     // Cache
     l1_d_cache_handler->config_gui();
     l1_p_cache_handler->config_gui();
     l2_u_cache_handler->config_gui(config->l2_unified_cache().mem_access_read(),
                                    config->l2_unified_cache().mem_access_write(),
                                    config->l2_unified_cache().mem_access_burst());
+    l3_u_cache_handler->config_gui(config->lower_cache(0).mem_access_read(),
+                                   config->lower_cache(0).mem_access_write(),
+                                   config->lower_cache(0).mem_access_burst());
     // Operating system and exceptions
     ui->osemu_enable->setChecked(config->osemu_enable());
     ui->osemu_known_syscall_stop->setChecked(config->osemu_known_syscall_stop());
@@ -421,10 +587,20 @@ void NewDialog::config_gui() {
     ui->branch_predictor->setEnabled(config->pipelined());
     ui->bht_bits_label->setEnabled(config->predictor());
     ui->bht_bits->setEnabled(config->predictor());
-    ui->predictor_bits_label->setEnabled(config->predictor());
-    ui->predictor_bits->setEnabled(config->predictor());
+    ui->predictor_label->setEnabled(config->predictor());
+    ui->predictor->setEnabled(config->predictor());
+    ui->btb_bits_label->setEnabled(config->predictor());
+    ui->btb_bits->setEnabled(config->predictor());
+    ui->btb_associativity_label->setEnabled(config->predictor());
+    ui->btb_associativity->setEnabled(config->predictor());
+    ui->btb_replacement_label->setEnabled(config->predictor());
+    ui->btb_replacement->setEnabled(config->predictor());
+    ui->ras_depth_label->setEnabled(config->predictor());
+    ui->ras_depth->setEnabled(config->predictor());
     ui->resolution_label->setEnabled(config->pipelined());
     ui->resolution->setEnabled(config->pipelined());
+    ui->mdu_model->setEnabled(config->pipelined());
+    ui->dual_issue_timing->setEnabled(!config->pipelined());
 }
 
 unsigned NewDialog::preset_number() {
@@ -451,6 +627,9 @@ void NewDialog::load_settings() {
     l1_d_cache_handler->set_config(config->access_l1_data_cache());
     l1_p_cache_handler->set_config(config->access_l1_program_cache());
     l2_u_cache_handler->set_config(config->access_l2_unified_cache());
+    if (config->lower_cache_count() == 0)
+        config->set_lower_cache_count(1);
+    l3_u_cache_handler->set_config(config->access_lower_cache(0));
 
     // Load preset
     unsigned preset = settings->value("Preset", 1).toUInt();
@@ -503,6 +682,13 @@ NewDialogCacheHandler::NewDialogCacheHandler(NewDialog *nd, Ui::NewDialogCache *
     connect(cache_ui->access_read, SIGNAL(valueChanged(int)), this, SLOT(access_read(int)));
     connect(cache_ui->access_write, SIGNAL(valueChanged(int)), this, SLOT(access_write(int)));
     connect(cache_ui->access_burst, SIGNAL(valueChanged(int)), this, SLOT(access_burst(int)));
+    connect(cache_ui->prefetcher, SIGNAL(activated(int)), this, SLOT(prefetcher(int)));
+    connect(cache_ui->prefetch_degree, SIGNAL(valueChanged(int)), this, SLOT(prefetch_degree(int)));
+    connect(cache_ui->prefetch_distance, SIGNAL(valueChanged(int)), this, SLOT(prefetch_distance(int)));
+    connect(cache_ui->inclusion, SIGNAL(activated(int)), this, SLOT(inclusion(int)));
+    connect(cache_ui->victim_entries, SIGNAL(valueChanged(int)), this, SLOT(victim_entries(int)));
+    connect(cache_ui->write_buffer_entries, SIGNAL(valueChanged(int)), this, SLOT(write_buffer_entries(int)));
+    connect(cache_ui->write_buffer_drain, SIGNAL(activated(int)), this, SLOT(write_buffer_drain(int)));
 }
 
 void NewDialogCacheHandler::set_config(machine::MachineConfigCache *config) {
@@ -520,6 +706,13 @@ void NewDialogCacheHandler::config_gui(int time_read, int time_write, int time_b
     cache_ui->access_read->setValue(time_read);
     cache_ui->access_write->setValue(time_write);
     cache_ui->access_burst->setValue(time_burst);
+    cache_ui->prefetcher->setCurrentIndex((int)config->prefetcher());
+    cache_ui->prefetch_degree->setValue(config->prefetch_degree());
+    cache_ui->prefetch_distance->setValue(config->prefetch_distance());
+    cache_ui->inclusion->setCurrentIndex((int)config->inclusion());
+    cache_ui->victim_entries->setValue(config->victim_entries());
+    cache_ui->write_buffer_entries->setValue(config->write_buffer_entries());
+    cache_ui->write_buffer_drain->setCurrentIndex((int)config->write_buffer_drain());
 }
 
 void NewDialogCacheHandler::enabled(bool val) {
@@ -556,6 +749,8 @@ void NewDialogCacheHandler::enabled(bool val) {
                 }
             }
             break;
+        case machine::MemoryAccess::MemoryType::LOWER_CACHE:
+            break;
         default:
             SANITY_ASSERT(0, "Debug me :)");
     }
@@ -607,3 +802,38 @@ void NewDialogCacheHandler::access_burst(int val) {
     config->set_mem_access_burst(val);
     nd->switch2custom();
 }
+
+void NewDialogCacheHandler::prefetcher(int val) {
+    config->set_prefetcher((enum machine::MachineConfigCache::PrefetcherType)val);
+    nd->switch2custom();
+}
+
+void NewDialogCacheHandler::prefetch_degree(int val) {
+    config->set_prefetch_degree(val);
+    nd->switch2custom();
+}
+
+void NewDialogCacheHandler::prefetch_distance(int val) {
+    config->set_prefetch_distance(val);
+    nd->switch2custom();
+}
+
+void NewDialogCacheHandler::inclusion(int val) {
+    config->set_inclusion((enum machine::MachineConfigCache::InclusionPolicy)val);
+    nd->switch2custom();
+}
+
+void NewDialogCacheHandler::victim_entries(int val) {
+    config->set_victim_entries(val);
+    nd->switch2custom();
+}
+
+void NewDialogCacheHandler::write_buffer_entries(int val) {
+    config->set_write_buffer_entries(val);
+    nd->switch2custom();
+}
+
+void NewDialogCacheHandler::write_buffer_drain(int val) {
+    config->set_write_buffer_drain((enum machine::MachineConfigCache::WriteBufferDrain)val);
+    nd->switch2custom();
+}
@@ -71,13 +71,26 @@ private slots:
     void elf_change(const QString& val);
     void set_preset();
     void pipelined_change(bool);
+    void dual_issue_timing_change(bool);
     void data_hazard_unit_change();
     void control_hazard_unit_change();
+    void mdu_model_change(bool);
+    void mdu_mul_latency_change(int);
+    void mdu_mul_interval_change(int);
+    void mdu_div_latency_change(int);
+    void mdu_div_interval_change(int);
     void mem_protec_exec_change(bool);
     void mem_protec_write_change(bool);
     void mem_time_read_change(int);
     void mem_time_write_change(int);
     void mem_time_burst_change(int);
+    void dram_model_change(bool);
+    void dram_banks_change(int);
+    void dram_row_bytes_change(int);
+    void dram_t_rcd_change(int);
+    void dram_t_cas_change(int);
+    void dram_t_rp_change(int);
+    void dram_page_policy_change(int);
     void osemu_enable_change(bool);
     void osemu_known_syscall_stop_change(bool);
     void osemu_unknown_syscall_stop_change(bool);
@@ -90,7 +103,7 @@ private slots:
 private:
     Ui::NewDialog *ui;
     Ui::NewDialogCache *ui_l1_p_cache, *ui_l1_d_cache;
-    Ui::NewDialogCache *ui_l2_cache;
+    Ui::NewDialogCache *ui_l2_cache, *ui_l3_cache;
     QSettings *settings;
     bool default_settings; // Whether or not to use previous settings or default.
 
@@ -101,7 +114,7 @@ private:
     void load_settings();
     void store_settings();
     NewDialogCacheHandler *l1_p_cache_handler, *l1_d_cache_handler;
-    NewDialogCacheHandler *l2_u_cache_handler;
+    NewDialogCacheHandler *l2_u_cache_handler, *l3_u_cache_handler;
 };
 
 class NewDialogCacheHandler : QObject {
@@ -124,6 +137,13 @@ private slots:
     void access_read(int);
     void access_write(int);
     void access_burst(int);
+    void prefetcher(int);
+    void prefetch_degree(int);
+    void prefetch_distance(int);
+    void inclusion(int);
+    void victim_entries(int);
+    void write_buffer_entries(int);
+    void write_buffer_drain(int);
 
 private:
 	NewDialog *nd;
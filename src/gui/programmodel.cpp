@@ -44,8 +44,10 @@ ProgramModel::ProgramModel(QObject *parent)
     machine = nullptr;
     memory_change_counter = 0;
     cache_program_change_counter = 0;
-    for (int i = 0 ; i < STAGEADDR_COUNT; i++)
+    for (int i = 0 ; i < STAGEADDR_COUNT; i++) {
         stage_addr[i] = machine::STAGEADDR_NONE;
+        stage_addr_shown[i] = machine::STAGEADDR_NONE;
+    }
     stages_need_update = false;
 }
 
@@ -190,26 +192,72 @@ void ProgramModel::update_all() {
         if (machine->l1_program_cache() != nullptr)
             cache_program_change_counter = machine->l1_program_cache()->get_change_counter();
     }
+    for (int i = 0 ; i < STAGEADDR_COUNT; i++)
+        stage_addr_shown[i] = stage_addr[i];
     stages_need_update = false;
     emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
 }
 
+// Emit dataChanged only for rows which overlap given address range
+void ProgramModel::update_range(std::uint32_t start, std::uint32_t last) {
+    int row_first, row_last;
+    if (last < index0_offset)
+        return;
+    if (!get_row_for_address(row_first, start < index0_offset ? index0_offset : start) ||
+        row_first >= rowCount())
+        return;
+    get_row_for_address(row_last, last);
+    if (row_last >= rowCount())
+        row_last = rowCount() - 1;
+    emit dataChanged(index(row_first, 0), index(row_last, columnCount() - 1));
+}
+
 void ProgramModel::check_for_updates() {
     bool need_update = stages_need_update;
+    bool ranges_known = true;
     const machine::MemoryAccess *mem;
+    const machine::Cache *cache;
+    QVector<machine::WriteLog::Range> ranges;
     mem = mem_access();
     if (mem == nullptr)
         return;
+    cache = machine->l1_program_cache();
 
-    if (memory_change_counter != mem->get_change_counter())
+    if (memory_change_counter != mem->get_change_counter()) {
         need_update = true;
-    if (machine->l1_data_cache() != nullptr) {
-        if (cache_program_change_counter != machine->l1_data_cache()->get_change_counter())
+        ranges_known = mem->get_changes_since(memory_change_counter, ranges);
+    }
+    if (cache != nullptr) {
+        if (cache_program_change_counter != cache->get_change_counter()) {
             need_update = true;
+            ranges_known = ranges_known &&
+                    cache->get_changes_since(cache_program_change_counter, ranges);
+        }
     }
     if (!need_update)
         return;
-    update_all();
+    if (!ranges_known) {
+        update_all();
+        return;
+    }
+    memory_change_counter = mem->get_change_counter();
+    if (cache != nullptr)
+        cache_program_change_counter = cache->get_change_counter();
+    if (stages_need_update) {
+        // Repaint only rows which lost or gained stage highlight
+        for (int i = 0 ; i < STAGEADDR_COUNT; i++) {
+            if (stage_addr_shown[i] == stage_addr[i])
+                continue;
+            if (stage_addr_shown[i] != machine::STAGEADDR_NONE)
+                update_range(stage_addr_shown[i], stage_addr_shown[i]);
+            if (stage_addr[i] != machine::STAGEADDR_NONE)
+                update_range(stage_addr[i], stage_addr[i]);
+            stage_addr_shown[i] = stage_addr[i];
+        }
+        stages_need_update = false;
+    }
+    for (const machine::WriteLog::Range &r : ranges)
+        update_range(r.start, r.last);
 }
 
 bool ProgramModel::adjustRowAndOffset(int &row, std::uint32_t address) {
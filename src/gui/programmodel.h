@@ -104,12 +104,14 @@ public slots:
 private:
     const machine::MemoryAccess *mem_access() const;
     machine::MemoryAccess *mem_access_rw() const;
+    void update_range(std::uint32_t start, std::uint32_t last);
     std::uint32_t index0_offset;
     QFont data_font;
     machine::QtMipsMachine *machine;
     std::uint32_t memory_change_counter;
     std::uint32_t cache_program_change_counter;
     std::uint32_t stage_addr[STAGEADDR_COUNT];
+    std::uint32_t stage_addr_shown[STAGEADDR_COUNT];
     bool stages_need_update;
 };
 
@@ -223,6 +223,10 @@ void RegistersDock::clear_highlights() {
     lo_highlighted = false;
 }
 
+void RegistersDock::refresh() {
+    notation_change(notation->currentIndex());
+}
+
 void RegistersDock::notation_change(std::int32_t idx) {
     if (regs) {
         int base;
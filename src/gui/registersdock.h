@@ -55,6 +55,9 @@ public:
 
     void setup(machine::QtMipsMachine *machine);
 
+public slots:
+    void refresh(); // Reload all values from registers
+
 private slots:
     void pc_changed(std::uint32_t val);
     void gp_changed(std::uint8_t i, std::uint32_t val);
@@ -40,8 +40,11 @@
 #include "serialport.h"
 #include "terminaldock.h"
 
+#define TX_RING_SIZE 65536
+#define SCROLLBACK_LINES_DEFAULT 10000
+#define FLUSH_INTERVAL 16
+
 TerminalDock::TerminalDock(QWidget *parent, QSettings *settings) : QDockWidget(parent) {
-    (void)settings;
     top_widget = new QWidget(this);
     setWidget(top_widget);
     layout_box = new QVBoxLayout(top_widget);
@@ -49,6 +52,9 @@ TerminalDock::TerminalDock(QWidget *parent, QSettings *settings) : QDockWidget(p
     terminal_text = new QTextEdit(top_widget);
     terminal_text->setMinimumSize(30, 30);
     layout_box->addWidget(terminal_text);
+    // Document drops the oldest lines itself when the limit is reached
+    terminal_text->document()->setMaximumBlockCount(
+                settings->value("TerminalScrollbackLines", SCROLLBACK_LINES_DEFAULT).toInt());
     append_cursor = new QTextCursor(terminal_text->document());
     layout_bottom_box = new QHBoxLayout();
     layout_bottom_box->addWidget(new QLabel("Input:"));
@@ -56,12 +62,21 @@ TerminalDock::TerminalDock(QWidget *parent, QSettings *settings) : QDockWidget(p
     layout_bottom_box->addWidget(input_edit);
     layout_box->addLayout(layout_bottom_box);
 
+    tx_ring = new char[TX_RING_SIZE];
+    tx_head = 0;
+    tx_count = 0;
+    flush_t = new QTimer(this);
+    flush_t->setSingleShot(true);
+    flush_t->setInterval(FLUSH_INTERVAL);
+    connect(flush_t, SIGNAL(timeout()), this, SLOT(flush_output()));
+
     setObjectName("Terminal");
     setWindowTitle("Terminal");
 }
 
 TerminalDock::~TerminalDock() {
     delete append_cursor;
+    delete[] tx_ring;
 }
 
 void TerminalDock::setup(machine::SerialPort *ser_port) {
@@ -75,11 +90,28 @@ void TerminalDock::setup(machine::SerialPort *ser_port) {
 }
 
 void TerminalDock::tx_byte(unsigned int data) {
+    if (tx_count == TX_RING_SIZE) {
+        // Would be trimmed from scrollback anyway
+        tx_head = (tx_head + 1) % TX_RING_SIZE;
+        tx_count--;
+    }
+    tx_ring[(tx_head + tx_count) % TX_RING_SIZE] = data;
+    tx_count++;
+    if (!flush_t->isActive())
+        flush_t->start();
+}
+
+void TerminalDock::flush_output() {
     bool at_end = terminal_text->textCursor().atEnd();
-    if (data == '\n')
-        append_cursor->insertBlock();
-    else
-        append_cursor->insertText(QString(QChar(data)));
+    while (tx_count > 0) {
+        unsigned int len = TX_RING_SIZE - tx_head;
+        if (len > tx_count)
+            len = tx_count;
+        // Newlines are turned into new blocks by insertText
+        append_cursor->insertText(QString::fromLatin1(tx_ring + tx_head, len));
+        tx_head = (tx_head + len) % TX_RING_SIZE;
+        tx_count -= len;
+    }
     if (at_end) {
         QTextCursor cursor = QTextCursor(terminal_text->document());
         cursor.movePosition(QTextCursor::End);
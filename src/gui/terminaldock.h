@@ -42,6 +42,7 @@
 #include <QLineEdit>
 #include <QTextEdit>
 #include <QTextCursor>
+#include <QTimer>
 #include "qtmipsmachine.h"
 
 class TerminalDock : public QDockWidget {
@@ -57,6 +58,9 @@ public slots:
     void tx_byte(int fd, unsigned int data);
     void rx_byte_pool(int fd, unsigned int &data, bool &available);
 
+private slots:
+    void flush_output();
+
 private:
     QVBoxLayout *layout_box;
     QHBoxLayout *layout_bottom_box;
@@ -65,6 +69,11 @@ private:
     QTextEdit *terminal_text;
     QTextCursor *append_cursor;
     QLineEdit *input_edit;
+    // Output waiting for next frame, oldest bytes are dropped when full
+    char *tx_ring;
+    unsigned int tx_head;
+    unsigned int tx_count;
+    QTimer *flush_t;
 };
 
 #endif // TERMINALDOCK_H
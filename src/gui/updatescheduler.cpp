@@ -0,0 +1,98 @@
+#include "updatescheduler.h"
+#include <QDockWidget>
+
+#define FRAME_INTERVAL_DEFAULT 16
+
+UpdateScheduler::UpdateScheduler(QObject *parent, QSettings *settings) : QObject(parent) {
+    this->settings = settings;
+    frame_t = new QTimer(this);
+    frame_t->setSingleShot(false);
+    frame_t->setInterval(settings->value("ViewUpdateInterval/Frame", FRAME_INTERVAL_DEFAULT).toInt());
+    connect(frame_t, SIGNAL(timeout()), this, SLOT(frame()));
+}
+
+void UpdateScheduler::add_view(const QString &name, QWidget *view, QObject *receiver, const char *method) {
+    View v;
+
+    v.name = name;
+    v.widget = view;
+    v.receiver = receiver;
+    v.method = method;
+    v.min_interval = settings->value("ViewUpdateInterval/" + name, 0).toInt();
+    v.dirty = false;
+    v.last.invalidate();
+    views.append(v);
+
+    // Showing a dock (tab switch, restore) does not mark anything dirty
+    QDockWidget *dock = qobject_cast<QDockWidget *>(view);
+    if (dock != nullptr)
+        connect(dock, SIGNAL(visibilityChanged(bool)), this, SLOT(view_visibility_changed(bool)));
+}
+
+void UpdateScheduler::set_view_interval(const QString &name, int msec) {
+    for (View &v : views) {
+        if (v.name == name)
+            v.min_interval = msec;
+    }
+    settings->setValue("ViewUpdateInterval/" + name, msec);
+}
+
+int UpdateScheduler::view_interval(const QString &name) const {
+    for (const View &v : views) {
+        if (v.name == name)
+            return v.min_interval;
+    }
+    return 0;
+}
+
+void UpdateScheduler::mark_dirty() {
+    for (View &v : views)
+        v.dirty = true;
+    if (!frame_t->isActive())
+        frame_t->start();
+}
+
+void UpdateScheduler::flush() {
+    frame_t->stop();
+    for (View &v : views) {
+        if (v.dirty)
+            refresh(v);
+    }
+}
+
+void UpdateScheduler::frame() {
+    bool pending = false;
+
+    for (View &v : views) {
+        if (!v.dirty)
+            continue;
+        if (v.widget.isNull() || !v.widget->isVisible())
+            continue;
+        if (v.last.isValid() && v.last.elapsed() < v.min_interval) {
+            pending = true;
+            continue;
+        }
+        refresh(v);
+    }
+    // Nothing visible is waiting, next mark_dirty() restarts the timer.
+    if (!pending)
+        frame_t->stop();
+}
+
+void UpdateScheduler::view_visibility_changed(bool visible) {
+    if (!visible || frame_t->isActive())
+        return;
+    for (const View &v : views) {
+        if (v.dirty && v.widget.data() == sender()) {
+            frame_t->start();
+            return;
+        }
+    }
+}
+
+void UpdateScheduler::refresh(View &v) {
+    v.dirty = false;
+    v.last.start();
+    if (!v.receiver.isNull())
+        QMetaObject::invokeMethod(v.receiver, v.method);
+}
@@ -0,0 +1,52 @@
+#ifndef UPDATESCHEDULER_H
+#define UPDATESCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QSettings>
+#include <QVector>
+#include <QWidget>
+
+// Collects "views are stale" notifications from the machine and refreshes
+// every registered view at most once per frame. Each view can be throttled
+// further by its own minimal interval (settings key ViewUpdateInterval/<name>).
+// Hidden views stay dirty until they are shown or the scheduler is flushed,
+// dock widgets are refreshed as soon as they become visible.
+class UpdateScheduler : public QObject {
+    Q_OBJECT
+public:
+    UpdateScheduler(QObject *parent, QSettings *settings);
+
+    void add_view(const QString &name, QWidget *view, QObject *receiver, const char *method);
+    void set_view_interval(const QString &name, int msec);
+    int view_interval(const QString &name) const;
+
+public slots:
+    void mark_dirty(); // Mark all views as stale and schedule refresh
+    void flush(); // Refresh all stale views immediately, ignoring throttling
+
+private slots:
+    void frame();
+    void view_visibility_changed(bool visible);
+
+private:
+    struct View {
+        QString name;
+        QPointer<QWidget> widget;
+        QPointer<QObject> receiver;
+        const char *method; // Name of the refresh slot
+        int min_interval;
+        QElapsedTimer last;
+        bool dirty;
+    };
+
+    void refresh(View &v);
+
+    QSettings *settings;
+    QTimer *frame_t;
+    QVector<View> views;
+};
+
+#endif // UPDATESCHEDULER_H
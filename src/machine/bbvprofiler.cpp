@@ -0,0 +1,133 @@
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+#include "bbvprofiler.h"
+#include "qtmipsexception.h"
+
+using namespace machine;
+
+BbvProfiler::BbvProfiler(std::uint64_t interval, bool delay_slot) {
+    SANITY_ASSERT(interval > 0, "BBV interval can't be empty");
+    interval_len = interval;
+    this->delay_slot = delay_slot;
+    reset();
+}
+
+void BbvProfiler::reset() {
+    interval_count = 0;
+    block_start = 0;
+    last_addr = 0;
+    block_len = 0;
+    until_block_end = -1;
+    block_ids.clear();
+    blocks.clear();
+    current.clear();
+    intervals.clear();
+}
+
+void BbvProfiler::retire(std::uint32_t inst_addr, const Instruction &inst) {
+    // Block ends after branch (and its delay slot) or on any discontinuity
+    // of the instruction stream (exception, eret, core switch)
+    if (block_len != 0 && (until_block_end == 0 || inst_addr != last_addr + 4))
+        close_block();
+    if (block_len == 0)
+        block_start = inst_addr;
+    block_len++;
+    last_addr = inst_addr;
+    if (until_block_end > 0)
+        until_block_end--;
+    if (inst.flags() & (IMF_BRANCH | IMF_JUMP))
+        until_block_end = delay_slot ? 1 : 0;
+
+    if (++interval_count >= interval_len)
+        close_interval();
+}
+
+void BbvProfiler::close_block() {
+    unsigned id = block_ids.value(block_start, 0);
+    if (id == 0) {
+        blocks.append(block_start);
+        id = blocks.size();
+        block_ids.insert(block_start, id);
+    }
+    current[id] += block_len;
+    block_len = 0;
+    until_block_end = -1;
+}
+
+void BbvProfiler::close_interval() {
+    // Block crossing the interval boundary is split between both intervals
+    if (block_len != 0) {
+        int until_end = until_block_end;
+        close_block();
+        if (until_end > 0)
+            until_block_end = until_end; // Delay slot belongs to the next part
+    }
+    Vector v;
+    v.reserve(current.size());
+    for (auto it = current.cbegin(); it != current.cend(); ++it)
+        v.append(qMakePair(it.key(), it.value()));
+    std::sort(v.begin(), v.end());
+    intervals.append(v);
+    current.clear();
+    interval_count = 0;
+}
+
+void BbvProfiler::finish() {
+    if (interval_count != 0)
+        close_interval();
+}
+
+std::uint64_t BbvProfiler::interval() const {
+    return interval_len;
+}
+
+const QVector<BbvProfiler::Vector> &BbvProfiler::vectors() const {
+    return intervals;
+}
+
+std::uint32_t BbvProfiler::block_address(unsigned id) const {
+    SANITY_ASSERT(id > 0 && id <= (unsigned)blocks.size(), "Unknown basic block id");
+    return blocks[id - 1];
+}
+
+void BbvProfiler::save(const QString &path) const {
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+        throw QTMIPS_EXCEPTION(Input, "Can't open BBV file for writing", path);
+    QTextStream out(&f);
+    for (const Vector &v : intervals) {
+        out << "T";
+        for (const auto &e : v)
+            out << ":" << e.first << ":" << e.second << " ";
+        out << "\n";
+    }
+}
+
+QVector<BbvProfiler::Vector> BbvProfiler::load(const QString &path) {
+    QFile f(path);
+    QVector<Vector> res;
+    if (!f.open(QIODevice::ReadOnly | QIODevice::Text))
+        throw QTMIPS_EXCEPTION(Input, "Can't open BBV file for reading", path);
+    QTextStream in(&f);
+    unsigned line_num = 0;
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        line_num++;
+        if (!line.startsWith("T"))
+            continue; // Comments and other records of the format are ignored
+        Vector v;
+        for (const QString &tok : line.mid(1).split(' ', QString::SkipEmptyParts)) {
+            QStringList parts = tok.split(':', QString::SkipEmptyParts);
+            bool ok_id = false, ok_count = false;
+            unsigned id = parts.size() == 2 ? parts[0].toUInt(&ok_id) : 0;
+            std::uint64_t count = parts.size() == 2 ? parts[1].toULongLong(&ok_count) : 0;
+            if (parts.size() != 2 || !ok_id || !ok_count || id == 0)
+                throw QTMIPS_EXCEPTION(Input, "Invalid BBV record",
+                                       QString("%1:%2").arg(path).arg(line_num));
+            v.append(qMakePair(id, count));
+        }
+        res.append(v);
+    }
+    return res;
+}
@@ -0,0 +1,52 @@
+#ifndef BBVPROFILER_H
+#define BBVPROFILER_H
+
+#include <QVector>
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <cstdint>
+#include "instruction.h"
+
+namespace machine {
+
+// Collects basic block vectors of retired instructions. Program is split into
+// intervals of fixed instruction count, every interval is described by number
+// of instructions executed in each basic block. Vectors are stored in SimPoint
+// .bb format ("T:id:count :id:count ...", ids are counted from 1).
+class BbvProfiler {
+public:
+    typedef QVector<QPair<unsigned, std::uint64_t>> Vector; // Block id and instruction count
+
+    BbvProfiler(std::uint64_t interval = 100000, bool delay_slot = true);
+
+    void retire(std::uint32_t inst_addr, const Instruction &inst);
+    void finish(); // Store last incomplete interval
+    void reset();
+
+    std::uint64_t interval() const;
+    const QVector<Vector> &vectors() const;
+    std::uint32_t block_address(unsigned id) const;
+
+    void save(const QString &path) const; // Throws Input exception on failure
+    static QVector<Vector> load(const QString &path);
+
+private:
+    void close_block();
+    void close_interval();
+
+    std::uint64_t interval_len;
+    bool delay_slot;
+    std::uint64_t interval_count; // Instructions in current interval
+    std::uint32_t block_start, last_addr;
+    std::uint64_t block_len;
+    int until_block_end; // Instructions left in block after branch, -1 if not known
+    QHash<std::uint32_t, unsigned> block_ids;
+    QVector<std::uint32_t> blocks; // Address of block by id - 1
+    QHash<unsigned, std::uint64_t> current;
+    QVector<Vector> intervals;
+};
+
+}
+
+#endif // BBVPROFILER_H
@@ -1,5 +1,6 @@
 #include "branchpredictor.h"
 #include "branchtargetbuffer.h"
+#include "returnaddressstack.h"
 
 #include <QDebug>
 
@@ -7,15 +8,21 @@ using namespace machine;
 
 BranchPredictor::BranchPredictor(std::uint8_t bht_bits) {
     this->btb_impl = std::make_shared<BranchTargetBuffer>(bht_bits);
+    this->ras_impl = nullptr;
     this->bht_bits = bht_bits;
     this->bht_size = power_of_2(this->bht_bits);
     this->bht = new std::uint8_t[this->bht_size]();
     this->predictions = 0;
     this->correct_predictions = 0;
+    this->flushed_cycles = 0;
+    this->btb_saved = 0;
+    this->ras_saved = 0;
+    this->j_info = JumpInfo();
 }
 
 BranchPredictor::~BranchPredictor() {
     delete[] this->bht;
+    delete this->ras_impl;
 }
 
 uint32_t BranchPredictor::bht_idx(std::uint32_t pc, bool ro) {
@@ -45,19 +52,36 @@ std::uint32_t BranchPredictor::predict(const machine::Instruction &bj_instr, std
     emit pred_accessed_bht(idx);
 
     if (jmp) {
-        j_info.btb_miss = !btb_impl->pc_address(pc, &address);
+        // JR $31 is the only return, any JAL or JALR is a call
+        bool ret = bj_instr.opcode() == 0 && bj_instr.funct() == 8 && bj_instr.rs() == 31;
+        bool call = (bj_instr.flags() & IMF_PC_TO_R31) || (bj_instr.opcode() == 0 && bj_instr.funct() == 9);
+
         j_info.addr = pc;
         j_info.pos_jmp = idx;
-        j_info.pred_addr = j_info.btb_miss ? (pc + 4) : address;
-
-        accessed_btb = true;
+        j_info.from_ras = ret && ras_impl != nullptr && ras_impl->pop(address);
+        if (j_info.from_ras) {
+            j_info.btb_miss = false;
+            j_info.pred_addr = address;
+            accessed_btb = false;
+        } else {
+            j_info.btb_miss = !btb_impl->pc_address(pc, &address);
+            j_info.pred_addr = j_info.btb_miss ? (pc + 4) : address;
+            accessed_btb = true;
+        }
+        // Predictor is used without delay slot, call links the next instruction
+        if (call && ras_impl != nullptr)
+            ras_impl->push(pc + 4);
+        if (ras_impl != nullptr)
+            ras_impl->checkpoint(j_info.ras_top, j_info.ras_count);
 
         return j_info.pred_addr;
     } else if (bj_instr.flags() & IMF_BRANCH) {
         BranchInfo b_info;
 
         b_info.inst_addr = pc;
-        b_info.branch = get_prediction(idx);
+        b_info.pos_branch = idx;
+        b_info.taken = predict_branch(b_info);
+        b_info.branch = b_info.taken;
         b_info.btb_miss = false;
         accessed_btb = false;
         if (b_info.branch) {
@@ -65,8 +89,9 @@ std::uint32_t BranchPredictor::predict(const machine::Instruction &bj_instr, std
             accessed_btb = true;
             b_info.branch = !b_info.btb_miss;
         }
-        b_info.pos_branch = idx;
         b_info.pred_addr = b_info.branch ? address : (pc + 4);
+        if (ras_impl != nullptr)
+            ras_impl->checkpoint(b_info.ras_top, b_info.ras_count);
 
         enqueue(b_info);
 
@@ -99,6 +124,71 @@ double BranchPredictor::accuracy() const {
     return predictions > 0 ? ((double) correct_predictions / (double) predictions) * 100.0 : 100.0;
 }
 
+std::uint64_t BranchPredictor::mispredictions() const {
+    return predictions - correct_predictions;
+}
+
+std::uint64_t BranchPredictor::flush_cycles() const {
+    return flushed_cycles;
+}
+
+void BranchPredictor::add_flush_cycles(std::uint32_t count) {
+    flushed_cycles += count;
+}
+
+std::uint64_t BranchPredictor::btb_saved_cycles() const {
+    return btb_saved;
+}
+
+std::uint64_t BranchPredictor::ras_saved_cycles() const {
+    return ras_saved;
+}
+
+void BranchPredictor::add_saved_cycles(bool is_branch, std::uint32_t count) {
+    if (is_branch) {
+        // Not taken prediction does not use any target
+        if (b_infos[0].branch)
+            btb_saved += count;
+    } else if (j_info.from_ras) {
+        ras_saved += count;
+    } else if (!j_info.btb_miss) {
+        btb_saved += count;
+    }
+}
+
+int BranchPredictor::providers() const {
+    return provider_stats.size();
+}
+
+QString BranchPredictor::provider_name(int provider) const {
+    return provider_stats[provider].name;
+}
+
+std::uint64_t BranchPredictor::provider_predictions(int provider) const {
+    return provider_stats[provider].predictions;
+}
+
+double BranchPredictor::provider_accuracy(int provider) const {
+    const Provider &p = provider_stats[provider];
+    return p.predictions > 0 ? ((double) p.correct / (double) p.predictions) * 100.0 : 100.0;
+}
+
+bool BranchPredictor::predict_branch(BranchInfo &b_info) {
+    return get_prediction(b_info.pos_branch);
+}
+
+void BranchPredictor::add_provider(const QString &name) {
+    provider_stats.append({name, 0, 0});
+}
+
+void BranchPredictor::count_provider(const BranchInfo &b_info, bool branch_taken) {
+    if (b_info.provider >= provider_stats.size())
+        return;
+    provider_stats[b_info.provider].predictions++;
+    if (b_info.taken == branch_taken)
+        provider_stats[b_info.provider].correct++;
+}
+
 uint32_t BranchPredictor::prediction(bool is_branch) const {
     return is_branch ? b_infos[0].pred_addr : j_info.pred_addr;
 }
@@ -107,7 +197,35 @@ const BranchTargetBuffer *BranchPredictor::btb() const {
     return btb_impl.get();
 }
 
+BranchTargetBuffer *BranchPredictor::btb_rw() {
+    return btb_impl.get();
+}
+
+void BranchPredictor::set_btb(std::uint8_t btb_bits, unsigned ways, MachineConfigCache::ReplacementPolicy policy) {
+    btb_impl = std::make_shared<BranchTargetBuffer>(btb_bits, ways, policy);
+}
+
+void BranchPredictor::set_ras_depth(unsigned depth) {
+    delete ras_impl;
+    ras_impl = depth > 0 ? new ReturnAddressStack(depth) : nullptr;
+}
+
+const ReturnAddressStack *BranchPredictor::ras() const {
+    return ras_impl;
+}
+
+void BranchPredictor::restore_ras(bool is_branch) {
+    if (ras_impl == nullptr)
+        return;
+    if (is_branch)
+        ras_impl->restore(b_infos[0].ras_top, b_infos[0].ras_count);
+    else
+        ras_impl->restore(j_info.ras_top, j_info.ras_count);
+}
+
 void BranchPredictor::handle_update_jump(uint32_t correct_address) {
+    if (j_info.from_ras)
+        ras_impl->record(j_info.pred_addr == correct_address);
     if (j_info.btb_miss || j_info.pred_addr != correct_address) {
         // Last instruction was a jump and we had a btb miss, update the btb.
         btb_impl->update(j_info.addr, correct_address);
@@ -144,12 +262,26 @@ void BranchPredictor::remove(const InstAddr &inst_addr) {
     remove(idx);
 }
 
+void BranchPredictor::clear_queue() {
+    b_infos.clear();
+}
+
 void BranchPredictor::reset() {
     for (size_t i = 0 ; i < this->bht_size ; i++) {
         this->bht[i] = 0;
     }
     this->predictions = 0;
     this->correct_predictions = 0;
+    this->flushed_cycles = 0;
+    this->btb_saved = 0;
+    this->ras_saved = 0;
+    btb_impl->reset_stats();
+    if (ras_impl != nullptr)
+        ras_impl->reset();
+    for (int i = 0; i < provider_stats.size(); i++) {
+        provider_stats[i].predictions = 0;
+        provider_stats[i].correct = 0;
+    }
 
     emit pred_updated_accuracy(accuracy());
 }
@@ -291,3 +423,191 @@ void TwoBitBranchPredictor::set_bht_entry(std::uint32_t bht_idx, QString val) {
         SANITY_ASSERT(0, "Debug me :)");
     }
 }
+
+HistoryBranchPredictor::HistoryBranchPredictor(uint8_t bht_bits) : TwoBitBranchPredictor(bht_bits) {
+    ghr = 0;
+}
+
+void HistoryBranchPredictor::update_bht(bool branch, bool is_branch, uint32_t correct_address) {
+    if (is_branch) {
+        // Copy, the entry is dequeued by two bit predictor update
+        const BranchInfo b_info = b_infos[0];
+
+        update_tables(b_info, branch);
+        count_provider(b_info, branch);
+        TwoBitBranchPredictor::update_bht(branch, is_branch, correct_address);
+        ghr = (ghr << 1) | (branch ? 1 : 0);
+    } else {
+        TwoBitBranchPredictor::update_bht(branch, is_branch, correct_address);
+    }
+}
+
+void HistoryBranchPredictor::reset() {
+    ghr = 0;
+    TwoBitBranchPredictor::reset();
+}
+
+std::uint64_t HistoryBranchPredictor::history() const {
+    return ghr;
+}
+
+void HistoryBranchPredictor::update_tables(const BranchInfo &b_info, bool branch_taken) {
+    (void)b_info;
+    (void)branch_taken;
+}
+
+void HistoryBranchPredictor::counter_update(std::uint8_t &counter, bool taken, std::uint8_t max) {
+    if (taken && counter < max)
+        counter++;
+    else if (!taken && counter > 0)
+        counter--;
+}
+
+GShareBranchPredictor::GShareBranchPredictor(uint8_t bht_bits) : HistoryBranchPredictor(bht_bits) {}
+
+uint32_t GShareBranchPredictor::bht_idx(std::uint32_t pc, bool ro) {
+    // History of bht_bits last branches selects the pattern for the address.
+    return (BranchPredictor::bht_idx(pc, ro) ^ ghr) % bht_size;
+}
+
+TournamentBranchPredictor::TournamentBranchPredictor(uint8_t bht_bits) : HistoryBranchPredictor(bht_bits) {
+    global_pht.resize(bht_size);
+    chooser.resize(bht_size);
+    add_provider("local");
+    add_provider("global");
+    reset();
+}
+
+void TournamentBranchPredictor::reset() {
+    global_pht.fill(0);
+    // Weakly prefer local predictor, it learns faster
+    chooser.fill(1);
+    HistoryBranchPredictor::reset();
+}
+
+bool TournamentBranchPredictor::predict_branch(BranchInfo &b_info) {
+    bool local = get_prediction(b_info.pos_branch);
+    bool global = global_pht[global_idx(b_info.inst_addr.val, ghr)] >= 2;
+    bool use_global = chooser[b_info.pos_branch] >= 2;
+
+    b_info.history = ghr;
+    b_info.provider = use_global ? 1 : 0;
+    b_info.alt_branch = use_global ? local : global;
+    return use_global ? global : local;
+}
+
+void TournamentBranchPredictor::update_tables(const BranchInfo &b_info, bool branch_taken) {
+    bool global = b_info.provider == 1 ? b_info.taken : b_info.alt_branch;
+    bool local = b_info.provider == 0 ? b_info.taken : b_info.alt_branch;
+
+    counter_update(global_pht[global_idx(b_info.inst_addr.val, b_info.history)], branch_taken);
+    // Chooser moves only when the components disagree
+    if (local != global)
+        counter_update(chooser[b_info.pos_branch], global == branch_taken);
+}
+
+uint32_t TournamentBranchPredictor::global_idx(std::uint32_t pc, std::uint64_t history) const {
+    return ((pc >> 2) ^ history) % bht_size;
+}
+
+#define TAGE_TAG_BITS 8
+
+static const std::uint8_t tage_history_len[TageBranchPredictor::TAGE_TABLES] = {4, 8, 16, 32};
+
+// Xor of history_len newest history bits split to chunks of given width
+static std::uint32_t fold_history(std::uint64_t history, std::uint8_t history_len, std::uint8_t bits) {
+    std::uint32_t folded = 0;
+
+    if (history_len < 64)
+        history &= (1ULL << history_len) - 1;
+    while (history != 0) {
+        folded ^= history & ((1U << bits) - 1);
+        history >>= bits;
+    }
+    return folded;
+}
+
+TageBranchPredictor::TageBranchPredictor(uint8_t bht_bits) : HistoryBranchPredictor(bht_bits) {
+    // Every tagged table has half of base table entries
+    table_bits = bht_bits > 1 ? bht_bits - 1 : 1;
+    for (int t = 0; t < TAGE_TABLES; t++)
+        tables[t].resize(power_of_2(table_bits));
+    add_provider("base");
+    for (int t = 0; t < TAGE_TABLES; t++)
+        add_provider(QString("T%1 (%2 bits)").arg(t + 1).arg(tage_history_len[t]));
+    reset();
+}
+
+void TageBranchPredictor::reset() {
+    for (int t = 0; t < TAGE_TABLES; t++)
+        tables[t].fill({false, 0, 0, 0});
+    HistoryBranchPredictor::reset();
+}
+
+bool TageBranchPredictor::predict_branch(BranchInfo &b_info) {
+    std::uint32_t pc = b_info.inst_addr.val;
+    bool pred = get_prediction(b_info.pos_branch);
+    bool alt = pred;
+    int provider = 0;
+
+    // The longest matching history provides the prediction, the next one is the alternative
+    for (int t = 0; t < TAGE_TABLES; t++) {
+        const Entry &e = tables[t][table_idx(t, pc, ghr)];
+        if (e.valid && e.tag == table_tag(t, pc, ghr)) {
+            alt = pred;
+            pred = e.ctr >= 0;
+            provider = t + 1;
+        }
+    }
+    b_info.history = ghr;
+    b_info.provider = provider;
+    b_info.alt_branch = alt;
+    return pred;
+}
+
+void TageBranchPredictor::update_tables(const BranchInfo &b_info, bool branch_taken) {
+    std::uint32_t pc = b_info.inst_addr.val;
+    std::uint64_t history = b_info.history;
+    int provider = b_info.provider;
+
+    if (provider > 0) {
+        Entry &e = tables[provider - 1][table_idx(provider - 1, pc, history)];
+        // Entry could be replaced since the prediction
+        if (e.valid && e.tag == table_tag(provider - 1, pc, history)) {
+            if (branch_taken && e.ctr < 3)
+                e.ctr++;
+            else if (!branch_taken && e.ctr > -4)
+                e.ctr--;
+            if (b_info.taken != b_info.alt_branch)
+                counter_update(e.useful, b_info.taken == branch_taken);
+        }
+    }
+    if (b_info.taken == branch_taken || provider == TAGE_TABLES)
+        return;
+
+    // Misprediction allocates entry with longer history, useful entries age when none is free
+    for (int t = provider; t < TAGE_TABLES; t++) {
+        Entry &e = tables[t][table_idx(t, pc, history)];
+        if (!e.valid || e.useful == 0) {
+            e.valid = true;
+            e.tag = table_tag(t, pc, history);
+            e.ctr = branch_taken ? 0 : -1;
+            e.useful = 0;
+            return;
+        }
+    }
+    for (int t = provider; t < TAGE_TABLES; t++)
+        tables[t][table_idx(t, pc, history)].useful--;
+}
+
+uint32_t TageBranchPredictor::table_idx(int table, std::uint32_t pc, std::uint64_t history) const {
+    pc >>= 2;
+    return (pc ^ (pc >> table_bits) ^ fold_history(history, tage_history_len[table], table_bits)) %
+            power_of_2(table_bits);
+}
+
+uint8_t TageBranchPredictor::table_tag(int table, std::uint32_t pc, std::uint64_t history) const {
+    pc >>= 2;
+    return (pc ^ fold_history(history, tage_history_len[table], TAGE_TAG_BITS) ^
+            (fold_history(history, tage_history_len[table], TAGE_TAG_BITS - 1) << 1)) & 0xff;
+}
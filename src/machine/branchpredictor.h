@@ -10,6 +10,7 @@ namespace machine {
 
 class Instruction;
 class BranchTargetBuffer;
+class ReturnAddressStack;
 
 class BranchPredictor : public QObject {
     Q_OBJECT
@@ -43,8 +44,14 @@ public:
         uint32_t pos_branch; // Last position of the table that was predicted for a branch instruction.
         bool btb_miss; // Wether or not we had a btb miss.
         bool branch; // Last prediction that was made (taken or not taken).
+        bool taken; // Predicted direction before BTB lookup.
+        bool alt_branch; // Direction predicted by the component which was not used.
+        std::uint8_t provider; // Component of the predictor which made the prediction.
+        std::uint64_t history; // Global history when the prediction was made.
+        unsigned ras_top, ras_count; // Return address stack after the prediction.
 
-        BranchInfo() : inst_addr(0), pred_addr(0), pos_branch(0), btb_miss(false), branch(false) {}
+        BranchInfo() : inst_addr(0), pred_addr(0), pos_branch(0), btb_miss(false), branch(false),
+                       taken(false), alt_branch(false), provider(0), history(0), ras_top(0), ras_count(0) {}
     };
 
     struct JumpInfo {
@@ -52,6 +59,8 @@ public:
         uint32_t pred_addr; // The predicted address.
         bool btb_miss; // Whether or not jump was taken (the only condition is if we had a btb miss).
         uint32_t pos_jmp;
+        bool from_ras; // Return address was predicted by return address stack.
+        unsigned ras_top, ras_count; // Return address stack after the prediction.
     };
 
     explicit BranchPredictor(std::uint8_t bht_bits);
@@ -62,7 +71,7 @@ public:
     virtual void set_bht_entry(std::uint32_t bht_idx, QString val) = 0;
 
     // returns an index in the branch history table based on the instruction.
-    std::uint32_t bht_idx(std::uint32_t pc, bool ro = false);
+    virtual std::uint32_t bht_idx(std::uint32_t pc, bool ro = false);
     // returns then new pc.
     std::uint32_t predict(const machine::Instruction &bj_instr, std::uint32_t pc, bool &accessed_btb);
     uint8_t bht_entry(std::uint32_t bht_idx) const;
@@ -70,15 +79,39 @@ public:
     std::uint32_t btb_entry_address(std::uint32_t btb_idx) const;
     std::uint32_t btb_entry_tag(std::uint32_t btb_idx) const;
     double accuracy() const;
+    // Predictions not confirmed correct, unresolved ones included
+    std::uint64_t mispredictions() const;
+    // Cycles lost by flushing wrong path instructions
+    std::uint64_t flush_cycles() const;
+    void add_flush_cycles(std::uint32_t count);
+    // Flush cycles avoided by correct targets from branch target buffer and return address stack
+    std::uint64_t btb_saved_cycles() const;
+    std::uint64_t ras_saved_cycles() const;
+    // Credits flush of the oldest unresolved branch or the last jump to the structure which predicted it
+    void add_saved_cycles(bool is_branch, std::uint32_t count);
+    // Branch direction statistics of components, predictors with single table have none
+    int providers() const;
+    QString provider_name(int provider) const;
+    std::uint64_t provider_predictions(int provider) const;
+    double provider_accuracy(int provider) const;
     uint32_t prediction(bool is_branch) const;
 //    std::uint32_t pos_predicted() const;
     const BranchTargetBuffer *btb() const;
+    BranchTargetBuffer *btb_rw();
+    // Replaces branch target buffer by empty one with 2^btb_bits entries
+    void set_btb(std::uint8_t btb_bits, unsigned ways, MachineConfigCache::ReplacementPolicy policy);
+    // Calls push return addresses popped by JR $31, zero depth disables the stack
+    void set_ras_depth(unsigned depth);
+    const ReturnAddressStack *ras() const; // Null when disabled
+    // Drops calls and returns predicted after the mispredicted branch or jump
+    void restore_ras(bool is_branch);
     void handle_update_jump(std::uint32_t correct_address);
     void enqueue(const BranchInfo &b_info);
     BranchPredictor::BranchInfo dequeue();
     void remove(std::uint32_t idx);
     void remove(const InstAddr &bj_instr);
-    void reset();
+    void clear_queue(); // Forget predictions which were not resolved
+    virtual void reset();
 
 signals:
     void pred_accessed_bht(int32_t);
@@ -88,14 +121,29 @@ signals:
     void pred_updated_accuracy(double acc);
 
 protected:
+    struct Provider {
+        QString name;
+        std::uint64_t predictions;
+        std::uint64_t correct;
+    };
+
+    // Direction of branch, fills component fields of b_info when predictor has more of them.
+    virtual bool predict_branch(BranchInfo &b_info);
+    void add_provider(const QString &name);
+    void count_provider(const BranchInfo &b_info, bool branch_taken);
+
     std::shared_ptr<BranchTargetBuffer> btb_impl;
+    ReturnAddressStack *ras_impl;
     std::uint8_t bht_bits; // The # of bits used to index the history table.
     size_t bht_size; // The size of the table.
     std::uint8_t *bht; // The branch history table.
-    std::uint32_t correct_predictions; // # of correct predictions.
-    std::uint32_t predictions; // # of all predictions.
+    std::uint64_t correct_predictions; // # of correct predictions.
+    std::uint64_t predictions; // # of all predictions.
     JumpInfo j_info;
     QVector<BranchInfo> b_infos;
+    std::uint64_t flushed_cycles;
+    std::uint64_t btb_saved, ras_saved;
+    QVector<Provider> provider_stats;
 };
 
 class OneBitBranchPredictor : public BranchPredictor {
@@ -131,6 +179,81 @@ public:
     void set_bht_entry(std::uint32_t bht_idx, QString val) override;
 };
 
+// Predictors using global history of resolved branches. Branch history table
+// keeps two bit counters, history is shifted when branch is resolved.
+class HistoryBranchPredictor : public TwoBitBranchPredictor {
+public:
+    explicit HistoryBranchPredictor(std::uint8_t bht_bits);
+
+    void update_bht(bool branch, bool is_branch, uint32_t correct_address) override;
+    void reset() override;
+    std::uint64_t history() const;
+
+protected:
+    // Trains tables other than branch history table, called before b_info is dequeued.
+    virtual void update_tables(const BranchInfo &b_info, bool branch_taken);
+    // Saturating counter with values from 0 to max
+    static void counter_update(std::uint8_t &counter, bool taken, std::uint8_t max = 3);
+
+    std::uint64_t ghr; // Outcomes of resolved branches, the newest in bit 0.
+};
+
+// Branch history table is indexed by pc xor-ed with global history.
+class GShareBranchPredictor : public HistoryBranchPredictor {
+public:
+    explicit GShareBranchPredictor(std::uint8_t bht_bits);
+
+    std::uint32_t bht_idx(std::uint32_t pc, bool ro = false) override;
+};
+
+// Branch history table is the local predictor, gshare table is the global
+// one and per branch chooser selects between them.
+class TournamentBranchPredictor : public HistoryBranchPredictor {
+public:
+    explicit TournamentBranchPredictor(std::uint8_t bht_bits);
+
+    void reset() override;
+
+protected:
+    bool predict_branch(BranchInfo &b_info) override;
+    void update_tables(const BranchInfo &b_info, bool branch_taken) override;
+
+private:
+    std::uint32_t global_idx(std::uint32_t pc, std::uint64_t history) const;
+
+    QVector<std::uint8_t> global_pht;
+    QVector<std::uint8_t> chooser; // Values 2 and 3 select global predictor.
+};
+
+// TAGE with branch history table as the base predictor and tagged tables
+// indexed by geometrically growing global history lengths.
+class TageBranchPredictor : public HistoryBranchPredictor {
+public:
+    enum { TAGE_TABLES = 4 };
+
+    explicit TageBranchPredictor(std::uint8_t bht_bits);
+
+    void reset() override;
+
+protected:
+    bool predict_branch(BranchInfo &b_info) override;
+    void update_tables(const BranchInfo &b_info, bool branch_taken) override;
+
+private:
+    struct Entry {
+        bool valid;
+        std::uint8_t tag;
+        std::int8_t ctr; // Taken when not negative, from -4 to 3.
+        std::uint8_t useful; // From 0 to 3.
+    };
+
+    std::uint32_t table_idx(int table, std::uint32_t pc, std::uint64_t history) const;
+    std::uint8_t table_tag(int table, std::uint32_t pc, std::uint64_t history) const;
+
+    std::uint8_t table_bits;
+    QVector<Entry> tables[TAGE_TABLES];
+};
+
 }
 
 #endif // BRANCHPREDICTOR_H
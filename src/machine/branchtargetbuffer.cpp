@@ -1,30 +1,88 @@
 #include "branchtargetbuffer.h"
+#include "qtmipsexception.h"
 
 #include <QDebug>
+#include <cstdlib>
 
 using namespace machine;
 
-BranchTargetBuffer::BranchTargetBuffer(std::uint8_t btb_bits) {
+BranchTargetBuffer::BranchTargetBuffer(std::uint8_t btb_bits, unsigned ways,
+                                       MachineConfigCache::ReplacementPolicy policy) {
+    SANITY_ASSERT(ways > 0, "Branch target buffer needs at least one way");
     this->btb_bits = btb_bits;
     this->btb_size = power_of_2(this->btb_bits);
+    this->btb_ways = ways < this->btb_size ? ways : this->btb_size;
+    SANITY_ASSERT(this->btb_size % this->btb_ways == 0, "Branch target buffer ways have to divide its size");
+    this->btb_sets = this->btb_size / this->btb_ways;
+    this->policy = policy;
     this->btb = new BTBEntry[btb_size];
+    this->use_clock = 0;
+    reset_stats();
 }
 
 BranchTargetBuffer::~BranchTargetBuffer() {
     delete[] this->btb;
 }
 
-bool BranchTargetBuffer::pc_address(uint32_t pc, uint32_t *address) {
-    uint32_t tag, btb_idx;
+// Entry holding pc when hit is set, entry to be replaced otherwise
+std::uint32_t BranchTargetBuffer::entry_idx(std::uint32_t pc, bool &hit) const {
+    uint32_t set, tag, victim;
+
     pc = pc >> 2;
-    btb_idx = pc % btb_size;
-    tag = pc / btb_size;
+    set = pc % btb_sets;
+    tag = pc / btb_sets;
+    victim = set * btb_ways;
+    hit = false;
+
+    for (uint32_t i = set * btb_ways; i < (set + 1) * btb_ways; i++) {
+        if (btb[i].valid && btb[i].tag == tag) {
+            hit = true;
+            return i;
+        }
+    }
+    for (uint32_t i = set * btb_ways; i < (set + 1) * btb_ways; i++) {
+        if (!btb[i].valid)
+            return i;
+    }
+    switch (policy) {
+        case MachineConfigCache::ReplacementPolicy::RP_RAND:
+            victim += rand() % btb_ways;
+            break;
+        case MachineConfigCache::ReplacementPolicy::RP_LRU:
+            for (uint32_t i = set * btb_ways + 1; i < (set + 1) * btb_ways; i++) {
+                if (btb[i].last_use < btb[victim].last_use)
+                    victim = i;
+            }
+            break;
+        case MachineConfigCache::ReplacementPolicy::RP_LFU:
+            for (uint32_t i = set * btb_ways + 1; i < (set + 1) * btb_ways; i++) {
+                if (btb[i].uses < btb[victim].uses)
+                    victim = i;
+            }
+            break;
+    }
+    return victim;
+}
 
+void BranchTargetBuffer::touch(std::uint32_t btb_idx) {
+    btb[btb_idx].last_use = ++use_clock;
+    btb[btb_idx].uses++;
+}
+
+bool BranchTargetBuffer::pc_address(uint32_t pc, uint32_t *address) {
+    bool hit;
+    uint32_t btb_idx = entry_idx(pc, hit);
+
+    lookup_cnt++;
     *address = btb[btb_idx].address;
+    if (hit) {
+        hit_cnt++;
+        touch(btb_idx);
+    }
 
     emit pred_accessed_btb(btb_idx);
 
-    return btb[btb_idx].valid && btb[btb_idx].tag == tag;
+    return hit;
 }
 
 bool BranchTargetBuffer::btb_entry_valid(uint32_t btb_idx) const {
@@ -40,14 +98,16 @@ std::uint32_t BranchTargetBuffer::btb_entry_tag(uint32_t btb_idx) const {
 }
 
 void BranchTargetBuffer::update(uint32_t pc, uint32_t inst_addr) {
-    uint32_t btb_idx;
-
-    pc = pc >> 2;
-    btb_idx = pc % btb_size;
+    bool hit;
+    uint32_t btb_idx = entry_idx(pc, hit);
 
-    btb[btb_idx].tag = pc / btb_size;
-    btb[btb_idx].valid = true;
+    if (!hit) {
+        btb[btb_idx].tag = (pc >> 2) / btb_sets;
+        btb[btb_idx].valid = true;
+        btb[btb_idx].uses = 0;
+    }
     btb[btb_idx].address = inst_addr;
+    touch(btb_idx);
 
     emit pred_updated_btb(btb_idx);
 }
@@ -57,5 +117,33 @@ void BranchTargetBuffer::reset() {
         this->btb[i].address = 0;
         this->btb[i].tag = 0;
         this->btb[i].valid = false;
+        this->btb[i].last_use = 0;
+        this->btb[i].uses = 0;
     }
+    reset_stats();
+}
+
+size_t BranchTargetBuffer::entries() const {
+    return btb_size;
+}
+
+unsigned BranchTargetBuffer::ways() const {
+    return btb_ways;
+}
+
+std::uint64_t BranchTargetBuffer::lookups() const {
+    return lookup_cnt;
+}
+
+std::uint64_t BranchTargetBuffer::hits() const {
+    return hit_cnt;
+}
+
+double BranchTargetBuffer::hit_rate() const {
+    return lookup_cnt > 0 ? ((double) hit_cnt / (double) lookup_cnt) * 100.0 : 0.0;
+}
+
+void BranchTargetBuffer::reset_stats() {
+    lookup_cnt = 0;
+    hit_cnt = 0;
 }
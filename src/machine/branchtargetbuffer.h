@@ -5,6 +5,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <climits>
+#include "machineconfig.h"
 
 class Instruction;
 
@@ -20,6 +21,8 @@ constexpr size_t power_of_2(uint8_t exponent) {
 
 namespace machine {
 
+// Set associative buffer of jump and branch targets. Entries of a set are
+// stored next to each other, entry index is set * ways + way.
 class BranchTargetBuffer : public QObject {
     Q_OBJECT
 private:
@@ -27,20 +30,32 @@ private:
         bool valid;
         uint32_t tag;
         uint32_t address;
+        std::uint64_t last_use; // For LRU
+        std::uint32_t uses; // For LFU
 
-        BTBEntry() : valid(false), tag(0), address(0) {}
+        BTBEntry() : valid(false), tag(0), address(0), last_use(0), uses(0) {}
     };
 
+    std::uint32_t entry_idx(std::uint32_t pc, bool &hit) const;
+    void touch(std::uint32_t btb_idx);
+
     uint8_t btb_bits;
     size_t btb_size;
+    unsigned btb_ways;
+    size_t btb_sets;
+    MachineConfigCache::ReplacementPolicy policy;
     BTBEntry *btb;
+    std::uint64_t use_clock;
+    std::uint64_t lookup_cnt, hit_cnt;
 
 signals:
     void pred_updated_btb(std::int32_t);
     void pred_accessed_btb(std::int32_t);
 
 public:
-    explicit BranchTargetBuffer(std::uint8_t btb_bits);
+    // 2^btb_bits entries, associativity is limited to number of entries
+    explicit BranchTargetBuffer(std::uint8_t btb_bits, unsigned ways = 1,
+                                MachineConfigCache::ReplacementPolicy policy = MachineConfigCache::RP_LRU);
     ~BranchTargetBuffer();
 
     bool pc_address(uint32_t current_pc, uint32_t *address);
@@ -49,6 +64,13 @@ public:
     std::uint32_t btb_entry_tag(std::uint32_t btb_idx) const;
     void update(uint32_t pc, uint32_t inst_addr);
     void reset();
+
+    size_t entries() const;
+    unsigned ways() const;
+    std::uint64_t lookups() const;
+    std::uint64_t hits() const;
+    double hit_rate() const;
+    void reset_stats();
 };
 
 }
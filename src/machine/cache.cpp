@@ -34,8 +34,12 @@
  ******************************************************************************/
 
 #include "cache.h"
+#include "prefetcher.h"
+#include "writebuffer.h"
+#include "qtmipsexception.h"
 
 #include <QDebug>
+#include <algorithm>
 
 using namespace machine;
 
@@ -48,11 +52,25 @@ Cache::Cache(const MachineConfigCache &cc, MemoryAccess *m, uint32_t acc_read, u
                 access_pen_burst(lower_acc_pen_b), uncached_start(0xf0000000), uncached_last(0xffffffff),
                 cache_type(cc.type()), read_hits(0), read_misses(0), write_hits(0), write_misses(0),
                 mem_lower_reads(0), mem_lower_writes(0), burst_reads(0), burst_writes(0),
-                change_counter(0), dt(nullptr), replc() {
+                change_counter(0), prefetcher(nullptr), prefetch_fills(0), prefetch_hits(0), prefetch_late(0),
+                wbuffer(nullptr),
+                cache_level(1), lower_cache(nullptr), exclusive_fill(false), victim_clock(0), victim_hit_cnt(0),
+                dt(nullptr), replc() {
 
     replc.lfu = nullptr;
     replc.lru = nullptr;
 
+    switch (cache_type) {
+        case MemoryType::L2_UNIFIED_CACHE:
+            cache_level = 2;
+            break;
+        case MemoryType::LOWER_CACHE:
+            cache_level = 3;
+            break;
+        default:
+            break;
+    }
+
     // Skip any other initialization if cache is disabled
     if (!cc.enabled())
         return;
@@ -64,9 +82,22 @@ Cache::Cache(const MachineConfigCache &cc, MemoryAccess *m, uint32_t acc_read, u
         for (size_t y = 0; y < cc.sets(); y++) {
             dt[i][y].valid = false;
             dt[i][y].dirty = false;
+            dt[i][y].prefetched = false;
+            dt[i][y].ready = 0;
             dt[i][y].data = new std::uint32_t[cc.blocks()];
         }
     }
+    prefetcher = Prefetcher::create(cc);
+    wbuffer = WriteBuffer::create(cc);
+    victims.resize(cc.victim_entries());
+    for (victim_line &v : victims) {
+        v.valid = false;
+        v.dirty = false;
+        v.base = 0;
+        v.last_use = 0;
+        v.data = new std::uint32_t[cc.blocks()];
+    }
+    victim_swap.resize(cc.blocks());
     // Allocate replacement policy data
     switch (cnf.replacement_policy()) {
         case MachineConfigCache::ReplacementPolicy::RP_LFU:
@@ -92,6 +123,10 @@ Cache::Cache(const MachineConfigCache &cc, MemoryAccess *m, uint32_t acc_read, u
 }
 
 Cache::~Cache(){
+    delete prefetcher;
+    delete wbuffer;
+    for (victim_line &v : victims)
+        delete[] v.data;
     if (dt != nullptr) {
         for (size_t i = 0; i < cnf.associativity(); i++) {
             if (dt[i]) {
@@ -140,10 +175,18 @@ bool Cache::wword(std::uint32_t address, std::uint32_t value) {
     changed = access(address, &data, true, value);
 
     if (cnf.write_policy() == MachineConfigCache::WritePolicy::WP_THROUGH) {
-        mem_lower_writes++;
-        emit_mem_lower_signal(false);
+        bool combined = false;
+        if (wbuffer != nullptr) {
+            charge_buffer_stall(wbuffer->store(address, cycle_stats.total_cycles, access_pen_write, combined));
+            emit write_buffer_update(wbuffer->combined(), wbuffer->forwarded(), wbuffer->full_stalls());
+        }
+        if (!combined) {
+            mem_lower_writes++;
+            emit_mem_lower_signal(false);
+        }
         update_statistics();
-        mem_lower->set_update_stats(true);
+        // Combined store is counted in lower level with the entry it joined
+        mem_lower->set_update_stats(!combined);
         return mem_lower->write_word(address, value);
     }
 
@@ -194,8 +237,17 @@ void Cache::flush() {
             }
         }
     }
+    for (victim_line &v : victims) {
+        if (v.valid) {
+            v.valid = false;
+            evict(v.base, v.data, v.dirty);
+        }
+    }
+    if (wbuffer != nullptr)
+        wbuffer->flush();
 
     change_counter++;
+    write_log.invalidate(change_counter);
     update_statistics();
 
     mem_lower->sync();
@@ -205,61 +257,160 @@ void Cache::sync() {
     flush();
 }
 
-std::uint32_t Cache::hit() const {
+std::uint64_t Cache::hit() const {
     return read_hits + write_hits;
 }
 
-std::uint32_t Cache::miss() const {
+std::uint64_t Cache::miss() const {
     return read_misses + write_misses;
 }
 
-std::uint32_t Cache::stalled_cycles() const {
-    uint32_t st_cycles = mem_lower_reads * access_pen_read + mem_lower_writes * access_pen_write;
+// Cycles spent in lower level. Computed in floating point as burst penalty
+// can be larger than the first access one and products can be huge.
+double Cache::lower_access_cycles() const {
+    double cycles = (double)mem_lower_reads * access_pen_read +
+                    (double)mem_lower_writes * access_pen_write;
 
     if (access_pen_burst != 0)
-        st_cycles -= burst_reads * (access_pen_read - access_pen_burst) +
-                     burst_writes * (access_pen_write - access_pen_burst);
+        cycles -= (double)burst_reads * ((double)access_pen_read - access_pen_burst) +
+                  (double)burst_writes * ((double)access_pen_write - access_pen_burst);
+
+    return cycles;
+}
 
-    return st_cycles;
+std::uint64_t Cache::stalled_cycles() const {
+    double cycles = lower_access_cycles();
+
+    if (cycles <= 0)
+        return 0;
+    if (cycles >= (double)UINT64_MAX)
+        return UINT64_MAX;
+    return (std::uint64_t)cycles;
 }
 
 double Cache::speed_improvement() const {
-    std::uint32_t lookup_time;
-    std::uint32_t lower_access_time;
-    std::uint32_t comp = read_hits + write_hits + read_misses + write_misses;
+    double lookup_time;
+    std::uint64_t comp = read_hits + write_hits + read_misses + write_misses;
 
     if (comp == 0)
         return 100.0;
 
-    lookup_time = read_hits + read_misses;
+    lookup_time = (double)read_hits + read_misses;
     if (cnf.write_policy() == MachineConfigCache::WritePolicy::WP_BACK)
-        lookup_time += write_hits + write_misses;
-
-    lower_access_time = mem_lower_reads * access_pen_read +
-                      mem_lower_writes * access_pen_write;
-
-    if (access_pen_burst != 0)
-        lower_access_time -= burst_reads * (access_pen_read - access_pen_burst) +
-                           burst_writes * (access_pen_write - access_pen_burst);
+        lookup_time += (double)write_hits + write_misses;
 
-    return (double)((read_hits + read_misses) * access_pen_read + (write_hits + write_misses) * access_pen_write) \
-            / (double)(lookup_time + lower_access_time) \
+    return ((double)(read_hits + read_misses) * access_pen_read +
+            (double)(write_hits + write_misses) * access_pen_write)
+            / (lookup_time + lower_access_cycles())
             * 100;
 }
 
 double Cache::hit_rate() const {
-    std::uint32_t comp = read_hits + write_hits + read_misses + write_misses;
+    std::uint64_t comp = read_hits + write_hits + read_misses + write_misses;
 
     return comp == 0 ? 0.0 :
                        (double)(read_hits + write_hits) / (double)comp * 100.0;
 }
 
+std::uint64_t Cache::prefetches() const {
+    return prefetch_fills;
+}
+
+std::uint64_t Cache::useful_prefetches() const {
+    return prefetch_hits;
+}
+
+std::uint64_t Cache::late_prefetches() const {
+    return prefetch_late;
+}
+
+double Cache::prefetch_accuracy() const {
+    return prefetch_fills == 0 ? 0.0 : (double)prefetch_hits / (double)prefetch_fills * 100.0;
+}
+
+double Cache::prefetch_coverage() const {
+    // Every useful prefetch would be a miss without prefetcher
+    std::uint64_t misses = prefetch_hits + read_misses + write_misses;
+
+    return misses == 0 ? 0.0 : (double)prefetch_hits / (double)misses * 100.0;
+}
+
+double Cache::prefetch_timeliness() const {
+    return prefetch_hits == 0 ? 0.0 :
+                                (double)(prefetch_hits - prefetch_late) / (double)prefetch_hits * 100.0;
+}
+
+std::uint64_t Cache::victim_hits() const {
+    return victim_hit_cnt;
+}
+
+const WriteBuffer *Cache::write_buffer() const {
+    return wbuffer;
+}
+
+std::uint64_t Cache::lower_reads() const {
+    return mem_lower_reads;
+}
+
+std::uint64_t Cache::lower_writes() const {
+    return mem_lower_writes;
+}
+
+bool Cache::line(std::uint32_t associat, std::uint32_t set, bool &dirty, std::uint32_t &tag,
+                 const std::uint32_t *&data) const {
+    const cache_data &cd = dt[associat][set];
+
+    dirty = cd.dirty;
+    tag = cd.tag;
+    data = cd.data;
+    return cd.valid;
+}
+
+unsigned Cache::level() const {
+    return cache_level;
+}
+
+void Cache::set_level(unsigned level) {
+    SANITY_ASSERT(level >= 1 && level < 3 + CycleStatistics::LOWER_CACHE_LEVELS,
+                  "Cache level has no stall counter");
+    cache_level = level;
+}
+
+void Cache::add_upper(Cache *upper) {
+    for (const Cache *c = this; c != nullptr; c = c->lower_cache) {
+        if (c->cnf.inclusion() == MachineConfigCache::IP_INCLUSIVE &&
+                c->cnf.blocks() % upper->cnf.blocks() != 0)
+            throw QTMIPS_EXCEPTION(Input, "Line of inclusive cache has to be multiple of upper level line",
+                                   QString("L%1").arg(c->cache_level));
+    }
+    if (cnf.inclusion() == MachineConfigCache::IP_EXCLUSIVE &&
+            (cnf.blocks() != upper->cnf.blocks() ||
+             upper->cnf.write_policy() != MachineConfigCache::WritePolicy::WP_BACK))
+        throw QTMIPS_EXCEPTION(Input, "Exclusive cache needs write-back upper level with the same line size",
+                               QString("L%1").arg(cache_level));
+    upper_caches.append(upper);
+    upper->lower_cache = this;
+}
+
 void Cache::reset() {
     // Set all cells to invalid
     if (cnf.enabled()) {
-        for (size_t as = 0; as < cnf.associativity(); as++)
-            for (size_t st = 0; st < cnf.sets(); st++)
+        for (size_t as = 0; as < cnf.associativity(); as++) {
+            for (size_t st = 0; st < cnf.sets(); st++) {
                 dt[as][st].valid = false;
+                dt[as][st].prefetched = false;
+            }
+        }
+    }
+    for (victim_line &v : victims)
+        v.valid = false;
+    victim_clock = 0;
+    exclusive_fill = false;
+    if (prefetcher != nullptr)
+        prefetcher->reset();
+    if (wbuffer != nullptr) {
+        wbuffer->reset();
+        emit write_buffer_update(0, 0, 0);
     }
 
     // Note: we don't have to zero replacement policy data as those are zeroed when first used on invalid cell
@@ -272,6 +423,10 @@ void Cache::reset() {
     mem_lower_writes = 0;
     burst_reads = 0;
     burst_writes = 0;
+    prefetch_fills = 0;
+    prefetch_hits = 0;
+    prefetch_late = 0;
+    victim_hit_cnt = 0;
 
     // Trigger signals
     emit hit_update(hit());
@@ -304,6 +459,12 @@ enum LocationStatus Cache::location_status(std::uint32_t address) const {
                     return (enum LocationStatus)LOCSTAT_CACHED;
             }
         }
+        int v = victim_find(base_address(tag, row));
+        if (v >= 0) {
+            if (victims[v].dirty && cnf.write_policy() == MachineConfigCache::WP_BACK)
+                return (enum LocationStatus)(LOCSTAT_CACHED | LOCSTAT_DIRTY);
+            return (enum LocationStatus)LOCSTAT_CACHED;
+        }
     }
 
     return mem_lower->location_status(address);
@@ -316,6 +477,7 @@ void Cache::emit_mem_lower_signal(bool read) const {
             SANITY_ASSERT(0, "Lower level cannot be an L1 cache.");
             break;
         case MemoryType::L2_UNIFIED_CACHE:
+        case MemoryType::LOWER_CACHE:
             if (read)
                 emit level2_cache_reads_update(mem_lower_reads);
             else
@@ -341,12 +503,17 @@ std::uint32_t Cache::debug_rword(std::uint32_t address) const {
         if (dt[indx][row].valid && dt[indx][row].tag == tag)
             return dt[indx][row].data[col];
     }
+    int v = victim_find(base_address(tag, row));
+    if (v >= 0)
+        return victims[v].data[col];
 
     return 0;
 }
 
 bool Cache::access(std::uint32_t address, std::uint32_t *data, bool write, std::uint32_t value) const {
     bool changed = false;
+    bool prefetch_trigger = false;
+    bool from_victim = false, victim_dirty = false;
     uint32_t row, col, tag, indx;
 
     compute_row_col_tag(row, col, tag, address);
@@ -357,48 +524,35 @@ bool Cache::access(std::uint32_t address, std::uint32_t *data, bool write, std::
         indx++;
     // Need to find new block
     if (indx >= cnf.associativity()) {
+        from_victim = victim_take(base_address(tag, row), victim_dirty);
         // return early if we do not need to allocate a block on write miss.
-        if (write && !cnf.write_alloc()) {
-            update_misses(false);
+        if (write && !cnf.write_alloc() && !from_victim) {
+            // Write buffer hides latency of the store, it charges its own stalls
+            if (wbuffer == nullptr)
+                update_misses(false);
+            else if (update_stats)
+                write_misses++;
             emit miss_update(miss());
             update_statistics();
             return false;
         }
-        // We have to kick something
-        switch (cnf.replacement_policy()) {
-            case MachineConfigCache::ReplacementPolicy::RP_RAND:
-                {
-                    bool found_empty = false;
-                    for (size_t i = 0 ; i < cnf.associativity() ; i++) {
-                        if (!dt[i][row].valid) {
-                            indx = i;
-                            found_empty = true;
-                        }
-                    }
-                    if (!found_empty) {
-                        indx = rand() % cnf.associativity();
-                    }
-                }
-                break;
-            case MachineConfigCache::ReplacementPolicy::RP_LRU:
-                indx = replc.lru[row][0];
-                break;
-            case MachineConfigCache::ReplacementPolicy::RP_LFU: {
-                uint32_t lowest = replc.lfu[row][0];
-                indx = 0;
-                for (size_t i = 1; i < cnf.associativity(); i++) {
-                    if (!dt[i][row].valid) {
-                        indx = i;
-                        break;
-                    }
-                    if (lowest > replc.lfu[row][i]) {
-                        lowest = replc.lfu[row][i];
-                        indx = i;
-                    }
-                }
-                break;
+        // Exclusive cache passes line read by upper level without keeping it
+        if (exclusive_fill && !from_victim) {
+            if (update_stats) {
+                ++mem_lower_reads;
+                burst_reads += cnf.blocks() - 1;
+                emit_mem_lower_signal(true);
             }
+            mem_lower->set_update_stats(update_stats);
+            mem_lower->set_access_pc(access_pc);
+            *data = mem_lower->read_word(address);
+            update_misses(true, true);
+            emit miss_update(miss());
+            update_statistics();
+            return false;
         }
+        // We have to kick something
+        indx = replacement_victim(row);
     }
     SANITY_ASSERT(indx < cnf.associativity(), "Probably unimplemented replacement policy");
 
@@ -408,6 +562,8 @@ bool Cache::access(std::uint32_t address, std::uint32_t *data, bool write, std::
     if (cd.valid && cd.tag != tag) {
         kick(indx, row);
         change_counter++;
+        write_log.record(base_address(cd.tag, row),
+                         base_address(cd.tag, row) + cnf.blocks() * 4 - 1, change_counter);
     }
 
     // Update statistics and otherwise read from memory
@@ -416,40 +572,137 @@ bool Cache::access(std::uint32_t address, std::uint32_t *data, bool write, std::
             update_hits(false);
         else
             update_hits(true);
+        if (cd.prefetched && update_stats) {
+            // First use of prefetched line, waits for the rest of its fill
+            cd.prefetched = false;
+            prefetch_hits++;
+            prefetch_trigger = true;
+            if (cd.ready > cycle_stats.total_cycles) {
+                prefetch_late++;
+                charge_stall(cd.ready - cycle_stats.total_cycles);
+            }
+        }
+
+        emit hit_update(hit());
+        update_statistics();
+    } else if (from_victim) {
+        // Line moves back from victim cache without lower level access
+        update_hits(!write);
+        std::copy(victim_swap.begin(), victim_swap.end(), cd.data);
+        cd.dirty = victim_dirty;
 
         emit hit_update(hit());
         update_statistics();
     } else {
-        if (write)
-            update_misses(false);
-        else
-            update_misses(true);
-        emit miss_update(miss());
+        bool forwarded = false;
+
+        prefetch_trigger = true;
+        // Line fill cannot overtake buffered store to the same line
+        if (!write && wbuffer != nullptr && update_stats) {
+            charge_buffer_stall(wbuffer->load(address, cycle_stats.total_cycles, forwarded));
+            emit write_buffer_update(wbuffer->combined(), wbuffer->forwarded(), wbuffer->full_stalls());
+        }
 
         // We allocate a block in cache if its a read miss or a write miss with write-allocate.
         if (!write || cnf.write_alloc()) {
-            for (size_t i = 0; i < cnf.blocks(); i++) {
-                mem_lower->set_update_stats(i == 0);
-                cd.data[i] = mem_lower->read_word(base_address(tag, row) + (4 * i));
+            fill_line(cd, tag, row, forwarded);
 
-                change_counter++;
+            if (!forwarded) {
+                ++mem_lower_reads;
+                burst_reads += cnf.blocks() - 1;
+                emit_mem_lower_signal(true);
             }
+        }
+        if (forwarded) {
+            // Line comes from the write buffer, there is no read penalty
+            read_misses++;
+        } else {
+            // Charged once the line is read, lower level may know how long it took
+            update_misses(!write, true);
+        }
+        emit miss_update(miss());
+        update_statistics();
+    }
+
+    update_replacement(indx, row, cd.valid);
 
-            ++mem_lower_reads;
-            burst_reads += cnf.blocks() - 1;
-            emit_mem_lower_signal(true);
+    cd.valid = true; // We either write to it or we read from memory. Either way it's valid when we leave Cache class
+    cd.dirty = cd.dirty || write;
+    cd.tag = tag;
+    *data = cd.data[col];
+
+    if (write) {
+        changed = cd.data[col] != value;
+        cd.data[col] = value;
+    }
+
+    emit cache_update(indx, row, col, cd.valid, cd.dirty, cd.tag, cd.data, write);
+    if (changed) {
+        change_counter++;
+        write_log.record(base_address(tag, row) + col * 4,
+                         base_address(tag, row) + col * 4 + 3, change_counter);
+    }
+
+    // Burst words of upper level fill are not demand accesses
+    if (prefetcher != nullptr && update_stats) {
+        prefetch_candidates.clear();
+        prefetcher->access(access_pc, address, prefetch_trigger, prefetch_candidates);
+        for (std::uint32_t pf_address : prefetch_candidates)
+            prefetch(pf_address);
+        if (!prefetch_candidates.isEmpty())
             update_statistics();
+    }
+    return changed;
+}
+
+std::uint32_t Cache::replacement_victim(std::uint32_t row) const {
+    std::uint32_t indx = 0;
+
+    switch (cnf.replacement_policy()) {
+        case MachineConfigCache::ReplacementPolicy::RP_RAND:
+            {
+                bool found_empty = false;
+                for (size_t i = 0 ; i < cnf.associativity() ; i++) {
+                    if (!dt[i][row].valid) {
+                        indx = i;
+                        found_empty = true;
+                    }
+                }
+                if (!found_empty) {
+                    indx = rand() % cnf.associativity();
+                }
+            }
+            break;
+        case MachineConfigCache::ReplacementPolicy::RP_LRU:
+            indx = replc.lru[row][0];
+            break;
+        case MachineConfigCache::ReplacementPolicy::RP_LFU: {
+            uint32_t lowest = replc.lfu[row][0];
+            indx = 0;
+            for (size_t i = 1; i < cnf.associativity(); i++) {
+                if (!dt[i][row].valid) {
+                    indx = i;
+                    break;
+                }
+                if (lowest > replc.lfu[row][i]) {
+                    lowest = replc.lfu[row][i];
+                    indx = i;
+                }
+            }
+            break;
         }
     }
+    return indx;
+}
 
-    // Update replacement data
+void Cache::update_replacement(std::uint32_t associat_indx, std::uint32_t row, bool hit) const {
     switch (cnf.replacement_policy()) {
         case MachineConfigCache::ReplacementPolicy::RP_LRU:
         {
-            uint32_t next_asi = indx;
+            uint32_t next_asi = associat_indx;
             int i = cnf.associativity() - 1;
             uint32_t tmp_asi = replc.lru[row][i];
-            while (tmp_asi != indx) {
+            while (tmp_asi != associat_indx) {
                 SANITY_ASSERT(i >= 0, "LRU lost the way from priority queue - access");
                 tmp_asi = replc.lru[row][i];
                 replc.lru[row][i] = next_asi;
@@ -459,49 +712,72 @@ bool Cache::access(std::uint32_t address, std::uint32_t *data, bool write, std::
             break;
         }
         case MachineConfigCache::ReplacementPolicy::RP_LFU:
-            if (cd.valid)
-                replc.lfu[row][indx]++;
+            if (hit)
+                replc.lfu[row][associat_indx]++;
             else
-                replc.lfu[row][indx] = 0;
+                replc.lfu[row][associat_indx] = 0;
             break;
         default:
             break;
     }
+}
 
-    cd.valid = true; // We either write to it or we read from memory. Either way it's valid when we leave Cache class
-    cd.dirty = cd.dirty || write;
-    cd.tag = tag;
-    *data = cd.data[col];
+// Fills line of address off the critical path. Lower levels account their
+// accesses, but cycles the fill takes only determine when the line is ready.
+void Cache::prefetch(std::uint32_t address) const {
+    std::uint32_t row, col, tag, indx;
+    std::uint32_t fill_cycles = access_pen_read;
+    CycleStatistics demand_stats = cycle_stats;
 
-    if (write) {
-        changed = cd.data[col] != value;
-        cd.data[col] = value;
+    if (address >= uncached_start && address <= uncached_last)
+        return;
+    compute_row_col_tag(row, col, tag, address);
+    for (indx = 0; indx < cnf.associativity(); indx++) {
+        if (dt[indx][row].valid && dt[indx][row].tag == tag)
+            return;
     }
+    if (victim_find(base_address(tag, row)) >= 0)
+        return;
 
-    emit cache_update(indx, row, col, cd.valid, cd.dirty, cd.tag, cd.data, write);
-    if (changed)
+    indx = replacement_victim(row);
+    cache_data &cd = dt[indx][row];
+    if (cd.valid) {
+        kick(indx, row);
         change_counter++;
-    return changed;
-}
+        write_log.record(base_address(cd.tag, row),
+                         base_address(cd.tag, row) + cnf.blocks() * 4 - 1, change_counter);
+    }
 
-void Cache::kick(std::uint32_t associat_indx, std::uint32_t row) const {
-    cache_data &cd = dt[associat_indx][row];
+    cd.dirty = false;
+    fill_line(cd, tag, row);
+    mem_lower->last_access_cycles(fill_cycles);
+    cd.ready = cycle_stats.total_cycles + fill_cycles +
+               (cycle_stats.memory_cycles - demand_stats.memory_cycles);
+    cycle_stats = demand_stats;
+
+    update_replacement(indx, row, false);
+    cd.valid = true;
+    cd.prefetched = true;
+    cd.tag = tag;
+    prefetch_fills++;
 
-    if (cd.dirty) {
-        if (cnf.write_policy() == MachineConfigCache::WritePolicy::WP_BACK) {
-            for (size_t i = 0; i < cnf.blocks(); i++) {
-                mem_lower->set_update_stats(i == 0);
-                mem_lower->write_word(base_address(cd.tag, row) + (4*i), cd.data[i]);
-            }
+    emit cache_update(indx, row, 0, cd.valid, cd.dirty, cd.tag, cd.data, false);
+}
 
-            ++mem_lower_writes;
-            burst_writes += cnf.blocks() - 1;
-            emit_mem_lower_signal(false);
-        }
-    }
+void Cache::kick(std::uint32_t associat_indx, std::uint32_t row, bool drop) const {
+    cache_data &cd = dt[associat_indx][row];
+    bool dirty = cd.dirty;
 
+    // Line is invalid before it leaves, lower levels may look for it meanwhile
     cd.valid = false;
     cd.dirty = false;
+    cd.prefetched = false;
+    if (!drop) {
+        if (victims.isEmpty())
+            evict(base_address(cd.tag, row), cd.data, dirty);
+        else
+            victim_insert(base_address(cd.tag, row), cd.data, dirty);
+    }
 
     switch (cnf.replacement_policy()) {
         case MachineConfigCache::ReplacementPolicy::RP_LRU:
@@ -526,34 +802,250 @@ void Cache::kick(std::uint32_t associat_indx, std::uint32_t row) const {
     }
 }
 
+// Line leaves this level. Inclusive cache takes it from upper levels first,
+// exclusive lower level receives it, otherwise dirty data are written back.
+void Cache::evict(std::uint32_t base, std::uint32_t *data, bool dirty) const {
+    bool upper_dirty = false;
+
+    if (cnf.inclusion() == MachineConfigCache::IP_INCLUSIVE) {
+        for (Cache *upper : upper_caches)
+            upper_dirty = upper->back_invalidate(base, cnf.blocks() * 4, data) || upper_dirty;
+    }
+    dirty = upper_dirty || (dirty && cnf.write_policy() == MachineConfigCache::WritePolicy::WP_BACK);
+
+    if (lower_exclusive()) {
+        lower_cache->install_line(base, data, dirty);
+    } else if (dirty) {
+        for (size_t i = 0; i < cnf.blocks(); i++) {
+            mem_lower->set_update_stats(i == 0);
+            mem_lower->write_word(base + (4*i), data[i]);
+        }
+    } else {
+        return;
+    }
+
+    ++mem_lower_writes;
+    burst_writes += cnf.blocks() - 1;
+    emit_mem_lower_signal(false);
+}
+
+bool Cache::lower_exclusive() const {
+    return lower_cache != nullptr && lower_cache->cnf.inclusion() == MachineConfigCache::IP_EXCLUSIVE;
+}
+
+// Reads line from lower level, exclusive lower level gives its copy up
+void Cache::fill_line(cache_data &cd, std::uint32_t tag, std::uint32_t row, bool forwarded) const {
+    std::uint32_t base = base_address(tag, row);
+    bool exclusive = lower_exclusive();
+
+    if (exclusive)
+        lower_cache->exclusive_fill = true;
+    // Stores reach the lower level at once, so it holds the forwarded data
+    for (size_t i = 0; i < cnf.blocks(); i++) {
+        mem_lower->set_update_stats(i == 0 && !forwarded);
+        mem_lower->set_access_pc(access_pc);
+        cd.data[i] = mem_lower->read_word(base + (4 * i));
+        change_counter++;
+    }
+    if (exclusive) {
+        lower_cache->exclusive_fill = false;
+        if (lower_cache->release_line(base))
+            cd.dirty = true;
+    }
+    write_log.record(base, base + cnf.blocks() * 4 - 1, change_counter);
+}
+
+// Upper level took line from this exclusive cache, returns if it was dirty
+bool Cache::release_line(std::uint32_t base) const {
+    std::uint32_t row, col, tag;
+
+    compute_row_col_tag(row, col, tag, base);
+    for (std::uint32_t indx = 0; indx < cnf.associativity(); indx++) {
+        cache_data &cd = dt[indx][row];
+        if (cd.valid && cd.tag == tag) {
+            bool dirty = cd.dirty && cnf.write_policy() == MachineConfigCache::WritePolicy::WP_BACK;
+            kick(indx, row, true);
+            emit cache_update(indx, row, 0, false, false, 0, nullptr, false);
+            return dirty;
+        }
+    }
+    return false;
+}
+
+// Line evicted by upper level moves to this exclusive cache
+void Cache::install_line(std::uint32_t base, const std::uint32_t *data, bool dirty) const {
+    std::uint32_t row, col, tag, indx;
+    int v = victim_find(base);
+
+    if (v >= 0) {
+        // Older copy, memory may still miss its changes
+        victims[v].valid = false;
+        dirty = dirty || victims[v].dirty;
+    }
+    compute_row_col_tag(row, col, tag, base);
+    for (indx = 0; indx < cnf.associativity(); indx++) {
+        if (dt[indx][row].valid && dt[indx][row].tag == tag)
+            break;
+    }
+    if (indx >= cnf.associativity())
+        indx = replacement_victim(row);
+
+    cache_data &cd = dt[indx][row];
+    if (cd.valid && cd.tag != tag) {
+        kick(indx, row);
+        change_counter++;
+        write_log.record(base_address(cd.tag, row),
+                         base_address(cd.tag, row) + cnf.blocks() * 4 - 1, change_counter);
+    }
+
+    update_replacement(indx, row, cd.valid);
+    std::copy(data, data + cnf.blocks(), cd.data);
+    cd.dirty = cd.dirty || dirty;
+    cd.valid = true;
+    cd.prefetched = false;
+    cd.tag = tag;
+    change_counter++;
+    write_log.record(base, base + cnf.blocks() * 4 - 1, change_counter);
+
+    emit cache_update(indx, row, 0, cd.valid, cd.dirty, cd.tag, cd.data, false);
+}
+
+// Inclusive lower level evicts range, copies in this level and above are
+// dropped. Dirty data are merged to the line, returns if there were any.
+bool Cache::back_invalidate(std::uint32_t base, std::uint32_t len, std::uint32_t *data) const {
+    bool merged = false, dropped = false;
+    bool write_back = cnf.write_policy() == MachineConfigCache::WritePolicy::WP_BACK;
+    std::uint32_t row, col, tag;
+
+    if (!cnf.enabled())
+        return false;
+    // Own copies are older than the ones of upper levels, merge them first
+    for (std::uint32_t address = base; address - base < len; address += cnf.blocks() * 4) {
+        compute_row_col_tag(row, col, tag, address);
+        for (std::uint32_t indx = 0; indx < cnf.associativity(); indx++) {
+            cache_data &cd = dt[indx][row];
+            if (!cd.valid || cd.tag != tag)
+                continue;
+            if (cd.dirty && write_back) {
+                std::copy(cd.data, cd.data + cnf.blocks(), data + (address - base) / 4);
+                merged = true;
+            }
+            kick(indx, row, true);
+            dropped = true;
+            emit cache_update(indx, row, 0, false, false, 0, nullptr, false);
+        }
+        int v = victim_find(address);
+        if (v >= 0) {
+            if (victims[v].dirty && write_back) {
+                std::copy(victims[v].data, victims[v].data + cnf.blocks(), data + (address - base) / 4);
+                merged = true;
+            }
+            victims[v].valid = false;
+            dropped = true;
+        }
+    }
+    if (dropped) {
+        change_counter++;
+        write_log.record(base, base + len - 1, change_counter);
+    }
+
+    for (Cache *upper : upper_caches)
+        merged = upper->back_invalidate(base, len, data) || merged;
+    return merged;
+}
+
+int Cache::victim_find(std::uint32_t base) const {
+    for (int i = 0; i < victims.size(); i++) {
+        if (victims[i].valid && victims[i].base == base)
+            return i;
+    }
+    return -1;
+}
+
+// Removes line from victim cache and copies it to victim_swap
+bool Cache::victim_take(std::uint32_t base, bool &dirty) const {
+    int v = victim_find(base);
+
+    if (v < 0)
+        return false;
+    std::copy(victims[v].data, victims[v].data + cnf.blocks(), victim_swap.begin());
+    dirty = victims[v].dirty;
+    victims[v].valid = false;
+    if (update_stats)
+        victim_hit_cnt++;
+    return true;
+}
+
+void Cache::victim_insert(std::uint32_t base, const std::uint32_t *data, bool dirty) const {
+    victim_line *slot = &victims[0];
+
+    for (victim_line &v : victims) {
+        if (!v.valid) {
+            slot = &v;
+            break;
+        }
+        if (v.last_use < slot->last_use)
+            slot = &v;
+    }
+    if (slot->valid) {
+        slot->valid = false;
+        evict(slot->base, slot->data, slot->dirty);
+    }
+
+    std::copy(data, data + cnf.blocks(), slot->data);
+    slot->valid = true;
+    slot->dirty = dirty;
+    slot->base = base;
+    slot->last_use = ++victim_clock;
+}
+
 std::uint32_t Cache::base_address(std::uint32_t tag, std::uint32_t row) const {
     return ((tag * cnf.blocks() * cnf.sets()) + (row * cnf.blocks())) << 2;
 }
 
 void Cache::update_statistics() const {
     emit statistics_update(stalled_cycles(), speed_improvement(), hit_rate());
+    if (prefetcher != nullptr)
+        emit prefetch_update(prefetch_fills, prefetch_accuracy(), prefetch_coverage(), prefetch_timeliness());
 }
 
 /* TODO: check if these work with various configurations for write policy!  */
-void Cache::update_misses(bool read) const {
+void Cache::update_misses(bool read, bool filled) const {
     if (update_stats) {
+        std::uint32_t cycles = read ? access_pen_read : access_pen_write;
         read_misses += read ? 1 : 0;
         write_misses += !read ? 1 : 0;
-        switch (cnf.type()) {
-            case MemoryType::L1_PROGRAM_CACHE:
-                cycle_stats.l1_program_stall_cycles = read ? access_pen_read : access_pen_write;
-                break;
-            case MemoryType::L1_DATA_CACHE:
-                cycle_stats.l1_data_stall_cycles = read ? access_pen_read : access_pen_write;
-                break;
-            case MemoryType::L2_UNIFIED_CACHE:
-                cycle_stats.l2_unified_stall_cycles = read ? access_pen_read : access_pen_write;
-                break;
-            default:
-                SANITY_ASSERT(0, "Wrong type for cache.");
-        }
-        cycle_stats.memory_cycles += read ? access_pen_read : access_pen_write;
+        // DRAM timing model replaces fixed penalty by latency of the line read
+        if (filled)
+            mem_lower->last_access_cycles(cycles);
+        charge_stall(cycles);
+    }
+}
+
+void Cache::charge_stall(std::uint32_t cycles) const {
+    switch (cnf.type()) {
+        case MemoryType::L1_PROGRAM_CACHE:
+            cycle_stats.l1_program_stall_cycles = cycles;
+            break;
+        case MemoryType::L1_DATA_CACHE:
+            cycle_stats.l1_data_stall_cycles = cycles;
+            break;
+        case MemoryType::L2_UNIFIED_CACHE:
+            cycle_stats.l2_unified_stall_cycles = cycles;
+            break;
+        case MemoryType::LOWER_CACHE:
+            cycle_stats.lower_cache_stall_cycles[cache_level - 3] = cycles;
+            break;
+        default:
+            SANITY_ASSERT(0, "Wrong type for cache.");
     }
+    cycle_stats.memory_cycles += cycles;
+}
+
+// Buffer stalls are counted apart from miss penalties of the cache
+void Cache::charge_buffer_stall(std::uint32_t cycles) const {
+    cycle_stats.write_buffer_stall_cycles += cycles;
+    cycle_stats.memory_cycles += cycles;
 }
 
 void Cache::update_hits(bool read) const {
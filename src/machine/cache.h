@@ -41,9 +41,13 @@
 #include <machineconfig.h>
 #include <cstdint>
 #include <ctime>
+#include <QVector>
 
 namespace machine {
 
+class Prefetcher;
+class WriteBuffer;
+
 class Cache : public MemoryAccess {
     Q_OBJECT
 public:
@@ -59,29 +63,51 @@ public:
     void flush(); // flush cache.
     void sync() override; // Same as flush.
 
-    std::uint32_t hit() const; // Number of recorded hits.
-    std::uint32_t miss() const; // Number of recorded misses.
+    std::uint64_t hit() const; // Number of recorded hits.
+    std::uint64_t miss() const; // Number of recorded misses.
 //    std::uint32_t ml_reads() const; // Number of reads on the lower level (L* or memory).
 //    std::uint32_t ml_writes() const; // Number of writes on the lower level (L* or memory).
-    std::uint32_t stalled_cycles() const; // Number of wasted cycles in lower level.
+    std::uint64_t stalled_cycles() const; // Number of wasted cycles in lower level.
     double speed_improvement() const; // Speed improvement in percents in comare with no used cache.
     double hit_rate() const; // Usage efficiency in percents.
 
+    std::uint64_t prefetches() const; // Number of lines filled by prefetcher.
+    std::uint64_t useful_prefetches() const; // Prefetched lines later used by demand access.
+    std::uint64_t late_prefetches() const; // Useful prefetches which were not filled yet when used.
+    double prefetch_accuracy() const; // Useful prefetches in percents of all of them.
+    double prefetch_coverage() const; // Misses removed by prefetching in percents.
+    double prefetch_timeliness() const; // Useful prefetches filled in time in percents.
+    std::uint64_t victim_hits() const; // Misses served by victim cache.
+    const WriteBuffer *write_buffer() const; // Null without write buffer.
+    std::uint64_t lower_reads() const; // Reads on the lower level (L* or memory).
+    std::uint64_t lower_writes() const; // Writes on the lower level (L* or memory).
+    // Line state for views, data holds blocks() words. False when line is not valid.
+    bool line(std::uint32_t associat, std::uint32_t set, bool &dirty, std::uint32_t &tag,
+              const std::uint32_t *&data) const;
+
+    unsigned level() const; // One for L1, two for L2 and so on.
+    void set_level(unsigned level);
+    // Connects cache directly above this one. Throws Input exception when
+    // inclusion policy of this or lower level cannot be kept for upper line size.
+    void add_upper(Cache *upper);
+
     void reset(); // Reset whole state of cache.
 
     const MachineConfigCache &config() const;
     enum LocationStatus location_status(std::uint32_t address) const override;
 
 signals:
-    void hit_update(std::uint32_t) const;
-    void miss_update(std::uint32_t) const;
-    void statistics_update(std::uint32_t stalled_cycles, double speed_improv, double hit_rate) const;
+    void hit_update(std::uint64_t) const;
+    void miss_update(std::uint64_t) const;
+    void statistics_update(std::uint64_t stalled_cycles, double speed_improv, double hit_rate) const;
+    void prefetch_update(std::uint64_t prefetches, double accuracy, double coverage, double timeliness) const;
+    void write_buffer_update(std::uint64_t combined, std::uint64_t forwarded, std::uint64_t full_stalls) const;
     void cache_update(std::uint32_t associat, std::uint32_t set, std::uint32_t col, bool valid, bool dirty,
                       std::uint32_t tag, const std::uint32_t *data, bool write) const;
-    void level2_cache_reads_update(std::uint32_t) const;
-    void level2_cache_writes_update(std::uint32_t) const;
-    void memory_writes_update(std::uint32_t) const;
-    void memory_reads_update(std::uint32_t) const;
+    void level2_cache_reads_update(std::uint64_t) const;
+    void level2_cache_writes_update(std::uint64_t) const;
+    void memory_writes_update(std::uint64_t) const;
+    void memory_reads_update(std::uint64_t) const;
 
 private:
     MachineConfigCache cnf;
@@ -90,13 +116,34 @@ private:
     uint32_t uncached_start;
     uint32_t uncached_last;
     MemoryType cache_type;
-    mutable std::uint32_t read_hits, read_misses, write_hits, write_misses;
-    mutable std::uint32_t mem_lower_reads, mem_lower_writes;
-    mutable std::uint32_t burst_reads, burst_writes;
+    mutable std::uint64_t read_hits, read_misses, write_hits, write_misses;
+    mutable std::uint64_t mem_lower_reads, mem_lower_writes;
+    mutable std::uint64_t burst_reads, burst_writes;
     mutable std::uint32_t change_counter;
+    Prefetcher *prefetcher;
+    mutable QVector<std::uint32_t> prefetch_candidates;
+    mutable std::uint64_t prefetch_fills, prefetch_hits, prefetch_late;
+    WriteBuffer *wbuffer;
+    unsigned cache_level;
+    Cache *lower_cache; // Lower level if it is a cache
+    QVector<Cache *> upper_caches;
+    mutable bool exclusive_fill; // Upper level reads line from this exclusive cache
+
+    // Small fully associative LRU buffer of lines evicted from the cache
+    struct victim_line {
+        bool valid, dirty;
+        std::uint32_t base;
+        std::uint64_t last_use;
+        std::uint32_t *data;
+    };
+    mutable QVector<victim_line> victims;
+    mutable QVector<std::uint32_t> victim_swap; // Line moving back from victim cache
+    mutable std::uint64_t victim_clock, victim_hit_cnt;
 
     struct cache_data {
         bool valid, dirty;
+        bool prefetched; // Filled by prefetcher and not used yet
+        std::uint64_t ready; // Cycle when prefetch fill completes
         std::uint32_t tag;
         std::uint32_t *data;
     };
@@ -110,9 +157,24 @@ private:
     void emit_mem_lower_signal(bool read) const;
     std::uint32_t debug_rword(std::uint32_t address) const;
     bool access(std::uint32_t address, std::uint32_t *data, bool write, std::uint32_t value = 0) const;
-    void kick(std::uint32_t associat_indx, std::uint32_t row) const;
+    std::uint32_t replacement_victim(std::uint32_t row) const;
+    void update_replacement(std::uint32_t associat_indx, std::uint32_t row, bool hit) const;
+    void prefetch(std::uint32_t address) const;
+    // Drop removes line without write back or moving it to victim cache
+    void kick(std::uint32_t associat_indx, std::uint32_t row, bool drop = false) const;
+    void evict(std::uint32_t base, std::uint32_t *data, bool dirty) const;
+    bool lower_exclusive() const;
+    // Forwarded line is taken from write buffer, it is not counted in lower level
+    void fill_line(cache_data &cd, std::uint32_t tag, std::uint32_t row, bool forwarded = false) const;
+    bool release_line(std::uint32_t base) const;
+    void install_line(std::uint32_t base, const std::uint32_t *data, bool dirty) const;
+    bool back_invalidate(std::uint32_t base, std::uint32_t len, std::uint32_t *data) const;
+    int victim_find(std::uint32_t base) const;
+    bool victim_take(std::uint32_t base, bool &dirty) const;
+    void victim_insert(std::uint32_t base, const std::uint32_t *data, bool dirty) const;
     std::uint32_t base_address(std::uint32_t tag, std::uint32_t row) const;
     void update_statistics() const;
+    double lower_access_cycles() const;
     inline void compute_row_col_tag(uint32_t &row, uint32_t &col, uint32_t &tag, uint32_t address) const {uint32_t ssize, index;
 
         address = address >> 2;
@@ -123,8 +185,11 @@ private:
         col = index % cnf.blocks();
     }
 
-    void update_misses(bool read) const;
+    // Filled is set when line was just read from lower level
+    void update_misses(bool read, bool filled = false) const;
     void update_hits(bool read) const;
+    void charge_stall(std::uint32_t cycles) const;
+    void charge_buffer_stall(std::uint32_t cycles) const;
 };
 
 }
@@ -37,10 +37,19 @@
 #include "machinedefs.h"
 #include "core.h"
 #include "qtmipsexception.h"
+#include "cyclestatistics.h"
+
+#include <algorithm>
 
 using namespace machine;
 
+extern CycleStatistics cycle_stats;
+
 #define COUNTER_IRQ_LEVEL 7
+// Separate line from timer so Compare write does not acknowledge counter overflow
+#define PERFCNT_IRQ_LEVEL 6
+// Upper bound of events counted in one cycle, overflow is checked before it can happen
+#define PERF_EVENTS_PER_CYCLE 4
 
 // sorry, unimplemented: non-trivial designated initializers not supported
 
@@ -70,7 +79,7 @@ static enum Cop0State::Cop0Registers cop0reg_map[32][8] = {
     /*22*/ {},
     /*23*/ {},
     /*24*/ {},
-    /*25*/ {},
+    /*25*/ {Cop0State::PerfCtl0, Cop0State::PerfCnt0, Cop0State::PerfCtl1, Cop0State::PerfCnt1},
     /*26*/ {},
     /*27*/ {},
     /*28*/ {},
@@ -89,11 +98,11 @@ const Cop0State::cop0reg_desc_t Cop0State::cop0reg_desc[Cop0State::COP0REGS_CNT]
     [Cop0State::BadVAddr] = {"BadVAddr", 0x00000000, 0x00000000,
         &Cop0State::read_cop0reg_default, &Cop0State::write_cop0reg_default},
     [Cop0State::Count] =    {"Count", 0xffffffff, 0x00000000,
-        &Cop0State::read_cop0reg_default, &Cop0State::write_cop0reg_count_compare},
+        &Cop0State::read_cop0reg_count, &Cop0State::write_cop0reg_count_compare},
     [Cop0State::Compare] =  {"Compare", 0xffffffff, 0x00000000,
         &Cop0State::read_cop0reg_default, &Cop0State::write_cop0reg_count_compare},
     [Cop0State::Status] =   {"Status",  Status_IE | Status_IntMask, 0x00000000,
-        &Cop0State::read_cop0reg_default, &Cop0State::write_cop0reg_default},
+        &Cop0State::read_cop0reg_default, &Cop0State::write_cop0reg_status},
     [Cop0State::Cause] =    {"Cause", 0x00000000, 0x00000000,
         &Cop0State::read_cop0reg_default, &Cop0State::write_cop0reg_default},
     [Cop0State::EPC] =      {"EPC", 0xffffffff, 0x00000000,
@@ -102,21 +111,59 @@ const Cop0State::cop0reg_desc_t Cop0State::cop0reg_desc[Cop0State::COP0REGS_CNT]
         &Cop0State::read_cop0reg_default, &Cop0State::write_cop0reg_default},
     [Cop0State::Config] =   {"Config", 0x00000000, 0x00000000,
         &Cop0State::read_cop0reg_default, &Cop0State::write_cop0reg_default},
+    [Cop0State::PerfCtl0] = {"PerfCtl0", PerfCtl_Event | PerfCtl_IE | PerfCtl_Modes, PerfCtl_M,
+        &Cop0State::read_cop0reg_default, &Cop0State::write_cop0reg_perfctl},
+    [Cop0State::PerfCnt0] = {"PerfCnt0", 0xffffffff, 0x00000000,
+        &Cop0State::read_cop0reg_perfcnt, &Cop0State::write_cop0reg_perfcnt},
+    [Cop0State::PerfCtl1] = {"PerfCtl1", PerfCtl_Event | PerfCtl_IE | PerfCtl_Modes, 0x00000000,
+        &Cop0State::read_cop0reg_default, &Cop0State::write_cop0reg_perfctl},
+    [Cop0State::PerfCnt1] = {"PerfCnt1", 0xffffffff, 0x00000000,
+        &Cop0State::read_cop0reg_perfcnt, &Cop0State::write_cop0reg_perfcnt},
 };
 
 Cop0State::Cop0State(Core *core) : QObject() {
     this->core = core;
+    this->events = nullptr;
+    this->count_event = 0;
+    this->perf_event = 0;
+    set_default_perf_sources();
     reset();
 }
 
 Cop0State::Cop0State(const Cop0State &orig) : QObject() {
     this->core = orig.core;
-    for (int i = 0; i < COP0REGS_CNT; i++)
+    this->events = nullptr;
+    this->count_event = 0;
+    this->perf_event = 0;
+    for (int i = 0; i < PERF_EVENTS_CNT; i++)
+        this->perf_sources[i] = orig.perf_sources[i];
+    set_default_perf_sources();
+    for (int i = 1; i < COP0REGS_CNT; i++)
         this->cop0reg[i] = orig.read_cop0reg((enum Cop0Registers)i);
+    // Count and performance counters were read up to date
+    this->last_core_cycles = core != nullptr ? core->get_cycles() : orig.last_core_cycles;
+    for (unsigned i = 0; i < PERF_COUNTERS; i++)
+        this->perf_start[i] = perf_event_count(i);
 }
 
 void Cop0State::setup_core(Core *core) {
     this->core = core;
+    schedule_count_compare();
+    schedule_perf_check();
+}
+
+void Cop0State::set_event_scheduler(EventScheduler *events) {
+    if (this->events != nullptr)
+        this->events->cancel(count_event);
+    count_event = 0;
+    if (this->events != nullptr)
+        this->events->cancel(perf_event);
+    perf_event = 0;
+    this->events = events;
+    update_count();
+    schedule_count_compare();
+    schedule_perf_check();
+    request_interrupt_check();
 }
 
 std::uint32_t Cop0State::read_cop0reg(std::uint8_t rd, std::uint8_t sel) const {
@@ -178,7 +225,11 @@ void Cop0State::reset() {
         this->cop0reg[i] = cop0reg_desc[i].init_value;
         emit cop0reg_update((enum Cop0Registers)i, cop0reg[i]);
     }
-    last_core_cycles = 0;
+    last_core_cycles = core != nullptr ? core->get_cycles() : 0;
+    for (unsigned i = 0; i < PERF_COUNTERS; i++)
+        perf_start[i] = 0; // Counters are stopped
+    schedule_count_compare();
+    schedule_perf_check();
 }
 
 void Cop0State::update_execption_cause(enum ExceptionCause excause, bool in_delay_slot) {
@@ -202,20 +253,30 @@ void Cop0State::set_interrupt_signal(uint irq_num, bool active) {
     else
         cop0reg[(int)Cause] &= ~mask;
     emit cop0reg_update(Cause, cop0reg[(int)Cause]);
+    request_interrupt_check();
 }
 
 bool Cop0State::core_interrupt_request() {
     std::uint32_t irqs;
+    bool request;
 
-    update_count_and_compare_irq();
+    if (events == nullptr) {
+        update_count_and_compare_irq();
+        if ((cop0reg[(int)PerfCtl0] | cop0reg[(int)PerfCtl1]) & PerfCtl_IE)
+            update_perf_irq();
+    }
 
     irqs = cop0reg[(int)Status];
     irqs &= cop0reg[(int)Cause];
     irqs &= Status_IntMask;
 
-    return !!(irqs && cop0reg[(int)Status] & Status_IntMask &&
-           !(cop0reg[(int)Status] & Status_EXL) &&
-           !(cop0reg[(int)Status] & Status_ERL));
+    request = !!(irqs && cop0reg[(int)Status] & Status_IntMask &&
+              !(cop0reg[(int)Status] & Status_EXL) &&
+              !(cop0reg[(int)Status] & Status_ERL));
+    // Fetch with interrupt can be flushed by pipeline, keep asking until it is accepted
+    if (request)
+        request_interrupt_check();
+    return request;
 }
 
 void Cop0State::set_status_exl(bool value) {
@@ -224,35 +285,191 @@ void Cop0State::set_status_exl(bool value) {
     else
         cop0reg[(int)Status] &= ~Status_EXL;
     emit cop0reg_update(Status, cop0reg[(int)Status]);
+    request_interrupt_check();
+}
+
+void Cop0State::request_interrupt_check() {
+    if (events != nullptr)
+        events->request_check();
 }
 
 std::uint32_t Cop0State::exception_pc_address() {
     return cop0reg[(int)EBase] + 0x180;
 }
 
+std::uint32_t Cop0State::read_cop0reg_count(enum Cop0Registers reg) const {
+    std::uint32_t val = cop0reg[(int)reg];
+    if (core != nullptr)
+        val += (std::uint32_t)(core->get_cycles() - last_core_cycles);
+    emit cop0reg_read(reg, val);
+    return val;
+}
+
 void Cop0State::write_cop0reg_count_compare(enum Cop0Registers reg, std::uint32_t value) {
+    update_count();
     set_interrupt_signal(COUNTER_IRQ_LEVEL, false);
     write_cop0reg_default(reg, value);
+    schedule_count_compare();
 }
 
-void Cop0State::update_count_and_compare_irq() {
-    std::uint32_t core_cycles;
-    std::uint32_t count_orig;
+void Cop0State::write_cop0reg_status(enum Cop0Registers reg, std::uint32_t value) {
+    write_cop0reg_default(reg, value);
+    request_interrupt_check();
+}
+
+void Cop0State::update_count() {
+    std::uint64_t core_cycles;
     if (core == nullptr)
         return;
-    count_orig = cop0reg[(int)Count];
     core_cycles = core->get_cycles();
-    cop0reg[(int)Count] += core_cycles - last_core_cycles;
+    // Count register wraps around, only low bits of the difference matter
+    cop0reg[(int)Count] += (std::uint32_t)(core_cycles - last_core_cycles);
     last_core_cycles = core_cycles;
     emit cop0reg_update(Count, cop0reg[(int)Count]);
+}
+
+void Cop0State::update_count_and_compare_irq() {
+    std::uint32_t count_orig;
+    if (core == nullptr)
+        return;
+    count_orig = cop0reg[(int)Count];
+    update_count();
 
     if ((std::int32_t)(cop0reg[(int)Compare] - count_orig) > 0 &&
         (std::int32_t)(cop0reg[(int)Compare] - cop0reg[(int)Count]) <= 0)
         set_interrupt_signal(COUNTER_IRQ_LEVEL, true);
 }
 
+// Count reaches Compare after known number of cycles, one event per timer
+// period replaces comparison on every fetch.
+void Cop0State::schedule_count_compare() {
+    std::uint64_t delta;
+    if (events == nullptr || core == nullptr)
+        return;
+    events->cancel(count_event);
+    delta = (std::uint32_t)(cop0reg[(int)Compare] - cop0reg[(int)Count]);
+    if (delta == 0)
+        delta = 1ULL << 32; // Equal now, next match after full period
+    count_event = events->schedule(last_core_cycles + delta, [this]() {
+        update_count();
+        set_interrupt_signal(COUNTER_IRQ_LEVEL, true);
+        schedule_count_compare();
+    });
+}
+
 void Cop0State::write_cop0reg_user_local(enum Cop0Registers reg, std::uint32_t value) {
     write_cop0reg_default(reg, value);
     if (core != nullptr)
         core->set_c0_userlocal(value);
 }
+
+void Cop0State::set_perf_source(enum PerfEvent event, PerfSource source) {
+    SANITY_ASSERT(event < PERF_EVENTS_CNT, QString("Unknown performance counter event ") + QString::number(event));
+    for (unsigned i = 0; i < PERF_COUNTERS; i++)
+        update_perf_counter(i);
+    perf_sources[event] = source;
+    for (unsigned i = 0; i < PERF_COUNTERS; i++)
+        perf_start[i] = perf_event_count(i);
+}
+
+void Cop0State::set_default_perf_sources() {
+    perf_sources[PERF_CYCLES] = [this]() -> std::uint64_t {
+        return core != nullptr ? core->get_cycles() : 0;
+    };
+    perf_sources[PERF_INSTRUCTIONS] = []() { return cycle_stats.instructions; };
+    perf_sources[PERF_DATA_HAZARD_STALLS] = []() { return cycle_stats.data_hazard_stalls; };
+    perf_sources[PERF_CONTROL_HAZARD_STALLS] = []() { return cycle_stats.control_hazard_stalls; };
+}
+
+std::uint64_t Cop0State::perf_event_count(unsigned counter) const {
+    std::uint32_t ctl = cop0reg[(int)PerfCtl0 + 2 * counter];
+    unsigned event = (ctl & PerfCtl_Event) >> PerfCtl_EventShift;
+    if (!(ctl & PerfCtl_Modes) || event >= PERF_EVENTS_CNT || !perf_sources[event])
+        return 0;
+    return perf_sources[event]();
+}
+
+std::uint32_t Cop0State::perf_counter_delta(unsigned counter) const {
+    std::uint64_t count = perf_event_count(counter);
+    // Source statistics can be cleared independently of the counter
+    return count > perf_start[counter] ? (std::uint32_t)(count - perf_start[counter]) : 0;
+}
+
+void Cop0State::update_perf_counter(unsigned counter) {
+    enum Cop0Registers reg = (enum Cop0Registers)((int)PerfCnt0 + 2 * counter);
+    std::uint32_t delta = perf_counter_delta(counter);
+    perf_start[counter] = perf_event_count(counter);
+    if (delta == 0)
+        return;
+    cop0reg[(int)reg] += delta;
+    emit cop0reg_update(reg, cop0reg[(int)reg]);
+}
+
+std::uint32_t Cop0State::read_cop0reg_perfcnt(enum Cop0Registers reg) const {
+    std::uint32_t val = cop0reg[(int)reg] + perf_counter_delta(((int)reg - (int)PerfCnt0) / 2);
+    emit cop0reg_read(reg, val);
+    return val;
+}
+
+void Cop0State::write_cop0reg_perfctl(enum Cop0Registers reg, std::uint32_t value) {
+    unsigned counter = ((int)reg - (int)PerfCtl0) / 2;
+    update_perf_counter(counter);
+    write_cop0reg_default(reg, value);
+    perf_start[counter] = perf_event_count(counter);
+    update_perf_irq();
+    schedule_perf_check();
+}
+
+void Cop0State::write_cop0reg_perfcnt(enum Cop0Registers reg, std::uint32_t value) {
+    unsigned counter = ((int)reg - (int)PerfCnt0) / 2;
+    write_cop0reg_default(reg, value);
+    perf_start[counter] = perf_event_count(counter);
+    update_perf_irq();
+    schedule_perf_check();
+}
+
+// Interrupt is requested while bit 31 of enabled counter is set
+void Cop0State::update_perf_irq() {
+    bool active = false;
+    for (unsigned i = 0; i < PERF_COUNTERS; i++) {
+        update_perf_counter(i);
+        if ((cop0reg[(int)PerfCtl0 + 2 * i] & PerfCtl_IE) &&
+            (cop0reg[(int)PerfCnt0 + 2 * i] & 0x80000000))
+            active = true;
+    }
+    if (active == !!(cop0reg[(int)Cause] & Cause_PCI))
+        return;
+    if (active)
+        cop0reg[(int)Cause] |= Cause_PCI;
+    else
+        cop0reg[(int)Cause] &= ~Cause_PCI;
+    set_interrupt_signal(PERFCNT_IRQ_LEVEL, active);
+}
+
+// Events other than cycles cannot be predicted, counter is checked again
+// before it could reach overflow at the highest event rate.
+void Cop0State::schedule_perf_check() {
+    std::uint64_t delta = UINT64_MAX;
+    if (events == nullptr || core == nullptr)
+        return;
+    events->cancel(perf_event);
+    perf_event = 0;
+    for (unsigned i = 0; i < PERF_COUNTERS; i++) {
+        std::uint32_t ctl = cop0reg[(int)PerfCtl0 + 2 * i];
+        std::uint32_t cnt = cop0reg[(int)PerfCnt0 + 2 * i] + perf_counter_delta(i);
+        std::uint64_t left;
+        if (!(ctl & PerfCtl_IE) || !(ctl & PerfCtl_Modes))
+            continue;
+        // Events until bit 31 of the counter changes
+        left = 0x80000000U - (cnt & 0x7fffffff);
+        if (((ctl & PerfCtl_Event) >> PerfCtl_EventShift) != PERF_CYCLES)
+            left = (left + PERF_EVENTS_PER_CYCLE - 1) / PERF_EVENTS_PER_CYCLE;
+        delta = std::min(delta, left);
+    }
+    if (delta == UINT64_MAX)
+        return;
+    perf_event = events->schedule(core->get_cycles() + delta, [this]() {
+        update_perf_irq();
+        schedule_perf_check();
+    });
+}
@@ -39,7 +39,9 @@
 #include <QObject>
 #include <QString>
 #include <cstdint>
+#include <functional>
 #include <machinedefs.h>
+#include "eventscheduler.h"
 namespace machine {
 
 class Core;
@@ -59,6 +61,10 @@ public:
         EPC,      // Program counter at last exception
         EBase,    // Exception vector base register
         Config,   // Configuration registers
+        PerfCtl0, // Performance counter 0 control
+        PerfCnt0, // Performance counter 0
+        PerfCtl1, // Performance counter 1 control
+        PerfCnt1, // Performance counter 1
         COP0REGS_CNT,
     };
 
@@ -70,6 +76,38 @@ public:
         Status_Int0 =    0x00000100,
     };
 
+    enum CauseReg {
+        Cause_PCI =      0x04000000, // Performance counter interrupt pending
+    };
+
+    // Privilege modes are not distinguished, counter runs when any mode bit is set
+    enum PerfCtlReg {
+        PerfCtl_EXL =    0x00000001,
+        PerfCtl_K =      0x00000002,
+        PerfCtl_S =      0x00000004,
+        PerfCtl_U =      0x00000008,
+        PerfCtl_Modes =  0x0000000f,
+        PerfCtl_IE =     0x00000010,
+        PerfCtl_Event =  0x00000fe0,
+        PerfCtl_EventShift = 5,
+        PerfCtl_M =      0x80000000,
+    };
+
+    // Events selected by PerfCtl Event field
+    enum PerfEvent {
+        PERF_CYCLES,
+        PERF_INSTRUCTIONS,
+        PERF_L1_PROGRAM_MISSES,
+        PERF_L1_DATA_MISSES,
+        PERF_L2_UNIFIED_MISSES,
+        PERF_DATA_HAZARD_STALLS,
+        PERF_CONTROL_HAZARD_STALLS,
+        PERF_BRANCH_MISPREDICTS,
+        PERF_EVENTS_CNT,
+    };
+    // Returns number of events since machine reset
+    typedef std::function<std::uint64_t()> PerfSource;
+
     Cop0State(Core *core = nullptr);
     Cop0State(const Cop0State&);
 
@@ -87,6 +125,13 @@ public:
     bool core_interrupt_request();
     std::uint32_t exception_pc_address();
 
+    // Without scheduler Count and interrupts are polled on every fetch
+    void set_event_scheduler(EventScheduler *events);
+    void update_count(); // Bring Count register up to date with core cycles
+    // Cycles, instructions and hazard stalls are counted by default,
+    // events without source never increment counter
+    void set_perf_source(enum PerfEvent event, PerfSource source);
+
 signals:
     void cop0reg_update(enum Cop0Registers reg, std::uint32_t val);
     void cop0reg_read(enum Cop0Registers reg, std::uint32_t val) const;
@@ -121,11 +166,30 @@ private:
 
     std::uint32_t read_cop0reg_default(enum Cop0Registers reg) const;
     void write_cop0reg_default(enum Cop0Registers reg, std::uint32_t value);
+    std::uint32_t read_cop0reg_count(enum Cop0Registers reg) const;
     void write_cop0reg_count_compare(enum Cop0Registers reg, std::uint32_t value);
+    void write_cop0reg_status(enum Cop0Registers reg, std::uint32_t value);
     void write_cop0reg_user_local(enum Cop0Registers reg, std::uint32_t value);
+    std::uint32_t read_cop0reg_perfcnt(enum Cop0Registers reg) const;
+    void write_cop0reg_perfctl(enum Cop0Registers reg, std::uint32_t value);
+    void write_cop0reg_perfcnt(enum Cop0Registers reg, std::uint32_t value);
+    void schedule_count_compare();
+    void request_interrupt_check();
+    void set_default_perf_sources();
+    std::uint64_t perf_event_count(unsigned counter) const; // Zero when counter is stopped
+    std::uint32_t perf_counter_delta(unsigned counter) const;
+    void update_perf_counter(unsigned counter);
+    void update_perf_irq();
+    void schedule_perf_check();
     Core *core;
     std::uint32_t cop0reg[COP0REGS_CNT]; // coprocessor 0 registers
-    std::uint32_t last_core_cycles;
+    std::uint64_t last_core_cycles;
+    EventScheduler *events;
+    EventScheduler::EventId count_event;
+    enum { PERF_COUNTERS = 2 };
+    PerfSource perf_sources[PERF_EVENTS_CNT];
+    std::uint64_t perf_start[PERF_COUNTERS]; // Event count folded into counter register
+    EventScheduler::EventId perf_event;
 };
 
 }
@@ -34,17 +34,36 @@
  ******************************************************************************/
 
 #include "branchpredictor.h"
+#include "bbvprofiler.h"
+#include "pipetrace.h"
+#include "hlelibrary.h"
 #include "core.h"
 #include "programloader.h"
 #include "utils.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
+#include <utility>
 #include <QDebug>
+#include <QElapsedTimer>
 
 using namespace machine;
 extern CycleStatistics cycle_stats;
 
+// Cycles of direct DRAM access beyond the one of the stage. Memory with timing
+// model reports latency of the access which was just done.
+static std::uint32_t dram_access_cycles(const MemoryAccess *mem, bool write, bool accessed = true) {
+    std::uint32_t cycles = write ? mem->get_access_write() : mem->get_access_read();
+
+    if (mem->type() != MemoryAccess::MemoryType::DRAM)
+        return 0;
+    if (accessed)
+        mem->last_access_cycles(cycles);
+    return cycles > 0 ? cycles - 1 : 0;
+}
+
 #include <QDebug>
 
 Core::Core(Registers *regs, MemoryAccess *mem_program, MemoryAccess *mem_data,
@@ -52,6 +71,7 @@ Core::Core(Registers *regs, MemoryAccess *mem_program, MemoryAccess *mem_data,
         ex_handlers(), hw_breaks(), trace_file(trace_dir_path + "/program.trace") {
     this->cycles = 0;
     this->stalls = 0;
+    this->fetch_memory_cycles = 0;
     this->regs = regs;
     this->cop0state = cop0state;
     this->mem_program = mem_program;
@@ -60,6 +80,18 @@ Core::Core(Registers *regs, MemoryAccess *mem_program, MemoryAccess *mem_data,
     this->ex_default_handler = new StopExceptionHandler();
     this->min_cache_row_size = min_cache_row_size;
     this->hwr_userlocal = 0xe0000000;
+    this->stop_pending = false;
+    this->stop_cause = EXCAUSE_NONE;
+    this->bbv = nullptr;
+    this->pipe_trace = nullptr;
+    this->events = nullptr;
+    this->program_end = 0xffffffff;
+    this->stop_address = 0xffffffff;
+    this->stop_flag = nullptr;
+    this->run_time_limit = -1;
+    this->run_check_interval = 8192;
+    this->idle_skip = false;
+    idle_reset();
     if (cop0state != nullptr)
         cop0state->setup_core(this);
     for (int i = 0; i < EXCAUSE_COUNT; i++) {
@@ -67,7 +99,8 @@ Core::Core(Registers *regs, MemoryAccess *mem_program, MemoryAccess *mem_data,
         step_over_exception[i] = true;
     }
     step_over_exception[EXCAUSE_INT] = false;
-    if (!trace_file.open(QIODevice::WriteOnly | QIODevice::Text))
+    // Appended as cores of one machine can share the file, machine truncates it
+    if (!trace_file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Append))
         throw QTMIPS_EXCEPTION(Runtime, "Failed to create trace file", trace_dir_path + "program.trace");
 }
 
@@ -76,23 +109,117 @@ Core::~Core() {
 }
 
 void Core::step(bool skip_break) {
+    stop_pending = false;
+    stop_cause = EXCAUSE_NONE;
     cycles++;
     ++cycle_stats.total_cycles;
     do_step(skip_break);
 }
 
+std::uint32_t Core::skip_stall(std::uint32_t max_cycles) {
+    std::uint32_t count = do_skip_stall(max_cycles);
+    if (count != 0) {
+        stop_pending = false;
+        cycles += count;
+        cycle_stats.total_cycles += count;
+    }
+    return count;
+}
+
+void Core::charge_cycles(std::uint64_t count, std::uint64_t instructions) {
+    cycles += count;
+    cycle_stats.total_cycles += count;
+    cycle_stats.instructions += instructions;
+    idle_dirty = true;
+}
+
+bool Core::is_run_stop(std::uint32_t address) const {
+    return address >= program_end || address == stop_address;
+}
+
+Core::StopReason Core::run(std::uint64_t max_cycles, unsigned stop_mask, bool skip_break) {
+    QElapsedTimer timer;
+    bool timed = (stop_mask & STOP_TIME) && run_time_limit >= 0;
+    std::uint64_t done = 0;
+    std::uint64_t next_check = run_check_interval;
+
+    if (timed)
+        timer.start();
+    // Knobs can be turned between runs, loop has to read them again before skip
+    idle_ready = false;
+    while (done < max_cycles) {
+        std::uint64_t skipped = idle_ready ? skip_idle(max_cycles - done) : 0;
+        if (skipped == 0)
+            skipped = skip_stall(std::min<std::uint64_t>(max_cycles - done, UINT32_MAX));
+        if (skipped == 0) {
+            step(skip_break);
+            skip_break = false;
+            done++;
+        } else {
+            done += skipped;
+        }
+
+        if (stop_pending) {
+            unsigned reason = stop_cause == EXCAUSE_BREAK || stop_cause == EXCAUSE_HWBREAK ?
+                              STOP_BREAK : STOP_EXCEPTION;
+            if (stop_mask & reason)
+                return (StopReason)reason;
+        }
+        std::uint32_t pc = regs->read_pc();
+        if ((stop_mask & STOP_PROGRAM_END) && pc >= program_end)
+            return STOP_PROGRAM_END;
+        if ((stop_mask & STOP_ADDRESS) && pc == stop_address)
+            return STOP_ADDRESS;
+        if (done >= next_check) {
+            next_check = done + run_check_interval;
+            if ((stop_mask & STOP_EXTERNAL) && stop_flag != nullptr &&
+                    stop_flag->load(std::memory_order_relaxed))
+                return STOP_EXTERNAL;
+            if (timed && timer.elapsed() >= run_time_limit)
+                return STOP_TIME;
+        }
+    }
+    return STOP_CYCLES;
+}
+
+void Core::set_program_end(std::uint32_t address) {
+    program_end = address;
+}
+
+void Core::set_stop_address(std::uint32_t address) {
+    stop_address = address;
+}
+
+void Core::set_stop_flag(const std::atomic<bool> *flag) {
+    stop_flag = flag;
+}
+
+void Core::set_run_time_limit(int msec) {
+    run_time_limit = msec;
+}
+
+void Core::set_run_check_interval(std::uint32_t cycles) {
+    run_check_interval = std::max(cycles, 1u);
+}
+
+std::uint32_t Core::do_skip_stall(std::uint32_t max_cycles) {
+    (void)max_cycles;
+    return 0;
+}
+
 void Core::reset() {
     cycles = 0;
     stalls = 0;
     memset(&cycle_stats, 0, sizeof(cycle_stats));
+    idle_reset();
     do_reset();
 }
 
-unsigned Core::get_cycles() const {
+std::uint64_t Core::get_cycles() const {
     return cycles;
 }
 
-uint32_t Core::get_stalls() const {
+std::uint64_t Core::get_stalls() const {
     return stalls;
 }
 
@@ -112,11 +239,11 @@ MemoryAccess *Core::get_mem_program() const {
     return mem_program;
 }
 
-void Core::set_cycles(uint32_t c) {
+void Core::set_cycles(std::uint64_t c) {
     cycles = c;
 }
 
-void Core::set_stalls(uint32_t s) {
+void Core::set_stalls(std::uint64_t s) {
     stalls = s;
     emit stall_value_changed(s);
 }
@@ -175,6 +302,7 @@ bool Core::handle_exception(Core *core, Registers *regs, ExceptionCause excause,
                             std::uint32_t jump_branch_pc, bool in_delay_slot,
                             std::uint32_t mem_ref_addr) {
     bool ret = false;
+    idle_dirty = true;
     if (excause == EXCAUSE_HWBREAK) {
         if (in_delay_slot)
             regs->pc_abs_jmp(jump_branch_pc);
@@ -204,12 +332,180 @@ bool Core::handle_exception(Core *core, Registers *regs, ExceptionCause excause,
         ret = ex_default_handler->handle_exception(core, regs, excause, inst_addr,
                                                    next_addr, jump_branch_pc, in_delay_slot,
                                                    mem_ref_addr);
-    if (get_stop_on_exception(excause))
-            emit core->stop_on_exception_reached();
+    if (get_stop_on_exception(excause)) {
+        core->stop_cause = excause;
+        core->request_stop_on_exception();
+    }
 
     return ret;
 }
 
+void Core::request_stop_on_exception() {
+    stop_pending = true;
+    emit stop_on_exception_reached();
+}
+
+bool Core::stop_on_exception_pending() const {
+    return stop_pending;
+}
+
+void Core::take_over(Core *other) {
+    // Handlers and breakpoints are swapped so each of them stays owned by exactly one core
+    ex_handlers.swap(other->ex_handlers);
+    std::swap(ex_default_handler, other->ex_default_handler);
+    hw_breaks.swap(other->hw_breaks);
+    for (int i = 0; i < EXCAUSE_COUNT; i++) {
+        stop_on_exception[i] = other->stop_on_exception[i];
+        step_over_exception[i] = other->step_over_exception[i];
+    }
+    cycles = other->cycles;
+    stalls = other->stalls;
+    hwr_userlocal = other->hwr_userlocal;
+    bbv = other->bbv;
+    other->bbv = nullptr;
+    events = other->events;
+    program_end = other->program_end;
+    stop_address = other->stop_address;
+    stop_flag = other->stop_flag;
+    run_time_limit = other->run_time_limit;
+    run_check_interval = other->run_check_interval;
+    idle_skip = other->idle_skip;
+    idle_reset();
+    if (cop0state != nullptr)
+        cop0state->setup_core(this);
+}
+
+void Core::set_bbv_profiler(BbvProfiler *profiler) {
+    bbv = profiler;
+}
+
+void Core::set_event_scheduler(EventScheduler *scheduler) {
+    events = scheduler;
+}
+
+void Core::set_idle_loop_skip(bool value) {
+    idle_skip = value;
+    idle_reset();
+}
+
+// Longest loop body which is considered for skipping
+#define IDLE_LOOP_BYTES 64
+
+void Core::idle_reset() {
+    idle_valid = false;
+    idle_dirty = false;
+    idle_ready = false;
+    idle_head = 0xffffffff;
+    idle_last_addr = 0;
+    idle_period = 0;
+    idle_count_regs = 0;
+    idle_count_mask = 0;
+}
+
+// Loop is found by retirement of instruction at or shortly before the previous
+// one. Its iteration is idle when registers at loop head are the same as in
+// the previous iteration, nothing was written to memory or Cop0 and no
+// peripheral register which changes by read was read. Status registers can
+// change only by event (terminal input is delivered by event too). Registers
+// loaded from Count may differ by the cycles of iteration, Count is computed
+// from core cycles. All following iterations are then the same until some
+// event, the nearest one for Count is Count reaching Compare.
+void Core::idle_retire(std::uint32_t inst_addr, const Instruction &inst, ExceptionCause excause,
+                       std::uint32_t mem_addr) {
+    if (inst_addr == idle_head) {
+        idle_loop_head();
+    } else if (inst_addr <= idle_last_addr && idle_last_addr - inst_addr < IDLE_LOOP_BYTES) {
+        idle_head = inst_addr;
+        idle_valid = false;
+        idle_period = 0;
+        idle_loop_head();
+    }
+    idle_last_addr = inst_addr;
+
+    if (inst_addr - idle_head >= IDLE_LOOP_BYTES) {
+        idle_dirty = true; // Left the loop
+        return;
+    }
+    InstructionFlags flags;
+    AluOp alu_op;
+    AccessControl mem_ctl;
+    inst.flags_alu_op_mem_ctl(flags, alu_op, mem_ctl);
+    if (excause != EXCAUSE_NONE || flags & (IMF_MEMWRITE | IMF_EXCEPTION | IMF_STOP_IF) ||
+            alu_op == ALU_OP_MTC0 || alu_op == ALU_OP_MFMC0)
+        idle_dirty = true;
+    if ((flags & IMF_MEMREAD) && (mem_data->location_status(mem_addr) & LOCSTAT_READ_EFFECT))
+        idle_dirty = true;
+    if (alu_op == ALU_OP_MFC0 && inst.rd() == Cop0State::Count && inst.cop0sel() == 0 && inst.rt() != 0)
+        idle_count_regs |= 1u << inst.rt();
+}
+
+void Core::idle_loop_head() {
+    std::uint32_t head_regs[33];
+    for (int i = 1; i < 32; i++)
+        head_regs[i - 1] = regs->read_gp(i);
+    head_regs[31] = regs->read_hi_lo(false);
+    head_regs[32] = regs->read_hi_lo(true);
+
+    std::uint64_t period = cycles - idle_head_cycle;
+    bool same = idle_valid && !idle_dirty;
+    for (int i = 0; same && i < 33; i++) {
+        // Count advances by one each cycle
+        if (i < 31 && (idle_count_regs & (1u << (i + 1))))
+            same = head_regs[i] - idle_regs[i] == (std::uint32_t)period;
+        else
+            same = head_regs[i] == idle_regs[i];
+    }
+    idle_ready = false;
+    if (same) {
+        // Pipeline timing has to settle too, same period twice in a row
+        idle_ready = period == idle_period && idle_count_regs == idle_count_mask;
+        idle_period = period;
+    } else {
+        idle_period = 0;
+    }
+    idle_count_mask = idle_count_regs;
+    idle_count_regs = 0;
+    memcpy(idle_regs, head_regs, sizeof(idle_regs));
+    idle_head_cycle = cycles;
+    idle_stats_prev = idle_stats;
+    idle_stats = cycle_stats;
+    idle_valid = true;
+    idle_dirty = false;
+}
+
+std::uint64_t Core::skip_idle(std::uint64_t max_cycles) {
+    std::uint64_t next_event, count;
+
+    idle_ready = false;
+    // Profiler has to see every instruction
+    if (events == nullptr || bbv != nullptr || idle_period == 0)
+        return 0;
+    next_event = events->next_event_cycle();
+    if (next_event <= cycles + idle_period)
+        return 0;
+    // Whole iterations only, state after them is the same as now
+    count = std::min(next_event - cycles - 1, max_cycles) / idle_period;
+    if (count == 0)
+        return 0;
+    CycleStatistics start = idle_stats_prev, end = idle_stats;
+    cycle_stats.add_repeated(start, end, count);
+    cycle_stats.idle_skipped_cycles += count * idle_period;
+    // Snapshots move forward too, so the next iteration is compared to the skipped one
+    idle_stats_prev.add_repeated(start, end, count);
+    idle_stats.add_repeated(start, end, count);
+    cycles += count * idle_period;
+    idle_head_cycle += count * idle_period;
+    // Values loaded from Count are those of the last skipped iteration
+    for (int i = 1; i < 32; i++) {
+        if (idle_count_mask & (1u << i)) {
+            regs->write_gp(i, regs->read_gp(i) + (std::uint32_t)(count * idle_period));
+            idle_regs[i - 1] += (std::uint32_t)(count * idle_period);
+        }
+    }
+    stop_pending = false;
+    return count * idle_period;
+}
+
 void Core::set_c0_userlocal(std::uint32_t address) {
     hwr_userlocal = address;
     if (cop0state != nullptr) {
@@ -286,10 +582,16 @@ struct Core::dtFetch Core::fetch(bool skip_break, bool signal, bool mem_access)
 //    Instruction inst(mem_program->read_word(inst_addr));
 
     if (mem_access) {
+        std::uint64_t prev_mem_cycles = cycle_stats.memory_cycles;
+
+        mem_program->set_access_pc(inst_addr);
+        // Data caches leave counting of direct accesses in unknown state
+        if (mem_program->type() == MemoryAccess::MemoryType::DRAM)
+            mem_program->set_update_stats(true);
         cache_instr = mem_program->read_word(inst_addr);
         // We read from memory. If we have no caches we should update cycles by memory latency and not by 1.
-        uint32_t mem_cycles = mem_program->type() == MemoryAccess::MemoryType::DRAM ? mem_program->get_access_read() - 1 : 0;
-        cycle_stats.memory_cycles += mem_cycles;
+        cycle_stats.memory_cycles += dram_access_cycles(mem_program, false);
+        fetch_memory_cycles += cycle_stats.memory_cycles - prev_mem_cycles;
     }
 
     Instruction inst(cache_instr);
@@ -312,7 +614,10 @@ struct Core::dtFetch Core::fetch(bool skip_break, bool signal, bool mem_access)
             excause = EXCAUSE_HWBREAK;
         }
     }
-    if (cop0state != nullptr && excause == EXCAUSE_NONE) {
+    if (cop0state != nullptr && excause == EXCAUSE_NONE &&
+            (events == nullptr || cycles >= events->next_event_cycle())) {
+        if (events != nullptr)
+            events->run_until(cycles);
         if (cop0state->core_interrupt_request()) {
             excause = EXCAUSE_INT;
         }
@@ -329,7 +634,8 @@ struct Core::dtFetch Core::fetch(bool skip_break, bool signal, bool mem_access)
             .excause = excause,
             .in_delay_slot = false,
             .is_valid = true,
-            .predicted = false
+            .predicted = false,
+            .trace_id = 0
     };
 }
 
@@ -340,6 +646,9 @@ struct Core::dtDecode Core::decode(const struct dtFetch &dt, bool inc_8) {
     AccessControl mem_ctl;
     ExceptionCause excause = dt.excause;
 
+    if (pipe_trace != nullptr && dt.trace_id != 0)
+        pipe_trace->stage(dt.trace_id, PipeTrace::STAGE_DECODE, cycles);
+
     dt.inst.flags_alu_op_mem_ctl(flags, alu_op, mem_ctl);
 
     if (!(flags & IMF_SUPPORTED))
@@ -411,6 +720,8 @@ struct Core::dtDecode Core::decode(const struct dtFetch &dt, bool inc_8) {
             .bj_not = !!(flags & IMF_BJ_NOT),
             .bgt_blez = !!(flags & IMF_BGTZ_BLEZ),
             .nb_skip_ds = !!(flags & IMF_NB_SKIP_DS),
+            .read_hilo = !!(flags & IMF_READ_HILO),
+            .write_hilo = !!(flags & IMF_WRITE_HILO),
             .forward_m_d_rs = false,
             .forward_m_d_rt = false,
             .aluop = alu_op,
@@ -430,6 +741,7 @@ struct Core::dtDecode Core::decode(const struct dtFetch &dt, bool inc_8) {
             .stall = false,
             .stop_if = !!(flags & IMF_STOP_IF),
             .is_valid = dt.is_valid,
+            .trace_id = dt.trace_id,
     };
 }
 
@@ -438,6 +750,9 @@ struct Core::dtExecute Core::execute(const struct dtDecode &dt) {
     ExceptionCause excause = dt.excause;
     std::uint32_t alu_val = 0;
 
+    if (pipe_trace != nullptr && dt.trace_id != 0)
+        pipe_trace->stage(dt.trace_id, PipeTrace::STAGE_EXECUTE, cycles);
+
     // Handle conditional move (we have to change regwrite signal if conditional is not met)
     bool regwrite = dt.regwrite;
 
@@ -462,7 +777,7 @@ struct Core::dtExecute Core::execute(const struct dtDecode &dt) {
                         alu_val = min_cache_row_size;
                         break;
                     case 2: // CC
-                        alu_val = cycles;
+                        alu_val = (std::uint32_t)cycles; // CC register holds low bits of the counter
                         break;
                     case 3: // CCRes
                         alu_val = 1;
@@ -553,6 +868,7 @@ struct Core::dtExecute Core::execute(const struct dtDecode &dt) {
             .in_delay_slot = dt.in_delay_slot,
             .stop_if = dt.stop_if,
             .is_valid = dt.is_valid,
+            .trace_id = dt.trace_id,
     };
 }
 
@@ -564,14 +880,17 @@ struct Core::dtMemory Core::memory(const struct dtExecute &dt) {
     bool memwrite = dt.memwrite;
     bool regwrite = dt.regwrite;
 
-    // We read from memory, if we directly hit DRAM we should update cycles accordingly.
-    if (memread) {
-        cycle_stats.memory_cycles += (mem_data->type() == MemoryAccess::MemoryType::DRAM) ? mem_data->get_access_read() - 1 : 0;
-    } else if (memwrite) {
-        cycle_stats.memory_cycles += (mem_data->type() == MemoryAccess::MemoryType::DRAM) ? mem_data->get_access_write() - 1 : 0;
-    }
+    if (pipe_trace != nullptr && dt.trace_id != 0)
+        pipe_trace->stage(dt.trace_id, PipeTrace::STAGE_MEMORY, cycles);
+
+    bool dram_read = memread;
+    bool dram_write = memwrite;
+    bool accessed = excause == EXCAUSE_NONE;
 
     if (excause == EXCAUSE_NONE) {
+        mem_data->set_access_pc(dt.inst_addr);
+        if (mem_data->type() == MemoryAccess::MemoryType::DRAM)
+            mem_data->set_update_stats(true);
         if (dt.memctl > AC_LAST_REGULAR) {
             excause = memory_special(dt.memctl, dt.inst.rt(), memread, memwrite,
                                      towrite_val, dt.val_rt, mem_addr);
@@ -583,6 +902,12 @@ struct Core::dtMemory Core::memory(const struct dtExecute &dt) {
         }
     }
 
+    // We read from memory, if we directly hit DRAM we should update cycles accordingly.
+    if (dram_read)
+        cycle_stats.memory_cycles += dram_access_cycles(mem_data, false, accessed);
+    else if (dram_write)
+        cycle_stats.memory_cycles += dram_access_cycles(mem_data, true, accessed);
+
     if (dt.excause != EXCAUSE_NONE) {
         memread = false;
         memwrite = false;
@@ -613,6 +938,7 @@ struct Core::dtMemory Core::memory(const struct dtExecute &dt) {
             .in_delay_slot = dt.in_delay_slot,
             .stop_if = dt.stop_if,
             .is_valid = dt.is_valid,
+            .trace_id = dt.trace_id,
     };
 }
 
@@ -625,6 +951,15 @@ void Core::writeback(const struct dtMemory &dt) {
     emit writeback_regw_num_value(dt.rwrite);
     if (dt.regwrite)
         regs->write_gp(dt.rwrite, dt.towrite_val);
+    if (dt.is_valid) {
+        ++cycle_stats.instructions;
+        if (bbv != nullptr)
+            bbv->retire(dt.inst_addr, dt.inst);
+        if (idle_skip)
+            idle_retire(dt.inst_addr, dt.inst, dt.excause, dt.mem_addr);
+    }
+    if (pipe_trace != nullptr && dt.trace_id != 0)
+        pipe_trace->retire(dt.trace_id, cycles);
 }
 
 template<typename Dt>
@@ -719,6 +1054,7 @@ void Core::dtFetchInit(struct dtFetch &dt, bool stall) {
     dt.in_delay_slot = false;
     dt.is_valid = false;
     dt.predicted = false;
+    dt.trace_id = 0;
 }
 
 void Core::dtDecodeInit(struct dtDecode &dt, bool stall) {
@@ -737,6 +1073,8 @@ void Core::dtDecodeInit(struct dtDecode &dt, bool stall) {
     dt.bj_not = false;
     dt.bgt_blez = false;
     dt.nb_skip_ds = false;
+    dt.read_hilo = false;
+    dt.write_hilo = false;
     dt.forward_m_d_rs = false;
     dt.forward_m_d_rt = false;
     dt.aluop = ALU_OP_SLL;
@@ -756,6 +1094,7 @@ void Core::dtDecodeInit(struct dtDecode &dt, bool stall) {
     dt.stall = false;
     dt.stop_if = false;
     dt.is_valid = false;
+    dt.trace_id = 0;
 }
 
 void Core::dtExecuteInit(struct dtExecute &dt, bool stall) {
@@ -771,6 +1110,7 @@ void Core::dtExecuteInit(struct dtExecute &dt, bool stall) {
     dt.in_delay_slot = false;
     dt.stop_if = false;
     dt.is_valid = false;
+    dt.trace_id = 0;
 }
 
 void Core::dtMemoryInit(struct dtMemory &dt, bool stall) {
@@ -784,11 +1124,14 @@ void Core::dtMemoryInit(struct dtMemory &dt, bool stall) {
     dt.in_delay_slot = false;
     dt.stop_if = false;
     dt.is_valid = false;
+    dt.trace_id = 0;
 }
 
 CoreSingle::CoreSingle(Registers *regs, MemoryAccess *mem_program, MemoryAccess *mem_data,
                        bool jmp_delay_slot, const QString& trace_dir_path, unsigned int min_cache_row_size, Cop0State *cop0state) :
         Core(regs, mem_program, mem_data, nullptr, trace_dir_path, min_cache_row_size, cop0state), delay_slot(jmp_delay_slot) {
+    warm_bp = nullptr;
+    hle = nullptr;
     if (jmp_delay_slot)
         dt_f = new struct Core::dtFetch();
     else
@@ -804,6 +1147,9 @@ CoreSingle::~CoreSingle() {
 void CoreSingle::do_step(bool skip_break) {
     bool branch_taken = false;
 
+    if (hle != nullptr && hle_call())
+        return;
+
     struct dtFetch f = fetch(skip_break);
     if (dt_f != nullptr) {
         struct dtFetch f_swap = *dt_f;
@@ -823,6 +1169,8 @@ void CoreSingle::do_step(bool skip_break) {
         emit fetch_inst_addr_value(STAGEADDR_NONE);
     } else {
         branch_taken = handle_pc<dtDecode>(d);
+        if (warm_bp != nullptr && (d.branch || d.jump) && m.excause == EXCAUSE_NONE)
+            warm_predictor(d, branch_taken);
         if (dt_f != nullptr) {
             dt_f->in_delay_slot = branch_taken;
             if (d.nb_skip_ds && !branch_taken) {
@@ -856,6 +1204,257 @@ BranchPredictor *CoreSingle::predictor() {
     return nullptr;
 }
 
+Core::ResumePoint CoreSingle::drain() {
+    ResumePoint rp;
+
+    // Only instruction fetched ahead for delay slot can be in flight
+    if (dt_f != nullptr && dt_f->is_valid) {
+        rp.pc = dt_f->inst_addr;
+        rp.next_pc = regs->read_pc();
+        rp.in_delay_slot = dt_f->in_delay_slot;
+    } else {
+        rp.pc = regs->read_pc();
+        rp.next_pc = rp.pc + 4;
+        rp.in_delay_slot = false;
+    }
+    if (dt_f != nullptr)
+        dtFetchInit(*dt_f);
+    regs->pc_abs_jmp(rp.pc);
+    return rp;
+}
+
+void CoreSingle::resume(const ResumePoint &rp) {
+    regs->pc_abs_jmp(rp.pc);
+    prev_inst_addr = rp.pc - 4;
+    if (dt_f != nullptr) {
+        *dt_f = fetch(true, false);
+        dt_f->in_delay_slot = rp.in_delay_slot;
+        regs->pc_abs_jmp(rp.in_delay_slot ? rp.next_pc : rp.pc + 4);
+    }
+}
+
+bool CoreSingle::next_instruction(Instruction &inst, std::uint32_t &inst_addr) const {
+    if (dt_f != nullptr) {
+        inst = dt_f->inst;
+        inst_addr = dt_f->inst_addr;
+        return dt_f->is_valid && dt_f->excause == EXCAUSE_NONE;
+    }
+    inst_addr = regs->read_pc();
+    inst = Instruction(mem_program->read_word(inst_addr, true));
+    return true;
+}
+
+void CoreSingle::set_warm_predictor(BranchPredictor *bp) {
+    warm_bp = bp;
+}
+
+void CoreSingle::set_hle_library(HleLibrary *hle) {
+    this->hle = hle;
+}
+
+bool CoreSingle::hle_call() {
+    std::uint32_t entry;
+
+    if (dt_f != nullptr) {
+        // Instruction fetched ahead is the one executed in this step
+        if (!dt_f->is_valid || dt_f->in_delay_slot || dt_f->excause != EXCAUSE_NONE)
+            return false;
+        entry = dt_f->inst_addr;
+    } else {
+        entry = regs->read_pc();
+    }
+    if (!hle->is_entry(entry) || is_hwbreak(entry))
+        return false;
+
+    std::uint64_t cost = hle->call(entry, regs, mem_data);
+    if (dt_f != nullptr)
+        dtFetchInit(*dt_f);
+    prev_inst_addr = entry;
+    // One cycle is already counted by the step, one instruction per cycle is assumed
+    charge_cycles(cost > 0 ? cost - 1 : 0, cost);
+    return true;
+}
+
+void CoreSingle::warm_predictor(const struct dtDecode &d, bool branch_taken) {
+    bool accessed_btb;
+    // Same sequence as pipeline does for each branch, the prediction itself is not used
+    warm_bp->predict(d.inst, d.inst_addr, accessed_btb);
+    warm_bp->update_bht(branch_taken, d.branch, branch_taken ? regs->read_pc() : d.inst_addr + 4);
+}
+
+CoreDualTiming::CoreDualTiming(Registers *regs, MemoryAccess *mem_program, MemoryAccess *mem_data, bool jmp_delay_slot,
+                               const QString& trace_dir_path, std::uint32_t min_cache_row_size, Cop0State *cop0state) :
+        CoreSingle(regs, mem_program, mem_data, jmp_delay_slot, trace_dir_path, min_cache_row_size, cop0state) {
+    clear_scoreboard();
+}
+
+void CoreDualTiming::do_step(bool skip_break) {
+    Instruction first, second;
+    std::uint32_t first_addr, second_addr;
+    enum InstructionFlags first_flags = (enum InstructionFlags)0;
+    enum InstructionFlags flags;
+    enum AluOp alu_op;
+    enum AccessControl mem_ctl;
+
+    if (mem_program_bubbles || mem_data_bubbles) {
+        memory_bubbles(1);
+        return;
+    }
+    if (fetch_bubble) {
+        fetch_bubble = false;
+        ++cycle_stats.control_hazard_stalls;
+        return;
+    }
+
+    bool regular = next_instruction(first, first_addr);
+    if (regular) {
+        first.flags_alu_op_mem_ctl(first_flags, alu_op, mem_ctl);
+        if (operands_ready(first, first_flags) > get_cycles()) {
+            ++cycle_stats.data_hazard_stalls;
+            return;
+        }
+    }
+    issue(skip_break, first, first_flags);
+    if (!regular || !next_instruction(second, second_addr))
+        return;
+
+    // Fall through instruction fetched with taken branch is discarded
+    if ((first_flags & (IMF_BRANCH | IMF_JUMP)) && second_addr != first_addr + 4) {
+        fetch_bubble = true;
+        return;
+    }
+    if (!pairable(first_flags, first_addr, second, second_addr))
+        return;
+    second.flags_alu_op_mem_ctl(flags, alu_op, mem_ctl);
+    issue(false, second, flags);
+    ++cycle_stats.paired_issues;
+}
+
+void CoreDualTiming::do_reset() {
+    CoreSingle::do_reset();
+    clear_scoreboard();
+}
+
+std::uint32_t CoreDualTiming::do_skip_stall(std::uint32_t max_cycles) {
+    std::uint32_t count = std::min(mem_program_bubbles + mem_data_bubbles, max_cycles);
+    if (count != 0)
+        memory_bubbles(count);
+    return count;
+}
+
+Core::ResumePoint CoreDualTiming::drain() {
+    // Issued instructions are complete, only their timing is dropped
+    clear_scoreboard();
+    return CoreSingle::drain();
+}
+
+void CoreDualTiming::resume(const ResumePoint &rp) {
+    CoreSingle::resume(rp);
+    clear_scoreboard();
+}
+
+// Branches compare operands in decode stage, they need results one cycle earlier
+std::uint64_t CoreDualTiming::operands_ready(const Instruction &inst, enum InstructionFlags flags) const {
+    std::uint64_t ready = 0;
+
+    if (flags & IMF_ALU_REQ_RS)
+        ready = std::max(ready, reg_ready[inst.rs()]);
+    if (flags & IMF_ALU_REQ_RT)
+        ready = std::max(ready, reg_ready[inst.rt()]);
+    if (flags & IMF_BJR_REQ_RS)
+        ready = std::max(ready, reg_ready[inst.rs()] + 1);
+    if (flags & IMF_BJR_REQ_RT)
+        ready = std::max(ready, reg_ready[inst.rt()] + 1);
+    if (flags & IMF_READ_HILO)
+        ready = std::max(ready, reg_ready[HILO_REG]);
+    return ready;
+}
+
+bool CoreDualTiming::pairable(enum InstructionFlags first_flags, std::uint32_t first_addr,
+                              const Instruction &inst, std::uint32_t inst_addr) {
+    const unsigned control = IMF_BRANCH | IMF_JUMP;
+    const unsigned hilo = IMF_READ_HILO | IMF_WRITE_HILO;
+    enum InstructionFlags flags;
+    enum AluOp alu_op;
+    enum AccessControl mem_ctl;
+
+    // Run has to see every address where it can stop
+    if (inst_addr != first_addr + 4 || is_hwbreak(inst_addr) ||
+            is_run_stop(regs->read_pc()) || stop_on_exception_pending())
+        return false;
+    if (first_flags & (IMF_STOP_IF | IMF_EXCEPTION))
+        return false;
+    inst.flags_alu_op_mem_ctl(flags, alu_op, mem_ctl);
+    if (!(flags & IMF_SUPPORTED) || (flags & (IMF_STOP_IF | IMF_EXCEPTION)))
+        return false;
+    if (((first_flags & IMF_MEM) && (flags & IMF_MEM)) ||
+            ((first_flags & control) && (flags & control)) ||
+            ((first_flags & hilo) && (flags & hilo)))
+        return false;
+    // Result of the first instruction is not forwarded within the pair
+    return operands_ready(inst, flags) <= get_cycles();
+}
+
+void CoreDualTiming::issue(bool skip_break, const Instruction &inst, enum InstructionFlags flags) {
+    std::uint64_t prev_mem_cycles = cycle_stats.memory_cycles;
+    std::uint64_t prev_fetch_cycles = fetch_memory_cycles;
+    std::uint64_t now = get_cycles();
+
+    CoreSingle::do_step(skip_break);
+    mem_program_bubbles += fetch_memory_cycles - prev_fetch_cycles;
+    mem_data_bubbles += (cycle_stats.memory_cycles - prev_mem_cycles) - (fetch_memory_cycles - prev_fetch_cycles);
+
+    if (flags & IMF_REGWRITE) {
+        std::uint8_t rwrite = (flags & IMF_PC_TO_R31) ? 31 : (flags & IMF_REGD) ? inst.rd() : inst.rt();
+        if (rwrite != 0)
+            reg_ready[rwrite] = now + ((flags & IMF_MEMREAD) ? 2 : 1);
+    }
+    if (flags & IMF_WRITE_HILO)
+        reg_ready[HILO_REG] = now + 1;
+}
+
+// Moves pending stall cycles of one memory level to its total, at most
+// remaining of them which is reduced accordingly
+static void drain_stall(std::uint64_t &pending, std::uint64_t &total, std::uint64_t &remaining) {
+    std::uint64_t n = std::min(pending, remaining);
+    pending -= n;
+    total += n;
+    remaining -= n;
+}
+
+static void drain_lower_stalls(std::uint64_t &remaining) {
+    drain_stall(cycle_stats.l2_unified_stall_cycles, cycle_stats.l2_unified_stall_cycles_total, remaining);
+    for (int i = 0; i < CycleStatistics::LOWER_CACHE_LEVELS; i++)
+        drain_stall(cycle_stats.lower_cache_stall_cycles[i], cycle_stats.lower_cache_stall_cycles_total[i],
+                    remaining);
+}
+
+// Fetch waits before data access of the issued instructions. Levels of each
+// stream are drained one after other so each cycle is accounted once, cycles
+// which are not accounted to any cache are spent in RAM by that stream
+void CoreDualTiming::memory_bubbles(std::uint32_t count) {
+    std::uint64_t program = std::min(mem_program_bubbles, count);
+    std::uint64_t data = count - program;
+
+    mem_program_bubbles -= program;
+    mem_data_bubbles -= data;
+    drain_stall(cycle_stats.l1_program_stall_cycles, cycle_stats.l1_program_stall_cycles_total, program);
+    drain_lower_stalls(program);
+    cycle_stats.ram_program_stall_cycles_total += program;
+    drain_stall(cycle_stats.l1_data_stall_cycles, cycle_stats.l1_data_stall_cycles_total, data);
+    drain_lower_stalls(data);
+    drain_stall(cycle_stats.write_buffer_stall_cycles, cycle_stats.write_buffer_stall_cycles_total, data);
+    cycle_stats.ram_data_stall_cycles_total += data;
+}
+
+void CoreDualTiming::clear_scoreboard() {
+    for (int i = 0; i <= HILO_REG; i++)
+        reg_ready[i] = 0;
+    mem_program_bubbles = 0;
+    mem_data_bubbles = 0;
+    fetch_bubble = false;
+}
+
 CorePipelined::CorePipelined(Registers *regs, MemoryAccess *mem_program, MemoryAccess *mem_data,
                              MemoryAccess *mem_program1,
                              bool data_cache_enabled, bool program_cache_enabled,
@@ -872,6 +1471,11 @@ CorePipelined::CorePipelined(Registers *regs, MemoryAccess *mem_program, MemoryA
     this->dhunit = dhunit;
     this->chunit = chunit;
     this->branch_res_id = branch_res_id;
+    this->mdu_enabled = false;
+    this->mdu_mul_latency = 1;
+    this->mdu_mul_interval = 1;
+    this->mdu_div_latency = 1;
+    this->mdu_div_interval = 1;
     switch (this->chunit) {
         case MachineConfig::CHU_STALL:
         case MachineConfig::CHU_DELAY_SLOT:
@@ -883,6 +1487,15 @@ CorePipelined::CorePipelined(Registers *regs, MemoryAccess *mem_program, MemoryA
         case MachineConfig::CHU_TWO_BIT_BP:
             this->bp = new TwoBitBranchPredictor(bp_bits);
             break;
+        case MachineConfig::CHU_GSHARE_BP:
+            this->bp = new GShareBranchPredictor(bp_bits);
+            break;
+        case MachineConfig::CHU_TOURNAMENT_BP:
+            this->bp = new TournamentBranchPredictor(bp_bits);
+            break;
+        case MachineConfig::CHU_TAGE_BP:
+            this->bp = new TageBranchPredictor(bp_bits);
+            break;
         default:
             // This is a bug.
             SANITY_ASSERT(0, "Branch unit has an unknown value in a pipelined mode");
@@ -893,6 +1506,8 @@ CorePipelined::CorePipelined(Registers *regs, MemoryAccess *mem_program, MemoryA
 }
 
 void CorePipelined::flush_stages(bool is_branch) {
+    std::uint32_t penalty = flush_penalty(is_branch);
+
     if (!branch_res_id && dt_d.branch) {
         // If the instruction is a branch, we need to remove from the queue.
         machine::BranchPredictor::InstAddr inst_addr(dt_d.inst_addr);
@@ -900,17 +1515,21 @@ void CorePipelined::flush_stages(bool is_branch) {
         remove_pc(dt_d.inst_addr);
     }
 
-    if (!mem_program_bubbles) {
+    if (!mem_program_bubbles)
         dtFetchInit(dt_f, true);
-        bp_stalls++;
-    }
-    if (!branch_res_id && is_branch) {
+    if (!branch_res_id && is_branch)
         // We evaluate branches on EX stage, flush ID too if the instruction was a branch.
         dtDecodeInit(dt_d, true);
-        if (!mem_program_bubbles) {
-            bp_stalls++;
-        }
-    }
+    bp_stalls += penalty;
+    bp->add_flush_cycles(penalty);
+    // Calls and returns of flushed instructions were already predicted at fetch
+    bp->restore_ras(is_branch);
+}
+
+std::uint32_t CorePipelined::flush_penalty(bool is_branch) const {
+    if (mem_program_bubbles)
+        return 0;
+    return (!branch_res_id && is_branch) ? 2 : 1;
 }
 
 uint32_t CorePipelined::get_correct_address(uint32_t pc, bool taken, bool jmp) {
@@ -924,11 +1543,92 @@ uint32_t CorePipelined::get_correct_address(uint32_t pc, bool taken, bool jmp) {
             return taken ? branch_target(dt_e.inst, dt_e.inst_addr) : (pc + 4);
 }
 
+void CorePipelined::set_pipe_trace(PipeTrace *trace) {
+    pipe_trace = trace;
+    // Sequence numbers of previous trace are not valid in the new one
+    dt_f.trace_id = 0;
+    dt_d.trace_id = 0;
+    dt_e.trace_id = 0;
+    dt_m.trace_id = 0;
+    cache_mem_instr.trace_id = 0;
+}
+
+void CorePipelined::set_mdu_timing(bool enabled, std::uint32_t mul_latency, std::uint32_t mul_interval,
+                                   std::uint32_t div_latency, std::uint32_t div_interval) {
+    if (enabled && (mul_latency == 0 || mul_interval == 0 || div_latency == 0 || div_interval == 0))
+        throw QTMIPS_EXCEPTION(Input, "Multiply/divide unit latency and interval have to be at least one cycle",
+                               QString("mul %1/%2, div %3/%4").arg(mul_latency).arg(mul_interval)
+                               .arg(div_latency).arg(div_interval));
+    mdu_enabled = enabled;
+    mdu_mul_latency = mul_latency;
+    mdu_mul_interval = mul_interval;
+    mdu_div_latency = div_latency;
+    mdu_div_interval = div_interval;
+    mdu_ready = 0;
+    mdu_free = 0;
+}
+
+// Operations computed by multiply/divide unit, they all write HI/LO
+static bool mdu_operation(enum AluOp op, bool &divide) {
+    switch (op) {
+        case ALU_OP_DIV:
+        case ALU_OP_DIVU:
+            divide = true;
+            return true;
+        case ALU_OP_MULT:
+        case ALU_OP_MULTU:
+        case ALU_OP_MADD:
+        case ALU_OP_MADDU:
+        case ALU_OP_MSUB:
+        case ALU_OP_MSUBU:
+            divide = false;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Instruction in decode stage executes in the next cycle. Accumulating
+// operations read HI/LO inside the unit so they only wait until it accepts them.
+bool CorePipelined::mdu_hazard(const struct dtDecode &dt) const {
+    std::uint64_t start = get_cycles() + 1;
+    bool divide;
+
+    if (!mdu_enabled || !dt.is_valid || dt.excause != EXCAUSE_NONE)
+        return false;
+    if (mdu_operation(dt.aluop, divide))
+        return start < mdu_free;
+    return (dt.read_hilo || dt.write_hilo) && start < mdu_ready;
+}
+
+void CorePipelined::mdu_issue(const struct dtDecode &dt) {
+    bool divide;
+
+    if (!mdu_enabled || !dt.is_valid || dt.excause != EXCAUSE_NONE || !mdu_operation(dt.aluop, divide))
+        return;
+    // Results of overlapping operations are written in order
+    mdu_ready = std::max(mdu_ready, get_cycles() + (divide ? mdu_div_latency : mdu_mul_latency));
+    mdu_free = get_cycles() + (divide ? mdu_div_interval : mdu_mul_interval);
+}
+
 void CorePipelined::do_step(bool skip_break) {
-    static bool check_branch_stall = true;
-    static bool data_branch_hazard_ex = false;
-    static bool resolved_branch_mem_prog_bubbles = false;
-    static dtMemory cache_mem_instr;
+    step_stages(skip_break);
+    if (pipe_trace != nullptr)
+        trace_cycle();
+}
+
+void CorePipelined::trace_cycle() {
+    if (dt_f.is_valid && dt_f.trace_id == 0)
+        dt_f.trace_id = pipe_trace->fetch(cycles, dt_f.inst_addr, dt_f.inst);
+    // Instruction waiting for data memory is replaced by bubble in dt_m
+    const std::uint64_t ids[] = {
+            dt_f.trace_id, dt_d.trace_id, dt_e.trace_id,
+            mem_data_bubbles ? cache_mem_instr.trace_id : dt_m.trace_id
+    };
+    pipe_trace->end_cycle(ids, sizeof(ids) / sizeof(ids[0]));
+}
+
+void CorePipelined::step_stages(bool skip_break) {
     bool data_branch_hazard_id = false;
     bool stall = false;
     bool data_hazard = false;
@@ -938,32 +1638,20 @@ void CorePipelined::do_step(bool skip_break) {
     uint32_t prev_mem_cycles;
 
     if (inc_data_hazards && !mem_data_bubbles) {
-        ++cycle_stats.data_hazard_stalls;
+        if (inc_mdu_stalls)
+            ++cycle_stats.mdu_stalls;
+        else
+            ++cycle_stats.data_hazard_stalls;
     }
 
     if (bp_stalls) {
         cycle_stats.control_hazard_stalls += bp_stalls;
+        cycle_stats.branch_flush_stalls += bp_stalls;
         bp_stalls = 0;
     }
 
     if (mem_data_bubbles) {
-        dtMemoryInit(dt_m, true);
-        writeback(dt_m);
-        --mem_data_bubbles;
-        if (!data_cache_enabled)
-            // If we have caches enabled we count these stalls as cache stalls.
-            ++cycle_stats.ram_data_stall_cycles_total;
-        if (!mem_data_bubbles) {
-            dt_m = cache_mem_instr;
-        }
-        if (cycle_stats.l1_data_stall_cycles) {
-            ++cycle_stats.l1_data_stall_cycles_total;
-            --cycle_stats.l1_data_stall_cycles;
-        }
-        if (cycle_stats.l2_unified_stall_cycles) {
-            ++cycle_stats.l2_unified_stall_cycles_total;
-            --cycle_stats.l2_unified_stall_cycles;
-        }
+        data_bubbles(1);
         return;
     }
 
@@ -984,6 +1672,7 @@ void CorePipelined::do_step(bool skip_break) {
             ++cycle_stats.l2_unified_stall_cycles_total;
             --cycle_stats.l2_unified_stall_cycles;
         }
+        cycle_stats.drain_lower_cache_stalls(1);
     }
 
     if (data_branch_hazard_ex) {
@@ -1012,6 +1701,7 @@ void CorePipelined::do_step(bool skip_break) {
             cache_mem_instr = dt_m;
         }
         dt_e = execute(dt_d);
+        mdu_issue(dt_d);
         dt_d = decode(dt_f, chunit == MachineConfig::CHU_DELAY_SLOT);
     }
 
@@ -1182,6 +1872,9 @@ void CorePipelined::do_step(bool skip_break) {
         check_branch_stall = false;
     }
 
+    // Multiply/divide unit interlocks regardless of the hazard unit
+    inc_mdu_stalls = !data_hazard && !data_branch_hazard_ex && mdu_hazard(dt_d);
+    data_hazard = data_hazard || inc_mdu_stalls;
     inc_data_hazards = data_hazard || data_branch_hazard_ex;
 
     if (dt_e.stop_if || dt_m.stop_if || data_hazard)
@@ -1238,6 +1931,9 @@ void CorePipelined::do_step(bool skip_break) {
                     break;
                 case MachineConfig::CHU_ONE_BIT_BP:
                 case MachineConfig::CHU_TWO_BIT_BP:
+                case MachineConfig::CHU_GSHARE_BP:
+                case MachineConfig::CHU_TOURNAMENT_BP:
+                case MachineConfig::CHU_TAGE_BP:
                     handle_fetch_bp();
                     if (mem_program_bubbles) {
                         resolved_branch_mem_prog_bubbles = true;
@@ -1301,7 +1997,52 @@ void CorePipelined::do_step(bool skip_break) {
     }
 }
 
+std::uint32_t CorePipelined::do_skip_stall(std::uint32_t max_cycles) {
+    // Only data memory bubbles stall whole pipeline, other stages keep
+    // working while fetch waits for program memory.
+    std::uint32_t count = std::min(mem_data_bubbles, max_cycles);
+    if (count == 0)
+        return 0;
+    if (bp_stalls) {
+        cycle_stats.control_hazard_stalls += bp_stalls;
+        cycle_stats.branch_flush_stalls += bp_stalls;
+        bp_stalls = 0;
+    }
+    data_bubbles(count);
+    return count;
+}
+
+void CorePipelined::data_bubbles(std::uint32_t count) {
+    std::uint64_t pending;
+
+    dtMemoryInit(dt_m, true);
+    writeback(dt_m);
+    mem_data_bubbles -= count;
+    if (!data_cache_enabled)
+        // If we have caches enabled we count these stalls as cache stalls.
+        cycle_stats.ram_data_stall_cycles_total += count;
+    if (!mem_data_bubbles) {
+        dt_m = cache_mem_instr;
+    }
+    pending = std::min<std::uint64_t>(cycle_stats.l1_data_stall_cycles, count);
+    cycle_stats.l1_data_stall_cycles_total += pending;
+    cycle_stats.l1_data_stall_cycles -= pending;
+    pending = std::min<std::uint64_t>(cycle_stats.l2_unified_stall_cycles, count);
+    cycle_stats.l2_unified_stall_cycles_total += pending;
+    cycle_stats.l2_unified_stall_cycles -= pending;
+    cycle_stats.drain_lower_cache_stalls(count);
+    pending = std::min<std::uint64_t>(cycle_stats.write_buffer_stall_cycles, count);
+    cycle_stats.write_buffer_stall_cycles_total += pending;
+    cycle_stats.write_buffer_stall_cycles -= pending;
+}
+
 void CorePipelined::do_reset() {
+    clear_pipeline();
+    if (bp)
+        bp->reset();
+}
+
+void CorePipelined::clear_pipeline() {
     dtFetchInit(dt_f);
     dt_f.inst_addr = 0;
     dtDecodeInit(dt_d);
@@ -1310,15 +2051,86 @@ void CorePipelined::do_reset() {
     dt_e.inst_addr = 0;
     dtMemoryInit(dt_m);
     dt_m.inst_addr = 0;
+    dtMemoryInit(cache_mem_instr);
+    cache_mem_instr.inst_addr = 0;
     this->mem_program_bubbles = 0;
     this->mem_data_bubbles = 0;
     this->control_hazard = false;
     this->inc_data_hazards = false;
+    this->inc_mdu_stalls = false;
+    this->mdu_ready = 0;
+    this->mdu_free = 0;
+    this->check_branch_stall = true;
+    this->data_branch_hazard_ex = false;
+    this->resolved_branch_mem_prog_bubbles = false;
     this->bp_stalls = 0;
     this->pc_before_jmp = 0;
     this->fetched_instr = 0;
+    this->pcs.clear();
     if (bp)
-        bp->reset();
+        bp->clear_queue();
+}
+
+Core::ResumePoint CorePipelined::drain() {
+    ResumePoint rp;
+    uint32_t jump_branch_pc = dt_m.inst_addr;
+    // Branch in execute waiting for loaded value is not resolved yet, it is run again
+    bool finish_e = dt_e.is_valid && !data_branch_hazard_ex;
+
+    if (mem_data_bubbles)
+        dt_m = cache_mem_instr;
+    writeback(dt_m);
+
+    // Oldest instruction which has not been executed yet
+    if (!finish_e && dt_e.is_valid) {
+        rp.pc = dt_e.inst_addr;
+        rp.next_pc = dt_d.is_valid ? dt_d.inst_addr : regs->read_pc();
+        rp.in_delay_slot = dt_e.in_delay_slot;
+    } else if (dt_d.is_valid) {
+        rp.pc = dt_d.inst_addr;
+        rp.next_pc = (dt_f.is_valid && !dt_f.in_delay_slot) ? dt_f.inst_addr : regs->read_pc();
+        rp.in_delay_slot = dt_d.in_delay_slot;
+    } else if (dt_f.is_valid) {
+        rp.pc = dt_f.inst_addr;
+        rp.next_pc = regs->read_pc();
+        rp.in_delay_slot = dt_f.in_delay_slot;
+    } else {
+        rp.pc = regs->read_pc();
+        rp.next_pc = rp.pc + 4;
+        rp.in_delay_slot = false;
+    }
+
+    if (finish_e) {
+        // Execute stage could already write HI/LO or Cop0 so instruction has to be completed
+        struct dtMemory m = memory(dt_e);
+        if (m.excause != EXCAUSE_NONE) {
+            regs->pc_abs_jmp(m.inst_addr + 4);
+            handle_exception(this, regs, m.excause, m.inst_addr, m.inst_addr + 4,
+                             jump_branch_pc, m.in_delay_slot, m.mem_addr);
+            rp.pc = regs->read_pc();
+            rp.next_pc = rp.pc + 4;
+            rp.in_delay_slot = false;
+        }
+        writeback(m);
+    }
+
+    cycle_stats.control_hazard_stalls += bp_stalls;
+    cycle_stats.branch_flush_stalls += bp_stalls;
+    clear_pipeline();
+    regs->pc_abs_jmp(rp.pc);
+    return rp;
+}
+
+void CorePipelined::resume(const ResumePoint &rp) {
+    regs->pc_abs_jmp(rp.pc);
+    if (rp.in_delay_slot) {
+        // Branch is already resolved, start with its delay slot in fetch stage
+        dt_f = fetch(true, false);
+        dt_f.in_delay_slot = true;
+        dt_f.predicted = true;
+        fetched_instr = dt_f.inst;
+        regs->pc_abs_jmp(rp.next_pc);
+    }
 }
 
 BranchPredictor *CorePipelined::predictor() {
@@ -1402,6 +2214,8 @@ void CorePipelined::handle_fetch_bp() {
             flush_stages(true);
             regs->pc_abs_jmp(correct_address);
             mispredict = true;
+        } else {
+            bp->add_saved_cycles(true, flush_penalty(true));
         }
         bp->update_bht(taken, true, correct_address);
 
@@ -1417,6 +2231,8 @@ void CorePipelined::handle_fetch_bp() {
             flush_stages(false);
             regs->pc_abs_jmp(correct_address);
             mispredict = true;
+        } else {
+            bp->add_saved_cycles(false, flush_penalty(false));
         }
         bp->update_bht(true, false, correct_address);
 
@@ -44,11 +44,14 @@
 #include <machineconfig.h>
 #include <registers.h>
 #include <cop0state.h>
+#include <eventscheduler.h>
 #include <memory.h>
 #include <instruction.h>
 #include <alu.h>
 #include <cyclestatistics.h>
 #include <QQueue>
+#include <cstdint>
+#include <atomic>
 
 namespace machine {
 
@@ -56,6 +59,9 @@ class Core;
 class BranchPredictor;
 class OneBitBranchPredictor;
 class TwoBitBranchPredictor;
+class BbvProfiler;
+class HleLibrary;
+class PipeTrace;
 
 class ExceptionHandler : public QObject {
     Q_OBJECT
@@ -84,15 +90,40 @@ public:
     ~Core();
 
     void step(bool skip_break = false); // Do single step
+    // Advance over at most max_cycles cycles in which the whole core only waits
+    // for memory. Returns number of skipped cycles, state is the same as after
+    // that many steps (only per cycle signals are not repeated).
+    std::uint32_t skip_stall(std::uint32_t max_cycles = UINT32_MAX);
+
+    enum StopReason : unsigned {
+        STOP_NONE        = 0,
+        STOP_BREAK       = 1u << 0, // Break instruction or hardware breakpoint with stop enabled
+        STOP_EXCEPTION   = 1u << 1, // Other exception with stop enabled or stop requested by handler
+        STOP_PROGRAM_END = 1u << 2, // PC reached program end address
+        STOP_ADDRESS     = 1u << 3, // PC reached stop address
+        STOP_CYCLES      = 1u << 4, // Cycle budget is exhausted (always enabled)
+        STOP_EXTERNAL    = 1u << 5, // External stop flag is set
+        STOP_TIME        = 1u << 6, // Host time limit elapsed
+        STOP_ALL         = 0x7f,
+    };
+    // Run until condition selected by stop_mask is met or max_cycles pass.
+    // External flag and host time are checked only once per check interval.
+    StopReason run(std::uint64_t max_cycles, unsigned stop_mask = STOP_ALL, bool skip_break = false);
+    void set_program_end(std::uint32_t address);
+    void set_stop_address(std::uint32_t address);
+    void set_stop_flag(const std::atomic<bool> *flag); // nullptr to disable
+    void set_run_time_limit(int msec); // Negative to disable
+    void set_run_check_interval(std::uint32_t cycles);
+
     void reset(); // Reset core (only core, memory and registers has to be reseted separately)
 
     virtual BranchPredictor *predictor() = 0;
 
-    uint32_t get_cycles() const;
-    uint32_t get_stalls() const;
+    std::uint64_t get_cycles() const;
+    std::uint64_t get_stalls() const;
 
-    void set_cycles(uint32_t);
-    void set_stalls(uint32_t);
+    void set_cycles(std::uint64_t);
+    void set_stalls(std::uint64_t);
 
     Registers *get_regs() const;
     Cop0State *get_cop0state() const;
@@ -109,6 +140,33 @@ public:
 
     void set_c0_userlocal(std::uint32_t address);
 
+    // Request stop of the machine after current step (break, exit syscall)
+    void request_stop_on_exception();
+    // True when last step requested stop on exception. Used when signals are blocked.
+    bool stop_on_exception_pending() const;
+
+    // Point in instruction stream where execution continues after drain
+    struct ResumePoint {
+        std::uint32_t pc; // Next instruction to execute
+        std::uint32_t next_pc; // Instruction executed after it
+        bool in_delay_slot; // Instruction at pc is in delay slot of taken branch to next_pc
+    };
+    // Complete instructions which already changed machine state, discard younger
+    // ones and return where execution continues. Core can be resumed afterwards.
+    virtual ResumePoint drain() = 0;
+    // Continue execution from point returned by drain of this or other core
+    virtual void resume(const ResumePoint &rp) = 0;
+    // Take exception handlers, breakpoints and cycle counters over from other core
+    void take_over(Core *other);
+
+    // Every instruction reaching writeback is reported to profiler (can be nullptr)
+    void set_bbv_profiler(BbvProfiler *profiler);
+    // Interrupts are checked only when event is due. Without scheduler on every fetch.
+    void set_event_scheduler(EventScheduler *scheduler);
+    // Let run skip repeated iterations of short loop which changes neither registers
+    // nor memory up to the next scheduled event. Requires event scheduler.
+    void set_idle_loop_skip(bool value);
+
     enum ForwardFrom {
         FORWARD_NONE   = 0b00,
         FORWARD_FROM_W = 0b01,
@@ -182,13 +240,18 @@ signals:
     void dhu_stall_value(std::uint32_t);
     void branch_forward_value(std::uint32_t);
 
-    void stall_value_changed(uint32_t);
+    void stall_value_changed(std::uint64_t);
 
     void stop_on_exception_reached();
 
 protected:
     virtual void do_step(bool skip_break = false) = 0;
     virtual void do_reset() = 0;
+    virtual std::uint32_t do_skip_stall(std::uint32_t max_cycles);
+    // Account work done outside of the pipeline (emulated library call)
+    void charge_cycles(std::uint64_t count, std::uint64_t instructions);
+    // Run stops when PC reaches address (program end or stop address)
+    bool is_run_stop(std::uint32_t address) const;
 
     bool handle_exception(Core *core, Registers *regs,
                      ExceptionCause excause, std::uint32_t inst_addr,
@@ -209,6 +272,7 @@ protected:
         bool in_delay_slot;
         bool is_valid;
         bool predicted;
+        std::uint64_t trace_id; // Sequence number in pipeline trace, zero when not traced
     };
     struct dtDecode {
         Instruction inst;
@@ -227,6 +291,8 @@ protected:
         bool bj_not;     // negate branch condition
         bool bgt_blez;   // BGTZ/BLEZ instead of BGEZ/BLTZ
         bool nb_skip_ds; // Skip delay slot if branch is not taken
+        bool read_hilo;  // reads HI or LO register
+        bool write_hilo; // writes HI and/or LO register
         bool forward_m_d_rs; // forwarding required for beq, bne, blez, bgtz, jr nad jalr
         bool forward_m_d_rt; // forwarding required for beq, bne
         AluOp aluop; // Decoded ALU operation
@@ -246,6 +312,7 @@ protected:
         bool stall;
         bool stop_if;
         bool is_valid;
+        std::uint64_t trace_id;
     };
     struct dtExecute {
         Instruction inst;
@@ -272,6 +339,7 @@ protected:
         bool in_delay_slot;
         bool stop_if;
         bool is_valid;
+        std::uint64_t trace_id;
     };
     struct dtMemory {
         Instruction inst;
@@ -285,6 +353,7 @@ protected:
         bool in_delay_slot;
         bool stop_if;
         bool is_valid;
+        std::uint64_t trace_id;
     };
 
     /* Pipeline. */
@@ -314,7 +383,8 @@ protected:
     static void dtMemoryInit(struct dtMemory &dt, bool stall = false);
 
 protected:
-    uint32_t stalls;
+    std::uint64_t stalls;
+    std::uint64_t fetch_memory_cycles; // Part of memory cycles spent by instruction fetch
 private:
     struct hwBreak{
         hwBreak(std::uint32_t addr);
@@ -322,15 +392,40 @@ private:
         std::uint32_t flags;
         std::uint32_t count;
     };
-    uint32_t cycles;
+    std::uint64_t cycles;
     uint32_t min_cache_row_size;
     uint32_t hwr_userlocal;
     QMap<std::uint32_t, hwBreak *> hw_breaks;
 protected:
     QFile trace_file;
+    PipeTrace *pipe_trace; // Stage timing is recorded when set
 private:
     bool stop_on_exception[EXCAUSE_COUNT];
     bool step_over_exception[EXCAUSE_COUNT];
+    bool stop_pending;
+    ExceptionCause stop_cause; // Exception which requested pending stop
+    BbvProfiler *bbv;
+    EventScheduler *events;
+    std::uint32_t program_end, stop_address;
+    const std::atomic<bool> *stop_flag;
+    int run_time_limit;
+    std::uint32_t run_check_interval;
+
+    void idle_retire(std::uint32_t inst_addr, const Instruction &inst, ExceptionCause excause,
+                     std::uint32_t mem_addr);
+    void idle_loop_head();
+    void idle_reset();
+    std::uint64_t skip_idle(std::uint64_t max_cycles);
+    bool idle_skip;
+    bool idle_valid; // Snapshot at loop head was taken
+    bool idle_dirty; // Iteration since snapshot had side effects
+    bool idle_ready; // Last two iterations were identical, state is at loop head
+    std::uint32_t idle_head, idle_last_addr;
+    std::uint64_t idle_head_cycle, idle_period;
+    std::uint32_t idle_regs[33]; // GP registers, HI and LO at loop head
+    std::uint32_t idle_count_regs; // GP registers loaded from Count in this iteration
+    std::uint32_t idle_count_mask; // The same for the last compared iteration
+    CycleStatistics idle_stats, idle_stats_prev; // At loop head of this and previous iteration
 };
 
 class CoreSingle : public Core {
@@ -339,15 +434,72 @@ public:
                const QString& trace_dir_path, std::uint32_t min_cache_row_size = 1, Cop0State *cop0state = nullptr);
     ~CoreSingle();
 
+    ResumePoint drain() override;
+    void resume(const ResumePoint &rp) override;
+    // Train predictor of other core by executed branches (nullptr to disable)
+    void set_warm_predictor(BranchPredictor *bp);
+    // Emulate calls of known library functions on host (nullptr to disable)
+    void set_hle_library(HleLibrary *hle);
+
 protected:
     void do_step(bool skip_break = false) override;
     void do_reset() override;
     BranchPredictor *predictor() override;
+    // Instruction executed by the next step, read without affecting caches.
+    // False when the step runs no regular instruction (bubble or fetch exception).
+    bool next_instruction(Instruction &inst, std::uint32_t &inst_addr) const;
 
 private:
+    void warm_predictor(const struct dtDecode &d, bool branch_taken);
+    bool hle_call();
+
     struct Core::dtFetch *dt_f;
     bool delay_slot;
     std::uint32_t prev_inst_addr;
+    BranchPredictor *warm_bp;
+    HleLibrary *hle;
+};
+
+// Dual issue timing model of the single cycle core. It is not a pipeline,
+// instructions are executed one after other by the single cycle core, up to
+// two of them in one cycle, so the architectural state is the same as of the
+// single cycle core. A scoreboard accounts the cycles a dual issue core with
+// branches resolved in decode stage would take. Results of both slots are
+// ready for both slots of the next cycle, loaded values and operands of
+// branches are ready one cycle later. Second instruction issues together with
+// the first one only when it follows it in memory, does not use its result,
+// the pair has at most one memory access (single data port), one branch or
+// jump and one HI/LO access, and the first one neither stops fetch nor raises
+// exception. Memory access latency stalls the core, fetch and data stalls are
+// accounted apart. There are no pipeline registers and no forwarding paths,
+// so the model cannot be combined with pipelined core.
+class CoreDualTiming : public CoreSingle {
+public:
+    CoreDualTiming(Registers *regs, MemoryAccess *mem_program, MemoryAccess *mem_data, bool jmp_delay_slot,
+                   const QString& trace_dir_path, std::uint32_t min_cache_row_size = 1, Cop0State *cop0state = nullptr);
+
+    ResumePoint drain() override;
+    void resume(const ResumePoint &rp) override;
+
+protected:
+    void do_step(bool skip_break = false) override;
+    void do_reset() override;
+    std::uint32_t do_skip_stall(std::uint32_t max_cycles) override;
+
+private:
+    enum { HILO_REG = 32 }; // Scoreboard entry shared by HI and LO
+
+    std::uint64_t operands_ready(const Instruction &inst, enum InstructionFlags flags) const;
+    bool pairable(enum InstructionFlags first_flags, std::uint32_t first_addr,
+                  const Instruction &inst, std::uint32_t inst_addr);
+    void issue(bool skip_break, const Instruction &inst, enum InstructionFlags flags);
+    void memory_bubbles(std::uint32_t count);
+    void clear_scoreboard();
+
+    std::uint64_t reg_ready[33]; // Cycle from which result is available to issued instruction
+    // Cycles the core waits for instruction fetch and for data access
+    std::uint32_t mem_program_bubbles, mem_data_bubbles;
+    bool fetch_bubble; // Taken branch without delay slot refetches target
 };
 
 class CorePipelined : public Core {
@@ -362,20 +514,39 @@ public:
                   std::uint32_t min_cache_row_size = 1,
                   Cop0State *cop0state = nullptr);
 
+    ResumePoint drain() override;
+    void resume(const ResumePoint &rp) override;
+
+    void set_pipe_trace(PipeTrace *trace); // Trace is not owned by the core
+    // Multiply/divide unit delivers HI/LO after latency cycles and accepts next
+    // operation after interval cycles. Disabled by default, results are ready
+    // for the next instruction then. Throws Input exception on zero latency or interval.
+    void set_mdu_timing(bool enabled, std::uint32_t mul_latency, std::uint32_t mul_interval,
+                        std::uint32_t div_latency, std::uint32_t div_interval);
+
 protected:
     void flush_stages(bool is_branch);
+    std::uint32_t flush_penalty(bool is_branch) const; // Wrong path instructions flushed by misprediction
     uint32_t get_correct_address(uint32_t pc_before_prediction, bool taken, bool jmp);
     void do_step(bool skip_break = false) override;
     void do_reset() override;
+    std::uint32_t do_skip_stall(std::uint32_t max_cycles) override;
     BranchPredictor *predictor() override;
+    void data_bubbles(std::uint32_t count);
     void enqueue_pc(std::uint32_t pc);
     std::uint32_t dequeue_pc();
     void remove_pc(std::uint32_t inst_addr);
     void handle_fetch_stall(bool check);
     void handle_fetch_dls();
     void handle_fetch_bp();
+    void clear_pipeline();
 
 private:
+    void step_stages(bool skip_break);
+    void trace_cycle();
+    bool mdu_hazard(const struct dtDecode &dt) const;
+    void mdu_issue(const struct dtDecode &dt);
+
     struct Core::dtFetch dt_f;
     struct Core::dtDecode dt_d;
     struct Core::dtExecute dt_e;
@@ -383,6 +554,7 @@ private:
 
     BranchPredictor *bp;
     bool inc_data_hazards;
+    bool inc_mdu_stalls; // Data hazard stall is caused by multiply/divide unit
     bool control_hazard;
     bool branch_res_id;
     bool data_cache_enabled, program_cache_enabled;
@@ -394,6 +566,14 @@ private:
     QVector<std::uint32_t> pcs; // Save pc for each prediction we make.
     uint32_t pc_before_jmp{};
     uint32_t mem_program_bubbles{}, mem_data_bubbles{};
+    bool check_branch_stall;
+    bool data_branch_hazard_ex;
+    bool resolved_branch_mem_prog_bubbles;
+    struct Core::dtMemory cache_mem_instr; // Instruction waiting in memory stage for data
+    bool mdu_enabled;
+    std::uint32_t mdu_mul_latency, mdu_mul_interval, mdu_div_latency, mdu_div_interval;
+    std::uint64_t mdu_ready; // Cycle from which HI/LO hold result of the last operation
+    std::uint64_t mdu_free; // Cycle from which the unit accepts next operation
 };
 
 }
@@ -0,0 +1,149 @@
+#include <QFile>
+#include <QTextStream>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "cpistack.h"
+#include "qtmipsexception.h"
+
+using namespace machine;
+
+static const char *component_names[CpiStack::CPI_COMPONENTS_CNT] = {
+    "base",
+    "data_hazard",
+    "control_hazard",
+    "branch_flush",
+    "mdu",
+    "l1_program",
+    "l1_data",
+    "l2_unified",
+    "lower_caches",
+    "write_buffer",
+    "dram",
+};
+
+double CpiStack::Sample::cpi(Component component) const {
+    if (instructions == 0)
+        return 0;
+    return (double)components[component] / (double)instructions;
+}
+
+CpiStack::CpiStack(std::uint64_t interval, unsigned capacity) {
+    SANITY_ASSERT(interval > 0 && capacity > 0, "CPI stack needs positive interval and capacity");
+    interval_len = interval;
+    capacity_len = capacity;
+    samples.reserve(capacity);
+    clear();
+}
+
+std::uint64_t CpiStack::interval() const {
+    return interval_len;
+}
+
+unsigned CpiStack::capacity() const {
+    return capacity_len;
+}
+
+void CpiStack::sample(const CycleStatistics &stats) {
+    Sample s;
+    std::uint64_t stalls = 0;
+
+    s.cycle = stats.total_cycles;
+    s.cycles = stats.total_cycles - last.total_cycles;
+    s.instructions = stats.instructions - last.instructions;
+    s.components[CPI_DATA_HAZARD] = stats.data_hazard_stalls - last.data_hazard_stalls;
+    s.components[CPI_BRANCH_FLUSH] = stats.branch_flush_stalls - last.branch_flush_stalls;
+    s.components[CPI_CONTROL_HAZARD] = stats.control_hazard_stalls - last.control_hazard_stalls -
+                                       s.components[CPI_BRANCH_FLUSH];
+    s.components[CPI_MDU] = stats.mdu_stalls - last.mdu_stalls;
+    s.components[CPI_L1_PROGRAM] = stats.l1_program_stall_cycles_total - last.l1_program_stall_cycles_total;
+    s.components[CPI_L1_DATA] = stats.l1_data_stall_cycles_total - last.l1_data_stall_cycles_total;
+    s.components[CPI_L2_UNIFIED] = stats.l2_unified_stall_cycles_total - last.l2_unified_stall_cycles_total;
+    s.components[CPI_LOWER_CACHES] = stats.lower_cache_stall_cycles_sum() - last.lower_cache_stall_cycles_sum();
+    s.components[CPI_WRITE_BUFFER] = stats.write_buffer_stall_cycles_total - last.write_buffer_stall_cycles_total;
+    s.components[CPI_DRAM] = stats.ram_program_stall_cycles_total - last.ram_program_stall_cycles_total +
+                             stats.ram_data_stall_cycles_total - last.ram_data_stall_cycles_total;
+    for (int i = CPI_BASE + 1; i < CPI_COMPONENTS_CNT; i++)
+        stalls += s.components[i];
+    // Stall counters can overlap at the end of interval, base never goes negative
+    s.components[CPI_BASE] = s.cycles > stalls ? s.cycles - stalls : 0;
+    last = stats;
+
+    if ((unsigned)samples.size() < capacity_len) {
+        samples.append(s);
+    } else {
+        samples[head] = s;
+        head = (head + 1) % capacity_len;
+        overwritten++;
+    }
+}
+
+void CpiStack::clear(const CycleStatistics &start) {
+    samples.clear();
+    head = 0;
+    overwritten = 0;
+    last = start;
+}
+
+unsigned CpiStack::size() const {
+    return samples.size();
+}
+
+const CpiStack::Sample &CpiStack::at(unsigned index) const {
+    SANITY_ASSERT(index < (unsigned)samples.size(), "CPI stack sample index out of range");
+    return samples[(head + index) % samples.size()];
+}
+
+std::uint64_t CpiStack::dropped() const {
+    return overwritten;
+}
+
+QString CpiStack::component_name(Component component) {
+    SANITY_ASSERT(component < CPI_COMPONENTS_CNT, "Unknown CPI stack component");
+    return component_names[component];
+}
+
+QString CpiStack::to_csv() const {
+    QString csv = "cycle,cycles,instructions";
+    for (int c = 0; c < CPI_COMPONENTS_CNT; c++)
+        csv += QString(",") + component_names[c];
+    csv += "\n";
+    for (unsigned i = 0; i < size(); i++) {
+        const Sample &s = at(i);
+        csv += QString("%1,%2,%3").arg(s.cycle).arg(s.cycles).arg(s.instructions);
+        for (int c = 0; c < CPI_COMPONENTS_CNT; c++)
+            csv += "," + QString::number(s.cpi((Component)c), 'f', 6);
+        csv += "\n";
+    }
+    return csv;
+}
+
+QString CpiStack::to_json() const {
+    QJsonArray list;
+    for (unsigned i = 0; i < size(); i++) {
+        const Sample &s = at(i);
+        QJsonObject cpi;
+        for (int c = 0; c < CPI_COMPONENTS_CNT; c++)
+            cpi.insert(component_names[c], s.cpi((Component)c));
+        QJsonObject sample;
+        // JSON numbers are doubles, exact up to 2^53 cycles
+        sample.insert("cycle", (double)s.cycle);
+        sample.insert("cycles", (double)s.cycles);
+        sample.insert("instructions", (double)s.instructions);
+        sample.insert("cpi", cpi);
+        list.append(sample);
+    }
+    QJsonObject root;
+    root.insert("interval", (double)interval_len);
+    root.insert("dropped", (double)overwritten);
+    root.insert("samples", list);
+    return QJsonDocument(root).toJson();
+}
+
+void CpiStack::save(const QString &path) const {
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+        throw QTMIPS_EXCEPTION(Input, "Can't open CPI stack file for writing", path);
+    QTextStream out(&f);
+    out << (path.endsWith(".json", Qt::CaseInsensitive) ? to_json() : to_csv());
+}
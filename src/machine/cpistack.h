@@ -0,0 +1,69 @@
+#ifndef CPISTACK_H
+#define CPISTACK_H
+
+#include <QVector>
+#include <QString>
+#include <cstdint>
+#include "cyclestatistics.h"
+
+namespace machine {
+
+// Time series of CPI stack. Cycles of every sampled interval are split into
+// base cycles and stall components taken from cycle statistics. Samples are
+// kept in ring buffer of fixed capacity, the oldest ones are overwritten.
+class CpiStack {
+public:
+    enum Component {
+        CPI_BASE,
+        CPI_DATA_HAZARD,
+        CPI_CONTROL_HAZARD, // Stalls not caused by branch mispredictions
+        CPI_BRANCH_FLUSH,
+        CPI_MDU, // Multiply/divide unit busy or its result not ready
+        CPI_L1_PROGRAM,
+        CPI_L1_DATA,
+        CPI_L2_UNIFIED,
+        CPI_LOWER_CACHES, // L3 and below
+        CPI_WRITE_BUFFER,
+        CPI_DRAM,
+        CPI_COMPONENTS_CNT
+    };
+
+    struct Sample {
+        std::uint64_t cycle; // Total cycles at end of interval
+        std::uint64_t cycles; // Length of interval
+        std::uint64_t instructions; // Retired in interval
+        std::uint64_t components[CPI_COMPONENTS_CNT]; // Cycles of interval
+
+        double cpi(Component component) const; // Zero when nothing retired
+    };
+
+    CpiStack(std::uint64_t interval, unsigned capacity = 1024);
+
+    std::uint64_t interval() const;
+    unsigned capacity() const;
+
+    void sample(const CycleStatistics &stats); // Close interval ending at given statistics
+    void clear(const CycleStatistics &start = CycleStatistics()); // Next interval starts at start
+
+    unsigned size() const;
+    const Sample &at(unsigned index) const; // Oldest kept sample has index 0
+    std::uint64_t dropped() const; // Samples overwritten by newer ones
+
+    static QString component_name(Component component);
+    QString to_csv() const;
+    QString to_json() const;
+    // JSON is written when path ends with .json, CSV otherwise. Throws Input exception on failure.
+    void save(const QString &path) const;
+
+private:
+    std::uint64_t interval_len;
+    unsigned capacity_len;
+    QVector<Sample> samples;
+    unsigned head; // Index of the oldest sample when buffer is full
+    std::uint64_t overwritten;
+    CycleStatistics last;
+};
+
+}
+
+#endif // CPISTACK_H
@@ -5,10 +5,18 @@
 
 namespace machine {
     struct CycleStatistics {
+        // Caches below L2 with own stall counters, index zero is L3.
+        // Configuration can't have more of them (MachineConfig::set_lower_cache_count).
+        enum { LOWER_CACHE_LEVELS = 4 };
+
         uint64_t total_cycles;
+        uint64_t instructions; // Instructions which reached writeback
         uint64_t memory_cycles;
         uint64_t data_hazard_stalls;
         uint64_t control_hazard_stalls;
+        uint64_t branch_flush_stalls; // Part of control hazard stalls caused by mispredictions
+        uint64_t mdu_stalls; // Waiting for multiply/divide unit or its HI/LO result
+        uint64_t paired_issues; // Cycles in which dual issue timing model issued two instructions
         uint64_t ram_program_stall_cycles_total;
         uint64_t ram_data_stall_cycles_total;
         uint64_t l1_data_stall_cycles;
@@ -17,12 +25,67 @@ namespace machine {
         uint64_t l1_program_stall_cycles_total;
         uint64_t l2_unified_stall_cycles;
         uint64_t l2_unified_stall_cycles_total;
+        uint64_t lower_cache_stall_cycles[LOWER_CACHE_LEVELS];
+        uint64_t lower_cache_stall_cycles_total[LOWER_CACHE_LEVELS];
+        uint64_t write_buffer_stall_cycles; // Stores finding full write buffer and loads waiting for it
+        uint64_t write_buffer_stall_cycles_total;
+        uint64_t idle_skipped_cycles; // Part of total cycles spent in skipped idle loops
 
-        CycleStatistics() : total_cycles(0), memory_cycles(0), data_hazard_stalls(0),
-                            control_hazard_stalls(0), ram_program_stall_cycles_total(0), ram_data_stall_cycles_total(0),
+        CycleStatistics() : total_cycles(0), instructions(0), memory_cycles(0), data_hazard_stalls(0),
+                            control_hazard_stalls(0), branch_flush_stalls(0), mdu_stalls(0), paired_issues(0), ram_program_stall_cycles_total(0), ram_data_stall_cycles_total(0),
                             l1_data_stall_cycles(0), l1_data_stall_cycles_total(0),
                             l1_program_stall_cycles(0), l1_program_stall_cycles_total(0),
-                            l2_unified_stall_cycles(0), l2_unified_stall_cycles_total(0) {}
+                            l2_unified_stall_cycles(0), l2_unified_stall_cycles_total(0),
+                            write_buffer_stall_cycles(0), write_buffer_stall_cycles_total(0),
+                            idle_skipped_cycles(0) {
+            for (int i = 0; i < LOWER_CACHE_LEVELS; i++) {
+                lower_cache_stall_cycles[i] = 0;
+                lower_cache_stall_cycles_total[i] = 0;
+            }
+        }
+
+        // Moves at most count pending stall cycles of each lower cache to totals
+        void drain_lower_cache_stalls(uint64_t count) {
+            for (int i = 0; i < LOWER_CACHE_LEVELS; i++) {
+                uint64_t n = lower_cache_stall_cycles[i] < count ? lower_cache_stall_cycles[i] : count;
+                lower_cache_stall_cycles[i] -= n;
+                lower_cache_stall_cycles_total[i] += n;
+            }
+        }
+
+        uint64_t lower_cache_stall_cycles_sum() const {
+            uint64_t sum = 0;
+            for (int i = 0; i < LOWER_CACHE_LEVELS; i++)
+                sum += lower_cache_stall_cycles_total[i];
+            return sum;
+        }
+
+        // Account count more repetitions of what happened between two snapshots
+        void add_repeated(const CycleStatistics &start, const CycleStatistics &end, uint64_t count) {
+            total_cycles += (end.total_cycles - start.total_cycles) * count;
+            instructions += (end.instructions - start.instructions) * count;
+            memory_cycles += (end.memory_cycles - start.memory_cycles) * count;
+            data_hazard_stalls += (end.data_hazard_stalls - start.data_hazard_stalls) * count;
+            control_hazard_stalls += (end.control_hazard_stalls - start.control_hazard_stalls) * count;
+            branch_flush_stalls += (end.branch_flush_stalls - start.branch_flush_stalls) * count;
+            mdu_stalls += (end.mdu_stalls - start.mdu_stalls) * count;
+            paired_issues += (end.paired_issues - start.paired_issues) * count;
+            ram_program_stall_cycles_total += (end.ram_program_stall_cycles_total -
+                                               start.ram_program_stall_cycles_total) * count;
+            ram_data_stall_cycles_total += (end.ram_data_stall_cycles_total -
+                                            start.ram_data_stall_cycles_total) * count;
+            l1_data_stall_cycles_total += (end.l1_data_stall_cycles_total -
+                                           start.l1_data_stall_cycles_total) * count;
+            l1_program_stall_cycles_total += (end.l1_program_stall_cycles_total -
+                                              start.l1_program_stall_cycles_total) * count;
+            l2_unified_stall_cycles_total += (end.l2_unified_stall_cycles_total -
+                                              start.l2_unified_stall_cycles_total) * count;
+            for (int i = 0; i < LOWER_CACHE_LEVELS; i++)
+                lower_cache_stall_cycles_total[i] += (end.lower_cache_stall_cycles_total[i] -
+                                                      start.lower_cache_stall_cycles_total[i]) * count;
+            write_buffer_stall_cycles_total += (end.write_buffer_stall_cycles_total -
+                                                start.write_buffer_stall_cycles_total) * count;
+        }
     };
 }
 
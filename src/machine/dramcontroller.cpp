@@ -0,0 +1,115 @@
+#include "dramcontroller.h"
+#include "qtmipsexception.h"
+
+using namespace machine;
+
+DramController::DramController(Memory *mem, const MachineConfig &cc) :
+        MemoryAccess(cc.ram_access_read(), cc.ram_access_write(), cc.ram_access_burst()),
+        open_row(cc.dram_banks()) {
+    if (cc.dram_banks() == 0 || cc.dram_row_bytes() < 4)
+        throw QTMIPS_EXCEPTION(Input, "DRAM needs at least one bank and rows of at least one word",
+                               QString::number(cc.dram_banks()) + " banks, " +
+                               QString::number(cc.dram_row_bytes()) + " bytes per row");
+    this->mem = mem;
+    this->row_bytes = cc.dram_row_bytes();
+    this->t_rcd = cc.dram_t_rcd();
+    this->t_cas = cc.dram_t_cas();
+    this->t_rp = cc.dram_t_rp();
+    this->page_policy = cc.dram_page_policy();
+    connect(mem, SIGNAL(external_change_notify(const MemoryAccess*,uint32_t,uint32_t,bool)),
+            this, SLOT(memory_external_change(const MemoryAccess*,uint32_t,uint32_t,bool)));
+    reset();
+}
+
+bool DramController::wword(std::uint32_t address, std::uint32_t value) {
+    writes++;
+    access(address);
+    return mem->write_word(address, value);
+}
+
+std::uint32_t DramController::rword(std::uint32_t address, bool debug_access) const {
+    if (!debug_access) {
+        reads++;
+        access(address);
+    }
+    return mem->read_word(address, debug_access);
+}
+
+std::uint32_t DramController::get_change_counter() const {
+    return mem->get_change_counter();
+}
+
+enum LocationStatus DramController::location_status(std::uint32_t address) const {
+    return mem->location_status(address);
+}
+
+bool DramController::last_access_cycles(std::uint32_t &cycles) const {
+    if (!last_valid)
+        return false;
+    cycles = last_cycles;
+    return true;
+}
+
+std::uint64_t DramController::row_hits() const {
+    return hit_cnt;
+}
+
+std::uint64_t DramController::row_misses() const {
+    return miss_cnt;
+}
+
+std::uint64_t DramController::row_conflicts() const {
+    return conflict_cnt;
+}
+
+double DramController::row_hit_rate() const {
+    std::uint64_t comp = hit_cnt + miss_cnt + conflict_cnt;
+
+    return comp == 0 ? 0.0 : (double)hit_cnt / (double)comp * 100.0;
+}
+
+unsigned DramController::banks() const {
+    return open_row.size();
+}
+
+void DramController::reset() {
+    open_row.fill(-1);
+    last_cycles = 0;
+    last_valid = false;
+    hit_cnt = 0;
+    miss_cnt = 0;
+    conflict_cnt = 0;
+    emit row_update(hit_cnt, miss_cnt, conflict_cnt);
+}
+
+void DramController::memory_external_change(const MemoryAccess *mem_access, std::uint32_t start_addr,
+                                            std::uint32_t last_addr, bool external) {
+    (void)mem_access;
+    emit external_change_notify(this, start_addr, last_addr, external);
+}
+
+// Burst words of a line fill or write back follow in the already open row,
+// only the first word of a transfer is timed and counted.
+void DramController::access(std::uint32_t address) const {
+    std::uint32_t row_index = address / row_bytes;
+    unsigned bank = row_index % open_row.size();
+    std::int64_t row = row_index / open_row.size();
+
+    if (!update_stats)
+        return;
+
+    if (open_row[bank] == row) {
+        hit_cnt++;
+        last_cycles = t_cas;
+    } else if (open_row[bank] < 0) {
+        miss_cnt++;
+        last_cycles = t_rcd + t_cas;
+    } else {
+        conflict_cnt++;
+        last_cycles = t_rp + t_rcd + t_cas;
+    }
+    last_valid = true;
+    // Precharge of closed page policy is done while the bank is idle
+    open_row[bank] = page_policy == MachineConfig::DRAM_CLOSED_PAGE ? -1 : row;
+    emit row_update(hit_cnt, miss_cnt, conflict_cnt);
+}
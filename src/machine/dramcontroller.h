@@ -0,0 +1,60 @@
+#ifndef DRAMCONTROLLER_H
+#define DRAMCONTROLLER_H
+
+#include <QObject>
+#include <QVector>
+#include <cstdint>
+#include "memory.h"
+#include "machineconfig.h"
+
+namespace machine {
+
+// Timing model of banked DRAM placed in front of the RAM range. Data are kept
+// by the wrapped memory, the controller only follows which row is open in the
+// row buffer of every bank. Address is split to row, bank and column from the
+// most significant bits, so consecutive rows are spread over all banks.
+// Access to the open row pays tCAS, to a precharged bank tRCD + tCAS and to
+// a bank with another row open tRP + tRCD + tCAS. Closed page policy
+// precharges the bank after every access so no row stays open.
+class DramController : public MemoryAccess {
+    Q_OBJECT
+public:
+    DramController(Memory *mem, const MachineConfig &cc);
+
+    bool wword(std::uint32_t address, std::uint32_t value) override;
+    std::uint32_t rword(std::uint32_t address, bool debug_access = false) const override;
+    std::uint32_t get_change_counter() const override;
+    enum LocationStatus location_status(std::uint32_t address) const override;
+    bool last_access_cycles(std::uint32_t &cycles) const override;
+
+    std::uint64_t row_hits() const; // Accesses to the open row.
+    std::uint64_t row_misses() const; // Accesses to a bank without open row.
+    std::uint64_t row_conflicts() const; // Accesses which closed another row first.
+    double row_hit_rate() const; // Row hits in percents of all accesses.
+
+    unsigned banks() const;
+    void reset(); // Close all rows and clear statistics.
+
+signals:
+    void row_update(std::uint64_t hits, std::uint64_t misses, std::uint64_t conflicts) const;
+
+private slots:
+    void memory_external_change(const MemoryAccess *mem_access, std::uint32_t start_addr,
+                                std::uint32_t last_addr, bool external);
+
+private:
+    Memory *mem;
+    std::uint32_t row_bytes;
+    std::uint32_t t_rcd, t_cas, t_rp;
+    enum MachineConfig::DramPagePolicy page_policy;
+    mutable QVector<std::int64_t> open_row; // Minus one for precharged bank
+    mutable std::uint32_t last_cycles;
+    mutable bool last_valid;
+    mutable std::uint64_t hit_cnt, miss_cnt, conflict_cnt;
+
+    void access(std::uint32_t address) const;
+};
+
+}
+
+#endif // DRAMCONTROLLER_H
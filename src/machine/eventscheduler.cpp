@@ -0,0 +1,56 @@
+#include <algorithm>
+#include "eventscheduler.h"
+
+using namespace machine;
+
+EventScheduler::EventScheduler() {
+    last_id = 0;
+    next_cycle = UINT64_MAX;
+}
+
+EventScheduler::EventId EventScheduler::schedule(std::uint64_t cycle, Handler handler) {
+    if (++last_id == 0)
+        last_id = 1;
+    queue.emplace(Key(cycle, last_id), std::move(handler));
+    event_cycles.insert(last_id, cycle);
+    next_cycle = std::min(next_cycle, cycle);
+    return last_id;
+}
+
+bool EventScheduler::cancel(EventId id) {
+    auto it = event_cycles.find(id);
+    if (it == event_cycles.end())
+        return false;
+    // Next cycle is left as is, spurious check costs less than finding new minimum
+    queue.erase(Key(it.value(), id));
+    event_cycles.erase(it);
+    return true;
+}
+
+bool EventScheduler::pending(EventId id) const {
+    return event_cycles.contains(id);
+}
+
+void EventScheduler::request_check() {
+    next_cycle = 0;
+}
+
+void EventScheduler::run_until(std::uint64_t cycle) {
+    next_cycle = UINT64_MAX;
+    while (!queue.empty() && queue.begin()->first.first <= cycle) {
+        auto it = queue.begin();
+        Handler handler = std::move(it->second);
+        event_cycles.remove(it->first.second);
+        queue.erase(it);
+        // Handler can schedule new events or request another check
+        handler();
+    }
+    if (!queue.empty())
+        next_cycle = std::min(next_cycle, queue.begin()->first.first);
+}
+
+void EventScheduler::reset() {
+    queue.clear();
+    event_cycles.clear();
+    next_cycle = UINT64_MAX;
+}
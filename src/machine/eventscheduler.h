@@ -0,0 +1,47 @@
+#ifndef EVENTSCHEDULER_H
+#define EVENTSCHEDULER_H
+
+#include <QHash>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <utility>
+
+namespace machine {
+
+// Discrete event queue of the machine. Devices schedule events at absolute
+// core cycles and the core only compares its cycle counter with the cycle of
+// the nearest event on each instruction fetch instead of polling devices.
+// Events due at the same cycle are dispatched in order of scheduling.
+class EventScheduler {
+public:
+    typedef std::function<void()> Handler;
+    typedef unsigned EventId; // Zero is never used for valid event
+
+    EventScheduler();
+
+    // Event at cycle which already passed is dispatched on next check
+    EventId schedule(std::uint64_t cycle, Handler handler);
+    bool cancel(EventId id); // Returns false if event already fired or is unknown
+    bool pending(EventId id) const;
+    // Core has to check interrupt request on next fetch even without any event
+    void request_check();
+
+    inline std::uint64_t next_event_cycle() const {
+        return next_cycle;
+    }
+    void run_until(std::uint64_t cycle); // Dispatch all events due at given cycle
+    void reset(); // Forget all events
+
+private:
+    typedef std::pair<std::uint64_t, EventId> Key;
+
+    std::map<Key, Handler> queue;
+    QHash<EventId, std::uint64_t> event_cycles;
+    EventId last_id;
+    std::uint64_t next_cycle;
+};
+
+}
+
+#endif // EVENTSCHEDULER_H
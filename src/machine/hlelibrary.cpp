@@ -0,0 +1,112 @@
+#include "hlelibrary.h"
+#include "qtmipsexception.h"
+
+using namespace machine;
+
+static const char *function_names[HleLibrary::HLE_FUNCTIONS_CNT] = {
+    "memcpy",
+    "memset",
+    "strlen",
+};
+
+HleLibrary::HleLibrary() {
+    cost = &HleLibrary::default_cost;
+    for (int i = 0; i < HLE_FUNCTIONS_CNT; i++)
+        call_count[i] = 0;
+}
+
+void HleLibrary::add(std::uint32_t entry, Function function) {
+    SANITY_ASSERT(function < HLE_FUNCTIONS_CNT, "Unknown HLE function");
+    entries.insert(entry, function);
+}
+
+unsigned HleLibrary::add_symbols(const SymbolTable *symtab) {
+    unsigned found = 0;
+    for (int i = 0; i < HLE_FUNCTIONS_CNT; i++) {
+        std::uint32_t entry;
+        if (symtab->name_to_value(entry, function_names[i])) {
+            add(entry, (Function)i);
+            found++;
+        }
+    }
+    return found;
+}
+
+void HleLibrary::set_cost_model(CostModel model) {
+    cost = model ? model : &HleLibrary::default_cost;
+}
+
+std::uint64_t HleLibrary::call(std::uint32_t entry, Registers *regs, MemoryAccess *mem) {
+    Function function = entries.value(entry, HLE_FUNCTIONS_CNT);
+    SANITY_ASSERT(function < HLE_FUNCTIONS_CNT, "No HLE function at given address");
+    std::uint32_t a0 = regs->read_gp(4);
+    std::uint32_t a1 = regs->read_gp(5);
+    std::uint32_t a2 = regs->read_gp(6);
+    std::uint32_t result = a0;
+    std::uint32_t bytes = a2;
+    bool update_stats = mem->get_update_stats();
+
+    // Emulated accesses are not part of cache statistics
+    mem->set_update_stats(false);
+    switch (function) {
+    case HLE_MEMCPY: {
+        std::uint32_t i = 0;
+        if (((a0 | a1) & 3) == 0) {
+            for (; i + 4 <= a2; i += 4)
+                mem->write_word(a0 + i, mem->read_word(a1 + i));
+        }
+        for (; i < a2; i++)
+            mem->write_byte(a0 + i, mem->read_byte(a1 + i));
+        break;
+    }
+    case HLE_MEMSET: {
+        std::uint8_t c = a1 & 0xff;
+        std::uint32_t word = c * 0x01010101U;
+        std::uint32_t i = 0;
+        for (; i < a2 && ((a0 + i) & 3) != 0; i++)
+            mem->write_byte(a0 + i, c);
+        for (; i + 4 <= a2; i += 4)
+            mem->write_word(a0 + i, word);
+        for (; i < a2; i++)
+            mem->write_byte(a0 + i, c);
+        break;
+    }
+    case HLE_STRLEN:
+        bytes = 0;
+        while (mem->read_byte(a0 + bytes) != 0)
+            bytes++;
+        result = bytes;
+        break;
+    default:
+        break;
+    }
+    mem->set_update_stats(update_stats);
+
+    regs->write_gp(2, result);
+    regs->pc_abs_jmp(regs->read_gp(31));
+    call_count[function]++;
+    return cost(function, bytes);
+}
+
+std::uint64_t HleLibrary::calls(Function function) const {
+    SANITY_ASSERT(function < HLE_FUNCTIONS_CNT, "Unknown HLE function");
+    return call_count[function];
+}
+
+QString HleLibrary::function_name(Function function) {
+    SANITY_ASSERT(function < HLE_FUNCTIONS_CNT, "Unknown HLE function");
+    return function_names[function];
+}
+
+std::uint64_t HleLibrary::default_cost(Function function, std::uint32_t bytes) {
+    switch (function) {
+    case HLE_MEMCPY:
+        return 10 + (std::uint64_t)bytes / 4 * 5 + bytes % 4 * 5;
+    case HLE_MEMSET:
+        return 10 + (std::uint64_t)bytes / 4 * 3 + bytes % 4 * 4;
+    case HLE_STRLEN:
+        return 4 + (std::uint64_t)bytes * 4;
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef HLELIBRARY_H
+#define HLELIBRARY_H
+
+#include <QHash>
+#include <QString>
+#include <cstdint>
+#include <functional>
+#include "registers.h"
+#include "memory.h"
+#include "symboltable.h"
+
+namespace machine {
+
+// High level emulation of simple C library routines for functional runs.
+// Call of known function is executed on host through data memory of the core
+// and registers are updated as after return (result in v0, jump to ra).
+// Cycles of the call are only estimated by cost model.
+class HleLibrary {
+public:
+    enum Function {
+        HLE_MEMCPY,
+        HLE_MEMSET,
+        HLE_STRLEN,
+        HLE_FUNCTIONS_CNT
+    };
+    // Estimated cycles of call which processed given number of bytes
+    typedef std::function<std::uint64_t(Function function, std::uint32_t bytes)> CostModel;
+
+    HleLibrary();
+
+    void add(std::uint32_t entry, Function function);
+    unsigned add_symbols(const SymbolTable *symtab); // Returns number of functions found
+    void set_cost_model(CostModel model);
+
+    inline bool is_entry(std::uint32_t address) const {
+        return entries.contains(address);
+    }
+    // Run function starting at entry and return its estimated cycles
+    std::uint64_t call(std::uint32_t entry, Registers *regs, MemoryAccess *mem);
+
+    std::uint64_t calls(Function function) const;
+    static QString function_name(Function function);
+    // Simple byte loops, memcpy is expected to copy words when possible
+    static std::uint64_t default_cost(Function function, std::uint32_t bytes);
+
+private:
+    QHash<std::uint32_t, Function> entries;
+    CostModel cost;
+    std::uint64_t call_count[HLE_FUNCTIONS_CNT];
+};
+
+}
+
+#endif // HLELIBRARY_H
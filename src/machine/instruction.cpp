@@ -982,28 +982,118 @@ Instruction &Instruction::operator=(const Instruction &c) {
     return *this;
 }
 
+namespace {
+
+// Fixed size buffer the disassembled text is formatted into.
+// Longest instruction text is far below its size.
+class DisasmBuffer {
+public:
+    DisasmBuffer() : len(0) {}
+
+    void put(char c) {
+        if (len < sizeof(buf))
+            buf[len++] = c;
+    }
+    void put(const char *str) {
+        while (*str)
+            put(*str++);
+    }
+    void put_hex(std::uint32_t val) {
+        char tmp[8];
+        int n = 0;
+        put("0x");
+        do {
+            tmp[n++] = "0123456789ABCDEF"[val & 0xf];
+            val >>= 4;
+        } while (val);
+        while (n)
+            put(tmp[--n]);
+    }
+    void put_dec(std::int32_t val) {
+        char tmp[10];
+        int n = 0;
+        std::uint32_t uval = val;
+        if (val < 0) {
+            put('-');
+            uval = -uval;
+        }
+        do {
+            tmp[n++] = '0' + uval % 10;
+            uval /= 10;
+        } while (uval);
+        while (n)
+            put(tmp[--n]);
+    }
+    QString str() const {
+        return QString::fromLatin1(buf, len);
+    }
+
+private:
+    char buf[80];
+    size_t len;
+};
+
+// Direct mapped cache of disassembled instructions shared by all users
+// of to_str (program view, trace, core view). Entries which depend on
+// instruction address (branch and jump targets) match only the same address.
+#define DISASM_CACHE_BITS 12
+
+struct DisasmCacheEntry {
+    bool valid;
+    bool symbolic;
+    bool addr_dependent;
+    std::uint32_t code;
+    std::int32_t inst_addr;
+    QString text;
+};
+
+DisasmCacheEntry disasm_cache[1 << DISASM_CACHE_BITS];
+
+inline DisasmCacheEntry &disasm_cache_entry(std::uint32_t code) {
+    std::uint32_t h = code * 0x9E3779B1;
+    return disasm_cache[h >> (32 - DISASM_CACHE_BITS)];
+}
+
+}
+
 QString Instruction::to_str(std::int32_t inst_addr) const {
+    if (dt == 0)
+        return stall_ ? QStringLiteral("STALL") : QStringLiteral("NOP");
+
+    DisasmCacheEntry &ce = disasm_cache_entry(dt);
+    if (ce.valid && ce.code == dt && ce.symbolic == symbolic_registers_fl &&
+        (!ce.addr_dependent || ce.inst_addr == inst_addr))
+        return ce.text;
+
+    ce.text = format_str(inst_addr, ce.addr_dependent);
+    ce.valid = true;
+    ce.code = dt;
+    ce.symbolic = symbolic_registers_fl;
+    ce.inst_addr = inst_addr;
+    return ce.text;
+}
+
+QString Instruction::format_str(std::int32_t inst_addr, bool &addr_dependent) const {
     const InstructionMap &im = InstructionMapFind(dt);
     // TODO there are exception where some fields are zero and such so we should not print them in such case
-    if (dt == 0)
-        return stall_ ? QString("STALL") : QString("NOP");
     SANITY_ASSERT(argdesbycode_filled, QString("argdesbycode_filled not initialized"));
-    QString res;
-    QString next_delim = " ";
+    DisasmBuffer res;
+    const char *next_delim = " ";
+    addr_dependent = false;
     if (im.type == T_UNKNOWN)
-        return QString("UNKNOWN");
+        return QStringLiteral("UNKNOWN");
 
-    res += im.name;
-    foreach (const QString &arg, im.args) {
-        res += next_delim;
+    res.put(im.name);
+    for (const QString &arg : im.args) {
+        res.put(next_delim);
         next_delim = ", ";
-        foreach (QChar ao, arg) {
+        for (QChar ao : arg) {
             uint a = ao.toLatin1();
             if (!a)
                 continue;
             const ArgumentDesc *adesc = argdesbycode[a];
             if (adesc == nullptr) {
-               res += ao;
+               res.put((char)a);
                continue;
             }
             uint bits = IMF_SUB_GET_BITS(adesc->loc);
@@ -1015,30 +1105,34 @@ QString Instruction::to_str(std::int32_t inst_addr) const {
             field <<= adesc->shift;
             switch (adesc->kind) {
             case 'g':
+                res.put('$');
                 if (symbolic_registers_fl)
-                    res += "$" + QString(regbycode[field].name);
+                    res.put(regbycode[field].name);
                 else
-                    res += "$" + QString::number(field);
+                    res.put_dec(field);
                 break;
             case 'o':
             case 'n':
                 if (adesc->min < 0)
-                    res += QString::number((std::int32_t)field, 10).toUpper();
+                    res.put_dec((std::int32_t)field);
                 else
-                    res += "0x" + QString::number(field, 16).toUpper();
+                    res.put_hex(field);
                 break;
             case 'p':
                 field += inst_addr + 4;
-                res += "0x" + QString::number((std::uint32_t)field, 16).toUpper();
+                res.put_hex(field);
+                addr_dependent = true;
                 break;
             case 'a':
                 std::uint32_t target = (inst_addr & 0xF0000000) | (address() << 2);
-                res += " 0x" + QString::number(target, 16).toUpper();
+                res.put(' ');
+                res.put_hex(target);
+                addr_dependent = true;
                 break;
             }
         }
     }
-    return res;
+    return res.str();
 }
 
 QMultiMap<QString, std::uint32_t> str_to_instruction_code_map;
@@ -168,6 +168,8 @@ public:
     static void set_symbolic_registers(bool enable);
     static void append_recognized_registers(QStringList &list);
 private:
+    QString format_str(std::int32_t inst_addr, bool &addr_dependent) const;
+
     std::uint32_t dt;
     bool stall_;
     static bool symbolic_registers_fl;
@@ -34,6 +34,7 @@
  ******************************************************************************/
 
 #include "lcddisplay.h"
+#include <QtEndian>
 
 using namespace machine;
 
@@ -41,7 +42,7 @@ LcdDisplay::LcdDisplay() {
     change_counter = 0;
     size_t need_bytes;
     fb_size = 0x4b000;
-    fb_bpp = 16;
+    fb_bpp = 16; // Only RGB565 is supported, pixel access assumes two bytes
     fb_width = 480;
     fb_height = 320;
     if (fb_bpp > 12) {
@@ -56,6 +57,11 @@ LcdDisplay::LcdDisplay() {
 
     fb_data = new uchar[fb_size];
     std::fill(fb_data, fb_data + fb_size, 0);
+
+    dirty_x_first.fill(-1, fb_height);
+    dirty_x_last.fill(-1, fb_height);
+    dirty_y_first = -1;
+    dirty_y_last = -1;
 }
 
 LcdDisplay::~LcdDisplay() {
@@ -63,25 +69,51 @@ LcdDisplay::~LcdDisplay() {
         delete[] fb_data;
 }
 
-std::uint32_t LcdDisplay::pixel_address(uint x, uint y)
-{
-    std::uint32_t address;
-    address = y * fb_linesize;
-    if (fb_bpp > 12)
-        address += x * ((fb_bpp + 7) >> 3);
-    else
-        address += x * fb_bpp / 8;
+// Guest sees each pixel as big endian halfword, as if the framebuffer was
+// stored byte by byte. Host keeps it in native order for the view.
+std::uint16_t LcdDisplay::get_pixel(std::uint32_t address) const {
+    return qFromUnaligned<std::uint16_t>(fb_data + address);
+}
+
+void LcdDisplay::set_pixel(std::uint32_t address, std::uint16_t pixel) {
+    qToUnaligned<std::uint16_t>(pixel, fb_data + address);
+}
 
-    return address;
+void LcdDisplay::mark_dirty(uint x_first, uint x_last, uint y) {
+    if (dirty_y_first < 0) {
+        dirty_y_first = dirty_y_last = y;
+        emit fb_changed();
+    } else if ((int)y < dirty_y_first) {
+        dirty_y_first = y;
+    } else if ((int)y > dirty_y_last) {
+        dirty_y_last = y;
+    }
+    if (dirty_x_first[y] < 0 || (int)x_first < dirty_x_first[y])
+        dirty_x_first[y] = x_first;
+    if ((int)x_last > dirty_x_last[y])
+        dirty_x_last[y] = x_last;
 }
 
+QVector<LcdDisplay::DirtySpan> LcdDisplay::take_dirty_spans() {
+    QVector<DirtySpan> spans;
+
+    if (dirty_y_first < 0)
+        return spans;
+    for (int y = dirty_y_first; y <= dirty_y_last; y++) {
+        if (dirty_x_first[y] < 0)
+            continue;
+        spans.append({(uint)y, (uint)dirty_x_first[y], (uint)dirty_x_last[y]});
+        dirty_x_first[y] = -1;
+        dirty_x_last[y] = -1;
+    }
+    dirty_y_first = -1;
+    dirty_y_last = -1;
+    return spans;
+}
 
 bool LcdDisplay::wword(std::uint32_t address, std::uint32_t value) {
     address &= ~3;
-    uint x, y, r, g, b;
-    std::uint32_t c;
-    std::uint32_t last_addr = address + 3;
-    std::uint32_t pixel_addr;
+    uint x, y;
 
     if (address + 3 >= fb_size)
         return 0;
@@ -92,34 +124,15 @@ bool LcdDisplay::wword(std::uint32_t address, std::uint32_t value) {
     if (value == rword(address, true))
         return false;
 
-    fb_data[address + 0] = (value >> 24) & 0xff;
-    fb_data[address + 1] = (value >> 16) & 0xff;
-    fb_data[address + 2] = (value >> 8) & 0xff;
-    fb_data[address + 3] = (value >> 0) & 0xff;
+    set_pixel(address + 0, (value >> 16) & 0xffff);
+    set_pixel(address + 2, (value >> 0) & 0xffff);
 
     change_counter++;
 
     y = address / fb_linesize;
-    if (fb_bpp > 12)
-        x = (address - y * fb_linesize) / ((fb_bpp + 7) >> 3);
-    else
-        x = (address - y * fb_linesize) * 8 / fb_bpp;
-
-    while ((pixel_addr = pixel_address(x, y)) <= last_addr) {
-        c = fb_data[pixel_addr] << 8;
-        c |= fb_data[pixel_addr + 1];
-
-        r = ((c >> 11) & 0x1f) << 3;
-        g = ((c >> 5) & 0x3f) << 2;
-        b = ((c >> 0) & 0x1f) << 3;
-
-        emit pixel_update(x, y, r, g, b);
-
-        if (++x >= fb_width) {
-            x = 0;
-            y++;
-        }
-    }
+    x = (address - y * fb_linesize) / 2;
+    if (y < fb_height)
+        mark_dirty(x, x + 1 < fb_width ? x + 1 : x, y);
 
     emit write_notification(address, value);
 
@@ -134,10 +147,8 @@ std::uint32_t LcdDisplay::rword(std::uint32_t address, bool debug_access) const
     if (address + 3 >= fb_size)
         return 0;
 
-    value = (std::uint32_t)fb_data[address + 0] << 24;
-    value |= (std::uint32_t)fb_data[address + 1] << 16;
-    value |= (std::uint32_t)fb_data[address + 2] << 8;
-    value |= (std::uint32_t)fb_data[address + 3] << 0;
+    value = (std::uint32_t)get_pixel(address + 0) << 16;
+    value |= (std::uint32_t)get_pixel(address + 2) << 0;
 
 #if 0
     printf("LcdDisplay::rword address 0x%08lx data 0x%08lx\n",
@@ -38,6 +38,7 @@
 
 #include <QObject>
 #include <QMap>
+#include <QVector>
 #include <cstdint>
 #include <qtmipsexception.h>
 #include "machinedefs.h"
@@ -54,9 +55,15 @@ public:
 signals:
     void write_notification(std::uint32_t address, std::uint32_t value);
     void read_notification(std::uint32_t address, std::uint32_t *value) const;
-    void pixel_update(uint x, uint y, uint r, uint g, uint b);
+    void fb_changed(); // First change since last take_dirty_spans()
 
 public:
+    struct DirtySpan {
+        uint y;
+        uint x_first;
+        uint x_last;
+    };
+
     bool wword(std::uint32_t address, std::uint32_t value) override;
     std::uint32_t rword(std::uint32_t address, bool debug_access = false) const override;
     virtual std::uint32_t get_change_counter() const override;
@@ -69,15 +76,38 @@ public:
         return fb_height;
     }
 
+    // Framebuffer is kept as RGB565 pixels in host byte order
+    // so it can be wrapped by QImage::Format_RGB16 without copy
+    inline const uchar *fb_pixels() const {
+        return fb_data;
+    }
+
+    inline unsigned bpp() const {
+        return fb_bpp;
+    }
+
+    inline uint linesize() const {
+        return fb_linesize;
+    }
+
+    // Returns changed parts of lines and starts new tracking period
+    QVector<DirtySpan> take_dirty_spans();
+
 private:
     mutable std::uint32_t change_counter;
-    std::uint32_t pixel_address(uint x, uint y);
+    std::uint16_t get_pixel(std::uint32_t address) const;
+    void set_pixel(std::uint32_t address, std::uint16_t pixel);
+    void mark_dirty(uint x_first, uint x_last, uint y);
     uchar *fb_data;
     size_t fb_size;
     unsigned fb_bpp;
     unsigned fb_width;
     unsigned fb_height;
     unsigned fb_linesize;
+    QVector<int> dirty_x_first;
+    QVector<int> dirty_x_last;
+    int dirty_y_first;
+    int dirty_y_last;
 };
 
 }
@@ -34,22 +34,42 @@
  ******************************************************************************/
 
 #include "machineconfig.h"
+#include "cyclestatistics.h"
 #include <QMap>
+#include <algorithm>
 
 using namespace machine;
 
 //////////////////////////////////////////////////////////////////////////////
 /// Default config of MachineConfig
 #define DF_PIPELINE true
+#define DF_DUAL_ISSUE_TIMING false
 #define DF_DHUNIT DHU_STALL_FORWARD
 #define DF_CHUNIT CHU_DELAY_SLOT
 #define DF_BP_BITS 0
+#define DF_BTB_BITS -1
+#define DF_BTB_WAYS 1
+#define DF_BTB_REPLC MachineConfigCache::RP_LRU
+#define DF_RAS_DEPTH 0
+#define DF_LOWER_CACHES 1
 #define DF_B_RES_ID true
+#define DF_MDU_MODEL false
+#define DF_MDU_MUL_LATENCY 5
+#define DF_MDU_MUL_INTERVAL 1
+#define DF_MDU_DIV_LATENCY 35
+#define DF_MDU_DIV_INTERVAL 35
 #define DF_EXEC_PROTEC false
 #define DF_WRITE_PROTEC false
 #define DF_DRAM_ACC_READ 80
 #define DF_DRAM_ACC_WRITE 80
 #define DF_DRAM_ACC_BURST 0
+#define DF_DRAM_MODEL false
+#define DF_DRAM_BANKS 8
+#define DF_DRAM_ROW_BYTES 1024
+#define DF_DRAM_T_RCD 25
+#define DF_DRAM_T_CAS 25
+#define DF_DRAM_T_RP 25
+#define DF_DRAM_PAGE_POL DRAM_OPEN_PAGE
 #define DF_ELF QString("")
 #define DF_TRACE QString(".")
 //////////////////////////////////////////////////////////////////////////////
@@ -64,17 +84,30 @@ using namespace machine;
 #define DFC_L2_UNIFIED_ACC_READ 5
 #define DFC_L2_UNIFIED_ACC_WRITE 5
 #define DFC_L2_UNIFIED_ACC_BURST 0
+#define DFC_LOWER_ACC_READ 20
+#define DFC_LOWER_ACC_WRITE 20
+#define DFC_LOWER_ACC_BURST 0
 #define DFC_SETS 1
 #define DFC_BLOCKS 1
 #define DFC_ASSOC 1
 #define DFC_REPLAC ReplacementPolicy::RP_LRU
 #define DFC_WRITE_POL WritePolicy::WP_BACK
 #define DFC_WRITE_ALLOC true
+#define DFC_PREFETCHER PrefetcherType::PF_NONE
+#define DFC_PF_DEGREE 1
+#define DFC_PF_DISTANCE 1
+#define DFC_INCLUSION InclusionPolicy::IP_NINE
+#define DFC_VICTIM_ENTRIES 0
+#define DFC_WB_ENTRIES 0
+#define DFC_WB_DRAIN WriteBufferDrain::WB_DRAIN_EAGER
 //////////////////////////////////////////////////////////////////////////////
 
 MachineConfigCache::MachineConfigCache(const MemoryAccess::MemoryType &ct) :
                     en(DFC_EN), n_sets(DFC_SETS), n_blocks(DFC_BLOCKS), d_associativity(DFC_ASSOC),
-                    replac_pol(DFC_REPLAC), write_pol(DFC_WRITE_POL), write_allocate(DFC_WRITE_ALLOC), cache_type(ct) {
+                    replac_pol(DFC_REPLAC), write_pol(DFC_WRITE_POL), write_allocate(DFC_WRITE_ALLOC), cache_type(ct),
+                    pf_type(DFC_PREFETCHER), pf_degree(DFC_PF_DEGREE), pf_distance(DFC_PF_DISTANCE),
+                    incl_pol(DFC_INCLUSION), victim_cnt(DFC_VICTIM_ENTRIES),
+                    wb_entries(DFC_WB_ENTRIES), wb_drain(DFC_WB_DRAIN) {
 
     switch (ct) {
         case MemoryAccess::MemoryType::L1_PROGRAM_CACHE:
@@ -92,6 +125,11 @@ MachineConfigCache::MachineConfigCache(const MemoryAccess::MemoryType &ct) :
             m_time_write = DFC_L2_UNIFIED_ACC_WRITE;
             m_time_burst = DFC_L2_UNIFIED_ACC_BURST;
             break;
+        case MemoryAccess::MemoryType::LOWER_CACHE:
+            m_time_read = DFC_LOWER_ACC_READ;
+            m_time_write = DFC_LOWER_ACC_WRITE;
+            m_time_burst = DFC_LOWER_ACC_BURST;
+            break;
         default:
             SANITY_ASSERT(0, "Invalid type for cache memory.");
     }
@@ -102,7 +140,10 @@ MachineConfigCache::MachineConfigCache(const MachineConfigCache &cc) :
                                         m_time_burst(cc.mem_access_burst()), n_sets(cc.sets()), n_blocks(cc.blocks()),
                                         d_associativity(cc.associativity()), replac_pol(cc.replacement_policy()),
                                         write_pol(cc.write_policy()), write_allocate(cc.write_alloc()),
-                                        cache_type(cc.type()) {}
+                                        cache_type(cc.type()), pf_type(cc.prefetcher()),
+                                        pf_degree(cc.prefetch_degree()), pf_distance(cc.prefetch_distance()),
+                                        incl_pol(cc.inclusion()), victim_cnt(cc.victim_entries()),
+                                        wb_entries(cc.write_buffer_entries()), wb_drain(cc.write_buffer_drain()) {}
 
 #define N(STR) (prefix + QString(STR))
 
@@ -114,7 +155,14 @@ MachineConfigCache::MachineConfigCache(const MemoryAccess::MemoryType &ct, const
                                        replac_pol((ReplacementPolicy)sts->value(N("ReplacementPol"), (int32_t) DFC_REPLAC).toUInt()),
                                        write_pol((WritePolicy)sts->value(N("WritePol"), (int32_t) DFC_WRITE_POL).toUInt()),
                                        write_allocate(sts->value(N("WriteAlloc"), DFC_WRITE_ALLOC).toBool()),
-                                       cache_type(ct) {
+                                       cache_type(ct),
+                                       pf_type((PrefetcherType)sts->value(N("Prefetcher"), (int32_t) DFC_PREFETCHER).toUInt()),
+                                       pf_degree(sts->value(N("PrefetchDegree"), DFC_PF_DEGREE).toUInt()),
+                                       pf_distance(sts->value(N("PrefetchDistance"), DFC_PF_DISTANCE).toUInt()),
+                                       incl_pol((InclusionPolicy)sts->value(N("Inclusion"), (int32_t) DFC_INCLUSION).toUInt()),
+                                       victim_cnt(sts->value(N("VictimEntries"), DFC_VICTIM_ENTRIES).toUInt()),
+                                       wb_entries(sts->value(N("WriteBufferEntries"), DFC_WB_ENTRIES).toUInt()),
+                                       wb_drain((WriteBufferDrain)sts->value(N("WriteBufferDrain"), (int32_t) DFC_WB_DRAIN).toUInt()) {
     switch (cache_type) {
         case MemoryAccess::MemoryType::L1_PROGRAM_CACHE:
             m_time_read = sts->value(N("AccessTimeRead"), DFC_L1_PROG_ACC_READ).toUInt();
@@ -131,6 +179,11 @@ MachineConfigCache::MachineConfigCache(const MemoryAccess::MemoryType &ct, const
             m_time_write = sts->value(N("AccessTimeRead"), DFC_L2_UNIFIED_ACC_WRITE).toUInt();
             m_time_burst = sts->value(N("AccessTimeRead"), DFC_L2_UNIFIED_ACC_BURST).toUInt();
             break;
+        case MemoryAccess::MemoryType::LOWER_CACHE:
+            m_time_read = sts->value(N("AccessTimeRead"), DFC_LOWER_ACC_READ).toUInt();
+            m_time_write = sts->value(N("AccessTimeWrite"), DFC_LOWER_ACC_WRITE).toUInt();
+            m_time_burst = sts->value(N("AccessTimeBurst"), DFC_LOWER_ACC_BURST).toUInt();
+            break;
         default:
             SANITY_ASSERT(0, "Invalid type for cache memory.");
     }
@@ -147,6 +200,13 @@ void MachineConfigCache::store(QSettings *sts, const QString &prefix) {
     sts->setValue(N("ReplacementPol"), (int32_t)replacement_policy());
     sts->setValue(N("WritePol"), (int32_t)write_policy());
     sts->setValue(N("WriteAlloc"), write_alloc());
+    sts->setValue(N("Prefetcher"), (int32_t)prefetcher());
+    sts->setValue(N("PrefetchDegree"), prefetch_degree());
+    sts->setValue(N("PrefetchDistance"), prefetch_distance());
+    sts->setValue(N("Inclusion"), (int32_t)inclusion());
+    sts->setValue(N("VictimEntries"), victim_entries());
+    sts->setValue(N("WriteBufferEntries"), write_buffer_entries());
+    sts->setValue(N("WriteBufferDrain"), (int32_t)write_buffer_drain());
 }
 
 #undef N
@@ -169,6 +229,11 @@ void MachineConfigCache::preset(ConfigPresets p) {
             set_mem_access_write(DFC_L2_UNIFIED_ACC_WRITE);
             set_mem_access_burst(DFC_L2_UNIFIED_ACC_BURST);
             break;
+        case MemoryAccess::MemoryType::LOWER_CACHE:
+            set_mem_access_read(DFC_LOWER_ACC_READ);
+            set_mem_access_write(DFC_LOWER_ACC_WRITE);
+            set_mem_access_burst(DFC_LOWER_ACC_BURST);
+            break;
         default:
             SANITY_ASSERT(0, "Invalid type for cache memory.");
     }
@@ -184,6 +249,13 @@ void MachineConfigCache::preset(ConfigPresets p) {
             set_replacement_policy(ReplacementPolicy::RP_RAND);
             set_write_policy(WritePolicy::WP_BACK);
             set_write_alloc(true);
+            set_prefetcher(PrefetcherType::PF_NONE);
+            set_prefetch_degree(DFC_PF_DEGREE);
+            set_prefetch_distance(DFC_PF_DISTANCE);
+            set_inclusion(DFC_INCLUSION);
+            set_victim_entries(DFC_VICTIM_ENTRIES);
+            set_write_buffer_entries(DFC_WB_ENTRIES);
+            set_write_buffer_drain(DFC_WB_DRAIN);
             break;
         case ConfigPresets::CP_SINGLE:
         case ConfigPresets::CP_PIPE_NO_HAZARD:
@@ -238,6 +310,34 @@ void MachineConfigCache::set_type(MemoryAccess::MemoryType ct) {
     cache_type = ct;
 }
 
+void MachineConfigCache::set_prefetcher(PrefetcherType pf) {
+    pf_type = pf;
+}
+
+void MachineConfigCache::set_prefetch_degree(std::uint32_t d) {
+    pf_degree = d;
+}
+
+void MachineConfigCache::set_prefetch_distance(std::uint32_t d) {
+    pf_distance = d;
+}
+
+void MachineConfigCache::set_inclusion(InclusionPolicy ip) {
+    incl_pol = ip;
+}
+
+void MachineConfigCache::set_victim_entries(std::uint32_t v) {
+    victim_cnt = v;
+}
+
+void MachineConfigCache::set_write_buffer_entries(std::uint32_t e) {
+    wb_entries = e;
+}
+
+void MachineConfigCache::set_write_buffer_drain(WriteBufferDrain d) {
+    wb_drain = d;
+}
+
 bool MachineConfigCache::enabled() const {
     return en;
 }
@@ -282,6 +382,34 @@ MemoryAccess::MemoryType MachineConfigCache::type() const {
     return cache_type;
 }
 
+MachineConfigCache::PrefetcherType MachineConfigCache::prefetcher() const {
+    return pf_type;
+}
+
+std::uint32_t MachineConfigCache::prefetch_degree() const {
+    return pf_degree;
+}
+
+std::uint32_t MachineConfigCache::prefetch_distance() const {
+    return pf_distance;
+}
+
+MachineConfigCache::InclusionPolicy MachineConfigCache::inclusion() const {
+    return incl_pol;
+}
+
+std::uint32_t MachineConfigCache::victim_entries() const {
+    return victim_cnt;
+}
+
+std::uint32_t MachineConfigCache::write_buffer_entries() const {
+    return wb_entries;
+}
+
+MachineConfigCache::WriteBufferDrain MachineConfigCache::write_buffer_drain() const {
+    return wb_drain;
+}
+
 bool MachineConfigCache::operator==(const MachineConfigCache &c) const {
 #define CMP(GETTER) (GETTER)() == (c.GETTER)()
     return CMP(enabled) && \
@@ -293,7 +421,14 @@ bool MachineConfigCache::operator==(const MachineConfigCache &c) const {
             CMP(associativity) && \
             CMP(replacement_policy) && \
             CMP(write_policy) && \
-            CMP(write_alloc);
+            CMP(write_alloc) && \
+            CMP(prefetcher) && \
+            CMP(prefetch_degree) && \
+            CMP(prefetch_distance) && \
+            CMP(inclusion) && \
+            CMP(victim_entries) && \
+            CMP(write_buffer_entries) && \
+            CMP(write_buffer_drain);
 #undef CMP
 }
 
@@ -301,25 +436,42 @@ bool MachineConfigCache::operator!=(const MachineConfigCache &c) const {
     return !operator==(c);
 }
 
-MachineConfig::MachineConfig() : pipeline(DF_PIPELINE), dhunit(DF_DHUNIT), chunit(DF_CHUNIT), bp_bits(DF_BP_BITS),
-                                 b_res_id(DF_B_RES_ID), exec_protect(DF_EXEC_PROTEC), write_protect(DF_WRITE_PROTEC),
+MachineConfig::MachineConfig() : pipeline(DF_PIPELINE), dual_timing(DF_DUAL_ISSUE_TIMING), dhunit(DF_DHUNIT), chunit(DF_CHUNIT), bp_bits(DF_BP_BITS),
+                                 btb_size_bits(DF_BTB_BITS), btb_ways(DF_BTB_WAYS), btb_replc(DF_BTB_REPLC),
+                                 ras_size(DF_RAS_DEPTH), b_res_id(DF_B_RES_ID),
+                                 mdu_multicycle(DF_MDU_MODEL), mdu_mul_lat(DF_MDU_MUL_LATENCY), mdu_mul_ii(DF_MDU_MUL_INTERVAL),
+                                 mdu_div_lat(DF_MDU_DIV_LATENCY), mdu_div_ii(DF_MDU_DIV_INTERVAL), exec_protect(DF_EXEC_PROTEC), write_protect(DF_WRITE_PROTEC),
                                  osem_enable(true), osem_known_syscall_stop(true), osem_unknown_syscall_stop(true),
                                  osem_interrupt_stop(true), osem_exception_stop(true), osem_fs_root(""),
                                  res_at_compile(true), elf_path(DF_ELF), trace_path(DF_TRACE), dram_access_read(DF_DRAM_ACC_READ),
                                  dram_access_write(DF_DRAM_ACC_WRITE), dram_access_burst(DF_DRAM_ACC_BURST),
+                                 dram_banked(DF_DRAM_MODEL), dram_bank_cnt(DF_DRAM_BANKS), dram_row_size(DF_DRAM_ROW_BYTES),
+                                 dram_trcd(DF_DRAM_T_RCD), dram_tcas(DF_DRAM_T_CAS), dram_trp(DF_DRAM_T_RP),
+                                 dram_page_pol(DF_DRAM_PAGE_POL),
                                  l1_program(MemoryAccess::MemoryType::L1_PROGRAM_CACHE), l1_data(MemoryAccess::MemoryType::L1_DATA_CACHE),
-                                 l2_unified(MemoryAccess::MemoryType::L2_UNIFIED_CACHE) {}
+                                 l2_unified(MemoryAccess::MemoryType::L2_UNIFIED_CACHE) {
+    set_lower_cache_count(DF_LOWER_CACHES);
+}
 
 MachineConfig::MachineConfig(const MachineConfig& cc) noexcept :
-                                            pipeline(cc.pipelined()), dhunit(cc.data_hazard_unit()), chunit(cc.control_hazard_unit()),
-                                            bp_bits(cc.bht_bits()), b_res_id(cc.branch_res_id()), exec_protect(cc.memory_execute_protection()),
+                                            pipeline(cc.pipelined()), dual_timing(cc.dual_issue_timing()), dhunit(cc.data_hazard_unit()), chunit(cc.control_hazard_unit()),
+                                            bp_bits(cc.bht_bits()), btb_size_bits(cc.btb_bits()),
+                                            btb_ways(cc.btb_associativity()), btb_replc(cc.btb_replacement_policy()),
+                                            ras_size(cc.ras_depth()), b_res_id(cc.branch_res_id()),
+                                            mdu_multicycle(cc.mdu_model()), mdu_mul_lat(cc.mdu_mul_latency()),
+                                            mdu_mul_ii(cc.mdu_mul_interval()), mdu_div_lat(cc.mdu_div_latency()),
+                                            mdu_div_ii(cc.mdu_div_interval()), exec_protect(cc.memory_execute_protection()),
                                             write_protect(cc.memory_write_protection()), osem_enable(cc.osemu_enable()),
                                             osem_known_syscall_stop(cc.osemu_known_syscall_stop()), osem_unknown_syscall_stop(cc.osemu_unknown_syscall_stop()),
                                             osem_interrupt_stop(cc.osemu_interrupt_stop()), osem_exception_stop(cc.osemu_exception_stop()),
                                             osem_fs_root(cc.osemu_fs_root()), res_at_compile(cc.reset_at_compile()), elf_path(cc.elf()), trace_path(cc.trace()),
                                             dram_access_read(cc.ram_access_read()), dram_access_write(cc.ram_access_write()),
-                                            dram_access_burst(cc.ram_access_burst()), l1_program(cc.l1_program_cache()),
-                                            l1_data(cc.l1_data_cache()), l2_unified(cc.l2_unified_cache()) {}
+                                            dram_access_burst(cc.ram_access_burst()), dram_banked(cc.dram_model()),
+                                            dram_bank_cnt(cc.dram_banks()), dram_row_size(cc.dram_row_bytes()),
+                                            dram_trcd(cc.dram_t_rcd()), dram_tcas(cc.dram_t_cas()), dram_trp(cc.dram_t_rp()),
+                                            dram_page_pol(cc.dram_page_policy()), l1_program(cc.l1_program_cache()),
+                                            l1_data(cc.l1_data_cache()), l2_unified(cc.l2_unified_cache()),
+                                            lower(cc.lower) {}
 
 #define N(STR) (prefix + QString(STR))
 
@@ -328,10 +480,20 @@ MachineConfig::MachineConfig(const QSettings *sts, const QString &prefix) :
                                 l1_data(MemoryAccess::MemoryType::L1_DATA_CACHE, sts, N("L1DataCache_")),
                                 l2_unified(MemoryAccess::MemoryType::L2_UNIFIED_CACHE, sts, N("L2UnifiedCache_")) {
     pipeline = sts->value(N("Pipelined"), DF_PIPELINE).toBool();
+    dual_timing = sts->value(N("DualIssueTiming"), DF_DUAL_ISSUE_TIMING).toBool();
     dhunit = (DataHazardUnit)sts->value(N("DataHazardUnit"), DF_DHUNIT).toUInt();
     chunit = (ControlHazardUnit)sts->value(N("ControlHazardUnit"), DF_CHUNIT).toUInt();
     bp_bits = sts->value(N("BPbits"), DF_BP_BITS).toInt();
+    btb_size_bits = sts->value(N("BTBbits"), DF_BTB_BITS).toInt();
+    btb_ways = sts->value(N("BTBAssociativity"), DF_BTB_WAYS).toUInt();
+    btb_replc = (MachineConfigCache::ReplacementPolicy)sts->value(N("BTBReplacement"), DF_BTB_REPLC).toUInt();
+    ras_size = sts->value(N("RASDepth"), DF_RAS_DEPTH).toUInt();
     b_res_id = sts->value(N("BResId"), DF_B_RES_ID).toBool();
+    mdu_multicycle = sts->value(N("MDUModel"), DF_MDU_MODEL).toBool();
+    mdu_mul_lat = sts->value(N("MDUMulLatency"), DF_MDU_MUL_LATENCY).toUInt();
+    mdu_mul_ii = sts->value(N("MDUMulInterval"), DF_MDU_MUL_INTERVAL).toUInt();
+    mdu_div_lat = sts->value(N("MDUDivLatency"), DF_MDU_DIV_LATENCY).toUInt();
+    mdu_div_ii = sts->value(N("MDUDivInterval"), DF_MDU_DIV_INTERVAL).toUInt();
     exec_protect = sts->value(N("MemoryExecuteProtection"), DF_EXEC_PROTEC).toBool();
     write_protect = sts->value(N("MemoryWriteProtection"), DF_WRITE_PROTEC).toBool();
     osem_enable = sts->value(N("OsemuEnable"), true).toBool();
@@ -346,14 +508,37 @@ MachineConfig::MachineConfig(const QSettings *sts, const QString &prefix) :
     dram_access_read = sts->value(N("DRAMAccessRead"), DF_DRAM_ACC_READ).toUInt();
     dram_access_write = sts->value(N("DRAMAccessWrite"), DF_DRAM_ACC_WRITE).toUInt();
     dram_access_burst = sts->value(N("DRAMAccessBurst"), DF_DRAM_ACC_BURST).toUInt();
+    dram_banked = sts->value(N("DRAMModel"), DF_DRAM_MODEL).toBool();
+    dram_bank_cnt = sts->value(N("DRAMBanks"), DF_DRAM_BANKS).toUInt();
+    dram_row_size = sts->value(N("DRAMRowBytes"), DF_DRAM_ROW_BYTES).toUInt();
+    dram_trcd = sts->value(N("DRAMtRCD"), DF_DRAM_T_RCD).toUInt();
+    dram_tcas = sts->value(N("DRAMtCAS"), DF_DRAM_T_CAS).toUInt();
+    dram_trp = sts->value(N("DRAMtRP"), DF_DRAM_T_RP).toUInt();
+    dram_page_pol = (DramPagePolicy)sts->value(N("DRAMPagePolicy"), DF_DRAM_PAGE_POL).toUInt();
+    // Deeper hierarchy stored by hand is cut to supported levels
+    unsigned lower_cnt = std::min<unsigned>(sts->value(N("LowerCaches"), DF_LOWER_CACHES).toUInt(),
+                                            CycleStatistics::LOWER_CACHE_LEVELS);
+    for (unsigned i = 0; i < lower_cnt; i++)
+        lower.append(MachineConfigCache(MemoryAccess::MemoryType::LOWER_CACHE, sts,
+                                        N(QString("L%1UnifiedCache_").arg(i + 3))));
 }
 
 void MachineConfig::store(QSettings *sts, const QString &prefix) {
     sts->setValue(N("Pipelined"), pipelined());
+    sts->setValue(N("DualIssueTiming"), dual_issue_timing());
     sts->setValue(N("DataHazardUnit"), (unsigned)data_hazard_unit());
     sts->setValue(N("ControlHazardUnit"), (unsigned)control_hazard_unit());
     sts->setValue(N("BPbits"), bht_bits());
+    sts->setValue(N("BTBbits"), btb_bits());
+    sts->setValue(N("BTBAssociativity"), btb_associativity());
+    sts->setValue(N("BTBReplacement"), (unsigned)btb_replacement_policy());
+    sts->setValue(N("RASDepth"), ras_depth());
     sts->setValue(N("BResId"), branch_res_id());
+    sts->setValue(N("MDUModel"), mdu_model());
+    sts->setValue(N("MDUMulLatency"), mdu_mul_latency());
+    sts->setValue(N("MDUMulInterval"), mdu_mul_interval());
+    sts->setValue(N("MDUDivLatency"), mdu_div_latency());
+    sts->setValue(N("MDUDivInterval"), mdu_div_interval());
     sts->setValue(N("OsemuEnable"), osemu_enable());
     sts->setValue(N("OsemuKnownSyscallStop"), osemu_known_syscall_stop());
     sts->setValue(N("OsemuUnknownSyscallStop"), osemu_unknown_syscall_stop());
@@ -366,9 +551,19 @@ void MachineConfig::store(QSettings *sts, const QString &prefix) {
     sts->setValue(N("DRAMAccessRead"), ram_access_read());
     sts->setValue(N("DRAMAccessWrite"), ram_access_write());
     sts->setValue(N("DRAMAccessBurst"), ram_access_burst());
+    sts->setValue(N("DRAMModel"), dram_model());
+    sts->setValue(N("DRAMBanks"), dram_banks());
+    sts->setValue(N("DRAMRowBytes"), dram_row_bytes());
+    sts->setValue(N("DRAMtRCD"), dram_t_rcd());
+    sts->setValue(N("DRAMtCAS"), dram_t_cas());
+    sts->setValue(N("DRAMtRP"), dram_t_rp());
+    sts->setValue(N("DRAMPagePolicy"), (unsigned)dram_page_policy());
     l1_data.store(sts, N("L1DataCache_"));
     l1_program.store(sts, N("L1ProgramCache_"));
     l2_unified.store(sts, N("L2UnifiedCache_"));
+    sts->setValue(N("LowerCaches"), lower_cache_count());
+    for (int i = 0; i < lower.size(); i++)
+        lower[i].store(sts, N(QString("L%1UnifiedCache_").arg(i + 3)));
 }
 
 #undef N
@@ -377,6 +572,7 @@ void MachineConfig::preset(enum ConfigPresets p) {
     // Note: we set just a minimal subset to get preset (preserving as much of hidden configuration as possible)
     set_control_hazard_unit(ControlHazardUnit::CHU_DELAY_SLOT);
     set_bht_bits(-1);
+    set_dual_issue_timing(false);
 
     switch (p) {
         case ConfigPresets::CP_SINGLE:
@@ -400,12 +596,21 @@ void MachineConfig::preset(enum ConfigPresets p) {
     access_l1_data_cache()->preset(p);
     access_l1_program_cache()->preset(p);
     access_l2_unified_cache()->preset(p);
+    for (MachineConfigCache &lc : lower) {
+        lc.preset(p);
+        // Presets describe two level hierarchy
+        lc.set_enabled(false);
+    }
 }
 
 void MachineConfig::set_pipelined(bool v) {
     pipeline = v;
 }
 
+void MachineConfig::set_dual_issue_timing(bool v) {
+    dual_timing = v;
+}
+
 void MachineConfig::set_data_hazard_unit(enum MachineConfig::DataHazardUnit dhu)  {
     dhunit = dhu;
 }
@@ -433,10 +638,46 @@ void MachineConfig::set_bht_bits(int8_t b) {
     bp_bits = b;
 }
 
+void MachineConfig::set_btb_bits(int8_t b) {
+    btb_size_bits = b;
+}
+
+void MachineConfig::set_btb_associativity(unsigned a) {
+    btb_ways = a;
+}
+
+void MachineConfig::set_btb_replacement_policy(MachineConfigCache::ReplacementPolicy rp) {
+    btb_replc = rp;
+}
+
+void MachineConfig::set_ras_depth(unsigned d) {
+    ras_size = d;
+}
+
 void MachineConfig::set_branch_res_id(bool bri) {
     b_res_id = bri;
 }
 
+void MachineConfig::set_mdu_model(bool m) {
+    mdu_multicycle = m;
+}
+
+void MachineConfig::set_mdu_mul_latency(std::uint32_t l) {
+    mdu_mul_lat = l;
+}
+
+void MachineConfig::set_mdu_mul_interval(std::uint32_t ii) {
+    mdu_mul_ii = ii;
+}
+
+void MachineConfig::set_mdu_div_latency(std::uint32_t l) {
+    mdu_div_lat = l;
+}
+
+void MachineConfig::set_mdu_div_interval(std::uint32_t ii) {
+    mdu_div_ii = ii;
+}
+
 void MachineConfig::set_memory_execute_protection(bool ep) {
     exec_protect = ep;
 }
@@ -494,6 +735,34 @@ void MachineConfig::set_ram_access_burst(std::uint32_t dab) {
     dram_access_burst = dab;
 }
 
+void MachineConfig::set_dram_model(bool v) {
+    dram_banked = v;
+}
+
+void MachineConfig::set_dram_banks(unsigned b) {
+    dram_bank_cnt = b;
+}
+
+void MachineConfig::set_dram_row_bytes(std::uint32_t rb) {
+    dram_row_size = rb;
+}
+
+void MachineConfig::set_dram_t_rcd(std::uint32_t t) {
+    dram_trcd = t;
+}
+
+void MachineConfig::set_dram_t_cas(std::uint32_t t) {
+    dram_tcas = t;
+}
+
+void MachineConfig::set_dram_t_rp(std::uint32_t t) {
+    dram_trp = t;
+}
+
+void MachineConfig::set_dram_page_policy(enum DramPagePolicy pp) {
+    dram_page_pol = pp;
+}
+
 void MachineConfig::set_l1_data_cache(const MachineConfigCache& l1_d) {
     l1_data = l1_d;
 }
@@ -506,23 +775,79 @@ void MachineConfig::set_l2_unified_cache(const MachineConfigCache& l2) {
     l2_unified = l2;
 }
 
+void MachineConfig::set_lower_cache_count(unsigned count) {
+    if (count > CycleStatistics::LOWER_CACHE_LEVELS)
+        throw QTMIPS_EXCEPTION(Input, "Too many cache levels below L2",
+                               QString("%1 (at most %2)").arg(count).arg(CycleStatistics::LOWER_CACHE_LEVELS));
+    while ((unsigned)lower.size() > count)
+        lower.removeLast();
+    while ((unsigned)lower.size() < count)
+        lower.append(MachineConfigCache(MemoryAccess::MemoryType::LOWER_CACHE));
+}
+
+void MachineConfig::set_lower_cache(unsigned idx, const MachineConfigCache &lc) {
+    SANITY_ASSERT(idx < lower_cache_count(), "Lower cache index out of range");
+    lower[idx] = lc;
+}
+
 bool MachineConfig::pipelined() const {
     return pipeline;
 }
 
+bool MachineConfig::dual_issue_timing() const {
+    return dual_timing;
+}
+
 // Returns true if predictor is enabled.
 bool MachineConfig::predictor() const {
-    return chunit == CHU_ONE_BIT_BP || chunit == CHU_TWO_BIT_BP;
+    return chunit == CHU_ONE_BIT_BP || chunit == CHU_TWO_BIT_BP || chunit == CHU_GSHARE_BP ||
+           chunit == CHU_TOURNAMENT_BP || chunit == CHU_TAGE_BP;
 }
 
 int8_t MachineConfig::bht_bits() const {
     return bp_bits;
 }
 
+int8_t MachineConfig::btb_bits() const {
+    return btb_size_bits;
+}
+
+unsigned MachineConfig::btb_associativity() const {
+    return btb_ways;
+}
+
+enum MachineConfigCache::ReplacementPolicy MachineConfig::btb_replacement_policy() const {
+    return btb_replc;
+}
+
+unsigned MachineConfig::ras_depth() const {
+    return ras_size;
+}
+
 bool MachineConfig::branch_res_id() const {
     return b_res_id;
 }
 
+bool MachineConfig::mdu_model() const {
+    return mdu_multicycle;
+}
+
+std::uint32_t MachineConfig::mdu_mul_latency() const {
+    return mdu_mul_lat;
+}
+
+std::uint32_t MachineConfig::mdu_mul_interval() const {
+    return mdu_mul_ii;
+}
+
+std::uint32_t MachineConfig::mdu_div_latency() const {
+    return mdu_div_lat;
+}
+
+std::uint32_t MachineConfig::mdu_div_interval() const {
+    return mdu_div_ii;
+}
+
 enum MachineConfig::DataHazardUnit MachineConfig::data_hazard_unit() const {
     // Hazard unit is always off when there is no pipeline
     return pipeline ? dhunit : machine::MachineConfig::DHU_NONE;
@@ -586,6 +911,34 @@ std::uint32_t MachineConfig::ram_access_burst() const {
     return dram_access_burst;
 }
 
+bool MachineConfig::dram_model() const {
+    return dram_banked;
+}
+
+unsigned MachineConfig::dram_banks() const {
+    return dram_bank_cnt;
+}
+
+std::uint32_t MachineConfig::dram_row_bytes() const {
+    return dram_row_size;
+}
+
+std::uint32_t MachineConfig::dram_t_rcd() const {
+    return dram_trcd;
+}
+
+std::uint32_t MachineConfig::dram_t_cas() const {
+    return dram_tcas;
+}
+
+std::uint32_t MachineConfig::dram_t_rp() const {
+    return dram_trp;
+}
+
+enum MachineConfig::DramPagePolicy MachineConfig::dram_page_policy() const {
+    return dram_page_pol;
+}
+
 const MachineConfigCache &MachineConfig::l1_data_cache() const {
     return l1_data;
 }
@@ -610,18 +963,50 @@ MachineConfigCache *MachineConfig::access_l2_unified_cache() {
     return &l2_unified;
 }
 
+unsigned MachineConfig::lower_cache_count() const {
+    return lower.size();
+}
+
+const MachineConfigCache &MachineConfig::lower_cache(unsigned idx) const {
+    SANITY_ASSERT(idx < lower_cache_count(), "Lower cache index out of range");
+    return lower[idx];
+}
+
+MachineConfigCache *MachineConfig::access_lower_cache(unsigned idx) {
+    SANITY_ASSERT(idx < lower_cache_count(), "Lower cache index out of range");
+    return &lower[idx];
+}
+
 bool MachineConfig::operator==(const MachineConfig &c) const {
 #define CMP(GETTER) (GETTER)() == (c.GETTER)()
     return CMP(pipelined) && \
+            CMP(dual_issue_timing) && \
             CMP(data_hazard_unit) && \
             CMP(control_hazard_unit) && \
             CMP(bht_bits) && \
+            CMP(btb_bits) && \
+            CMP(btb_associativity) && \
+            CMP(btb_replacement_policy) && \
+            CMP(ras_depth) && \
+            CMP(mdu_model) && \
+            CMP(mdu_mul_latency) && \
+            CMP(mdu_mul_interval) && \
+            CMP(mdu_div_latency) && \
+            CMP(mdu_div_interval) && \
             CMP(memory_execute_protection) && \
             CMP(memory_write_protection) && \
             CMP(elf) && \
+            CMP(dram_model) && \
+            CMP(dram_banks) && \
+            CMP(dram_row_bytes) && \
+            CMP(dram_t_rcd) && \
+            CMP(dram_t_cas) && \
+            CMP(dram_t_rp) && \
+            CMP(dram_page_policy) && \
             CMP(l1_data_cache) && \
             CMP(l1_program_cache) && \
-            CMP(l2_unified_cache);
+            CMP(l2_unified_cache) && \
+            lower == c.lower;
 #undef CMP
 }
 
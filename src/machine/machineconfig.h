@@ -37,6 +37,7 @@
 #define MACHINECONFIG_H
 
 #include <QString>
+#include <QList>
 #include <QSettings>
 #include "memory.h"
 
@@ -70,6 +71,26 @@ public:
         WP_BACK
     };
 
+    enum PrefetcherType {
+        PF_NONE,
+        PF_NEXT_LINE, // Lines following the missed one
+        PF_STRIDE, // Constant stride of load/store instruction
+        PF_STREAM // Sequential misses in either direction
+    };
+
+    // Relation of lines held by cache to lines of caches above it
+    enum InclusionPolicy {
+        IP_NINE, // Neither inclusive nor exclusive
+        IP_INCLUSIVE, // Evicted lines are invalidated in upper levels
+        IP_EXCLUSIVE // Line moves to upper level on fill and back on its eviction
+    };
+
+    // When write buffer of write through cache passes stores to lower level
+    enum WriteBufferDrain {
+        WB_DRAIN_EAGER, // Whenever lower level is free
+        WB_DRAIN_FULL // Only when buffer is full, stores wait longer for combining
+    };
+
 //    enum class WritePolicy {
 //        WP_THROUGH_NOALLOC, // Write through - no allocate
 //        WP_THROUGH_ALLOC, // Write through - allocate
@@ -89,6 +110,13 @@ public:
     void set_write_policy(WritePolicy wp);
     void set_write_alloc(bool wa);
     void set_type(MemoryAccess::MemoryType ct);
+    void set_prefetcher(PrefetcherType pf);
+    void set_prefetch_degree(std::uint32_t d); // Lines requested at once
+    void set_prefetch_distance(std::uint32_t d); // Lines ahead of access
+    void set_inclusion(InclusionPolicy ip);
+    void set_victim_entries(std::uint32_t v); // Lines of victim cache, zero for none
+    void set_write_buffer_entries(std::uint32_t e); // Lines of write buffer, zero for none
+    void set_write_buffer_drain(WriteBufferDrain d);
 
     bool enabled() const;
     std::uint32_t mem_access_read() const;
@@ -101,6 +129,13 @@ public:
     WritePolicy write_policy() const;
     bool write_alloc() const;
     MemoryAccess::MemoryType type() const;
+    PrefetcherType prefetcher() const;
+    std::uint32_t prefetch_degree() const;
+    std::uint32_t prefetch_distance() const;
+    InclusionPolicy inclusion() const;
+    std::uint32_t victim_entries() const;
+    std::uint32_t write_buffer_entries() const;
+    WriteBufferDrain write_buffer_drain() const;
 
     bool operator ==(const MachineConfigCache &c) const;
     bool operator !=(const MachineConfigCache &c) const;
@@ -113,6 +148,12 @@ private:
     WritePolicy write_pol;
     bool write_allocate;
     MemoryAccess::MemoryType cache_type;
+    PrefetcherType pf_type;
+    std::uint32_t pf_degree, pf_distance;
+    InclusionPolicy incl_pol;
+    std::uint32_t victim_cnt;
+    std::uint32_t wb_entries;
+    WriteBufferDrain wb_drain;
 };
 
 class MachineConfig {
@@ -136,12 +177,24 @@ public:
         CHU_STALL,
         CHU_DELAY_SLOT,
         CHU_ONE_BIT_BP,
-        CHU_TWO_BIT_BP
+        CHU_TWO_BIT_BP,
+        CHU_GSHARE_BP,
+        CHU_TOURNAMENT_BP,
+        CHU_TAGE_BP
+    };
+
+    enum DramPagePolicy {
+        DRAM_OPEN_PAGE, // Row stays open in row buffer until other row of the bank is accessed
+        DRAM_CLOSED_PAGE // Bank is precharged after every access
     };
 
     // Configure if CPU is pipelined
     // In default disabled.
     void set_pipelined(bool);
+    // Single cycle core accounts time as if it issued up to two instructions
+    // per cycle (timing model only, it is not a pipeline).
+    // In default disabled, ignored for pipelined CPU.
+    void set_dual_issue_timing(bool);
     // Hazard unit
     void set_data_hazard_unit(DataHazardUnit);
     bool set_data_hazard_unit(QString);
@@ -149,8 +202,22 @@ public:
     void set_control_hazard_unit(ControlHazardUnit);
     // Branch history table lookup bits
     void set_bht_bits(std::int8_t);
+    // Branch target buffer has 2^bits entries, negative value follows BHT bits
+    void set_btb_bits(std::int8_t);
+    void set_btb_associativity(unsigned);
+    void set_btb_replacement_policy(MachineConfigCache::ReplacementPolicy);
+    // Return address stack entries, zero disables the stack
+    void set_ras_depth(unsigned);
     // Wether or not branch resolution is done on ID.
     void set_branch_res_id(bool);
+    // Multiply/divide unit takes several cycles, HI/LO accesses wait for its result.
+    // In default disabled, result is available to the next instruction.
+    void set_mdu_model(bool);
+    // Cycles to the result and cycles before unit accepts next operation
+    void set_mdu_mul_latency(std::uint32_t);
+    void set_mdu_mul_interval(std::uint32_t);
+    void set_mdu_div_latency(std::uint32_t);
+    void set_mdu_div_interval(std::uint32_t);
     // Protect data memory from execution. Only program sections can be executed.
     void set_memory_execute_protection(bool);
     // Protect program memory from accidental writes.
@@ -172,17 +239,41 @@ public:
     void set_ram_access_read(std::uint32_t);
     void set_ram_access_write(std::uint32_t);
     void set_ram_access_burst(std::uint32_t);
+    // Banked DRAM model with row buffers, replaces fixed DRAM access times when enabled.
+    void set_dram_model(bool);
+    void set_dram_banks(unsigned);
+    void set_dram_row_bytes(std::uint32_t);
+    // Activate, column access and precharge latencies in core cycles
+    void set_dram_t_rcd(std::uint32_t);
+    void set_dram_t_cas(std::uint32_t);
+    void set_dram_t_rp(std::uint32_t);
+    void set_dram_page_policy(enum DramPagePolicy);
     // Configure cache
     void set_l1_data_cache(const MachineConfigCache&);
     void set_l1_program_cache(const MachineConfigCache&);
     void set_l2_unified_cache(const MachineConfigCache&);
+    // Levels below L2, index zero is L3. New levels are added disabled.
+    // Throws Input exception for more than CycleStatistics::LOWER_CACHE_LEVELS
+    // levels, each level has its own stall counter.
+    void set_lower_cache_count(unsigned);
+    void set_lower_cache(unsigned idx, const MachineConfigCache&);
 
     bool pipelined() const;
+    bool dual_issue_timing() const;
     bool predictor() const;
     enum DataHazardUnit data_hazard_unit() const;
     enum ControlHazardUnit control_hazard_unit() const;
     std::int8_t bht_bits() const;
+    std::int8_t btb_bits() const;
+    unsigned btb_associativity() const;
+    enum MachineConfigCache::ReplacementPolicy btb_replacement_policy() const;
+    unsigned ras_depth() const;
     bool branch_res_id() const;
+    bool mdu_model() const;
+    std::uint32_t mdu_mul_latency() const;
+    std::uint32_t mdu_mul_interval() const;
+    std::uint32_t mdu_div_latency() const;
+    std::uint32_t mdu_div_interval() const;
     bool memory_execute_protection() const;
     bool memory_write_protection() const;
     bool osemu_enable() const;
@@ -197,6 +288,13 @@ public:
     std::uint32_t ram_access_read() const;
     std::uint32_t ram_access_write() const;
     std::uint32_t ram_access_burst() const;
+    bool dram_model() const;
+    unsigned dram_banks() const;
+    std::uint32_t dram_row_bytes() const;
+    std::uint32_t dram_t_rcd() const;
+    std::uint32_t dram_t_cas() const;
+    std::uint32_t dram_t_rp() const;
+    enum DramPagePolicy dram_page_policy() const;
 
     const MachineConfigCache &l1_data_cache() const;
     const MachineConfigCache &l1_program_cache() const;
@@ -204,16 +302,26 @@ public:
     MachineConfigCache *access_l1_data_cache();
     MachineConfigCache *access_l1_program_cache();
     MachineConfigCache *access_l2_unified_cache();
+    unsigned lower_cache_count() const;
+    const MachineConfigCache &lower_cache(unsigned idx) const;
+    MachineConfigCache *access_lower_cache(unsigned idx);
 
     bool operator ==(const MachineConfig&) const;
     bool operator !=(const MachineConfig&) const;
 
 private:
     bool pipeline;
+    bool dual_timing;
     DataHazardUnit dhunit;
     ControlHazardUnit chunit;
     std::uint8_t bp_bits;
+    std::int8_t btb_size_bits;
+    unsigned btb_ways;
+    enum MachineConfigCache::ReplacementPolicy btb_replc;
+    unsigned ras_size;
     bool b_res_id;
+    bool mdu_multicycle;
+    std::uint32_t mdu_mul_lat, mdu_mul_ii, mdu_div_lat, mdu_div_ii;
     bool exec_protect, write_protect;
     bool osem_enable, osem_known_syscall_stop, osem_unknown_syscall_stop;
     bool osem_interrupt_stop, osem_exception_stop;
@@ -221,10 +329,17 @@ private:
     bool res_at_compile;
     QString elf_path, trace_path;
     std::uint32_t dram_access_read, dram_access_write, dram_access_burst;
+    bool dram_banked;
+    unsigned dram_bank_cnt;
+    std::uint32_t dram_row_size;
+    std::uint32_t dram_trcd, dram_tcas, dram_trp;
+    enum DramPagePolicy dram_page_pol;
     // L1 cache is split to data/program cache.
     MachineConfigCache l1_program, l1_data;
     // L2 cache is unified.
     MachineConfigCache l2_unified;
+    // Unified caches of level three and below, all shared by both L1 caches.
+    QList<MachineConfigCache> lower;
 };
 
 }
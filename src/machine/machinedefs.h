@@ -140,6 +140,7 @@ enum LocationStatus {
     LOCSTAT_DIRTY     = 1 << 1,
     LOCSTAT_READ_ONLY = 1 << 2,
     LOCSTAT_ILLEGAL   = 1 << 3,
+    LOCSTAT_READ_EFFECT = 1 << 4, // Reading changes state of device
 };
 
 const std::uint32_t STAGEADDR_NONE = 0xffffffff;
@@ -140,15 +140,15 @@ MemoryAccess::MemoryType MemoryAccess::type() const {
     return MemoryType::DRAM;
 }
 
-uint32_t MemoryAccess::get_access_cycles() const {
+std::uint64_t MemoryAccess::get_access_cycles() const {
     return access_read * reads + access_write * writes;
 }
 
-uint32_t MemoryAccess::get_reads() const {
+std::uint64_t MemoryAccess::get_reads() const {
     return reads;
 }
 
-uint32_t MemoryAccess::get_writes() const {
+std::uint64_t MemoryAccess::get_writes() const {
     return writes;
 }
 
@@ -156,6 +156,10 @@ void MemoryAccess::set_update_stats(bool us) {
     update_stats = us;
 }
 
+void MemoryAccess::set_access_pc(std::uint32_t pc) {
+    access_pc = pc;
+}
+
 uint32_t MemoryAccess::get_access_read() const {
     return access_read;
 }
@@ -168,6 +172,15 @@ uint32_t MemoryAccess::get_access_burst() const {
     return access_burst;
 }
 
+bool MemoryAccess::last_access_cycles(std::uint32_t &cycles) const {
+    (void)cycles;
+    return false;
+}
+
+bool MemoryAccess::get_changes_since(std::uint32_t change_counter, QVector<WriteLog::Range> &ranges) const {
+    return write_log.ranges_since(change_counter, ranges);
+}
+
 bool MemoryAccess::get_update_stats() const {
     return update_stats;
 }
@@ -256,10 +269,14 @@ bool MemorySection::operator!=(const MemorySection &ms) const {
 
 Memory::Memory() {
     this->mt_root = allocate_section_tree();
+    change_counter = 0;
+    write_counter = 0;
 }
 
 Memory::Memory(uint32_t access_read, uint32_t access_write, uint32_t access_burst) : MemoryAccess(access_read, access_write, access_burst) {
     this->mt_root = allocate_section_tree();
+    change_counter = 0;
+    write_counter = 0;
 }
 
 Memory::Memory(const Memory &m) : MemoryAccess(m.access_read, m.access_write, m.access_burst) {
@@ -277,11 +294,15 @@ void Memory::reset() {
     free_section_tree(this->mt_root, 0);
     delete[] this->mt_root;
     this->mt_root = allocate_section_tree();
+    change_counter++;
+    write_log.invalidate(change_counter);
 }
 
 void Memory::reset(const Memory &m) {
     free_section_tree(this->mt_root, 0);
     this->mt_root = copy_section_tree(m.get_memorytree_root(), 0);
+    change_counter++;
+    write_log.invalidate(change_counter);
 }
 
 MemorySection *Memory::get_section(std::uint32_t address, bool create) const {
@@ -313,8 +334,10 @@ bool Memory::wword(std::uint32_t address, std::uint32_t value) {
     changed = section->write_word(SECTION_OFFSET_MASK(address), value);
     writes++;
     write_counter++;
-    if (changed)
+    if (changed) {
         change_counter++;
+        write_log.record(address & ~3, address | 3, change_counter);
+    }
     return changed;
 }
 
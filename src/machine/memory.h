@@ -40,6 +40,7 @@
 #include <cstdint>
 #include <qtmipsexception.h>
 #include "machinedefs.h"
+#include "writelog.h"
 
 namespace machine {
 
@@ -54,7 +55,8 @@ public:
         L1_PROGRAM_CACHE = 0,
         L1_DATA_CACHE = 1,
         L2_UNIFIED_CACHE = 2,
-        DRAM
+        DRAM,
+        LOWER_CACHE // Unified cache of level three and below
     };
 
     // Note: hword and word methods are throwing away lowest bits so unaligned access is ignored without error.
@@ -73,12 +75,19 @@ public:
     virtual enum LocationStatus location_status(std::uint32_t offset) const;
     virtual MemoryType type() const;
     virtual std::uint32_t get_change_counter() const = 0;
+    // Memory with own timing model stores cycles taken by its last counted
+    // access and returns true, fixed access times apply otherwise
+    virtual bool last_access_cycles(std::uint32_t &cycles) const;
+    // Ranges written since given value of change counter, false if not known
+    bool get_changes_since(std::uint32_t change_counter, QVector<WriteLog::Range> &ranges) const;
 
     void set_update_stats(bool);
+    // Address of instruction which issues following accesses, used by prefetchers
+    void set_access_pc(std::uint32_t pc);
 
-    uint32_t get_access_cycles() const;
-    uint32_t get_reads() const;
-    uint32_t get_writes() const;
+    std::uint64_t get_access_cycles() const;
+    std::uint64_t get_reads() const;
+    std::uint64_t get_writes() const;
     uint32_t get_access_read() const;
     uint32_t get_access_write() const;
     uint32_t get_access_burst() const;
@@ -89,9 +98,11 @@ signals:
 
 protected:
     uint32_t access_read, access_write, access_burst;
-    mutable uint32_t reads, writes;
+    mutable std::uint64_t reads, writes;
     // this allows us to count lower memory accesses/stalls only once and not for each word in the block.
     bool update_stats;
+    std::uint32_t access_pc = 0;
+    mutable WriteLog write_log;
     virtual bool wword(std::uint32_t offset, std::uint32_t value) = 0;
     virtual std::uint32_t rword(std::uint32_t offset, bool debug_access = false) const = 0;
 
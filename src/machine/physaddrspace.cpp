@@ -39,6 +39,7 @@ using namespace machine;
 
 PhysAddrSpace::PhysAddrSpace(uint32_t access_read, uint32_t access_write, uint32_t access_burst) : MemoryAccess(access_read, access_write, access_burst) {
     change_counter = 0;
+    last_access = nullptr;
 }
 
 PhysAddrSpace::~PhysAddrSpace() {
@@ -60,9 +61,13 @@ bool PhysAddrSpace::wword(std::uint32_t address, std::uint32_t value) {
     if (p_range == nullptr)
         return false;
     writes++;
+    last_access = p_range->mem_acces;
+    p_range->mem_acces->set_update_stats(update_stats);
     changed = p_range->mem_acces->write_word(address - p_range->start_addr, value);
-    if (changed)
+    if (changed) {
         change_counter++;
+        write_log.record(address & ~3, address | 3, change_counter);
+    }
     return changed;
 }
 
@@ -71,6 +76,10 @@ uint32_t PhysAddrSpace::rword(std::uint32_t address, bool debug_access) const {
     if (p_range == nullptr)
         return 0x00000000;
     reads++;
+    if (!debug_access) {
+        last_access = p_range->mem_acces;
+        p_range->mem_acces->set_update_stats(update_stats);
+    }
     return p_range->mem_acces->read_word(address - p_range->start_addr, debug_access);
 }
 
@@ -78,6 +87,12 @@ uint32_t PhysAddrSpace::get_change_counter() const {
     return change_counter;
 }
 
+bool PhysAddrSpace::last_access_cycles(std::uint32_t &cycles) const {
+    if (last_access == nullptr)
+        return false;
+    return last_access->last_access_cycles(cycles);
+}
+
 enum LocationStatus PhysAddrSpace::location_status(std::uint32_t address) const {
     const RangeDesc *p_range = find_range(address);
     if (p_range == nullptr)
@@ -115,6 +130,8 @@ bool PhysAddrSpace::remove_range(MemoryAccess *mem_acces) {
     if (p_range == nullptr)
         return false;
     ranges_by_addr.remove(p_range->last_addr);
+    if (last_access == p_range->mem_acces)
+        last_access = nullptr;
     if (p_range->owned)
         delete p_range->mem_acces;
     delete p_range;
@@ -141,6 +158,9 @@ void PhysAddrSpace::range_external_change(const MemoryAccess *mem_access, std::u
     while (i != ranges_by_access.end() && i.key() == mem_access) {
         RangeDesc *p_range = i.value();
         ++i;
+        if (external)
+            write_log.record(start_addr + p_range->start_addr,
+                             last_addr + p_range->start_addr, change_counter);
         emit external_change_notify(this, start_addr + p_range->start_addr,
                                     last_addr + p_range->start_addr, external);
     }
@@ -54,6 +54,7 @@ public:
     bool wword(uint32_t address, uint32_t value) override;
     std::uint32_t rword(uint32_t address, bool debug_access = false) const override;
     virtual std::uint32_t get_change_counter() const override;
+    bool last_access_cycles(std::uint32_t &cycles) const override;
 
     bool insert_range(MemoryAccess *mem_acces, uint32_t start_addr, uint32_t last_addr, bool move_ownership);
     bool remove_range(MemoryAccess *mem_acces);
@@ -75,6 +76,7 @@ private:
     QMultiMap<MemoryAccess *, RangeDesc *> ranges_by_access;
     RangeDesc *find_range(std::uint32_t address) const;
     mutable std::uint32_t change_counter;
+    mutable const MemoryAccess *last_access; // Range which served last access
 };
 
 }
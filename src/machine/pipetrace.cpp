@@ -0,0 +1,121 @@
+#include "pipetrace.h"
+#include "qtmipsexception.h"
+
+using namespace machine;
+
+#define BUFFER_FLUSH_SIZE (64 * 1024)
+
+PipeTrace::PipeTrace(const QString &path, std::uint64_t ticks_per_cycle) : file(path) {
+    SANITY_ASSERT(ticks_per_cycle > 0, "Pipeline trace needs positive ticks per cycle");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+        throw QTMIPS_EXCEPTION(Input, "Can't open pipeline trace file for writing", path);
+    ticks = ticks_per_cycle;
+    last_id = 0;
+    pending_valid = false;
+    buffer.reserve(BUFFER_FLUSH_SIZE + 1024);
+}
+
+PipeTrace::~PipeTrace() {
+    if (pending_valid)
+        write(pending);
+    for (int i = 0; i < in_flight.size(); i++)
+        write(in_flight[i]);
+    flush();
+}
+
+std::uint64_t PipeTrace::fetch(std::uint64_t cycle, std::uint32_t inst_addr, const Instruction &inst) {
+    if (pending_valid) {
+        pending_valid = false;
+        if (pending.inst_addr == inst_addr) {
+            pending.inst = inst;
+            in_flight.append(pending);
+            return pending.id;
+        }
+        write(pending);
+    }
+    Record r;
+    r.id = ++last_id;
+    r.inst_addr = inst_addr;
+    r.inst = inst;
+    for (int s = 0; s < STAGE_CNT; s++)
+        r.cycles[s] = 0;
+    r.cycles[STAGE_FETCH] = cycle;
+    in_flight.append(r);
+    return r.id;
+}
+
+void PipeTrace::stage(std::uint64_t id, Stage stage, std::uint64_t cycle) {
+    int i = find(id);
+    if (i < 0 || in_flight[i].cycles[stage] != 0)
+        return;
+    in_flight[i].cycles[stage] = cycle;
+}
+
+void PipeTrace::retire(std::uint64_t id, std::uint64_t cycle) {
+    int i = find(id);
+    if (i < 0)
+        return;
+    in_flight[i].cycles[STAGE_WRITEBACK] = cycle;
+    write(in_flight[i]);
+    in_flight.remove(i);
+}
+
+void PipeTrace::end_cycle(const std::uint64_t *ids, unsigned count) {
+    for (int i = in_flight.size(); i-- > 0;) {
+        bool live = false;
+        for (unsigned j = 0; j < count; j++)
+            live = live || ids[j] == in_flight[i].id;
+        if (live)
+            continue;
+        const Record &r = in_flight[i];
+        if (r.cycles[STAGE_DECODE] == 0) {
+            // Fetch did not leave IF, it is restarted after program memory stall
+            if (pending_valid)
+                write(pending);
+            pending = r;
+            pending_valid = true;
+        } else {
+            write(r);
+        }
+        in_flight.remove(i);
+    }
+}
+
+void PipeTrace::flush() {
+    if (buffer.isEmpty())
+        return;
+    file.write(buffer);
+    file.flush();
+    buffer.clear();
+}
+
+int PipeTrace::find(std::uint64_t id) const {
+    // Only a few instructions are in flight, newest are at the end
+    for (int i = in_flight.size(); i-- > 0;) {
+        if (in_flight[i].id == id)
+            return i;
+    }
+    return -1;
+}
+
+void PipeTrace::write(const Record &r) {
+    std::uint64_t t[STAGE_CNT];
+    for (int s = 0; s < STAGE_CNT; s++)
+        t[s] = r.cycles[s] * ticks;
+    // Retire tick marks completed instruction, flushed ones keep it zero
+    bool store = r.cycles[STAGE_WRITEBACK] != 0 && r.inst.flags() & IMF_MEMWRITE;
+
+    QString rec = QString("O3PipeView:fetch:%1:0x%2:0:%3:%4\n")
+            .arg(t[STAGE_FETCH]).arg(r.inst_addr, 8, 16, QChar('0')).arg(r.id)
+            .arg(r.inst.to_str(r.inst_addr));
+    rec += QString("O3PipeView:decode:%1\n").arg(t[STAGE_DECODE]);
+    rec += QString("O3PipeView:rename:%1\n").arg(t[STAGE_DECODE]);
+    rec += QString("O3PipeView:dispatch:%1\n").arg(t[STAGE_DECODE]);
+    rec += QString("O3PipeView:issue:%1\n").arg(t[STAGE_EXECUTE]);
+    rec += QString("O3PipeView:complete:%1\n").arg(t[STAGE_MEMORY]);
+    rec += QString("O3PipeView:retire:%1:store:%2\n").arg(t[STAGE_WRITEBACK])
+            .arg(store ? t[STAGE_MEMORY] : 0);
+    buffer.append(rec.toLatin1());
+    if (buffer.size() >= BUFFER_FLUSH_SIZE)
+        flush();
+}
@@ -0,0 +1,63 @@
+#ifndef PIPETRACE_H
+#define PIPETRACE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <cstdint>
+#include "instruction.h"
+
+namespace machine {
+
+// Stage timing of instructions in gem5 O3PipeView text format, which is read
+// by Konata and o3-pipeview.py. Record of every instruction is written once
+// it retires or is flushed. Five stage pipeline maps to the format as IF to
+// fetch, ID to decode/rename/dispatch, EX to issue, MEM to complete and WB to
+// retire. Flushed instructions have zero retire tick.
+class PipeTrace {
+public:
+    enum Stage {
+        STAGE_FETCH,
+        STAGE_DECODE,
+        STAGE_EXECUTE,
+        STAGE_MEMORY,
+        STAGE_WRITEBACK,
+        STAGE_CNT
+    };
+
+    PipeTrace(const QString &path, std::uint64_t ticks_per_cycle = 1000); // Throws Input exception on failure
+    ~PipeTrace(); // Instructions still in flight are written as flushed
+
+    // Instruction entered fetch stage, returns its sequence number (never zero)
+    std::uint64_t fetch(std::uint64_t cycle, std::uint32_t inst_addr, const Instruction &inst);
+    void stage(std::uint64_t id, Stage stage, std::uint64_t cycle); // Only first entry is recorded
+    void retire(std::uint64_t id, std::uint64_t cycle);
+    // Instructions in flight which are not in any of given stages were flushed
+    void end_cycle(const std::uint64_t *ids, unsigned count);
+    void flush(); // Write buffered records to the file
+
+private:
+    struct Record {
+        std::uint64_t id;
+        std::uint32_t inst_addr;
+        Instruction inst;
+        std::uint64_t cycles[STAGE_CNT]; // Zero for stages not reached
+    };
+
+    int find(std::uint64_t id) const;
+    void write(const Record &r);
+
+    QFile file;
+    QByteArray buffer;
+    std::uint64_t ticks;
+    std::uint64_t last_id;
+    QVector<Record> in_flight;
+    // Fetch discarded while waiting for program memory, continued when the same address is fetched
+    bool pending_valid;
+    Record pending;
+};
+
+}
+
+#endif // PIPETRACE_H
@@ -0,0 +1,180 @@
+#include "prefetcher.h"
+#include "qtmipsexception.h"
+
+#include <algorithm>
+
+using namespace machine;
+
+Prefetcher::Prefetcher(unsigned degree, unsigned distance, unsigned line_bytes) {
+    SANITY_ASSERT(degree > 0 && distance > 0, "Prefetch degree and distance have to be positive");
+    this->pf_degree = degree;
+    this->pf_distance = distance;
+    this->line_bytes = line_bytes;
+}
+
+Prefetcher::~Prefetcher() {
+}
+
+Prefetcher *Prefetcher::create(const MachineConfigCache &cc) {
+    unsigned line_bytes = cc.blocks() * 4;
+    // Zero read from damaged settings behaves as one
+    unsigned degree = std::max(cc.prefetch_degree(), 1U);
+    unsigned distance = std::max(cc.prefetch_distance(), 1U);
+
+    if (!cc.enabled())
+        return nullptr;
+    switch (cc.prefetcher()) {
+        case MachineConfigCache::PF_NEXT_LINE:
+            return new NextLinePrefetcher(degree, distance, line_bytes);
+        case MachineConfigCache::PF_STRIDE:
+            return new StridePrefetcher(degree, distance, line_bytes);
+        case MachineConfigCache::PF_STREAM:
+            return new StreamPrefetcher(degree, distance, line_bytes);
+        case MachineConfigCache::PF_NONE:
+        default:
+            return nullptr;
+    }
+}
+
+void Prefetcher::reset() {
+}
+
+unsigned Prefetcher::degree() const {
+    return pf_degree;
+}
+
+unsigned Prefetcher::distance() const {
+    return pf_distance;
+}
+
+std::uint32_t Prefetcher::line_base(std::uint32_t address) const {
+    return address - address % line_bytes;
+}
+
+NextLinePrefetcher::NextLinePrefetcher(unsigned degree, unsigned distance, unsigned line_bytes) :
+                                       Prefetcher(degree, distance, line_bytes) {
+}
+
+void NextLinePrefetcher::access(std::uint32_t pc, std::uint32_t address, bool trigger,
+                                QVector<std::uint32_t> &candidates) {
+    (void)pc;
+    if (!trigger)
+        return;
+    for (unsigned i = 0; i < pf_degree; i++)
+        candidates.append(line_base(address) + (pf_distance + i) * line_bytes);
+}
+
+StridePrefetcher::StridePrefetcher(unsigned degree, unsigned distance, unsigned line_bytes) :
+                                   Prefetcher(degree, distance, line_bytes), table(STRIDE_ENTRIES) {
+    reset();
+}
+
+void StridePrefetcher::access(std::uint32_t pc, std::uint32_t address, bool trigger,
+                              QVector<std::uint32_t> &candidates) {
+    Entry &e = table[(pc >> 2) % STRIDE_ENTRIES];
+    std::int32_t stride, step;
+    (void)trigger;
+
+    if (!e.valid || e.pc != pc) {
+        e.valid = true;
+        e.pc = pc;
+        e.last_address = address;
+        e.stride = 0;
+        e.confidence = 0;
+        return;
+    }
+
+    stride = (std::int32_t)(address - e.last_address);
+    e.last_address = address;
+    if (stride != 0 && stride == e.stride) {
+        if (e.confidence < STRIDE_CONFIDENCE_MAX)
+            e.confidence++;
+    } else if (e.confidence > 0) {
+        e.confidence--;
+    } else {
+        e.stride = stride;
+    }
+    if (e.confidence < STRIDE_CONFIDENT)
+        return;
+
+    // Strides shorter than line would request the line being accessed
+    step = e.stride;
+    if (step > 0 && step < (std::int32_t)line_bytes)
+        step = line_bytes;
+    else if (step < 0 && -step < (std::int32_t)line_bytes)
+        step = -(std::int32_t)line_bytes;
+    for (unsigned i = 0; i < pf_degree; i++)
+        candidates.append(line_base(address + step * (std::int32_t)(pf_distance + i)));
+}
+
+void StridePrefetcher::reset() {
+    for (Entry &e : table) {
+        e.valid = false;
+        e.pc = 0;
+        e.last_address = 0;
+        e.stride = 0;
+        e.confidence = 0;
+    }
+}
+
+StreamPrefetcher::StreamPrefetcher(unsigned degree, unsigned distance, unsigned line_bytes) :
+                                   Prefetcher(degree, distance, line_bytes), streams(STREAMS) {
+    reset();
+}
+
+void StreamPrefetcher::access(std::uint32_t pc, std::uint32_t address, bool trigger,
+                              QVector<std::uint32_t> &candidates) {
+    std::uint32_t line = address / line_bytes;
+    Stream *s = nullptr;
+    Stream *victim = &streams[0];
+    (void)pc;
+
+    if (!trigger)
+        return;
+    use_clock++;
+
+    for (Stream &st : streams) {
+        std::int64_t delta = (std::int64_t)line - st.last_line;
+        if (st.valid && delta != 0 && delta <= STREAM_WINDOW && delta >= -STREAM_WINDOW &&
+                (st.direction == 0 || (delta > 0) == (st.direction > 0))) {
+            s = &st;
+            break;
+        }
+        if (!st.valid || (victim->valid && st.last_use < victim->last_use))
+            victim = &st;
+    }
+
+    if (s == nullptr) {
+        victim->valid = true;
+        victim->last_line = line;
+        victim->direction = 0;
+        victim->confidence = 0;
+        victim->last_use = use_clock;
+        return;
+    }
+
+    s->direction = line > s->last_line ? 1 : -1;
+    s->confidence++;
+    s->last_line = line;
+    s->last_use = use_clock;
+    if (s->confidence + 1 < STREAM_CONFIRMED)
+        return;
+
+    for (unsigned i = 0; i < pf_degree; i++) {
+        std::int64_t target = (std::int64_t)line + s->direction * (std::int64_t)(pf_distance + i);
+        if (target < 0 || target > (std::int64_t)(0xffffffff / line_bytes))
+            break;
+        candidates.append((std::uint32_t)target * line_bytes);
+    }
+}
+
+void StreamPrefetcher::reset() {
+    for (Stream &st : streams) {
+        st.valid = false;
+        st.last_line = 0;
+        st.direction = 0;
+        st.confidence = 0;
+        st.last_use = 0;
+    }
+    use_clock = 0;
+}
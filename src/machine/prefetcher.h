@@ -0,0 +1,104 @@
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <QVector>
+#include <cstdint>
+#include "machineconfig.h"
+
+namespace machine {
+
+// Hardware prefetcher attached to one cache level. It observes demand accesses
+// of the level and proposes line aligned addresses to be filled ahead of use.
+// Degree is the number of lines requested at once, distance is how many lines
+// (or strides) ahead of the current access the first of them is.
+class Prefetcher {
+public:
+    Prefetcher(unsigned degree, unsigned distance, unsigned line_bytes);
+    virtual ~Prefetcher();
+
+    // Null for PF_NONE or disabled cache
+    static Prefetcher *create(const MachineConfigCache &cc);
+
+    // Demand access of instruction at pc, trigger is set on a miss and on the
+    // first use of a prefetched line. Addresses to prefetch are appended to candidates.
+    virtual void access(std::uint32_t pc, std::uint32_t address, bool trigger,
+                        QVector<std::uint32_t> &candidates) = 0;
+    virtual void reset();
+
+    unsigned degree() const;
+    unsigned distance() const;
+
+protected:
+    std::uint32_t line_base(std::uint32_t address) const;
+
+    unsigned pf_degree, pf_distance;
+    unsigned line_bytes;
+};
+
+// Requests lines following the one which missed
+class NextLinePrefetcher : public Prefetcher {
+public:
+    NextLinePrefetcher(unsigned degree, unsigned distance, unsigned line_bytes);
+
+    void access(std::uint32_t pc, std::uint32_t address, bool trigger,
+                QVector<std::uint32_t> &candidates) override;
+};
+
+// Reference prediction table indexed by PC of load/store. Prefetches once the
+// same stride was seen repeatedly by one instruction.
+class StridePrefetcher : public Prefetcher {
+public:
+    enum {
+        STRIDE_ENTRIES = 64,
+        STRIDE_CONFIDENT = 2,
+        STRIDE_CONFIDENCE_MAX = 3
+    };
+
+    StridePrefetcher(unsigned degree, unsigned distance, unsigned line_bytes);
+
+    void access(std::uint32_t pc, std::uint32_t address, bool trigger,
+                QVector<std::uint32_t> &candidates) override;
+    void reset() override;
+
+private:
+    struct Entry {
+        bool valid;
+        std::uint32_t pc;
+        std::uint32_t last_address;
+        std::int32_t stride;
+        unsigned confidence;
+    };
+    QVector<Entry> table;
+};
+
+// Detects sequences of misses to neighbouring lines regardless of PC and runs
+// ahead of them in the detected direction.
+class StreamPrefetcher : public Prefetcher {
+public:
+    enum {
+        STREAMS = 4,
+        STREAM_WINDOW = 4, // Lines from last access which still belong to stream
+        STREAM_CONFIRMED = 2 // Accesses in one direction before prefetching starts
+    };
+
+    StreamPrefetcher(unsigned degree, unsigned distance, unsigned line_bytes);
+
+    void access(std::uint32_t pc, std::uint32_t address, bool trigger,
+                QVector<std::uint32_t> &candidates) override;
+    void reset() override;
+
+private:
+    struct Stream {
+        bool valid;
+        std::uint32_t last_line;
+        int direction; // 0 until second access
+        unsigned confidence; // Moves in direction
+        std::uint64_t last_use;
+    };
+    QVector<Stream> streams;
+    std::uint64_t use_clock;
+};
+
+}
+
+#endif // PREFETCHER_H
@@ -34,7 +34,10 @@
  ******************************************************************************/
 
 #include <QTime>
+#include <QFile>
+#include <utility>
 #include "branchpredictor.h"
+#include "branchtargetbuffer.h"
 #include "qtmipsmachine.h"
 #include "programloader.h"
 
@@ -44,12 +47,20 @@ CycleStatistics cycle_stats;
 
 QtMipsMachine::QtMipsMachine(const MachineConfig &cc, bool load_symtab, bool load_executable) :
                              QObject(), mcnf(cc) {
-    MemoryAccess *cpu_mem, *core_mem_data, *core_mem_program;
-    std::uint32_t min_cache_row_size;
-
     stat = ST_READY;
     symtab = nullptr;
-
+    coalesce = true;
+    cr_standby = nullptr;
+    warm_bp = true;
+    idle_skip = true;
+    hle = nullptr;
+    cpi = nullptr;
+    cpi_event = 0;
+    cpi_next_cycle = 0;
+    pipe_trace = nullptr;
+    switch_when = SWITCH_NONE;
+
+    events = new EventScheduler();
     regs = new Registers();
     if (load_executable) {
         ProgramLoader program(cc.elf());
@@ -68,10 +79,17 @@ QtMipsMachine::QtMipsMachine(const MachineConfig &cc, bool load_symtab, bool loa
     }
 
     physaddrspace = new PhysAddrSpace(cc.ram_access_read(), cc.ram_access_write(), cc.ram_access_burst());
-    physaddrspace->insert_range(mem, 0x00000000, 0xefffffff, false);
+    if (cc.dram_model()) {
+        dram = new DramController(mem, cc);
+        physaddrspace->insert_range(dram, 0x00000000, 0xefffffff, true);
+    } else {
+        dram = nullptr;
+        physaddrspace->insert_range(mem, 0x00000000, 0xefffffff, false);
+    }
     cpu_mem = physaddrspace;
 
     ser_port = new SerialPort();
+    ser_port->set_event_scheduler(events);
     addressapce_insert_range(ser_port, 0xffffc000, 0xffffc03f, true);
     addressapce_insert_range(ser_port, 0xffff0000, 0xffff003f, false);
     connect(ser_port, SIGNAL(signal_interrupt(uint,bool)),
@@ -83,29 +101,54 @@ QtMipsMachine::QtMipsMachine(const MachineConfig &cc, bool load_symtab, bool loa
     perip_lcd_display = new LcdDisplay();
     addressapce_insert_range(perip_lcd_display, 0xffe00000, 0xffe4afff, true);
 
-    l2_unified = new Cache(cc.l2_unified_cache(), cpu_mem, cc.l2_unified_cache().mem_access_read(),
+    // Hierarchy is built from the bottom. Every cache goes to the next enabled
+    // level below it and its penalties are access times of that level.
+    MemoryAccess *below = cpu_mem;
+    Cache *below_cache = nullptr;
+    std::uint32_t below_read = cc.ram_access_read();
+    std::uint32_t below_write = cc.ram_access_write();
+    std::uint32_t below_burst = cc.ram_access_burst();
+
+    lower_caches.resize(cc.lower_cache_count());
+    for (unsigned i = cc.lower_cache_count(); i-- > 0; ) {
+        const MachineConfigCache &lc = cc.lower_cache(i);
+        lower_caches[i] = new Cache(lc, below, lc.mem_access_read(), lc.mem_access_write(), lc.mem_access_burst(),
+                                    below_read, below_write, below_burst);
+        lower_caches[i]->set_level(i + 3);
+        if (!lc.enabled())
+            continue;
+        if (below_cache != nullptr)
+            below_cache->add_upper(lower_caches[i]);
+        below = below_cache = lower_caches[i];
+        below_read = lc.mem_access_read();
+        below_write = lc.mem_access_write();
+        below_burst = lc.mem_access_burst();
+    }
+
+    l2_unified = new Cache(cc.l2_unified_cache(), below, cc.l2_unified_cache().mem_access_read(),
                            cc.l2_unified_cache().mem_access_write(), cc.l2_unified_cache().mem_access_burst(),
-                           cc.ram_access_read(), cc.ram_access_write(), cc.ram_access_burst());
+                           below_read, below_write, below_burst);
     if (cc.l2_unified_cache().enabled()) {
         SANITY_ASSERT(cc.l1_data_cache().enabled() || cc.l1_program_cache().enabled(), "L2 cache is enabled but none of L1 caches are enabled!");
+        if (below_cache != nullptr)
+            below_cache->add_upper(l2_unified);
+        below = below_cache = l2_unified;
+        below_read = cc.l2_unified_cache().mem_access_read();
+        below_write = cc.l2_unified_cache().mem_access_write();
+        below_burst = cc.l2_unified_cache().mem_access_burst();
     }
 
-    if (cc.l2_unified_cache().enabled()) {
-        l1_program = new Cache(cc.l1_program_cache(), l2_unified, cc.l1_program_cache().mem_access_read(),
-                               cc.l1_program_cache().mem_access_write(), cc.l1_program_cache().mem_access_burst(),
-                               cc.l2_unified_cache().mem_access_read(), cc.l2_unified_cache().mem_access_write(),
-                               cc.l2_unified_cache().mem_access_burst());
-        l1_data = new Cache(cc.l1_data_cache(), l2_unified, cc.l1_data_cache().mem_access_read(),
-                            cc.l1_data_cache().mem_access_write(), cc.l1_data_cache().mem_access_burst(),
-                            cc.l2_unified_cache().mem_access_read(), cc.l2_unified_cache().mem_access_write(),
-                            cc.l2_unified_cache().mem_access_burst());
-    } else {
-        l1_program = new Cache(cc.l1_program_cache(), cpu_mem, cc.l1_program_cache().mem_access_read(),
-                               cc.l1_program_cache().mem_access_write(), cc.l1_program_cache().mem_access_burst(),
-                               cc.ram_access_read(), cc.ram_access_write(), cc.ram_access_burst());
-        l1_data = new Cache(cc.l1_data_cache(), cpu_mem, cc.l1_data_cache().mem_access_read(),
-                            cc.l1_data_cache().mem_access_write(), cc.l1_data_cache().mem_access_burst(),
-                            cc.ram_access_read(), cc.ram_access_write(), cc.ram_access_burst());
+    l1_program = new Cache(cc.l1_program_cache(), below, cc.l1_program_cache().mem_access_read(),
+                           cc.l1_program_cache().mem_access_write(), cc.l1_program_cache().mem_access_burst(),
+                           below_read, below_write, below_burst);
+    l1_data = new Cache(cc.l1_data_cache(), below, cc.l1_data_cache().mem_access_read(),
+                        cc.l1_data_cache().mem_access_write(), cc.l1_data_cache().mem_access_burst(),
+                        below_read, below_write, below_burst);
+    if (below_cache != nullptr) {
+        if (cc.l1_program_cache().enabled())
+            below_cache->add_upper(l1_program);
+        if (cc.l1_data_cache().enabled())
+            below_cache->add_upper(l1_data);
     }
 
     core_mem_program = cc.l1_program_cache().enabled() ? l1_program : cpu_mem;
@@ -119,22 +162,19 @@ QtMipsMachine::QtMipsMachine(const MachineConfig &cc, bool load_symtab, bool loa
         min_cache_row_size = cc.l1_program_cache().blocks() * 4;
 
     cop0st = new Cop0State();
-
-    if (cc.pipelined()) {
-        // Control hazard unit cannot be none if we are in pipeline mode.
-        SANITY_ASSERT(cc.control_hazard_unit() != MachineConfig::CHU_NONE, "Invalid configuration for control branch unit.");
-        cr = new CorePipelined(regs, core_mem_program, core_mem_data, cpu_mem, cc.l1_data_cache().enabled(),
-                               cc.l1_program_cache().enabled(), cc.trace(), cc.data_hazard_unit(),
-                               cc.control_hazard_unit(), cc.bht_bits(), cc.branch_res_id(),
-                               min_cache_row_size, cop0st);
-    }
-    else {
-        SANITY_ASSERT(cc.control_hazard_unit() == MachineConfig::CHU_NONE
-                        || cc.control_hazard_unit() == MachineConfig::CHU_DELAY_SLOT, "Invalid configuration for control branch unit.");
-        cr = new CoreSingle(regs, core_mem_program, core_mem_data,
-                            cc.control_hazard_unit() == machine::MachineConfig::CHU_DELAY_SLOT,
-                            cc.trace(), min_cache_row_size, cop0st);
-    }
+    cop0st->set_perf_source(Cop0State::PERF_L1_PROGRAM_MISSES, [this]() { return l1_program->miss(); });
+    cop0st->set_perf_source(Cop0State::PERF_L1_DATA_MISSES, [this]() { return l1_data->miss(); });
+    cop0st->set_perf_source(Cop0State::PERF_L2_UNIFIED_MISSES, [this]() { return l2_unified->miss(); });
+    cop0st->set_perf_source(Cop0State::PERF_BRANCH_MISPREDICTS, [this]() -> std::uint64_t {
+        BranchPredictor *pred = bp();
+        return pred != nullptr ? pred->mispredictions() : 0;
+    });
+
+    // Cores only append to trace
+    QFile::resize(cc.trace() + "/program.trace", 0);
+    cr = create_core(cc.pipelined());
+    cr_pipelined = cc.pipelined();
+    cop0st->set_event_scheduler(events);
 
     connect(this, SIGNAL(set_interrupt_signal(uint,bool)),
             cop0st, SLOT(set_interrupt_signal(uint,bool)));
@@ -157,15 +197,22 @@ QtMipsMachine::QtMipsMachine(const MachineConfig &cc, bool load_symtab, bool loa
 QtMipsMachine::~QtMipsMachine() {
     delete run_t;
     delete cr;
+    delete cr_standby;
+    delete hle;
+    delete cpi;
+    delete pipe_trace;
     delete cop0st;
     delete regs;
     delete mem;
     delete l1_program;
     delete l1_data;
     delete l2_unified;
+    for (Cache *c : lower_caches)
+        delete c;
     delete physaddrspace;
     delete mem_program_only;
     delete symtab;
+    delete events;
 }
 
 const MachineConfig &QtMipsMachine::config() const {
@@ -177,6 +224,14 @@ void QtMipsMachine::set_speed(unsigned int ips, unsigned int time_chunk) {
     run_t->setInterval(ips);
 }
 
+void QtMipsMachine::set_coalesce_updates(bool value) {
+    coalesce = value;
+}
+
+bool QtMipsMachine::coalesce_updates() const {
+    return coalesce;
+}
+
 const Registers *QtMipsMachine::registers() {
     return regs;
 }
@@ -213,6 +268,18 @@ Cache *QtMipsMachine::l2_unified_cache_rw() const {
     return l2_unified;
 }
 
+unsigned QtMipsMachine::lower_cache_count() const {
+    return lower_caches.size();
+}
+
+const Cache *QtMipsMachine::lower_cache(unsigned idx) const {
+    return idx < (unsigned)lower_caches.size() ? lower_caches[idx] : nullptr;
+}
+
+const DramController *QtMipsMachine::dram_controller() const {
+    return dram;
+}
+
 void QtMipsMachine::mem_sync() {
     if (l1_program != nullptr)
         l1_program->sync();
@@ -220,6 +287,8 @@ void QtMipsMachine::mem_sync() {
         l1_data->sync();
     if (l2_unified != nullptr)
         l2_unified->sync();
+    for (Cache *c : lower_caches)
+        c->sync();
 }
 
 const PhysAddrSpace *QtMipsMachine::physical_address_space() {
@@ -264,12 +333,216 @@ const Core *QtMipsMachine::core() {
     return cr;
 }
 
+Core *QtMipsMachine::core_rw() {
+    return cr;
+}
+
 const CoreSingle *QtMipsMachine::core_singe() {
-    return mcnf.pipelined() ? nullptr : (const CoreSingle*)cr;
+    return cr_pipelined ? nullptr : (const CoreSingle*)cr;
 }
 
 const CorePipelined *QtMipsMachine::core_pipelined() {
-    return mcnf.pipelined() ? (const CorePipelined*)cr : nullptr;
+    return cr_pipelined ? (const CorePipelined*)cr : nullptr;
+}
+
+bool QtMipsMachine::core_is_pipelined() const {
+    return cr_pipelined;
+}
+
+Core *QtMipsMachine::create_core(bool pipelined) {
+    const MachineConfig &cc = mcnf;
+    MachineConfig::ControlHazardUnit chunit = cc.control_hazard_unit();
+    Core *core;
+
+    // Core of other kind than configured one has to keep delay slot semantics
+    if (pipelined != cc.pipelined()) {
+        if (chunit != MachineConfig::CHU_DELAY_SLOT)
+            chunit = pipelined ? MachineConfig::CHU_STALL : MachineConfig::CHU_NONE;
+    }
+
+    if (pipelined) {
+        // Control hazard unit cannot be none if we are in pipeline mode.
+        SANITY_ASSERT(chunit != MachineConfig::CHU_NONE, "Invalid configuration for control branch unit.");
+        CorePipelined *pipe = new CorePipelined(regs, core_mem_program, core_mem_data, cpu_mem,
+                                                cc.l1_data_cache().enabled(), cc.l1_program_cache().enabled(),
+                                                cc.trace(), cc.data_hazard_unit(),
+                                                chunit, cc.bht_bits(), cc.branch_res_id(),
+                                                min_cache_row_size, cop0st);
+        pipe->set_pipe_trace(pipe_trace);
+        pipe->set_mdu_timing(cc.mdu_model(), cc.mdu_mul_latency(), cc.mdu_mul_interval(),
+                             cc.mdu_div_latency(), cc.mdu_div_interval());
+        core = pipe;
+        if (core->predictor() != nullptr) {
+            core->predictor()->set_btb(cc.btb_bits() < 0 ? cc.bht_bits() : cc.btb_bits(),
+                                       cc.btb_associativity(), cc.btb_replacement_policy());
+            core->predictor()->set_ras_depth(cc.ras_depth());
+        }
+    } else {
+        SANITY_ASSERT(chunit == MachineConfig::CHU_NONE
+                        || chunit == MachineConfig::CHU_DELAY_SLOT, "Invalid configuration for control branch unit.");
+        CoreSingle *single;
+        // Core used only to fast forward pipelined one stays single cycle
+        if (cc.dual_issue_timing() && !cc.pipelined())
+            single = new CoreDualTiming(regs, core_mem_program, core_mem_data,
+                                        chunit == machine::MachineConfig::CHU_DELAY_SLOT,
+                                        cc.trace(), min_cache_row_size, cop0st);
+        else
+            single = new CoreSingle(regs, core_mem_program, core_mem_data,
+                                    chunit == machine::MachineConfig::CHU_DELAY_SLOT,
+                                    cc.trace(), min_cache_row_size, cop0st);
+        single->set_hle_library(hle);
+        core = single;
+    }
+    core->set_event_scheduler(events);
+    core->set_idle_loop_skip(idle_skip);
+    return core;
+}
+
+void QtMipsMachine::switch_core(bool pipelined) {
+    if (pipelined == cr_pipelined)
+        return;
+    if (cr_standby == nullptr)
+        cr_standby = create_core(pipelined);
+
+    Core *next = cr_standby;
+    Core::ResumePoint rp = cr->drain();
+    next->take_over(cr);
+    next->resume(rp);
+    if (!pipelined)
+        ((CoreSingle *)next)->set_warm_predictor(warm_bp ? cr->predictor() : nullptr);
+    next->blockSignals(cr->signalsBlocked());
+    cr->blockSignals(false);
+    cr_standby = cr;
+    cr = next;
+    cr_pipelined = pipelined;
+    emit core_switched(pipelined);
+}
+
+void QtMipsMachine::schedule_core_switch(bool pipelined, std::uint32_t address) {
+    switch_when = SWITCH_AT_ADDR;
+    switch_to_pipelined = pipelined;
+    switch_addr = address;
+}
+
+bool QtMipsMachine::schedule_core_switch(bool pipelined, const QString &symbol) {
+    std::uint32_t address;
+    if (symtab == nullptr || !symtab->name_to_value(address, symbol))
+        return false;
+    schedule_core_switch(pipelined, address);
+    return true;
+}
+
+void QtMipsMachine::schedule_core_switch_at_cycle(bool pipelined, std::uint64_t cycle) {
+    switch_when = SWITCH_AT_CYCLE;
+    switch_to_pipelined = pipelined;
+    switch_cycle = cycle;
+}
+
+void QtMipsMachine::cancel_core_switch() {
+    switch_when = SWITCH_NONE;
+}
+
+std::uint64_t QtMipsMachine::run_cycle_limit() const {
+    // Switch scheduled for given cycle has to happen exactly at it
+    if (switch_when == SWITCH_AT_CYCLE)
+        return switch_cycle > cr->get_cycles() ? switch_cycle - cr->get_cycles() : 0;
+    return UINT64_MAX;
+}
+
+void QtMipsMachine::check_core_switch() {
+    switch (switch_when) {
+    case SWITCH_NONE:
+        return;
+    case SWITCH_AT_ADDR:
+        if (regs->read_pc() != switch_addr)
+            return;
+        break;
+    case SWITCH_AT_CYCLE:
+        if (cr->get_cycles() < switch_cycle)
+            return;
+        break;
+    }
+    switch_when = SWITCH_NONE;
+    switch_core(switch_to_pipelined);
+}
+
+void QtMipsMachine::set_warm_predictor(bool value) {
+    warm_bp = value;
+    if (!cr_pipelined)
+        ((CoreSingle *)cr)->set_warm_predictor(warm_bp && cr_standby != nullptr ?
+                                               cr_standby->predictor() : nullptr);
+}
+
+void QtMipsMachine::set_idle_loop_skip(bool value) {
+    idle_skip = value;
+    cr->set_idle_loop_skip(value);
+    if (cr_standby != nullptr)
+        cr_standby->set_idle_loop_skip(value);
+}
+
+unsigned QtMipsMachine::set_hle(bool value) {
+    unsigned found = 0;
+    HleLibrary *old = hle;
+
+    hle = nullptr;
+    if (value && symtab != nullptr) {
+        hle = new HleLibrary();
+        found = hle->add_symbols(symtab);
+    }
+    if (!cr_pipelined)
+        ((CoreSingle *)cr)->set_hle_library(hle);
+    else if (cr_standby != nullptr)
+        ((CoreSingle *)cr_standby)->set_hle_library(hle);
+    delete old;
+    return found;
+}
+
+HleLibrary *QtMipsMachine::hle_library() {
+    return hle;
+}
+
+void QtMipsMachine::set_cpi_stack(std::uint64_t interval, unsigned capacity) {
+    events->cancel(cpi_event);
+    cpi_event = 0;
+    delete cpi;
+    cpi = nullptr;
+    if (interval == 0)
+        return;
+    cpi = new CpiStack(interval, capacity);
+    cpi->clear(cycle_stats);
+    cpi_next_cycle = cr->get_cycles();
+    schedule_cpi_sample();
+}
+
+const CpiStack *QtMipsMachine::cpi_stack() const {
+    return cpi;
+}
+
+void QtMipsMachine::set_pipe_trace(const QString &path) {
+    PipeTrace *old = pipe_trace;
+
+    pipe_trace = path.isEmpty() ? nullptr : new PipeTrace(path);
+    if (cr_pipelined)
+        ((CorePipelined *)cr)->set_pipe_trace(pipe_trace);
+    else if (cr_standby != nullptr)
+        ((CorePipelined *)cr_standby)->set_pipe_trace(pipe_trace);
+    delete old;
+}
+
+// Sample is taken on the first fetch at or after interval boundary, interval
+// which ends late (e.g. by emulated call) is not followed by empty ones
+void QtMipsMachine::schedule_cpi_sample() {
+    do {
+        cpi_next_cycle += cpi->interval();
+    } while (cpi_next_cycle <= cr->get_cycles());
+    cpi_event = events->schedule(cpi_next_cycle, [this]() {
+        cpi->sample(cycle_stats);
+        schedule_cpi_sample();
+    });
+}
+
+bool QtMipsMachine::program_end_reached() const {
+    return regs->read_pc() >= program_end;
 }
 
 bool QtMipsMachine::executable_loaded() const {
@@ -310,13 +583,48 @@ void QtMipsMachine::step_internal(bool skip_break) {
     emit tick();
     try {
         QTime start_time = QTime::currentTime();
-        do {
-            cr->step(skip_break);
-            // Update cycles for cache misses in every step
+        if (coalesce && time_chunk != 0 && skip_break == false) {
+            // Views are refreshed once per chunk. Only the last step
+            // of the chunk is run with view signals enabled.
+            Core::StopReason reason = Core::STOP_NONE;
+            int time_left;
+            block_view_signals(true);
+            while (stat == ST_BUSY && reason != Core::STOP_PROGRAM_END &&
+                   (time_left = time_chunk - start_time.msecsTo(QTime::currentTime())) > 0) {
+                unsigned stop_mask = Core::STOP_BREAK | Core::STOP_EXCEPTION |
+                                     Core::STOP_PROGRAM_END | Core::STOP_TIME;
+                if (switch_when == SWITCH_AT_ADDR) {
+                    cr->set_stop_address(switch_addr);
+                    stop_mask |= Core::STOP_ADDRESS;
+                }
+                cr->set_program_end(program_end);
+                cr->set_run_time_limit(time_left);
+                reason = cr->run(run_cycle_limit(), stop_mask);
+                if (reason == Core::STOP_BREAK || reason == Core::STOP_EXCEPTION)
+                    pause();
+                check_core_switch();
+            }
+            block_view_signals(false);
+            if (stat == ST_BUSY && reason != Core::STOP_PROGRAM_END) {
+                cr->step(skip_break);
+                check_core_switch();
+            }
+            cop0st->update_count(); // Count is not updated by core on each cycle
             emit cycle_stats_update(cycle_stats);
-        } while(time_chunk != 0 && stat == ST_BUSY && skip_break == false &&
-                start_time.msecsTo(QTime::currentTime()) < (int)time_chunk);
+            emit views_update();
+        } else {
+            do {
+                cr->step(skip_break);
+                check_core_switch();
+                cop0st->update_count();
+                // Update cycles for cache misses in every step
+                emit cycle_stats_update(cycle_stats);
+            } while(time_chunk != 0 && stat == ST_BUSY && skip_break == false &&
+                    start_time.msecsTo(QTime::currentTime()) < (int)time_chunk);
+        }
     } catch (QtMipsException &e) {
+        block_view_signals(false);
+        emit views_update();
         run_t->stop();
         set_status(ST_TRAPPED);
         emit program_trap(e);
@@ -337,6 +645,12 @@ void QtMipsMachine::step() {
     step_internal(true);
 }
 
+void QtMipsMachine::advance_core() {
+    if (cr->skip_stall() == 0)
+        cr->step();
+    cop0st->update_count();
+}
+
 void QtMipsMachine::step_timer() {
     step_internal();
 }
@@ -349,10 +663,47 @@ void QtMipsMachine::restart() {
     l1_program->reset();
     l1_data->reset();
     l2_unified->reset();
+    for (Cache *c : lower_caches)
+        c->reset();
+    if (dram != nullptr)
+        dram->reset();
+    if (cr_pipelined != mcnf.pipelined()) {
+        // Start again with configured core
+        cr_standby->take_over(cr);
+        std::swap(cr, cr_standby);
+        cr_pipelined = mcnf.pipelined();
+    }
     cr->reset();
+    if (cr_standby != nullptr)
+        cr_standby->reset();
+    // Events are scheduled at cycles of the run which is over
+    events->reset();
+    cop0st->reset();
+    if (cpi != nullptr) {
+        cpi->clear();
+        cpi_next_cycle = 0;
+        schedule_cpi_sample();
+    }
     set_status(ST_READY);
 }
 
+// Signals which only feed the views. Peripherals, caches and memory stay
+// connected as their views are updated incrementally or drive the simulation.
+void QtMipsMachine::block_view_signals(bool block) {
+    cr->blockSignals(block);
+    regs->blockSignals(block);
+    cop0st->blockSignals(block);
+    if (bp() != nullptr) {
+        bp()->blockSignals(block);
+        bp()->btb_rw()->blockSignals(block);
+    }
+    l1_program->blockSignals(block);
+    l1_data->blockSignals(block);
+    l2_unified->blockSignals(block);
+    for (Cache *c : lower_caches)
+        c->blockSignals(block);
+}
+
 void QtMipsMachine::set_status(enum Status st) {
     bool change = st != stat;
     stat = st;
@@ -414,6 +765,9 @@ bool QtMipsMachine::get_step_over_exception(enum ExceptionCause excause) const {
 }
 
 BranchPredictor *QtMipsMachine::bp() const {
+    // Predictor of pipelined core is kept while functional core runs
+    if (!cr_pipelined && cr_standby != nullptr)
+        return cr_standby->predictor();
     return cr->predictor();
 }
 
@@ -44,9 +44,14 @@
 #include <registers.h>
 #include <memory.h>
 #include <core.h>
+#include <hlelibrary.h>
+#include <cpistack.h>
+#include <pipetrace.h>
 #include <cache.h>
 #include <cyclestatistics.h>
+#include <eventscheduler.h>
 #include <physaddrspace.h>
+#include <dramcontroller.h>
 #include <peripheral.h>
 #include <serialport.h>
 #include <peripspiled.h>
@@ -63,6 +68,8 @@ public:
 
     const MachineConfig &config() const;
     void set_speed(std::uint32_t ips, std::uint32_t time_chunk = 0);
+    void set_coalesce_updates(bool value);
+    bool coalesce_updates() const;
     const Registers *registers();
     const Cop0State *cop0state();
     const Memory *memory();
@@ -72,6 +79,9 @@ public:
     const Cache *l2_unified_cache() const;
     Cache *l1_data_cache_rw() const;
     Cache *l2_unified_cache_rw() const;
+    unsigned lower_cache_count() const;
+    const Cache *lower_cache(unsigned idx) const; // Index zero is L3
+    const DramController *dram_controller() const; // Null when DRAM has fixed access times
     void mem_sync();
     const  PhysAddrSpace *physical_address_space();
     PhysAddrSpace *physical_address_space_rw();
@@ -83,8 +93,39 @@ public:
     void set_symbol(QString name, std::uint32_t value, size_t size,
                     std::uint8_t info = 0, std::uint8_t other = 0);
     const Core *core();
+    Core *core_rw();
     const CoreSingle *core_singe();
     const CorePipelined *core_pipelined();
+    bool core_is_pipelined() const;
+    // Drain current core and continue execution by the other one.
+    // Registers, Cop0, memory and caches are shared by both cores.
+    void switch_core(bool pipelined);
+    // One step (or skipped stall cycles) of current core without status and
+    // view updates. Count register is kept current like in regular run.
+    void advance_core();
+    // Switch core when execution reaches address or core cycle counter reaches
+    // given value. Only one switch can be scheduled, it is forgotten once done.
+    void schedule_core_switch(bool pipelined, std::uint32_t address);
+    bool schedule_core_switch(bool pipelined, const QString &symbol);
+    void schedule_core_switch_at_cycle(bool pipelined, std::uint64_t cycle);
+    void cancel_core_switch();
+    // Functional core trains branch predictor of pipelined one
+    void set_warm_predictor(bool value);
+    // Polling loops without side effects are skipped up to next device event
+    // when machine runs with coalesced view updates. Enabled by default,
+    // single steps are never skipped.
+    void set_idle_loop_skip(bool value);
+    // Functional core emulates memcpy, memset and strlen found in symbol table
+    // on host. Returns number of recognized functions. Disabled by default.
+    unsigned set_hle(bool value);
+    HleLibrary *hle_library(); // Null when HLE is disabled
+    // Sample CPI stack every interval cycles, zero interval disables sampling
+    void set_cpi_stack(std::uint64_t interval, unsigned capacity = 1024);
+    const CpiStack *cpi_stack() const; // Null when sampling is disabled
+    // Pipelined core writes stage timing of instructions to the file in
+    // O3PipeView format, empty path closes the trace. Throws Input exception.
+    void set_pipe_trace(const QString &path);
+    bool program_end_reached() const;
     bool executable_loaded() const;
 
     enum Status {
@@ -124,6 +165,8 @@ signals:
     void post_tick(); // Emitted after tick to allow updates
     void set_interrupt_signal(uint irq_num, bool active);
     void cycle_stats_update(const CycleStatistics&);
+    void views_update(); // Emitted after run chunk with suppressed per-step view signals
+    void core_switched(bool pipelined); // Views connected to core signals should reconnect
 
 private slots:
     void step_timer();
@@ -131,20 +174,44 @@ private slots:
 private:
     void step_internal(bool skip_break = false);
     void set_status(Status st);
+    void block_view_signals(bool block);
+    Core *create_core(bool pipelined);
+    void check_core_switch();
+    std::uint64_t run_cycle_limit() const;
+    void schedule_cpi_sample();
 
     MachineConfig mcnf;
     Registers *regs;
     Memory *mem, *mem_program_only;
     PhysAddrSpace *physaddrspace;
+    DramController *dram; // Owned by physaddrspace
     SerialPort *ser_port;
     PeripSpiLed *perip_spi_led;
     LcdDisplay *perip_lcd_display;
     Cache *l1_program, *l1_data;
     Cache *l2_unified;
+    QVector<Cache *> lower_caches; // Configured levels below L2, disabled ones included
     Cop0State *cop0st;
+    EventScheduler *events; // Shared by both cores, time is measured in core cycles
+    MemoryAccess *cpu_mem, *core_mem_data, *core_mem_program;
+    std::uint32_t min_cache_row_size;
     Core *cr;
+    Core *cr_standby; // Created on first switch_core
+    bool cr_pipelined;
+    bool warm_bp;
+    bool idle_skip;
+    HleLibrary *hle;
+    CpiStack *cpi;
+    EventScheduler::EventId cpi_event;
+    std::uint64_t cpi_next_cycle;
+    PipeTrace *pipe_trace;
+    enum { SWITCH_NONE, SWITCH_AT_ADDR, SWITCH_AT_CYCLE } switch_when;
+    bool switch_to_pipelined;
+    std::uint32_t switch_addr;
+    std::uint64_t switch_cycle;
     QTimer *run_t;
     std::uint32_t time_chunk;
+    bool coalesce;
     SymbolTable *symtab;
     std::uint32_t program_end;
     Status stat;
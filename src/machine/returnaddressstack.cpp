@@ -0,0 +1,69 @@
+#include "returnaddressstack.h"
+#include "qtmipsexception.h"
+
+using namespace machine;
+
+ReturnAddressStack::ReturnAddressStack(unsigned depth) : stack(depth) {
+    SANITY_ASSERT(depth > 0, "Return address stack needs at least one entry");
+    reset();
+}
+
+unsigned ReturnAddressStack::depth() const {
+    return stack.size();
+}
+
+unsigned ReturnAddressStack::size() const {
+    return count;
+}
+
+void ReturnAddressStack::push(std::uint32_t address) {
+    stack[top] = address;
+    top = (top + 1) % stack.size();
+    if (count < (unsigned)stack.size())
+        count++;
+}
+
+bool ReturnAddressStack::pop(std::uint32_t &address) {
+    if (count == 0)
+        return false;
+    top = (top + stack.size() - 1) % stack.size();
+    address = stack[top];
+    count--;
+    return true;
+}
+
+void ReturnAddressStack::reset() {
+    stack.fill(0);
+    top = 0;
+    count = 0;
+    prediction_cnt = 0;
+    hit_cnt = 0;
+}
+
+void ReturnAddressStack::checkpoint(unsigned &top, unsigned &count) const {
+    top = this->top;
+    count = this->count;
+}
+
+void ReturnAddressStack::restore(unsigned top, unsigned count) {
+    this->top = top;
+    this->count = count;
+}
+
+void ReturnAddressStack::record(bool hit) {
+    prediction_cnt++;
+    if (hit)
+        hit_cnt++;
+}
+
+std::uint64_t ReturnAddressStack::predictions() const {
+    return prediction_cnt;
+}
+
+std::uint64_t ReturnAddressStack::hits() const {
+    return hit_cnt;
+}
+
+double ReturnAddressStack::hit_rate() const {
+    return prediction_cnt > 0 ? ((double) hit_cnt / (double) prediction_cnt) * 100.0 : 0.0;
+}
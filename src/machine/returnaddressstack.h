@@ -0,0 +1,39 @@
+#ifndef RETURNADDRESSSTACK_H
+#define RETURNADDRESSSTACK_H
+
+#include <QVector>
+#include <cstdint>
+
+namespace machine {
+
+// Circular stack of return addresses pushed by calls and popped by returns
+// at fetch. The oldest address is overwritten when the stack is full.
+class ReturnAddressStack {
+public:
+    explicit ReturnAddressStack(unsigned depth);
+
+    unsigned depth() const;
+    unsigned size() const;
+    void push(std::uint32_t address);
+    bool pop(std::uint32_t &address); // Returns false when stack is empty
+    void reset();
+    // Top of the stack, restored when wrong path calls and returns are flushed
+    void checkpoint(unsigned &top, unsigned &count) const;
+    void restore(unsigned top, unsigned count);
+
+    // Returns predicted from the stack and the correct ones of them
+    void record(bool hit);
+    std::uint64_t predictions() const;
+    std::uint64_t hits() const;
+    double hit_rate() const;
+
+private:
+    QVector<std::uint32_t> stack;
+    unsigned top; // Index where the next address is pushed
+    unsigned count;
+    std::uint64_t prediction_cnt, hit_cnt;
+};
+
+}
+
+#endif // RETURNADDRESSSTACK_H
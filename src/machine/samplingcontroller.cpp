@@ -0,0 +1,263 @@
+#include <cmath>
+#include <limits>
+#include "samplingcontroller.h"
+#include "qtmipsmachine.h"
+
+using namespace machine;
+
+extern CycleStatistics cycle_stats;
+
+// Counters which are extrapolated, pending stall counters are not included
+static const struct {
+    const char *name;
+    std::uint64_t CycleStatistics::*field;
+} stat_fields[] = {
+    {"total_cycles", &CycleStatistics::total_cycles},
+    {"memory_cycles", &CycleStatistics::memory_cycles},
+    {"data_hazard_stalls", &CycleStatistics::data_hazard_stalls},
+    {"control_hazard_stalls", &CycleStatistics::control_hazard_stalls},
+    {"mdu_stalls", &CycleStatistics::mdu_stalls},
+    {"paired_issues", &CycleStatistics::paired_issues},
+    {"ram_program_stall_cycles", &CycleStatistics::ram_program_stall_cycles_total},
+    {"ram_data_stall_cycles", &CycleStatistics::ram_data_stall_cycles_total},
+    {"l1_data_stall_cycles", &CycleStatistics::l1_data_stall_cycles_total},
+    {"l1_program_stall_cycles", &CycleStatistics::l1_program_stall_cycles_total},
+    {"l2_unified_stall_cycles", &CycleStatistics::l2_unified_stall_cycles_total},
+    {"write_buffer_stall_cycles", &CycleStatistics::write_buffer_stall_cycles_total},
+};
+
+#define STAT_FIELDS_COUNT (sizeof(stat_fields) / sizeof(stat_fields[0]))
+
+// Quantile for two sided interval, found by bisection of erf
+static double normal_quantile(double level) {
+    double lo = 0, hi = 10;
+    for (int i = 0; i < 64; i++) {
+        double mid = (lo + hi) / 2;
+        if (std::erf(mid / std::sqrt(2.0)) < level)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return (lo + hi) / 2;
+}
+
+SamplingController::SamplingController(QtMipsMachine *machine, std::uint64_t period,
+                                       std::uint64_t warmup, std::uint64_t window) : QObject() {
+    this->machine = machine;
+    this->period = period;
+    this->warmup = warmup;
+    this->window = window;
+    warm_bp = true;
+    total_instructions = 0;
+    set_confidence(0.95);
+}
+
+void SamplingController::set_period(std::uint64_t instructions) {
+    period = instructions;
+}
+
+void SamplingController::set_warmup(std::uint64_t instructions) {
+    warmup = instructions;
+}
+
+void SamplingController::set_window(std::uint64_t instructions) {
+    window = instructions;
+}
+
+void SamplingController::set_warm_predictor(bool value) {
+    warm_bp = value;
+}
+
+void SamplingController::set_confidence(double level) {
+    SANITY_ASSERT(level > 0 && level < 1, "Confidence level has to be between 0 and 1");
+    this->level = level;
+    z = normal_quantile(level);
+}
+
+void SamplingController::run() {
+    SANITY_ASSERT(window > 0 && period > warmup + window, "Sample has to fit into sampling period");
+    std::uint64_t first = cycle_stats.instructions;
+
+    windows.clear();
+    weights.clear();
+    machine->set_warm_predictor(warm_bp);
+    while (true) {
+        machine->switch_core(false);
+        if (!advance(period - warmup - window))
+            break;
+        start_detailed();
+        if (!advance(warmup))
+            break;
+        CycleStatistics start = window_start();
+        if (!advance(window))
+            break; // Incomplete window is not used
+        window_end(start, 1);
+    }
+    weights.clear(); // Windows are equally weighted
+    total_instructions = cycle_stats.instructions - first;
+}
+
+void SamplingController::run_regions(const QVector<SimPointSelector::Region> &regions,
+                                     std::uint64_t interval) {
+    SANITY_ASSERT(interval > 0, "Region can't be empty");
+    std::uint64_t first = cycle_stats.instructions;
+    bool running = true;
+
+    windows.clear();
+    weights.clear();
+    machine->set_warm_predictor(warm_bp);
+    for (const SimPointSelector::Region &r : regions) {
+        std::uint64_t start = first + r.interval * interval;
+        std::uint64_t warm_start = start - std::min<std::uint64_t>(warmup, start - first);
+        if (cycle_stats.instructions > start)
+            continue; // Regions have to be sorted and can't overlap
+        machine->switch_core(false);
+        if (!advance(warm_start > cycle_stats.instructions ? warm_start - cycle_stats.instructions : 0))
+            break;
+        start_detailed();
+        if (!advance(start - cycle_stats.instructions))
+            break;
+        CycleStatistics s = window_start();
+        running = advance(interval);
+        // Last interval of the program is usually shorter
+        if (cycle_stats.instructions > s.instructions)
+            window_end(s, r.weight);
+        if (!running)
+            break;
+    }
+    // Rest of the program is needed for its output and instruction count
+    machine->switch_core(false);
+    if (running)
+        advance(std::numeric_limits<std::uint64_t>::max() - cycle_stats.instructions);
+    total_instructions = cycle_stats.instructions - first;
+}
+
+// Functional core does not wait for memory, stalls which caches charged
+// during fast forward are owed by nobody
+static void clear_pending_stalls() {
+    cycle_stats.l1_data_stall_cycles = 0;
+    cycle_stats.l1_program_stall_cycles = 0;
+    cycle_stats.l2_unified_stall_cycles = 0;
+    for (int i = 0; i < CycleStatistics::LOWER_CACHE_LEVELS; i++)
+        cycle_stats.lower_cache_stall_cycles[i] = 0;
+    cycle_stats.write_buffer_stall_cycles = 0;
+}
+
+void SamplingController::start_detailed() {
+    machine->switch_core(true);
+    clear_pending_stalls();
+}
+
+CycleStatistics SamplingController::window_start() {
+    // Memory stalls of warmup instructions are finished before the window
+    // starts, so the window neither pays them nor misses its own
+    while (machine->core_rw()->skip_stall() != 0)
+        ;
+    return cycle_stats;
+}
+
+void SamplingController::window_end(const CycleStatistics &start, double weight) {
+    CycleStatistics w;
+    w.instructions = cycle_stats.instructions - start.instructions;
+    for (unsigned i = 0; i < STAT_FIELDS_COUNT; i++)
+        w.*stat_fields[i].field = cycle_stats.*stat_fields[i].field - start.*stat_fields[i].field;
+    windows.append(w);
+    weights.append(weight);
+    emit sample_done(windows.size(), (double)w.total_cycles / w.instructions);
+}
+
+bool SamplingController::advance(std::uint64_t instructions) {
+    Core *cr = machine->core_rw();
+    std::uint64_t target = cycle_stats.instructions + instructions;
+
+    while (cycle_stats.instructions < target) {
+        machine->advance_core();
+        if (cr->stop_on_exception_pending() || machine->program_end_reached())
+            return false;
+    }
+    return true;
+}
+
+unsigned SamplingController::samples() const {
+    return windows.size();
+}
+
+std::uint64_t SamplingController::instructions() const {
+    return total_instructions;
+}
+
+double SamplingController::field_mean(std::uint64_t CycleStatistics::*field) const {
+    double sum = 0, total_weight = 0;
+    if (windows.isEmpty())
+        return 0;
+    for (int i = 0; i < windows.size(); i++) {
+        double weight = weights.isEmpty() ? 1 : weights[i];
+        sum += weight * windows[i].*field / windows[i].instructions;
+        total_weight += weight;
+    }
+    return total_weight > 0 ? sum / total_weight : 0;
+}
+
+double SamplingController::field_error(std::uint64_t CycleStatistics::*field) const {
+    double mean = field_mean(field);
+    double var = 0;
+    if (windows.size() < 2 || !weights.isEmpty())
+        return std::numeric_limits<double>::infinity();
+    for (const CycleStatistics &w : windows) {
+        double d = (double)(w.*field) / w.instructions - mean;
+        var += d * d;
+    }
+    var /= windows.size() - 1;
+    return z * std::sqrt(var / windows.size());
+}
+
+double SamplingController::cpi() const {
+    return field_mean(&CycleStatistics::total_cycles);
+}
+
+double SamplingController::cpi_error() const {
+    return field_error(&CycleStatistics::total_cycles);
+}
+
+CycleStatistics SamplingController::estimate() const {
+    CycleStatistics est;
+    est.instructions = total_instructions;
+    for (unsigned i = 0; i < STAT_FIELDS_COUNT; i++)
+        est.*stat_fields[i].field = std::llround(field_mean(stat_fields[i].field) * total_instructions);
+    return est;
+}
+
+CycleStatistics SamplingController::estimate_error() const {
+    CycleStatistics err;
+    if (windows.size() < 2 || !weights.isEmpty())
+        return err;
+    for (unsigned i = 0; i < STAT_FIELDS_COUNT; i++)
+        err.*stat_fields[i].field = std::ceil(field_error(stat_fields[i].field) * total_instructions);
+    return err;
+}
+
+QString SamplingController::report() const {
+    QString s;
+    s += QString("samples: %1\n").arg(samples());
+    s += QString("instructions: %1\n").arg(total_instructions);
+    if (!weights.isEmpty()) {
+        // Weighted regions, there is no variance estimate
+        s += QString("cpi: %1\n").arg(cpi(), 0, 'f', 4);
+        CycleStatistics est = estimate();
+        for (unsigned i = 0; i < STAT_FIELDS_COUNT; i++)
+            s += QString("%1: %2\n").arg(stat_fields[i].name).arg(est.*stat_fields[i].field);
+        return s;
+    }
+    if (windows.size() < 2) {
+        s += "not enough samples for confidence interval\n";
+        return s;
+    }
+    s += QString("confidence: %1%\n").arg(level * 100);
+    s += QString("cpi: %1 +- %2\n").arg(cpi(), 0, 'f', 4).arg(cpi_error(), 0, 'f', 4);
+    CycleStatistics est = estimate();
+    CycleStatistics err = estimate_error();
+    for (unsigned i = 0; i < STAT_FIELDS_COUNT; i++)
+        s += QString("%1: %2 +- %3\n").arg(stat_fields[i].name)
+                .arg(est.*stat_fields[i].field).arg(err.*stat_fields[i].field);
+    return s;
+}
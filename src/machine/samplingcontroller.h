@@ -0,0 +1,72 @@
+#ifndef SAMPLINGCONTROLLER_H
+#define SAMPLINGCONTROLLER_H
+
+#include <QObject>
+#include <QVector>
+#include <QString>
+#include <cstdint>
+#include "cyclestatistics.h"
+#include "simpointselector.h"
+
+namespace machine {
+
+class QtMipsMachine;
+
+// Sampled simulation in SMARTS style. Program runs on functional core between
+// samples while caches (and optionally branch predictor) are kept warm. Every
+// period one sample is run by pipelined core: warmup instructions refill the
+// pipeline and then the window is measured. Statistics of measured windows are
+// extrapolated to the whole run.
+class SamplingController : public QObject {
+    Q_OBJECT
+public:
+    SamplingController(QtMipsMachine *machine, std::uint64_t period = 100000,
+                       std::uint64_t warmup = 2000, std::uint64_t window = 1000);
+
+    void set_period(std::uint64_t instructions);
+    void set_warmup(std::uint64_t instructions);
+    void set_window(std::uint64_t instructions);
+    void set_warm_predictor(bool value);
+    void set_confidence(double level); // For example 0.95 for 95% confidence interval
+
+    // Runs program until it reaches its end or stop is requested (exit syscall,
+    // breakpoint). Machine exceptions are passed to the caller.
+    void run();
+    // Measure only selected intervals of given length (for example SimPoint
+    // regions from BBV profile of the same program). Every region is preceded
+    // by warmup, the rest of the program runs on functional core. Estimate is
+    // weighted by region weights and has no confidence interval.
+    void run_regions(const QVector<SimPointSelector::Region> &regions, std::uint64_t interval);
+
+    unsigned samples() const;
+    std::uint64_t instructions() const; // Instructions executed by the whole run
+    double cpi() const;
+    double cpi_error() const; // Half width of confidence interval
+    CycleStatistics estimate() const; // Extrapolated to the whole run
+    CycleStatistics estimate_error() const; // Half widths of confidence intervals
+    QString report() const;
+
+signals:
+    void sample_done(unsigned sample, double cpi);
+
+private:
+    bool advance(std::uint64_t instructions);
+    void start_detailed(); // Switch to pipelined core after fast forward
+    CycleStatistics window_start();
+    void window_end(const CycleStatistics &start, double weight);
+    double field_mean(std::uint64_t CycleStatistics::*field) const;
+    double field_error(std::uint64_t CycleStatistics::*field) const;
+
+    QtMipsMachine *machine;
+    std::uint64_t period, warmup, window;
+    bool warm_bp;
+    double z; // Quantile of normal distribution for selected confidence
+    double level;
+    std::uint64_t total_instructions;
+    QVector<CycleStatistics> windows; // Statistics of every measured window
+    QVector<double> weights; // Weights of windows measured by run_regions
+};
+
+}
+
+#endif // SAMPLINGCONTROLLER_H
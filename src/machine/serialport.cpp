@@ -58,6 +58,8 @@ SerialPort::SerialPort() {
     rx_irq_level = 3;  // HW Interrupt 1
     tx_irq_active = false;
     rx_irq_active = false;
+    events = nullptr;
+    rx_event = 0;
 }
 
 SerialPort::~SerialPort() {
@@ -115,7 +117,9 @@ std::uint32_t SerialPort::rword(std::uint32_t address, bool debug_access) const
 #endif
     switch (address & ~3) {
     case SERP_RX_ST_REG_o:
-        pool_rx_byte();
+        // Input comes by event when scheduler is set, status read has no side effect
+        if (events == nullptr)
+            pool_rx_byte();
         value = rx_st_reg;
         break;
     case SERP_RX_DATA_REG_o:
@@ -127,6 +131,9 @@ std::uint32_t SerialPort::rword(std::uint32_t address, bool debug_access) const
                 update_rx_irq();
                 emit external_change_notify(this, SERP_RX_ST_REG_o,
                                             SERP_RX_DATA_REG_o + 3, true);
+                // Next queued byte is taken by event too
+                if (events != nullptr)
+                    rx_queue_check();
             }
         } else {
             value = 0;
@@ -147,6 +154,13 @@ std::uint32_t SerialPort::get_change_counter() const {
     return change_counter;
 }
 
+enum LocationStatus SerialPort::location_status(std::uint32_t offset) const {
+    // Reading of data register takes received byte
+    if ((offset & ~3) == SERP_RX_DATA_REG_o)
+        return LOCSTAT_READ_EFFECT;
+    return LOCSTAT_NONE;
+}
+
 void SerialPort::update_rx_irq() const {
     bool active = !!(rx_st_reg & SERP_RX_ST_REG_IE_m);
     active &= !!(rx_st_reg & SERP_RX_ST_REG_READY_m);
@@ -173,7 +187,25 @@ void SerialPort::rx_queue_check_internal() const {
     update_rx_irq();
 }
 
+void SerialPort::set_event_scheduler(EventScheduler *events) {
+    if (this->events != nullptr)
+        this->events->cancel(rx_event);
+    rx_event = 0;
+    this->events = events;
+}
+
 void SerialPort::rx_queue_check() const {
+    if (events != nullptr) {
+        if (!events->pending(rx_event)) {
+            rx_event = events->schedule(0, [this]() {
+                pool_rx_byte();
+                rx_queue_check_internal();
+                emit external_change_notify(this, SERP_RX_ST_REG_o,
+                                            SERP_RX_DATA_REG_o + 3, true);
+            });
+        }
+        return;
+    }
     rx_queue_check_internal();
     emit external_change_notify(this, SERP_RX_ST_REG_o,
                                 SERP_RX_DATA_REG_o + 3, true);
@@ -41,6 +41,7 @@
 #include <cstdint>
 #include <qtmipsexception.h>
 #include "peripheral.h"
+#include "eventscheduler.h"
 
 namespace machine {
 
@@ -64,6 +65,10 @@ public:
     bool wword(std::uint32_t address, std::uint32_t value) override;
     std::uint32_t rword(std::uint32_t address, bool debug_access = false) const override;
     virtual std::uint32_t get_change_counter() const override;
+    enum LocationStatus location_status(std::uint32_t offset) const override;
+    // Received input is then delivered to program at next instruction fetch,
+    // status register reads no longer take input on their own
+    void set_event_scheduler(EventScheduler *events);
 private:
     void rx_queue_check_internal() const;
     mutable std::uint32_t change_counter;
@@ -77,6 +82,8 @@ private:
     std::uint8_t rx_irq_level;
     mutable bool tx_irq_active;
     mutable bool rx_irq_active;
+    EventScheduler *events;
+    mutable EventScheduler::EventId rx_event;
 };
 
 }
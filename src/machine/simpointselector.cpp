@@ -0,0 +1,272 @@
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include "simpointselector.h"
+#include "qtmipsexception.h"
+
+using namespace machine;
+
+// Element of random projection matrix in range <-1, 1>. Matrix is not stored,
+// elements are derived from block id so memory does not grow with program size.
+static double projection(unsigned id, unsigned dim, std::uint32_t seed) {
+    std::uint64_t x = ((std::uint64_t)id << 32) ^ ((std::uint64_t)dim << 16) ^ seed;
+    // splitmix64 finalizer
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return (double)(x >> 11) / (double)(1ULL << 52) - 1.0;
+}
+
+static double distance2(const QVector<double> &a, const QVector<double> &b) {
+    double d = 0;
+    for (int i = 0; i < a.size(); i++)
+        d += (a[i] - b[i]) * (a[i] - b[i]);
+    return d;
+}
+
+SimPointSelector::SimPointSelector(unsigned max_k, unsigned dimensions, std::uint32_t seed) {
+    SANITY_ASSERT(max_k > 0 && dimensions > 0, "At least one cluster and dimension is required");
+    this->max_k = max_k;
+    this->dims = dimensions;
+    this->seed = seed;
+    restarts = 5;
+    bic_threshold = 0.9;
+    chosen_k = 0;
+}
+
+void SimPointSelector::set_max_k(unsigned value) {
+    SANITY_ASSERT(value > 0, "At least one cluster is required");
+    max_k = value;
+}
+
+void SimPointSelector::set_bic_threshold(double value) {
+    bic_threshold = value;
+}
+
+void SimPointSelector::set_restarts(unsigned value) {
+    restarts = std::max(value, 1u);
+}
+
+unsigned SimPointSelector::clusters() const {
+    return chosen_k;
+}
+
+const QVector<unsigned> &SimPointSelector::assignment() const {
+    return chosen_assign;
+}
+
+double SimPointSelector::kmeans(const QVector<Point> &points, const QVector<double> &point_weights,
+                                unsigned k, std::uint32_t run_seed, QVector<unsigned> &assign,
+                                QVector<Point> &centers) const {
+    std::mt19937 rng(run_seed);
+    int n = points.size();
+    QVector<double> nearest(n, std::numeric_limits<double>::infinity());
+
+    // k-means++ initialization, next center is chosen with probability
+    // proportional to weighted squared distance from already chosen ones
+    centers.clear();
+    centers.append(points[std::uniform_int_distribution<int>(0, n - 1)(rng)]);
+    while ((unsigned)centers.size() < k) {
+        double sum = 0;
+        for (int i = 0; i < n; i++) {
+            nearest[i] = std::min(nearest[i], distance2(points[i], centers.last()));
+            sum += nearest[i] * point_weights[i];
+        }
+        if (sum <= 0)
+            break; // Less distinct points than clusters
+        double r = std::uniform_real_distribution<double>(0, sum)(rng);
+        int pick = n - 1;
+        for (int i = 0; i < n; i++) {
+            r -= nearest[i] * point_weights[i];
+            if (r <= 0) {
+                pick = i;
+                break;
+            }
+        }
+        centers.append(points[pick]);
+    }
+
+    assign.fill(0, n);
+    bool changed = true;
+    for (int iter = 0; iter < 100 && changed; iter++) {
+        changed = false;
+        for (int i = 0; i < n; i++) {
+            unsigned best = 0;
+            double best_d = distance2(points[i], centers[0]);
+            for (int c = 1; c < centers.size(); c++) {
+                double d = distance2(points[i], centers[c]);
+                if (d < best_d) {
+                    best_d = d;
+                    best = c;
+                }
+            }
+            if (iter == 0 || assign[i] != best) {
+                assign[i] = best;
+                changed = true;
+            }
+        }
+        QVector<Point> sums(centers.size(), Point(dims, 0));
+        QVector<double> mass(centers.size(), 0);
+        for (int i = 0; i < n; i++) {
+            for (unsigned d = 0; d < dims; d++)
+                sums[assign[i]][d] += points[i][d] * point_weights[i];
+            mass[assign[i]] += point_weights[i];
+        }
+        for (int c = 0; c < centers.size(); c++) {
+            if (mass[c] <= 0)
+                continue; // Empty cluster keeps its center
+            for (unsigned d = 0; d < dims; d++)
+                centers[c][d] = sums[c][d] / mass[c];
+        }
+    }
+
+    double distortion = 0;
+    for (int i = 0; i < n; i++)
+        distortion += distance2(points[i], centers[assign[i]]) * point_weights[i];
+    return distortion;
+}
+
+// Bayesian information criterion of spherical Gaussian mixture (Pelleg and Moore)
+double SimPointSelector::bic(const QVector<Point> &points, unsigned k,
+                             const QVector<unsigned> &assign,
+                             const QVector<Point> &centers) const {
+    const double pi = 3.14159265358979323846;
+    double r = points.size();
+    double m = dims;
+    QVector<double> sizes(k, 0);
+    double dist = 0;
+    for (int i = 0; i < points.size(); i++) {
+        sizes[assign[i]] += 1;
+        dist += distance2(points[i], centers[assign[i]]);
+    }
+    double variance = r > k ? dist / (m * (r - k)) : 0;
+    variance = std::max(variance, std::numeric_limits<double>::min());
+
+    double loglik = 0;
+    for (unsigned c = 0; c < k; c++) {
+        double rn = sizes[c];
+        if (rn == 0)
+            continue;
+        loglik += -rn / 2 * std::log(2 * pi) - rn * m / 2 * std::log(variance)
+                - (rn - k) / 2 + rn * std::log(rn) - rn * std::log(r);
+    }
+    double params = (k - 1) + m * k + 1;
+    return loglik - params / 2 * std::log(r);
+}
+
+QVector<SimPointSelector::Region> SimPointSelector::select(const QVector<BbvProfiler::Vector> &vectors) {
+    QVector<Region> regions;
+    QVector<Point> points;
+    QVector<double> point_weights;
+    double total = 0;
+
+    chosen_k = 0;
+    chosen_assign.clear();
+    for (const BbvProfiler::Vector &v : vectors) {
+        std::uint64_t len = 0;
+        for (const auto &e : v)
+            len += e.second;
+        Point p(dims, 0);
+        if (len != 0) {
+            for (const auto &e : v) {
+                double f = (double)e.second / len;
+                for (unsigned d = 0; d < dims; d++)
+                    p[d] += f * projection(e.first, d, seed);
+            }
+        }
+        points.append(p);
+        point_weights.append(len);
+        total += len;
+    }
+    if (points.isEmpty() || total <= 0)
+        return regions;
+    // Weights relative to average interval, so partial last interval counts less
+    for (double &w : point_weights)
+        w *= points.size() / total;
+
+    unsigned k_limit = std::min<unsigned>(max_k, points.size());
+    QVector<QVector<unsigned>> assigns(k_limit + 1);
+    QVector<QVector<Point>> centers(k_limit + 1);
+    QVector<double> bics(k_limit + 1);
+    for (unsigned k = 1; k <= k_limit; k++) {
+        double best = std::numeric_limits<double>::infinity();
+        for (unsigned run = 0; run < restarts; run++) {
+            QVector<unsigned> a;
+            QVector<Point> c;
+            double distortion = kmeans(points, point_weights, k, seed + run * 7919 + k, a, c);
+            if (distortion < best) {
+                best = distortion;
+                assigns[k] = a;
+                centers[k] = c;
+            }
+        }
+        bics[k] = bic(points, centers[k].size(), assigns[k], centers[k]);
+    }
+
+    double bic_min = bics[1], bic_max = bics[1];
+    for (unsigned k = 2; k <= k_limit; k++) {
+        bic_min = std::min(bic_min, bics[k]);
+        bic_max = std::max(bic_max, bics[k]);
+    }
+    chosen_k = k_limit;
+    for (unsigned k = 1; k <= k_limit; k++) {
+        if (bics[k] >= bic_min + bic_threshold * (bic_max - bic_min)) {
+            chosen_k = k;
+            break;
+        }
+    }
+    chosen_assign = assigns[chosen_k];
+
+    const QVector<Point> &c = centers[chosen_k];
+    for (int cl = 0; cl < c.size(); cl++) {
+        Region reg;
+        double best_d = std::numeric_limits<double>::infinity();
+        double mass = 0;
+        reg.interval = 0;
+        reg.cluster = cl;
+        for (int i = 0; i < points.size(); i++) {
+            if ((int)chosen_assign[i] != cl)
+                continue;
+            mass += point_weights[i];
+            double d = distance2(points[i], c[cl]);
+            if (d < best_d) {
+                best_d = d;
+                reg.interval = i;
+            }
+        }
+        if (mass <= 0)
+            continue;
+        reg.weight = mass / points.size();
+        regions.append(reg);
+    }
+    std::sort(regions.begin(), regions.end(), [](const Region &a, const Region &b) {
+        return a.interval < b.interval;
+    });
+    return regions;
+}
+
+void SimPointSelector::save(const QVector<Region> &regions, const QString &simpoints_path,
+                            const QString &weights_path) {
+    QFile sf(simpoints_path), wf(weights_path);
+    if (!sf.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+        throw QTMIPS_EXCEPTION(Input, "Can't open simpoints file for writing", simpoints_path);
+    if (!wf.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+        throw QTMIPS_EXCEPTION(Input, "Can't open weights file for writing", weights_path);
+    QTextStream s(&sf), w(&wf);
+    for (const Region &r : regions) {
+        s << r.interval << " " << r.cluster << "\n";
+        w << QString::number(r.weight, 'f', 6) << " " << r.cluster << "\n";
+    }
+}
+
+QString SimPointSelector::report(const QVector<Region> &regions) {
+    QString s = QString("regions: %1\n").arg(regions.size());
+    for (const Region &r : regions)
+        s += QString("interval %1 cluster %2 weight %3\n").arg(r.interval)
+                .arg(r.cluster).arg(r.weight, 0, 'f', 4);
+    return s;
+}
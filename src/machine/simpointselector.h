@@ -0,0 +1,58 @@
+#ifndef SIMPOINTSELECTOR_H
+#define SIMPOINTSELECTOR_H
+
+#include <QVector>
+#include <QString>
+#include <cstdint>
+#include "bbvprofiler.h"
+
+namespace machine {
+
+// Offline selection of representative intervals from basic block vectors as
+// done by SimPoint. Vectors are normalized, randomly projected to few
+// dimensions and clustered by k-means. Number of clusters is the smallest one
+// which reaches given fraction of the best Bayesian information criterion.
+// One interval closest to centroid represents every cluster.
+class SimPointSelector {
+public:
+    struct Region {
+        unsigned interval; // Index of interval in the vectors
+        unsigned cluster;
+        double weight; // Fraction of executed instructions represented
+    };
+
+    SimPointSelector(unsigned max_k = 10, unsigned dimensions = 15, std::uint32_t seed = 1);
+
+    void set_max_k(unsigned value);
+    void set_bic_threshold(double value); // 0.9 by default
+    void set_restarts(unsigned value); // Number of k-means runs with different initial centers
+
+    QVector<Region> select(const QVector<BbvProfiler::Vector> &vectors);
+
+    unsigned clusters() const; // Chosen k of last selection
+    const QVector<unsigned> &assignment() const; // Cluster of every interval
+
+    // Write SimPoint .simpoints ("interval cluster") and .weights ("weight cluster") files
+    static void save(const QVector<Region> &regions, const QString &simpoints_path,
+                     const QString &weights_path);
+    static QString report(const QVector<Region> &regions);
+
+private:
+    typedef QVector<double> Point;
+
+    double kmeans(const QVector<Point> &points, const QVector<double> &point_weights,
+                  unsigned k, std::uint32_t run_seed, QVector<unsigned> &assign,
+                  QVector<Point> &centers) const;
+    double bic(const QVector<Point> &points, unsigned k, const QVector<unsigned> &assign,
+               const QVector<Point> &centers) const;
+
+    unsigned max_k, dims, restarts;
+    std::uint32_t seed;
+    double bic_threshold;
+    unsigned chosen_k;
+    QVector<unsigned> chosen_assign;
+};
+
+}
+
+#endif // SIMPOINTSELECTOR_H
@@ -35,9 +35,16 @@
 
 #include "tst_machine.h"
 #include "cache.h"
+#include "dramcontroller.h"
+#include "physaddrspace.h"
+#include "writebuffer.h"
+#include "cyclestatistics.h"
+#include "qtmipsexception.h"
 
 using namespace machine;
 
+extern CycleStatistics cycle_stats;
+
 void MachineTests::cache_data() {
     QTest::addColumn<MachineConfigCache>("cache_c");
     QTest::addColumn<unsigned>("hit");
@@ -91,6 +98,282 @@ void MachineTests::cache() {
     QCOMPARE(m.read_word(0x700), (std::uint32_t)0x23);
 
     // Verify counts
-    QCOMPARE(cch.hit(), hit);
-    QCOMPARE(cch.miss(), miss);
+    QCOMPARE(cch.hit(), (std::uint64_t)hit);
+    QCOMPARE(cch.miss(), (std::uint64_t)miss);
+}
+
+void MachineTests::cache_prefetch_data() {
+    QTest::addColumn<int>("prefetcher");
+    QTest::addColumn<std::uint32_t>("start");
+    QTest::addColumn<int>("step");
+    QTest::addColumn<unsigned>("count");
+    QTest::addColumn<unsigned>("miss");
+    QTest::addColumn<unsigned>("prefetches");
+    QTest::addColumn<unsigned>("useful");
+
+    // Lines of two words, first use of prefetched line triggers the next one
+    QTest::newRow("Next line") << (int)MachineConfigCache::PF_NEXT_LINE << (std::uint32_t)0x1000 << 4
+                               << 64U << 1U << 32U << 31U;
+    // Stride is confirmed by fourth access of the same instruction
+    QTest::newRow("Stride") << (int)MachineConfigCache::PF_STRIDE << (std::uint32_t)0x1000 << 32
+                            << 20U << 4U << 17U << 16U;
+    // Descending stream is confirmed by second missed line
+    QTest::newRow("Stream") << (int)MachineConfigCache::PF_STREAM << (std::uint32_t)0x10fc << -4
+                            << 64U << 2U << 31U << 30U;
+}
+
+void MachineTests::cache_prefetch() {
+    QFETCH(int, prefetcher);
+    QFETCH(std::uint32_t, start);
+    QFETCH(int, step);
+    QFETCH(unsigned, count);
+    QFETCH(unsigned, miss);
+    QFETCH(unsigned, prefetches);
+    QFETCH(unsigned, useful);
+
+    Memory m;
+    MachineConfigCache cache_c(MemoryAccess::MemoryType::L1_DATA_CACHE);
+    cache_c.set_enabled(true);
+    cache_c.set_sets(16);
+    cache_c.set_blocks(2);
+    cache_c.set_associativity(2);
+    cache_c.set_replacement_policy(MachineConfigCache::ReplacementPolicy::RP_LRU);
+    cache_c.set_prefetcher((MachineConfigCache::PrefetcherType)prefetcher);
+    Cache cch(cache_c, &m, 1, 1, 0, 10, 10, 0);
+
+    for (unsigned i = 0; i < count; i++)
+        m.write_word(start + i * step, i);
+    cch.set_access_pc(0x80020000);
+    std::uint64_t memory_cycles = cycle_stats.memory_cycles;
+    for (unsigned i = 0; i < count; i++) {
+        QCOMPARE(cch.read_word(start + i * step), (std::uint32_t)i);
+        // Leave enough time for fills to complete
+        cycle_stats.total_cycles += 20;
+    }
+
+    QCOMPARE(cch.miss(), (std::uint64_t)miss);
+    QCOMPARE(cch.prefetches(), (std::uint64_t)prefetches);
+    QCOMPARE(cch.useful_prefetches(), (std::uint64_t)useful);
+    QCOMPARE(cch.late_prefetches(), (std::uint64_t)0);
+    // Only demand misses stall
+    QCOMPARE(cycle_stats.memory_cycles - memory_cycles, (std::uint64_t)miss * 10);
+}
+
+void MachineTests::cache_hierarchy() {
+    MachineConfigCache l1_c(MemoryAccess::MemoryType::L1_DATA_CACHE);
+    l1_c.set_enabled(true);
+    l1_c.set_sets(2);
+    l1_c.set_blocks(1);
+    l1_c.set_associativity(1);
+    l1_c.set_write_policy(MachineConfigCache::WritePolicy::WP_BACK);
+    MachineConfigCache l2_c(MemoryAccess::MemoryType::L2_UNIFIED_CACHE);
+    l2_c.set_enabled(true);
+    l2_c.set_sets(1);
+    l2_c.set_blocks(1);
+    l2_c.set_associativity(1);
+    l2_c.set_inclusion(MachineConfigCache::IP_INCLUSIVE);
+
+    // Inclusive L2 evicting line takes dirty data from L1 with it
+    {
+        Memory m;
+        Cache l2(l2_c, &m, 5, 5, 0, 10, 10, 0);
+        Cache l1(l1_c, &l2, 1, 1, 0, 5, 5, 0);
+        l2.add_upper(&l1);
+        l1.write_word(0x0, 0x55);
+        QCOMPARE(l1.read_word(0x4), (std::uint32_t)0);
+        QCOMPARE(m.read_word(0x0), (std::uint32_t)0x55);
+        QCOMPARE(l1.read_word(0x0), (std::uint32_t)0x55);
+        QCOMPARE(l1.miss(), (std::uint64_t)3);
+
+        MachineConfigCache wide_c(l1_c);
+        wide_c.set_blocks(2);
+        Cache wide(wide_c, &l2, 1, 1, 0, 5, 5, 0);
+#ifdef QVERIFY_EXCEPTION_THROWN
+        QVERIFY_EXCEPTION_THROWN(l2.add_upper(&wide), QtMipsExceptionInput);
+#endif
+    }
+
+    // Exclusive L2 holds only lines evicted from L1
+    l1_c.set_sets(1);
+    l2_c.set_associativity(2);
+    l2_c.set_replacement_policy(MachineConfigCache::ReplacementPolicy::RP_LRU);
+    l2_c.set_inclusion(MachineConfigCache::IP_EXCLUSIVE);
+    {
+        Memory m;
+        Cache l2(l2_c, &m, 5, 5, 0, 10, 10, 0);
+        Cache l1(l1_c, &l2, 1, 1, 0, 5, 5, 0);
+        l2.add_upper(&l1);
+        m.write_word(0x0, 0x11);
+        m.write_word(0x4, 0x22);
+        QCOMPARE(l1.read_word(0x0), (std::uint32_t)0x11);
+        QCOMPARE(l1.read_word(0x4), (std::uint32_t)0x22);
+        QCOMPARE(l1.read_word(0x0), (std::uint32_t)0x11);
+        QCOMPARE(l2.hit(), (std::uint64_t)1);
+        QCOMPARE(l2.miss(), (std::uint64_t)2);
+        // Dirty line moves down on eviction and reaches memory on flush
+        l1.write_word(0x0, 0x33);
+        QCOMPARE(l1.read_word(0x4), (std::uint32_t)0x22);
+        QCOMPARE(m.read_word(0x0), (std::uint32_t)0x11);
+        l1.sync();
+        QCOMPARE(m.read_word(0x0), (std::uint32_t)0x33);
+
+        MachineConfigCache wt_c(l1_c);
+        wt_c.set_write_policy(MachineConfigCache::WritePolicy::WP_THROUGH);
+        Cache wt(wt_c, &l2, 1, 1, 0, 5, 5, 0);
+#ifdef QVERIFY_EXCEPTION_THROWN
+        QVERIFY_EXCEPTION_THROWN(l2.add_upper(&wt), QtMipsExceptionInput);
+#endif
+    }
+
+    // Conflicting lines alternate between cache and its victim cache
+    l1_c.set_victim_entries(2);
+    {
+        Memory m;
+        Cache l1(l1_c, &m, 1, 1, 0, 10, 10, 0);
+        m.write_word(0x0, 0x11);
+        m.write_word(0x4, 0x22);
+        std::uint64_t memory_cycles = cycle_stats.memory_cycles;
+        for (int i = 0; i < 2; i++) {
+            QCOMPARE(l1.read_word(0x0), (std::uint32_t)0x11);
+            QCOMPARE(l1.read_word(0x4), (std::uint32_t)0x22);
+        }
+        QCOMPARE(l1.miss(), (std::uint64_t)2);
+        QCOMPARE(l1.hit(), (std::uint64_t)2);
+        QCOMPARE(l1.victim_hits(), (std::uint64_t)2);
+        QCOMPARE(cycle_stats.memory_cycles - memory_cycles, (std::uint64_t)20);
+    }
+
+    // Every level below L2 needs its own stall counter
+    {
+        MachineConfig cc;
+        cc.set_lower_cache_count(CycleStatistics::LOWER_CACHE_LEVELS);
+        QCOMPARE(cc.lower_cache_count(), (unsigned)CycleStatistics::LOWER_CACHE_LEVELS);
+#ifdef QVERIFY_EXCEPTION_THROWN
+        QVERIFY_EXCEPTION_THROWN(cc.set_lower_cache_count(CycleStatistics::LOWER_CACHE_LEVELS + 1),
+                                 QtMipsExceptionInput);
+#endif
+        QCOMPARE(cc.lower_cache_count(), (unsigned)CycleStatistics::LOWER_CACHE_LEVELS);
+    }
+}
+
+void MachineTests::dram_controller() {
+    MachineConfig cc;
+    cc.set_dram_model(true);
+    cc.set_dram_banks(2);
+    cc.set_dram_row_bytes(16);
+    cc.set_dram_t_rcd(3);
+    cc.set_dram_t_cas(2);
+    cc.set_dram_t_rp(4);
+    MachineConfigCache l1_c(MemoryAccess::MemoryType::L1_DATA_CACHE);
+    l1_c.set_enabled(true);
+    l1_c.set_sets(32);
+    l1_c.set_blocks(1);
+    l1_c.set_associativity(1);
+
+    // Empty bank, open row, other row of the same bank and the other bank
+    {
+        Memory m;
+        DramController dram(&m, cc);
+        PhysAddrSpace phys(80, 80, 0);
+        phys.insert_range(&dram, 0x00000000, 0xefffffff, false);
+        Cache l1(l1_c, &phys, 1, 1, 0, 80, 80, 0);
+        m.write_word(0x40, 0x44);
+        std::uint64_t memory_cycles = cycle_stats.memory_cycles;
+        l1.read_word(0x0);
+        l1.read_word(0x4);
+        QCOMPARE(l1.read_word(0x40), (std::uint32_t)0x44);
+        l1.read_word(0x10);
+        QCOMPARE(dram.row_hits(), (std::uint64_t)1);
+        QCOMPARE(dram.row_misses(), (std::uint64_t)2);
+        QCOMPARE(dram.row_conflicts(), (std::uint64_t)1);
+        QCOMPARE(cycle_stats.memory_cycles - memory_cycles, (std::uint64_t)(5 + 2 + 9 + 5));
+        std::uint32_t cycles = 0;
+        QVERIFY(phys.last_access_cycles(cycles));
+        QCOMPARE(cycles, (std::uint32_t)5);
+    }
+
+    // Closed page never finds row open
+    cc.set_dram_page_policy(MachineConfig::DRAM_CLOSED_PAGE);
+    {
+        Memory m;
+        DramController dram(&m, cc);
+        PhysAddrSpace phys(80, 80, 0);
+        phys.insert_range(&dram, 0x00000000, 0xefffffff, false);
+        Cache l1(l1_c, &phys, 1, 1, 0, 80, 80, 0);
+        std::uint64_t memory_cycles = cycle_stats.memory_cycles;
+        l1.read_word(0x0);
+        l1.read_word(0x4);
+        QCOMPARE(dram.row_hits(), (std::uint64_t)0);
+        QCOMPARE(dram.row_misses(), (std::uint64_t)2);
+        QCOMPARE(cycle_stats.memory_cycles - memory_cycles, (std::uint64_t)10);
+    }
+
+    cc.set_dram_banks(0);
+    {
+        Memory m;
+#ifdef QVERIFY_EXCEPTION_THROWN
+        QVERIFY_EXCEPTION_THROWN(DramController(&m, cc), QtMipsExceptionInput);
+#endif
+    }
+}
+
+void MachineTests::cache_write_buffer() {
+    MachineConfigCache l1_c(MemoryAccess::MemoryType::L1_DATA_CACHE);
+    l1_c.set_enabled(true);
+    l1_c.set_sets(8);
+    l1_c.set_blocks(2);
+    l1_c.set_associativity(1);
+    l1_c.set_write_policy(MachineConfigCache::WritePolicy::WP_THROUGH);
+    l1_c.set_write_alloc(false);
+    l1_c.set_write_buffer_entries(2);
+
+    // Eager buffer writes the first line at once, second one waits behind it
+    {
+        Memory m;
+        Cache l1(l1_c, &m, 1, 1, 0, 10, 10, 0);
+        QVERIFY(l1.write_buffer() != nullptr);
+        std::uint64_t memory_cycles = cycle_stats.memory_cycles;
+        l1.write_word(0x0, 0x11);
+        l1.write_word(0x10, 0x22);
+        l1.write_word(0x14, 0x33);
+        QCOMPARE(l1.write_buffer()->combined(), (std::uint64_t)1);
+        QCOMPARE(cycle_stats.memory_cycles - memory_cycles, (std::uint64_t)0);
+        // Full buffer holds the store until the first line is written
+        l1.write_word(0x20, 0x44);
+        QCOMPARE(l1.write_buffer()->full_stalls(), (std::uint64_t)1);
+        QCOMPARE(cycle_stats.memory_cycles - memory_cycles, (std::uint64_t)10);
+        QCOMPARE(m.read_word(0x14), (std::uint32_t)0x33);
+        // Whole line is forwarded without lower level read, partial one has to be written first
+        QCOMPARE(l1.read_word(0x10), (std::uint32_t)0x22);
+        QCOMPARE(l1.write_buffer()->forwarded(), (std::uint64_t)1);
+        QCOMPARE(l1.lower_reads(), (std::uint64_t)0);
+        QCOMPARE(l1.miss(), (std::uint64_t)5);
+        QCOMPARE(cycle_stats.memory_cycles - memory_cycles, (std::uint64_t)10);
+        QCOMPARE(l1.read_word(0x20), (std::uint32_t)0x44);
+        QCOMPARE(l1.write_buffer()->load_stall_cycles(), (std::uint64_t)30);
+        QCOMPARE(l1.lower_reads(), (std::uint64_t)1);
+        QCOMPARE(cycle_stats.memory_cycles - memory_cycles, (std::uint64_t)50);
+        QCOMPARE(l1.write_buffer()->occupancy(), (unsigned)0);
+    }
+
+    // Buffer draining when full keeps the line open for combining
+    l1_c.set_write_buffer_drain(MachineConfigCache::WB_DRAIN_FULL);
+    {
+        Memory m;
+        Cache l1(l1_c, &m, 1, 1, 0, 10, 10, 0);
+        l1.write_word(0x0, 0x11);
+        l1.write_word(0x4, 0x22);
+        QCOMPARE(l1.write_buffer()->combined(), (std::uint64_t)1);
+        QCOMPARE(l1.write_buffer()->occupancy(), (unsigned)1);
+        l1.sync();
+        QCOMPARE(l1.write_buffer()->occupancy(), (unsigned)0);
+    }
+
+    // Write back cache has no buffer
+    l1_c.set_write_policy(MachineConfigCache::WritePolicy::WP_BACK);
+    {
+        Memory m;
+        Cache l1(l1_c, &m, 1, 1, 0, 10, 10, 0);
+        QVERIFY(l1.write_buffer() == nullptr);
+    }
 }
@@ -33,14 +33,31 @@
  *
  ******************************************************************************/
 
+#include <cmath>
 #include <QVector>
+#include <QTemporaryDir>
 #include "tst_machine.h"
 #include "core.h"
 #include "cache.h"
 #include "machineconfig.h"
+#include "bbvprofiler.h"
+#include "simpointselector.h"
+#include "samplingcontroller.h"
+#include "qtmipsmachine.h"
+#include "eventscheduler.h"
+#include "hlelibrary.h"
+#include "cpistack.h"
+#include "pipetrace.h"
+#include "branchpredictor.h"
+#include "branchtargetbuffer.h"
+#include "returnaddressstack.h"
+#include "serialport.h"
+#include "physaddrspace.h"
 
 using namespace machine;
 
+extern CycleStatistics cycle_stats;
+
 static void core_regs_data() {
     QTest::addColumn<Instruction>("i");
     QTest::addColumn<Registers>("init");
@@ -219,6 +236,10 @@ void MachineTests::pipecore_regs_data() {
     core_regs_data();
 }
 
+void MachineTests::dualcore_regs_data() {
+    core_regs_data();
+}
+
 void MachineTests::singlecore_regs() {
     QFETCH(Instruction, i);
     QFETCH(Registers, init);
@@ -259,6 +280,28 @@ void MachineTests::pipecore_regs() {
     QCOMPARE(mem, mem_used); // There should be no change in memory
 }
 
+void MachineTests::dualcore_regs() {
+    QFETCH(Instruction, i);
+    QFETCH(Registers, init);
+    QFETCH(Registers, res);
+
+    Memory mem; // Just memory (it shouldn't be used here except instruction)
+    mem.write_word(res.read_pc(), i.data()); // Store single instruction (anything else should be 0 so NOP effectively)
+    Memory mem_used(mem);
+
+    CoreDualTiming core(&init, &mem_used, &mem_used, true, ".");
+    res.pc_inc();
+    res.pc_inc();
+    // Instruction can be paired with following nop, which moves PC one more instruction ahead
+    for (int k = 0; k < 4 && init.read_pc() < res.read_pc(); k++)
+        core.step();
+    QVERIFY(init.read_pc() == res.read_pc() || init.read_pc() == res.read_pc() + 4);
+
+    res.pc_abs_jmp(init.read_pc());
+    QCOMPARE(init, res); // Same state as single cycle core reaches
+    QCOMPARE(mem, mem_used); // There should be no change in memory
+}
+
 static void core_jmp_data() {
     QTest::addColumn<Instruction>("i");
     QTest::addColumn<Registers>("regs");
@@ -741,6 +784,705 @@ void MachineTests::pipecorestall_alu_forward() {
     run_code_fragment(core, reg_init, reg_res, mem_init, mem_res, code);
 }
 
+void MachineTests::core_switch_data() {
+    core_alu_forward_data();
+}
+
+void MachineTests::core_switch() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Registers, reg_res);
+    Memory mem_init;
+    Memory mem_res;
+    CoreSingle single(&reg_init, &mem_init, &mem_init, true, ".");
+    CorePipelined pipelined(&reg_init, &mem_init, &mem_init, &mem_init, false, false, ".",
+                            MachineConfig::DHU_STALL_FORWARD, MachineConfig::CHU_DELAY_SLOT);
+    std::uint32_t addr = reg_init.read_pc();
+
+    foreach (uint32_t i, code) {
+        mem_init.write_word(addr, i);
+        mem_res.write_word(addr, i);
+        addr += 4;
+    }
+
+    // Switch while instruction is fetched ahead for delay slot
+    for (int k = 0; k < 3; k++)
+        single.step();
+    Core::ResumePoint rp = single.drain();
+    pipelined.take_over(&single);
+    pipelined.resume(rp);
+
+    for (int k = 10000; k ; k--) {
+        pipelined.step();
+        if (reg_init.read_pc() == reg_res.read_pc() && k > 6)
+            k = 6;
+    }
+    reg_res.pc_abs_jmp(reg_init.read_pc());
+    QCOMPARE(reg_init, reg_res);
+    QCOMPARE(mem_init, mem_res);
+}
+
+void MachineTests::core_run_data() {
+    core_alu_forward_data();
+}
+
+void MachineTests::core_run() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Registers, reg_res);
+    Memory mem_init;
+    Memory mem_res;
+    CorePipelined core(&reg_init, &mem_init, &mem_init, &mem_init, false, false, ".");
+    std::uint32_t addr = reg_init.read_pc();
+
+    foreach (uint32_t i, code) {
+        mem_init.write_word(addr, i);
+        mem_res.write_word(addr, i);
+        addr += 4;
+    }
+
+    QCOMPARE(core.run(3), Core::STOP_CYCLES);
+    QCOMPARE(core.get_cycles(), (std::uint64_t)3);
+    // Pipeline is drained by few more cycles after end of the fragment is fetched
+    core.set_program_end(reg_res.read_pc());
+    QCOMPARE(core.run(10000, Core::STOP_PROGRAM_END), Core::STOP_PROGRAM_END);
+    QVERIFY(core.get_cycles() < 10000);
+    QCOMPARE(core.run(6, Core::STOP_NONE), Core::STOP_CYCLES);
+    reg_res.pc_abs_jmp(reg_init.read_pc());
+    QCOMPARE(reg_init, reg_res);
+    QCOMPARE(mem_init, mem_res);
+}
+
+void MachineTests::bbv_simpoint() {
+    BbvProfiler bbv(96, false);
+    Instruction nop(0x00000000);
+    Instruction bne(0x1620fff9); // bne s1,zero,-7
+
+    // Two program phases as loops of different length: A B A
+    for (int phase = 0; phase < 3; phase++) {
+        std::uint32_t base = phase == 1 ? 0x80020200 : 0x80020100;
+        std::uint32_t len = phase == 1 ? 4 : 8;
+        for (int i = 0; i < 10 * 96 / (int)len; i++) {
+            for (std::uint32_t k = 0; k < len - 1; k++)
+                bbv.retire(base + 4 * k, nop);
+            bbv.retire(base + 4 * (len - 1), bne);
+        }
+    }
+    bbv.finish();
+    QCOMPARE(bbv.vectors().size(), 30);
+    QCOMPARE(bbv.vectors()[0].size(), 1);
+    QCOMPARE(bbv.vectors()[0][0].second, (std::uint64_t)96);
+    QCOMPARE(bbv.block_address(bbv.vectors()[15][0].first), (std::uint32_t)0x80020200);
+
+    SimPointSelector selector(5);
+    QVector<SimPointSelector::Region> regions = selector.select(bbv.vectors());
+    QCOMPARE(selector.clusters(), 2u);
+    QCOMPARE(regions.size(), 2);
+    // Representative of phase A can be taken from its first or second run
+    bool first_a = regions[0].interval < 10 || regions[0].interval >= 20;
+    double weight_a = first_a ? regions[0].weight : regions[1].weight;
+    QVERIFY(qAbs(weight_a - 2.0 / 3) < 1e-6);
+}
+
+// Loop summing loaded word, jump to 0xf0000000 ends the program
+static void sampling_program(QtMipsMachine &machine, std::uint32_t iterations) {
+    const std::uint32_t code[] = {
+        0x3c0cf000, // lui t4,0xf000
+        0x240b0000 | iterations, // addiu t3,zero,iterations
+        0x8c090100, // loop: lw t1,0x100(zero)
+        0x01495021, // addu t2,t2,t1 (load use stall)
+        0x256bffff, // addiu t3,t3,-1
+        0x1560fffc, // bne t3,zero,loop
+        0x00000000, // nop
+        0x01800008, // jr t4
+        0x00000000, // nop
+    };
+    std::uint32_t addr = machine.registers()->read_pc();
+    for (std::uint32_t i : code) {
+        machine.memory_rw()->write_word(addr, i);
+        addr += 4;
+    }
+    machine.memory_rw()->write_word(0x100, 3);
+    machine.core_rw()->reset();
+}
+
+void MachineTests::core_sampling() {
+    const std::uint32_t iterations = 3800;
+    MachineConfig config;
+    config.set_ram_access_read(1);
+    config.set_ram_access_write(1);
+    config.set_ram_access_burst(0);
+
+    // Whole run by pipelined core, instructions in flight at the end are
+    // drained and finished by functional core to get the same total
+    config.set_pipelined(true);
+    QtMipsMachine full(config, false, false);
+    sampling_program(full, iterations);
+    while (!full.program_end_reached())
+        full.advance_core();
+    double full_cpi = (double)cycle_stats.total_cycles / cycle_stats.instructions;
+    full.switch_core(false);
+    while (!full.program_end_reached())
+        full.advance_core();
+    std::uint64_t full_instructions = cycle_stats.instructions;
+    QCOMPARE(full.registers()->read_gp(10), 3 * iterations);
+
+    // Window length is not multiple of the loop length and period shifts
+    // windows by one instruction, so windows differ in stall cycles. Program
+    // ends in fast forward after nine periods.
+    config.set_pipelined(false);
+    QtMipsMachine machine(config, false, false);
+    sampling_program(machine, iterations);
+    SamplingController sampler(&machine, 2001, 200, 502);
+    QVector<double> cpis;
+    unsigned switches = 0;
+    bool windows_pipelined = true;
+    QObject::connect(&machine, &QtMipsMachine::core_switched, [&switches](bool pipelined) {
+        if (pipelined)
+            switches++;
+    });
+    QObject::connect(&sampler, &SamplingController::sample_done, [&](unsigned, double cpi) {
+        windows_pipelined = windows_pipelined && machine.core_is_pipelined();
+        cpis.append(cpi);
+    });
+    sampler.run();
+    QCOMPARE(sampler.samples(), 9u);
+    QCOMPARE(switches, sampler.samples());
+    QVERIFY(windows_pipelined);
+    QCOMPARE(sampler.instructions(), full_instructions);
+    QCOMPARE(machine.registers()->read_gp(10), 3 * iterations);
+    QVERIFY(qAbs(sampler.cpi() - full_cpi) <= sampler.cpi_error());
+
+    // Half width of the interval is normal quantile times standard error
+    double mean = 0, var = 0;
+    for (double c : cpis)
+        mean += c;
+    mean /= cpis.size();
+    for (double c : cpis)
+        var += (c - mean) * (c - mean);
+    double se = std::sqrt(var / (cpis.size() - 1) / cpis.size());
+    QVERIFY(se > 0);
+    QVERIFY(qAbs(sampler.cpi() - mean) < 1e-12);
+    QVERIFY(qAbs(sampler.cpi_error() - 1.959964 * se) < 1e-6 * se);
+    QVERIFY(sampler.report().contains("confidence: 95%"));
+    QVERIFY(sampler.report().contains("samples: 9\n"));
+    sampler.set_confidence(0.99);
+    QVERIFY(qAbs(sampler.cpi_error() - 2.575829 * se) < 1e-6 * se);
+    QVERIFY(sampler.report().contains("confidence: 99%"));
+
+    // Weighted region is extrapolated without confidence interval
+    QtMipsMachine regions_machine(config, false, false);
+    sampling_program(regions_machine, iterations);
+    SamplingController regions_sampler(&regions_machine, 2001, 200, 502);
+    QVector<SimPointSelector::Region> regions{{5, 0, 1.0}};
+    regions_sampler.run_regions(regions, 1000);
+    QCOMPARE(regions_sampler.samples(), 1u);
+    QCOMPARE(regions_sampler.instructions(), full_instructions);
+    QVERIFY(qAbs(regions_sampler.cpi() - full_cpi) < 0.01);
+    QVERIFY(!regions_sampler.report().contains("confidence"));
+}
+
+void MachineTests::core_count_compare_event() {
+    std::uint64_t irq_cycle[2];
+    std::uint32_t irq_count[2];
+
+    // Timer interrupt has to be taken at the same cycle when polled and when scheduled
+    for (int sched = 0; sched < 2; sched++) {
+        QVector<uint32_t> code{
+            0x40885800, // mtc0 t0,Compare
+            0x40896000, // mtc0 t1,Status
+            0x1000ffff, // b .
+            0x00000000, // nop
+        };
+        Registers regs;
+        Memory mem;
+        Cop0State cop0;
+        EventScheduler events;
+        std::uint32_t addr = regs.read_pc();
+        foreach (uint32_t i, code) {
+            mem.write_word(addr, i);
+            addr += 4;
+        }
+        regs.write_gp(8, 40);
+        regs.write_gp(9, Cop0State::Status_IE | (Cop0State::Status_Int0 << 7));
+        CoreSingle core(&regs, &mem, &mem, true, ".", 1, &cop0);
+        core.set_stop_on_exception(EXCAUSE_INT, false);
+        if (sched) {
+            core.set_event_scheduler(&events);
+            cop0.set_event_scheduler(&events);
+        }
+        while (regs.read_pc() != 0x80000180 && core.get_cycles() < 1000)
+            core.step();
+        irq_cycle[sched] = core.get_cycles();
+        irq_count[sched] = cop0.read_cop0reg(Cop0State::Count);
+        QVERIFY(cop0.read_cop0reg(Cop0State::Cause) & (Cop0State::Status_Int0 << 7));
+    }
+    QVERIFY(irq_cycle[0] < 1000);
+    QCOMPARE(irq_cycle[1], irq_cycle[0]);
+    QCOMPARE(irq_count[1], irq_count[0]);
+}
+
+void MachineTests::core_idle_skip() {
+    std::uint64_t irq_cycle[2];
+    CycleStatistics stats[2];
+
+    // Waiting for timer interrupt in empty loop, skipped iterations have to be accounted
+    for (int skip = 0; skip < 2; skip++) {
+        QVector<uint32_t> code{
+            0x40885800, // mtc0 t0,Compare
+            0x40896000, // mtc0 t1,Status
+            0x1000ffff, // b .
+            0x00000000, // nop
+        };
+        Registers regs;
+        Memory mem;
+        Cop0State cop0;
+        EventScheduler events;
+        std::uint32_t addr = regs.read_pc();
+        foreach (uint32_t i, code) {
+            mem.write_word(addr, i);
+            addr += 4;
+        }
+        regs.write_gp(8, 5000);
+        regs.write_gp(9, Cop0State::Status_IE | (Cop0State::Status_Int0 << 7));
+        CoreSingle core(&regs, &mem, &mem, true, ".", 1, &cop0);
+        core.reset();
+        core.set_event_scheduler(&events);
+        cop0.set_event_scheduler(&events);
+        core.set_idle_loop_skip(skip);
+        QCOMPARE(core.run(100000, Core::STOP_EXCEPTION), Core::STOP_EXCEPTION);
+        QCOMPARE(regs.read_pc(), (std::uint32_t)0x80000180);
+        irq_cycle[skip] = core.get_cycles();
+        stats[skip] = cycle_stats;
+    }
+    QCOMPARE(irq_cycle[1], irq_cycle[0]);
+    QCOMPARE(stats[1].total_cycles, stats[0].total_cycles);
+    QCOMPARE(stats[1].instructions, stats[0].instructions);
+    QCOMPARE(stats[0].idle_skipped_cycles, (std::uint64_t)0);
+    QVERIFY(stats[1].idle_skipped_cycles > 4000);
+
+    // Loops polling serial port or Count. Status register read has no side effect,
+    // data register read takes received byte, Count is skipped up to Compare
+    const struct {
+        std::uint32_t poll;
+        bool idle;
+    } polls[] = {
+        {0x8c0bc000, true}, // lw t3,-16384(zero) receiver status
+        {0x8c0bc004, false}, // lw t3,-16380(zero) receiver data
+        {0x400b4800, true}, // mfc0 t3,Count
+    };
+    for (const auto &p : polls) {
+        std::uint32_t t3[2];
+        for (int skip = 0; skip < 2; skip++) {
+            QVector<uint32_t> code{
+                0x40885800, // mtc0 t0,Compare
+                0x40896000, // mtc0 t1,Status
+                p.poll,
+                0x1000fffe, // b .-4
+                0x00000000, // nop
+            };
+            Registers regs;
+            Memory mem;
+            SerialPort ser_port;
+            PhysAddrSpace phys(1, 1, 0);
+            Cop0State cop0;
+            EventScheduler events;
+            phys.insert_range(&mem, 0x00000000, 0xefffffff, false);
+            phys.insert_range(&ser_port, 0xffffc000, 0xffffc03f, false);
+            std::uint32_t addr = regs.read_pc();
+            foreach (uint32_t i, code) {
+                mem.write_word(addr, i);
+                addr += 4;
+            }
+            regs.write_gp(8, 5000);
+            regs.write_gp(9, Cop0State::Status_IE | (Cop0State::Status_Int0 << 7));
+            CoreSingle core(&regs, &phys, &phys, true, ".", 1, &cop0);
+            core.reset();
+            core.set_event_scheduler(&events);
+            cop0.set_event_scheduler(&events);
+            ser_port.set_event_scheduler(&events);
+            core.set_idle_loop_skip(skip);
+            QCOMPARE(core.run(100000, Core::STOP_EXCEPTION), Core::STOP_EXCEPTION);
+            QCOMPARE(regs.read_pc(), (std::uint32_t)0x80000180);
+            irq_cycle[skip] = core.get_cycles();
+            t3[skip] = regs.read_gp(11);
+        }
+        QCOMPARE(irq_cycle[1], irq_cycle[0]);
+        QCOMPARE(t3[1], t3[0]);
+        QCOMPARE(cycle_stats.idle_skipped_cycles > 4000, p.idle);
+    }
+}
+
+void MachineTests::core_hle() {
+    // Body of strlen is break, it is never executed when call is emulated
+    for (int delay_slot = 0; delay_slot < 2; delay_slot++) {
+        Registers regs;
+        Memory mem;
+        std::uint32_t start = regs.read_pc();
+        std::uint32_t entry = start + 0x100;
+        QVector<uint32_t> code{
+            0x0c000000 | ((entry >> 2) & 0x3ffffff), // jal strlen
+            0x00000000, // nop
+            0x1000ffff, // b .
+            0x00000000, // nop
+        };
+        std::uint32_t addr = start;
+        foreach (uint32_t i, code) {
+            mem.write_word(addr, i);
+            addr += 4;
+        }
+        mem.write_word(entry, 0x0000000d); // break
+        const char *str = "hello";
+        for (std::uint32_t i = 0; i <= 5; i++)
+            mem.write_byte(0x80021000 + i, str[i]);
+        regs.write_gp(4, 0x80021000);
+
+        HleLibrary hle;
+        hle.add(entry, HleLibrary::HLE_STRLEN);
+        CoreSingle core(&regs, &mem, &mem, delay_slot, ".", 1);
+        core.set_hle_library(&hle);
+        core.reset();
+        for (int i = 0; i < 10; i++)
+            core.step();
+        QCOMPARE(regs.read_gp(2), (std::uint32_t)5);
+        QCOMPARE(hle.calls(HleLibrary::HLE_STRLEN), (std::uint64_t)1);
+        QVERIFY(regs.read_pc() >= start + 4 && regs.read_pc() <= start + 0xc);
+        QVERIFY(core.get_cycles() >= 10 + HleLibrary::default_cost(HleLibrary::HLE_STRLEN, 5) - 1);
+    }
+
+    Registers regs;
+    Memory mem;
+    HleLibrary hle;
+    hle.add(0x1000, HleLibrary::HLE_MEMCPY);
+    hle.add(0x2000, HleLibrary::HLE_MEMSET);
+    for (std::uint32_t i = 0; i < 10; i++)
+        mem.write_byte(0x80021000 + i, i + 1);
+
+    regs.write_gp(4, 0x80021100);
+    regs.write_gp(5, 0x80021000);
+    regs.write_gp(6, 10);
+    regs.write_gp(31, 0x80020008);
+    hle.call(0x1000, &regs, &mem);
+    QCOMPARE(regs.read_gp(2), (std::uint32_t)0x80021100);
+    QCOMPARE(regs.read_pc(), (std::uint32_t)0x80020008);
+    for (std::uint32_t i = 0; i < 10; i++)
+        QCOMPARE(mem.read_byte(0x80021100 + i), (std::uint8_t)(i + 1));
+    QCOMPARE(mem.read_byte(0x8002110a), (std::uint8_t)0);
+
+    regs.write_gp(4, 0x80021201);
+    regs.write_gp(5, 0x1aa);
+    regs.write_gp(6, 9);
+    hle.call(0x2000, &regs, &mem);
+    QCOMPARE(regs.read_gp(2), (std::uint32_t)0x80021201);
+    QCOMPARE(mem.read_byte(0x80021200), (std::uint8_t)0);
+    for (std::uint32_t i = 1; i <= 9; i++)
+        QCOMPARE(mem.read_byte(0x80021200 + i), (std::uint8_t)0xaa);
+    QCOMPARE(mem.read_byte(0x8002120a), (std::uint8_t)0);
+}
+
+void MachineTests::core_perf_counter() {
+    std::uint64_t irq_cycle[2];
+
+    // Counter of retired instructions overflows to bit 31 in waiting loop
+    for (int sched = 0; sched < 2; sched++) {
+        QVector<uint32_t> code{
+            0x4088c801, // mtc0 t0,PerfCnt0
+            0x4089c800, // mtc0 t1,PerfCtl0
+            0x408a6000, // mtc0 t2,Status
+            0x1000ffff, // b .
+            0x00000000, // nop
+        };
+        Registers regs;
+        Memory mem;
+        Cop0State cop0;
+        EventScheduler events;
+        std::uint32_t addr = regs.read_pc();
+        foreach (uint32_t i, code) {
+            mem.write_word(addr, i);
+            addr += 4;
+        }
+        regs.write_gp(8, 0x7ffffff0);
+        regs.write_gp(9, (Cop0State::PERF_INSTRUCTIONS << Cop0State::PerfCtl_EventShift) |
+                         Cop0State::PerfCtl_IE | Cop0State::PerfCtl_K);
+        regs.write_gp(10, Cop0State::Status_IE | (Cop0State::Status_Int0 << 6));
+        CoreSingle core(&regs, &mem, &mem, true, ".", 1, &cop0);
+        core.set_stop_on_exception(EXCAUSE_INT, false);
+        if (sched) {
+            core.set_event_scheduler(&events);
+            cop0.set_event_scheduler(&events);
+        }
+        while (regs.read_pc() != 0x80000180 && core.get_cycles() < 1000)
+            core.step();
+        irq_cycle[sched] = core.get_cycles();
+        QVERIFY(cop0.read_cop0reg(Cop0State::Cause) & Cop0State::Cause_PCI);
+        QVERIFY(cop0.read_cop0reg(Cop0State::PerfCnt0) & 0x80000000);
+        QCOMPARE(cop0.read_cop0reg(Cop0State::PerfCtl0) & Cop0State::PerfCtl_M,
+                 (std::uint32_t)Cop0State::PerfCtl_M);
+
+        // Writing counter acknowledges the interrupt
+        cop0.write_cop0reg(Cop0State::PerfCnt0, 0);
+        QVERIFY(!(cop0.read_cop0reg(Cop0State::Cause) & Cop0State::Cause_PCI));
+    }
+    QVERIFY(irq_cycle[0] < 1000);
+    QCOMPARE(irq_cycle[1], irq_cycle[0]);
+}
+
+void MachineTests::cpi_stack() {
+    CpiStack stack(100, 3);
+    CycleStatistics stats;
+
+    for (int i = 1; i <= 4; i++) {
+        stats.total_cycles += 100;
+        stats.instructions += 50;
+        stats.data_hazard_stalls += 10;
+        stats.control_hazard_stalls += 20 + i;
+        stats.branch_flush_stalls += i;
+        stats.l1_data_stall_cycles_total += 5;
+        stats.ram_data_stall_cycles_total += 4;
+        stack.sample(stats);
+    }
+    // The oldest sample was overwritten
+    QCOMPARE(stack.size(), 3u);
+    QCOMPARE(stack.dropped(), (std::uint64_t)1);
+    const CpiStack::Sample &s = stack.at(0);
+    QCOMPARE(s.cycle, (std::uint64_t)200);
+    QCOMPARE(s.cycles, (std::uint64_t)100);
+    QCOMPARE(s.instructions, (std::uint64_t)50);
+    QCOMPARE(s.components[CpiStack::CPI_BRANCH_FLUSH], (std::uint64_t)2);
+    QCOMPARE(s.components[CpiStack::CPI_CONTROL_HAZARD], (std::uint64_t)20);
+    QCOMPARE(s.components[CpiStack::CPI_DRAM], (std::uint64_t)4);
+    QCOMPARE(s.components[CpiStack::CPI_BASE], (std::uint64_t)(100 - 10 - 22 - 5 - 4));
+    QCOMPARE(s.cpi(CpiStack::CPI_DATA_HAZARD), 0.2);
+    QCOMPARE(stack.at(2).cycle, (std::uint64_t)400);
+    QCOMPARE(stack.to_csv().count("\n"), 4);
+
+    stack.clear(stats);
+    QCOMPARE(stack.size(), 0u);
+    stack.sample(stats);
+    QCOMPARE(stack.at(0).cpi(CpiStack::CPI_BASE), 0.0);
+}
+
+void MachineTests::pipe_trace() {
+    QTemporaryDir dir;
+    QString path = dir.filePath("trace.out");
+    {
+        PipeTrace trace(path, 1000);
+        std::uint64_t sw = trace.fetch(1, 0x80020000, Instruction(0xae080004)); // sw t0,4(s0)
+        std::uint64_t nop = trace.fetch(2, 0x80020004, Instruction(0x00000000));
+        QVERIFY(sw != 0 && nop != sw);
+        trace.stage(sw, PipeTrace::STAGE_DECODE, 2);
+        trace.stage(sw, PipeTrace::STAGE_DECODE, 3); // Stalled in decode
+        trace.stage(sw, PipeTrace::STAGE_EXECUTE, 4);
+        trace.stage(sw, PipeTrace::STAGE_MEMORY, 5);
+        trace.retire(sw, 6);
+        // Second fetch was flushed and is written when trace is closed
+        std::uint64_t live[] = { sw };
+        trace.end_cycle(live, 1);
+    }
+    QFile f(path);
+    QVERIFY(f.open(QIODevice::ReadOnly | QIODevice::Text));
+    QStringList lines = QString(f.readAll()).split('\n', QString::SkipEmptyParts);
+    QCOMPARE(lines.size(), 14);
+    QVERIFY(lines[0].startsWith("O3PipeView:fetch:1000:0x80020000:0:1:"));
+    QCOMPARE(lines[1], QString("O3PipeView:decode:2000"));
+    QCOMPARE(lines[4], QString("O3PipeView:issue:4000"));
+    QCOMPARE(lines[5], QString("O3PipeView:complete:5000"));
+    QCOMPARE(lines[6], QString("O3PipeView:retire:6000:store:5000"));
+    QVERIFY(lines[7].startsWith("O3PipeView:fetch:2000:0x80020004:0:2:"));
+    QCOMPARE(lines[13], QString("O3PipeView:retire:0:store:0"));
+}
+
+void MachineTests::pipecore_mdu_latency() {
+    const struct {
+        QVector<uint32_t> code;
+        std::uint32_t lo;
+        std::uint64_t stalls;
+    } progs[] = {
+        {{0x01090018, 0x00005012}, 42, 4}, // mult t0,t1; mflo t2
+        // Multiplier accepts new operation every cycle, mflo waits for the second one
+        {{0x01090018, 0x01090018, 0x00005012}, 42, 4},
+        // Iterative divider is busy for the whole operation
+        {{0x0109001a, 0x0109001a, 0x00005012}, 1, 18}, // div t0,t1; div t0,t1; mflo t2
+    };
+
+    for (const auto &p : progs) {
+        for (int enabled = 0; enabled < 2; enabled++) {
+            Registers regs;
+            Memory mem;
+            std::uint32_t addr = regs.read_pc();
+            foreach (uint32_t i, p.code) {
+                mem.write_word(addr, i);
+                addr += 4;
+            }
+            regs.write_gp(8, 7);
+            regs.write_gp(9, 6);
+            CorePipelined core(&regs, &mem, &mem, &mem, false, false, ".");
+            core.set_mdu_timing(enabled, 5, 1, 10, 10);
+            core.reset();
+            for (int i = 0; i < 60; i++)
+                core.step();
+            QCOMPARE(regs.read_gp(10), p.lo);
+            QCOMPARE(cycle_stats.mdu_stalls, enabled ? p.stalls : 0);
+            QCOMPARE(cycle_stats.data_hazard_stalls, (std::uint64_t)0);
+        }
+    }
+
+#ifdef QVERIFY_EXCEPTION_THROWN
+    Registers regs;
+    Memory mem;
+    CorePipelined core(&regs, &mem, &mem, &mem, false, false, ".");
+    QVERIFY_EXCEPTION_THROWN(core.set_mdu_timing(true, 0, 1, 10, 10), QtMipsExceptionInput);
+#endif
+}
+
+void MachineTests::dualcore_issue() {
+    // First cycle only fetches the instruction for delay slot semantics
+    const struct {
+        QVector<uint32_t> code;
+        int steps;
+        std::uint8_t reg;
+        std::uint32_t value;
+        std::uint64_t paired;
+        std::uint64_t stalls;
+    } progs[] = {
+        // addiu t0,zero,1; addiu t1,zero,2; addu t2,t0,t1 (pairs with following nop)
+        {{0x24080001, 0x24090002, 0x01095021}, 3, 10, 3, 2, 0},
+        // Result is not forwarded within the pair
+        {{0x24080001, 0x01084821}, 3, 9, 2, 1, 0}, // addiu t0,zero,1; addu t1,t0,t0
+        // Single data port
+        {{0x8c080100, 0x8c090104}, 3, 9, 21, 1, 0}, // lw t0,0x100(zero); lw t1,0x104(zero)
+        // Loaded value is available one cycle later
+        {{0x8c080100, 0x01084821}, 4, 9, 42, 1, 1}, // lw t0,0x100(zero); addu t1,t0,t0
+        // Single HI/LO access, HI/LO result is available in the next cycle
+        {{0x24080003, 0x01080018, 0x00004812}, 4, 9, 9, 1, 0}, // addiu t0,zero,3; mult t0,t0; mflo t1
+    };
+
+    for (const auto &p : progs) {
+        Registers regs;
+        Memory mem;
+        std::uint32_t addr = regs.read_pc();
+        foreach (uint32_t i, p.code) {
+            mem.write_word(addr, i);
+            addr += 4;
+        }
+        mem.write_word(0x100, 21);
+        mem.write_word(0x104, 21);
+        CoreDualTiming core(&regs, &mem, &mem, true, ".");
+        core.reset();
+        for (int i = 0; i < p.steps; i++)
+            core.step();
+        QCOMPARE(regs.read_gp(p.reg), p.value);
+        QCOMPARE(cycle_stats.paired_issues, p.paired);
+        QCOMPARE(cycle_stats.data_hazard_stalls, p.stalls);
+    }
+
+    // Taken jump without delay slot discards fall through fetch
+    {
+        Registers regs;
+        Memory mem;
+        mem.write_word(regs.read_pc(), 0x08008002); // j 0x80020008
+        mem.write_word(regs.read_pc() + 4, 0x24080001); // addiu t0,zero,1
+        mem.write_word(regs.read_pc() + 8, 0x24090002); // addiu t1,zero,2
+        CoreDualTiming core(&regs, &mem, &mem, false, ".");
+        core.reset();
+        for (int i = 0; i < 3; i++)
+            core.step();
+        QCOMPARE(regs.read_gp(8), (std::uint32_t)0);
+        QCOMPARE(regs.read_gp(9), (std::uint32_t)2);
+        QCOMPARE(cycle_stats.control_hazard_stalls, (std::uint64_t)1);
+        QCOMPARE(cycle_stats.paired_issues, (std::uint64_t)1);
+    }
+
+    // Memory stalls are accounted to the stream which caused them
+    {
+        Registers regs;
+        Memory mem(5, 5, 1);
+        mem.write_word(regs.read_pc(), 0x8c080100); // lw t0,0x100(zero)
+        mem.write_word(0x100, 21);
+        CoreDualTiming core(&regs, &mem, &mem, true, ".");
+        core.reset();
+        // Fetch of lw, then fetches of the pair and load of lw
+        for (int i = 0; i < 18; i++)
+            core.step();
+        QCOMPARE(regs.read_gp(8), (std::uint32_t)21);
+        QCOMPARE(cycle_stats.paired_issues, (std::uint64_t)1);
+        QCOMPARE(cycle_stats.ram_program_stall_cycles_total, (std::uint64_t)12);
+        QCOMPARE(cycle_stats.ram_data_stall_cycles_total, (std::uint64_t)4);
+    }
+}
+
+void MachineTests::branch_predictor_history() {
+    Instruction beq(0x10000004); // beq zero,zero,0x14
+    GShareBranchPredictor gshare(6);
+    TournamentBranchPredictor tournament(6);
+    TageBranchPredictor tage(6);
+    HistoryBranchPredictor *preds[] = {&gshare, &tournament, &tage};
+
+    for (HistoryBranchPredictor *bp : preds) {
+        bool accessed_btb;
+        // Alternating branch is never learned by two bit counters alone
+        for (int i = 0; i < 200; i++) {
+            bool taken = i % 2;
+            bp->predict(beq, 0x80020000, accessed_btb);
+            bp->update_bht(taken, true, taken ? 0x80020014 : 0x80020004);
+        }
+        QVERIFY(bp->accuracy() > 90.0);
+        bp->reset();
+        QCOMPARE(bp->history(), (std::uint64_t)0);
+    }
+    QCOMPARE(gshare.providers(), 0);
+    QCOMPARE(tournament.providers(), 2);
+    QCOMPARE(tage.providers(), 1 + TageBranchPredictor::TAGE_TABLES);
+}
+
+void MachineTests::btb_ras() {
+    // Two sets of two ways, even word addresses share set 0
+    BranchTargetBuffer btb(2, 2, MachineConfigCache::RP_LRU);
+    std::uint32_t address;
+    btb.update(0x80020000, 0x80020100);
+    btb.update(0x80020008, 0x80020200);
+    QVERIFY(btb.pc_address(0x80020000, &address));
+    btb.update(0x80020010, 0x80020300); // Evicts least recently used 0x80020008
+    QVERIFY(!btb.pc_address(0x80020008, &address));
+    QVERIFY(btb.pc_address(0x80020010, &address));
+    QCOMPARE(address, (std::uint32_t)0x80020300);
+    QCOMPARE(btb.lookups(), (std::uint64_t)3);
+    QCOMPARE(btb.hits(), (std::uint64_t)2);
+
+    Instruction jal(0x0c008040); // jal 0x80020100
+    Instruction jr_ra(0x03e00008); // jr ra
+    TwoBitBranchPredictor bp(4);
+    bool accessed_btb;
+    bp.set_ras_depth(2);
+    bp.predict(jal, 0x80020000, accessed_btb);
+    bp.update_bht(true, false, 0x80020100);
+    QCOMPARE(bp.predict(jr_ra, 0x80020104, accessed_btb), (std::uint32_t)0x80020004);
+    QVERIFY(!accessed_btb);
+    bp.update_bht(true, false, 0x80020004);
+    QCOMPARE(bp.ras()->predictions(), (std::uint64_t)1);
+    QCOMPARE(bp.ras()->hits(), (std::uint64_t)1);
+    // Empty stack falls back to branch target buffer
+    bp.predict(jr_ra, 0x80020104, accessed_btb);
+    QVERIFY(accessed_btb);
+    bp.update_bht(true, false, 0x80020004);
+
+    // Call on the wrong path of mispredicted branch is dropped from the stack
+    Instruction beq(0x10000004); // beq zero,zero,0x14
+    bp.predict(jal, 0x80020000, accessed_btb);
+    bp.update_bht(true, false, 0x80020100);
+    bp.predict(beq, 0x80020100, accessed_btb);
+    bp.predict(jal, 0x80020104, accessed_btb);
+    QCOMPARE(bp.ras()->size(), 2u);
+    bp.restore_ras(true);
+    bp.update_bht(true, true, 0x80020114);
+    QCOMPARE(bp.ras()->size(), 1u);
+    QCOMPARE(bp.predict(jr_ra, 0x80020114, accessed_btb), (std::uint32_t)0x80020004);
+    bp.update_bht(true, false, 0x80020004);
+    bp.add_saved_cycles(false, 1);
+    QCOMPARE(bp.ras_saved_cycles(), (std::uint64_t)1);
+    QCOMPARE(bp.btb_saved_cycles(), (std::uint64_t)0);
+}
+
 /*======================================================================*/
 
 static void core_memory_tests_data() {
@@ -953,6 +1695,10 @@ void MachineTests::pipecore_wb_memory_tests_data() {
     core_memory_tests_data();
 }
 
+void MachineTests::dualcore_memory_tests_data() {
+    core_memory_tests_data();
+}
+
 void MachineTests::singlecore_memory_tests() {
     QFETCH(QVector<uint32_t>, code);
     QFETCH(Registers, reg_init);
@@ -963,6 +1709,16 @@ void MachineTests::singlecore_memory_tests() {
     run_code_fragment(core, reg_init, reg_res, mem_init, mem_res, code);
 }
 
+void MachineTests::dualcore_memory_tests() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Registers, reg_res);
+    QFETCH(Memory, mem_init);
+    QFETCH(Memory, mem_res);
+    CoreDualTiming core(&reg_init, &mem_init, &mem_init, true, ".");
+    run_code_fragment(core, reg_init, reg_res, mem_init, mem_res, code);
+}
+
 void MachineTests::pipecore_nc_memory_tests() {
     QFETCH(QVector<uint32_t>, code);
     QFETCH(Registers, reg_init);
@@ -1011,6 +1767,59 @@ void MachineTests::pipecore_wt_a_memory_tests() {
     run_code_fragment(core, reg_init, reg_res, mem_init, mem_res, code);
 }
 
+void MachineTests::pipecore_skip_stall_data() {
+    core_memory_tests_data();
+}
+
+void MachineTests::pipecore_skip_stall() {
+    QFETCH(QVector<uint32_t>, code);
+    QFETCH(Registers, reg_init);
+    QFETCH(Memory, mem_init);
+    MachineConfigCache cache_conf;
+    cache_conf.set_enabled(true);
+    cache_conf.set_sets(4);
+    cache_conf.set_blocks(2);
+    cache_conf.set_associativity(2);
+    cache_conf.set_replacement_policy(MachineConfigCache::ReplacementPolicy::RP_LRU);
+    cache_conf.set_write_policy(MachineConfigCache::WritePolicy::WP_BACK);
+    Registers regs[2] = {reg_init, reg_init};
+    Memory mem[2] = {mem_init, mem_init};
+    CycleStatistics stats[2];
+    const std::uint64_t run_cycles = 3000;
+
+    // Same program is run cycle by cycle and with stalls skipped
+    for (int skip = 0; skip < 2; skip++) {
+        std::uint32_t addr = reg_init.read_pc();
+        foreach (uint32_t i, code) {
+            mem[skip].write_word(addr, i);
+            addr += 4;
+        }
+        MachineConfigCache i_conf(cache_conf), d_conf(cache_conf);
+        i_conf.set_type(MemoryAccess::MemoryType::L1_PROGRAM_CACHE);
+        d_conf.set_type(MemoryAccess::MemoryType::L1_DATA_CACHE);
+        Cache i_cache(i_conf, &mem[skip], 1, 1, 1, 10, 10, 2);
+        Cache d_cache(d_conf, &mem[skip], 1, 1, 1, 10, 10, 2);
+        CorePipelined core(&regs[skip], &i_cache, &d_cache, &i_cache, true, true, ".");
+        core.reset();
+        while (core.get_cycles() < run_cycles) {
+            if (!skip || core.skip_stall((std::uint32_t)(run_cycles - core.get_cycles())) == 0)
+                core.step();
+        }
+        d_cache.sync();
+        stats[skip] = cycle_stats;
+        QCOMPARE(core.get_cycles(), run_cycles);
+    }
+    QCOMPARE(regs[1], regs[0]);
+    QCOMPARE(mem[1], mem[0]);
+    QCOMPARE(stats[1].total_cycles, stats[0].total_cycles);
+    QCOMPARE(stats[1].instructions, stats[0].instructions);
+    QCOMPARE(stats[1].memory_cycles, stats[0].memory_cycles);
+    QCOMPARE(stats[1].data_hazard_stalls, stats[0].data_hazard_stalls);
+    QCOMPARE(stats[1].control_hazard_stalls, stats[0].control_hazard_stalls);
+    QCOMPARE(stats[1].l1_data_stall_cycles_total, stats[0].l1_data_stall_cycles_total);
+    QCOMPARE(stats[1].l1_program_stall_cycles_total, stats[0].l1_program_stall_cycles_total);
+}
+
 void MachineTests::pipecore_wb_memory_tests() {
     QFETCH(QVector<uint32_t>, code);
     QFETCH(Registers, reg_init);
@@ -61,4 +61,17 @@ void MachineTests::instruction_access() {
     QCOMPARE(i.address(), (std::uint32_t) 0x3ffffff);
 }
 
-// TODO test to_str
+// Test disassembly, including the same words at different addresses
+void MachineTests::instruction_to_str() {
+    QCOMPARE(Instruction(0x0).to_str(), QString("NOP"));
+    QCOMPARE(Instruction(0x10000003).to_str(0x0), QString("BEQ $0, $0, 0x10"));
+    QCOMPARE(Instruction(0x10000003).to_str(0x100), QString("BEQ $0, $0, 0x110"));
+    QCOMPARE(Instruction(0x10000003).to_str(0x0), QString("BEQ $0, $0, 0x10"));
+    QCOMPARE(Instruction(0x1000ffff).to_str(0x100), QString("BEQ $0, $0, 0x100"));
+    QCOMPARE(Instruction(0x08000100).to_str(0x10000000), QString("J  0x10000400"));
+
+    Instruction::set_symbolic_registers(true);
+    QCOMPARE(Instruction(0x10850003).to_str(0x0), QString("BEQ $a0, $a1, 0x10"));
+    Instruction::set_symbolic_registers(false);
+    QCOMPARE(Instruction(0x10850003).to_str(0x0), QString("BEQ $4, $5, 0x10"));
+}
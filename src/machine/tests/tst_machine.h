@@ -63,6 +63,7 @@ private Q_SLOTS:
     // Instruction
     void instruction();
     void instruction_access();
+    void instruction_to_str();
     // Alu
     void alu();
     void alu_data();
@@ -75,6 +76,8 @@ private Q_SLOTS:
     void singlecore_regs_data();
     void pipecore_regs();
     void pipecore_regs_data();
+    void dualcore_regs();
+    void dualcore_regs_data();
     void singlecore_jmp();
     void singlecore_jmp_data();
     void pipecore_jmp();
@@ -89,19 +92,44 @@ private Q_SLOTS:
     void pipecore_alu_forward_data();
     void pipecorestall_alu_forward();
     void pipecorestall_alu_forward_data();
+    void core_switch();
+    void core_switch_data();
+    void core_run();
+    void core_run_data();
+    void bbv_simpoint();
+    void core_sampling();
+    void pipecore_skip_stall();
+    void pipecore_skip_stall_data();
+    void core_count_compare_event();
+    void core_idle_skip();
+    void core_hle();
+    void core_perf_counter();
+    void cpi_stack();
+    void pipe_trace();
+    void pipecore_mdu_latency();
+    void dualcore_issue();
+    void branch_predictor_history();
+    void btb_ras();
     void singlecore_memory_tests_data();
     void pipecore_nc_memory_tests_data();
     void pipecore_wt_na_memory_tests_data();
     void pipecore_wt_a_memory_tests_data();
     void pipecore_wb_memory_tests_data();
+    void dualcore_memory_tests_data();
     void singlecore_memory_tests();
     void pipecore_nc_memory_tests();
     void pipecore_wt_na_memory_tests();
     void pipecore_wt_a_memory_tests();
     void pipecore_wb_memory_tests();
+    void dualcore_memory_tests();
     // Cache
     void cache_data();
     void cache();
+    void cache_prefetch_data();
+    void cache_prefetch();
+    void cache_hierarchy();
+    void dram_controller();
+    void cache_write_buffer();
 };
 
 #endif // TST_MACHINE_H
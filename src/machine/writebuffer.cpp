@@ -0,0 +1,171 @@
+#include "writebuffer.h"
+#include "qtmipsexception.h"
+
+#include <algorithm>
+
+using namespace machine;
+
+WriteBuffer::WriteBuffer(unsigned entries, unsigned line_words, MachineConfigCache::WriteBufferDrain drain) {
+    SANITY_ASSERT(entries > 0 && line_words > 0, "Write buffer needs at least one entry of one word");
+    this->capacity = entries;
+    this->line_words = line_words;
+    this->drain = drain;
+    reset();
+}
+
+WriteBuffer *WriteBuffer::create(const MachineConfigCache &cc) {
+    if (!cc.enabled() || cc.write_buffer_entries() == 0 ||
+            cc.write_policy() != MachineConfigCache::WritePolicy::WP_THROUGH)
+        return nullptr;
+    return new WriteBuffer(cc.write_buffer_entries(), cc.blocks(), cc.write_buffer_drain());
+}
+
+std::uint32_t WriteBuffer::store(std::uint32_t address, std::uint64_t now, std::uint32_t drain_cycles,
+                                 bool &combined) {
+    std::uint32_t base = line_base(address);
+    std::uint32_t stall = 0;
+    Entry e;
+
+    advance(now);
+    store_cnt++;
+    // Entry which is being written cannot take more data
+    for (int i = head_draining ? 1 : 0; i < fifo.size(); i++) {
+        if (fifo[i].base == base) {
+            fifo[i].words.setBit((address - base) / 4);
+            combined_cnt++;
+            combined = true;
+            return 0;
+        }
+    }
+    combined = false;
+
+    if ((unsigned)fifo.size() >= capacity) {
+        if (!head_draining)
+            start_drain(std::max(now, fifo.last().enqueued));
+        stall = head_done - now;
+        full_cnt++;
+        full_cycles += stall;
+        pop_head();
+    }
+
+    e.base = base;
+    e.words = QBitArray(line_words);
+    e.words.setBit((address - base) / 4);
+    e.enqueued = now + stall;
+    e.cost = drain_cycles;
+    fifo.append(e);
+    return stall;
+}
+
+std::uint32_t WriteBuffer::load(std::uint32_t address, std::uint64_t now, bool &forwarded) {
+    std::uint32_t base = line_base(address);
+    std::uint64_t done = now;
+    int i;
+
+    forwarded = false;
+    advance(now);
+    for (i = fifo.size() - 1; i >= 0 && fifo[i].base != base; i--)
+        ;
+    if (i < 0)
+        return 0;
+    if (fifo[i].words.count(true) == fifo[i].words.size()) {
+        forward_cnt++;
+        forwarded = true;
+        return 0;
+    }
+
+    // Entries leave in order, all older ones are written first
+    for (; i >= 0; i--) {
+        if (!head_draining)
+            start_drain(now);
+        done = head_done;
+        pop_head();
+    }
+    load_cycles += done - now;
+    return done - now;
+}
+
+void WriteBuffer::flush() {
+    fifo.clear();
+    head_draining = false;
+}
+
+void WriteBuffer::reset() {
+    flush();
+    head_done = 0;
+    port_free = 0;
+    store_cnt = 0;
+    combined_cnt = 0;
+    forward_cnt = 0;
+    full_cnt = 0;
+    full_cycles = 0;
+    load_cycles = 0;
+}
+
+unsigned WriteBuffer::entries() const {
+    return capacity;
+}
+
+unsigned WriteBuffer::occupancy() const {
+    return fifo.size();
+}
+
+std::uint64_t WriteBuffer::stores() const {
+    return store_cnt;
+}
+
+std::uint64_t WriteBuffer::combined() const {
+    return combined_cnt;
+}
+
+std::uint64_t WriteBuffer::forwarded() const {
+    return forward_cnt;
+}
+
+std::uint64_t WriteBuffer::full_stalls() const {
+    return full_cnt;
+}
+
+std::uint64_t WriteBuffer::full_stall_cycles() const {
+    return full_cycles;
+}
+
+std::uint64_t WriteBuffer::load_stall_cycles() const {
+    return load_cycles;
+}
+
+std::uint32_t WriteBuffer::line_base(std::uint32_t address) const {
+    return address - address % (line_words * 4);
+}
+
+// Oldest entry starts to drain once the lower level is free and not before
+// the earliest cycle given
+void WriteBuffer::start_drain(std::uint64_t earliest) {
+    std::uint64_t start = std::max(port_free, std::max(earliest, fifo.first().enqueued));
+    head_done = start + fifo.first().cost;
+    head_draining = true;
+}
+
+void WriteBuffer::pop_head() {
+    port_free = head_done;
+    fifo.removeFirst();
+    head_draining = false;
+}
+
+void WriteBuffer::advance(std::uint64_t now) {
+    while (!fifo.isEmpty()) {
+        if (!head_draining) {
+            // Lazy buffer keeps entries for combining until it fills up
+            if (drain == MachineConfigCache::WB_DRAIN_FULL) {
+                if ((unsigned)fifo.size() < capacity)
+                    return;
+                start_drain(fifo.last().enqueued);
+            } else {
+                start_drain(0);
+            }
+        }
+        if (head_done > now)
+            return;
+        pop_head();
+    }
+}
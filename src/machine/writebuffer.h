@@ -0,0 +1,71 @@
+#ifndef WRITEBUFFER_H
+#define WRITEBUFFER_H
+
+#include <QVector>
+#include <QBitArray>
+#include <cstdint>
+#include "machineconfig.h"
+
+namespace machine {
+
+// Write buffer between write through cache and its lower level. Stores still
+// reach the lower level at once, the buffer models only the time the lower
+// level needs for them. Entries hold one line and drain in order, one at a
+// time, each taking write access time of the lower level. Store to a line
+// waiting in the buffer is combined into its entry. Store which finds the
+// buffer full waits until the oldest entry is written. Loads bypass buffered
+// stores to other lines. Load of a line waiting in the buffer waits until its
+// entry drains, unless the entry holds the whole line which is forwarded and
+// then the line is filled without lower level read.
+class WriteBuffer {
+public:
+    WriteBuffer(unsigned entries, unsigned line_words, MachineConfigCache::WriteBufferDrain drain);
+
+    // Null if cache is not write through or has no buffer
+    static WriteBuffer *create(const MachineConfigCache &cc);
+
+    // Store at cycle now which takes drain_cycles in lower level. Returns cycles
+    // it waits for free entry. Combined is set when it joins an existing entry.
+    std::uint32_t store(std::uint32_t address, std::uint64_t now, std::uint32_t drain_cycles, bool &combined);
+    // Returns cycles the load of line with address waits for buffered store.
+    // Forwarded is set when whole line is taken from the buffer.
+    std::uint32_t load(std::uint32_t address, std::uint64_t now, bool &forwarded);
+    void flush(); // All entries are written at once
+    void reset();
+
+    unsigned entries() const;
+    unsigned occupancy() const;
+    std::uint64_t stores() const; // Stores passed through the buffer.
+    std::uint64_t combined() const; // Stores merged to existing entry.
+    std::uint64_t forwarded() const; // Loads served by whole line entry.
+    std::uint64_t full_stalls() const; // Stores which found buffer full.
+    std::uint64_t full_stall_cycles() const;
+    std::uint64_t load_stall_cycles() const; // Loads waiting for entry of their line.
+
+private:
+    struct Entry {
+        std::uint32_t base;
+        QBitArray words; // Words written by combined stores
+        std::uint64_t enqueued;
+        std::uint32_t cost;
+    };
+
+    unsigned capacity;
+    unsigned line_words;
+    MachineConfigCache::WriteBufferDrain drain;
+    QVector<Entry> fifo;
+    bool head_draining;
+    std::uint64_t head_done; // Cycle when oldest entry is written
+    std::uint64_t port_free; // Cycle when lower level finished last entry
+    std::uint64_t store_cnt, combined_cnt, forward_cnt;
+    std::uint64_t full_cnt, full_cycles, load_cycles;
+
+    std::uint32_t line_base(std::uint32_t address) const;
+    void start_drain(std::uint64_t earliest);
+    void pop_head();
+    void advance(std::uint64_t now);
+};
+
+}
+
+#endif // WRITEBUFFER_H
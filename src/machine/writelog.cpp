@@ -0,0 +1,58 @@
+#include "writelog.h"
+
+using namespace machine;
+
+// Number of most recent entries checked for merge with new range.
+#define MERGE_WINDOW 4
+
+WriteLog::WriteLog(int capacity) : entries(capacity) {
+    this->head = 0;
+    this->count = 0;
+    this->dropped_stamp = 0;
+}
+
+void WriteLog::record(std::uint32_t start, std::uint32_t last, std::uint32_t stamp) {
+    int i = count;
+    int stop = i > MERGE_WINDOW ? i - MERGE_WINDOW : 0;
+
+    // Programs tend to write same or neighbouring words repeatedly (stack,
+    // loop counters, arrays) so try to extend one of the recent ranges first.
+    while (i-- > stop) {
+        Entry &e = at(i);
+        if (start <= e.last + 4 && last + 4 >= e.start) {
+            if (start < e.start)
+                e.start = start;
+            if (last > e.last)
+                e.last = last;
+            e.stamp = stamp;
+            return;
+        }
+    }
+
+    // Oldest entry is overwritten in place, nothing is moved
+    if (count >= entries.size()) {
+        if (newer(at(0).stamp, dropped_stamp))
+            dropped_stamp = at(0).stamp;
+        head = (head + 1) % entries.size();
+        count--;
+    }
+    at(count) = {start, last, stamp};
+    count++;
+}
+
+void WriteLog::invalidate(std::uint32_t stamp) {
+    head = 0;
+    count = 0;
+    dropped_stamp = stamp;
+}
+
+bool WriteLog::ranges_since(std::uint32_t stamp, QVector<Range> &ranges) const {
+    if (newer(dropped_stamp, stamp))
+        return false;
+    for (int i = 0; i < count; i++) {
+        const Entry &e = at(i);
+        if (newer(e.stamp, stamp))
+            ranges.append({e.start, e.last});
+    }
+    return true;
+}
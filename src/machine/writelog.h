@@ -0,0 +1,52 @@
+#ifndef WRITELOG_H
+#define WRITELOG_H
+
+#include <cstdint>
+#include <QVector>
+
+namespace machine {
+
+// Bounded log of address ranges changed in a memory access object.
+// Every record is stamped with the change counter of the owner, so
+// each reader can ask for the ranges changed since the counter value
+// it has seen last. When the log overflows the oldest ranges are
+// dropped and readers older than that fall back to a full refresh.
+class WriteLog {
+public:
+    struct Range {
+        std::uint32_t start;
+        std::uint32_t last;
+    };
+
+    explicit WriteLog(int capacity = 256);
+
+    void record(std::uint32_t start, std::uint32_t last, std::uint32_t stamp);
+    // Forget all ranges. Readers with older stamp have to refresh everything.
+    void invalidate(std::uint32_t stamp);
+    // Appends ranges changed after given stamp. Returns false when the
+    // log does not cover all changes since then.
+    bool ranges_since(std::uint32_t stamp, QVector<Range> &ranges) const;
+
+private:
+    struct Entry {
+        std::uint32_t start;
+        std::uint32_t last;
+        std::uint32_t stamp;
+    };
+
+    static bool newer(std::uint32_t stamp, std::uint32_t than) {
+        return (std::int32_t)(stamp - than) > 0;
+    }
+
+    Entry &at(int i) { return entries[(head + i) % entries.size()]; }
+    const Entry &at(int i) const { return entries[(head + i) % entries.size()]; }
+
+    QVector<Entry> entries; // Ring buffer, count entries from head are valid
+    int head;
+    int count;
+    std::uint32_t dropped_stamp;
+};
+
+}
+
+#endif // WRITELOG_H
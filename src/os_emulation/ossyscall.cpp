@@ -1029,7 +1029,7 @@ bool OsSyscallExceptionHandler::handle_exception(Core *core, Registers *regs,
     status = (this->*sdesc->handler)(result, core, syscall_num,
                                       a1, a2, a3, a4, a5, a6, a7, a8);
     if (known_syscall_stop)
-        emit core->stop_on_exception_reached();
+        core->request_stop_on_exception();
 
     regs->write_gp(7, status);
     if (status < 0)
@@ -1215,7 +1215,7 @@ int OsSyscallExceptionHandler::syscall_default_handler(std::uint32_t &result, Co
     (void)a1; (void)a2; (void)a3; (void)a4; (void)a5; (void)a6; (void)a7; (void)a8;
     result = 0;
     if (unknown_syscall_stop)
-        emit core->stop_on_exception_reached();
+        core->request_stop_on_exception();
     return TARGET_ENOSYS;
 }
 
@@ -1232,7 +1232,8 @@ int OsSyscallExceptionHandler::do_sys_exit(std::uint32_t &result, Core *core,
     int status = a1;
 
     printf("sys_exit status %d\n", status);
-        emit core->stop_on_exception_reached();
+    emit program_exit(status);
+        core->request_stop_on_exception();
 
     return 0;
 }
@@ -89,6 +89,7 @@ public:
 signals:
     void char_written(int fd, unsigned int val);
     void rx_byte_pool(int fd, unsigned int &data, bool &available);
+    void program_exit(int status); // Emitted before stop is requested
 private:
     enum FdMapping {
         FD_UNUSED = -1,